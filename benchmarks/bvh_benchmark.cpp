@@ -0,0 +1,175 @@
+// Measures building, refitting, editing and querying the scene BVH over randomly placed boxes.
+// Usage: BvhBenchmark [--objects N] [--iterations N]
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "../renderer/bvh.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    struct BenchmarkOptions
+    {
+        uint32_t objectCount = 1 << 18;
+        uint32_t iterations  = 20;
+    };
+
+    BenchmarkOptions parseOptions(int argc, char* argv[])
+    {
+        BenchmarkOptions options;
+
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+
+            if (arg == "--objects" && i + 1 < argc)
+            {
+                options.objectCount = std::max(1, std::stoi(argv[++i]));
+            }
+            else if (arg == "--iterations" && i + 1 < argc)
+            {
+                options.iterations = std::max(1, std::stoi(argv[++i]));
+            }
+            else
+            {
+                throw std::invalid_argument("unknown or incomplete option: " + arg);
+            }
+        }
+
+        return options;
+    }
+
+    // Best time of all iterations in milliseconds; the best run is the one least disturbed by the system.
+    template <typename Function>
+    double bestTime(uint32_t iterations, Function function)
+    {
+        double best = 0.0;
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            function();
+            double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            best        = i == 0 ? time : std::min(best, time);
+        }
+        return best;
+    }
+
+    std::optional<float> intersectBox(const Aabb& box, const Ray& ray, float maxDistance)
+    {
+        glm::vec3 inverse = 1.0f / ray.direction;
+        glm::vec3 t0      = (box.min - ray.origin) * inverse;
+        glm::vec3 t1      = (box.max - ray.origin) * inverse;
+        glm::vec3 near    = glm::min(t0, t1);
+        glm::vec3 far     = glm::max(t0, t1);
+
+        float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+        float exit  = std::min(std::min(far.x, far.y), std::min(far.z, maxDistance));
+        return enter <= exit ? std::optional<float>(enter) : std::nullopt;
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        BenchmarkOptions options = parseOptions(argc, argv);
+
+        std::mt19937                          random(1);
+        std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+        std::uniform_real_distribution<float> size(0.25f, 1.0f);
+        std::uniform_real_distribution<float> motion(-0.05f, 0.05f);
+
+        std::vector<Aabb> boxes(options.objectCount);
+        for (Aabb& box : boxes)
+        {
+            glm::vec3 center(position(random), position(random), position(random));
+            glm::vec3 extent(size(random), size(random), size(random));
+            box = {center - extent, center + extent};
+        }
+
+        Bvh    bvh;
+        double buildTime = bestTime(options.iterations, [&] { bvh.build(boxes); });
+
+        // Every object drifts a little, as a frame of coherent motion would move them.
+        for (uint32_t i = 0; i < options.objectCount; i++)
+        {
+            glm::vec3 offset(motion(random), motion(random), motion(random));
+            boxes[i] = {boxes[i].min + offset, boxes[i].max + offset};
+            bvh.setBounds(i, boxes[i]);
+        }
+        double refitTime = bestTime(options.iterations, [&] { bvh.refit(); });
+
+        glm::mat4 view = glm::lookAt(glm::vec3(150.0f, 0.0f, 0.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        glm::mat4 proj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 400.0f);
+
+        FrustumPlanes         planes = extractFrustumPlanes(proj * view);
+        std::vector<uint32_t> visible;
+
+        double cullTime = bestTime(options.iterations, [&] { bvh.cullFrustum(planes, visible); });
+
+        constexpr uint32_t rayCount = 10000;
+        std::vector<Ray>   rays(rayCount);
+        for (Ray& ray : rays)
+        {
+            ray.origin    = glm::vec3(150.0f, 0.0f, 0.0f);
+            ray.direction = glm::vec3(position(random), position(random), position(random)) - ray.origin;
+        }
+
+        uint32_t hits    = 0;
+        double   rayTime = bestTime(
+            options.iterations,
+            [&]
+            {
+                hits = 0;
+                for (const Ray& ray : rays)
+                {
+                    auto hit = bvh.intersect(
+                        ray,
+                        FLT_MAX,
+                        [&](uint32_t primitive, const Ray& r, float maxDistance)
+                        { return intersectBox(boxes[primitive], r, maxDistance); });
+                    hits += hit.has_value();
+                }
+            });
+
+        // One percent of the objects leave the tree and come back elsewhere, e.g. streamed out and in.
+        uint32_t editCount = std::max(1u, options.objectCount / 100);
+        auto     editStart = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < editCount; i++)
+        {
+            bvh.remove(i);
+        }
+        for (uint32_t i = 0; i < editCount; i++)
+        {
+            glm::vec3 center(position(random), position(random), position(random));
+            boxes[i] = {center - glm::vec3(0.5f), center + glm::vec3(0.5f)};
+            bvh.insert(i, boxes[i]);
+        }
+        double editTime =
+            std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - editStart).count();
+
+        std::cout << "[BENCHMARK] \tBVH over " << options.objectCount << " objects, " << bvh.nodeCount()
+                  << " nodes: build " << buildTime << " ms, refit " << refitTime << " ms" << std::endl;
+        std::cout << "[BENCHMARK] \tfrustum query " << cullTime << " ms (" << visible.size() << " visible); "
+                  << rayCount / rayTime / 1e3 << " M rays/s (" << hits << " hits); insert + remove "
+                  << editTime / (2 * editCount) << " us per edit" << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+// Compares a benchmark report written with --benchmark-json, or by a Google Benchmark executable, against a stored
+// baseline and fails when any time regressed. Usage: BenchmarkCompare <baseline.json> <current.json> [--threshold
+// PERCENT]
+#include "../renderer/benchmark_report.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    struct CompareOptions
+    {
+        std::string baselinePath;
+        std::string currentPath;
+        // Allowed growth before a statistic counts as a regression, in percent of the baseline.
+        double threshold = 5.0;
+    };
+
+    CompareOptions parseOptions(int argc, char* argv[])
+    {
+        CompareOptions           options;
+        std::vector<std::string> paths;
+
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+
+            if (arg == "--threshold" && i + 1 < argc)
+            {
+                options.threshold = std::max(0.0, std::stod(argv[++i]));
+            }
+            else if (!arg.empty() && arg[0] != '-')
+            {
+                paths.push_back(arg);
+            }
+            else
+            {
+                throw std::invalid_argument("unknown or incomplete option: " + arg);
+            }
+        }
+
+        if (paths.size() != 2)
+        {
+            throw std::invalid_argument("usage: BenchmarkCompare <baseline.json> <current.json> [--threshold PERCENT]");
+        }
+
+        options.baselinePath = paths[0];
+        options.currentPath  = paths[1];
+        return options;
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        CompareOptions  options  = parseOptions(argc, argv);
+        BenchmarkReport baseline = BenchmarkReport::readJson(options.baselinePath);
+        BenchmarkReport current  = BenchmarkReport::readJson(options.currentPath);
+
+        for (const std::string& difference : configDifferences(baseline, current))
+        {
+            std::cout << "[COMPARE] \twarning: runs differ in " << difference << std::endl;
+        }
+
+        std::vector<BenchmarkRegression> regressions = findRegressions(baseline, current, options.threshold / 100.0);
+        for (const BenchmarkRegression& regression : regressions)
+        {
+            std::cout << "[COMPARE] \tregression: " << regression.metric << " " << regression.statistic << " "
+                      << regression.baseline << " -> " << regression.current << " ms (+"
+                      << (regression.current / regression.baseline - 1.0) * 100.0 << "%)" << std::endl;
+        }
+
+        std::cout << "[COMPARE] \t" << regressions.size() << " regressions beyond " << options.threshold << "%"
+                  << std::endl;
+        return regressions.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,134 @@
+// Measures assigning point lights to the cluster grid at growing light counts, the CPU side of clustered shading's
+// cost per frame. Usage: LightClusteringBenchmark [--lights N] [--iterations N]
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "../renderer/frame_arena.h"
+#include "../renderer/light_clusters.h"
+#include "../renderer/simd.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    struct BenchmarkOptions
+    {
+        uint32_t maxLights  = 1 << 16;
+        uint32_t iterations = 50;
+    };
+
+    BenchmarkOptions parseOptions(int argc, char* argv[])
+    {
+        BenchmarkOptions options;
+
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+
+            if (arg == "--lights" && i + 1 < argc)
+            {
+                options.maxLights = std::max(1, std::stoi(argv[++i]));
+            }
+            else if (arg == "--iterations" && i + 1 < argc)
+            {
+                options.iterations = std::max(1, std::stoi(argv[++i]));
+            }
+            else
+            {
+                throw std::invalid_argument("unknown or incomplete option: " + arg);
+            }
+        }
+
+        return options;
+    }
+
+    // Best time of all iterations in milliseconds; the best run is the one least disturbed by the system.
+    template <typename Function>
+    double bestTime(uint32_t iterations, Function function)
+    {
+        double best = 0.0;
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            function();
+            double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            best        = i == 0 ? time : std::min(best, time);
+        }
+        return best;
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        BenchmarkOptions options = parseOptions(argc, argv);
+
+        // Lights scattered through a cube the camera looks into from outside, so some fall outside the view and the
+        // rest land at every depth.
+        std::mt19937                          random(1);
+        std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+        std::uniform_real_distribution<float> radius(2.0f, 8.0f);
+
+        BoundingSpheres allLights;
+        for (uint32_t i = 0; i < options.maxLights; i++)
+        {
+            allLights.push_back(glm::vec4(position(random), position(random), position(random), radius(random)));
+        }
+
+        glm::mat4 view = glm::lookAt(glm::vec3(150.0f, 0.0f, 0.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        glm::mat4 proj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 400.0f);
+        proj[1][1] *= -1;
+
+        LightClusters clusters;
+        clusters.setProjection(proj, 0.1f, 400.0f);
+
+        // As in the viewer, each assignment gathers its pairs in an arena that is reset before the next.
+        FrameArena arena(size_t(64) << 20);
+
+        std::vector<uint32_t> lightCounts;
+        for (uint32_t count = 256; count < options.maxLights; count *= 4)
+        {
+            lightCounts.push_back(count);
+        }
+        lightCounts.push_back(options.maxLights);
+
+        for (uint32_t count : lightCounts)
+        {
+            BoundingSpheres lights;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                lights.push_back(glm::vec4(allLights.x[i], allLights.y[i], allLights.z[i], allLights.radius[i]));
+            }
+
+            size_t written = 0;
+            double time    = bestTime(
+                options.iterations,
+                [&]
+                {
+                    arena.reset();
+                    written = clusters.assign(lights, view, SIZE_MAX, &arena);
+                });
+
+            std::cout << "[BENCHMARK] \t" << simdInstructionSet() << ", " << count << " lights: " << time
+                      << " ms per assignment, " << written << " light indices ("
+                      << static_cast<double>(written) / LightClusters::clusterCount << " per cluster)" << std::endl;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,483 @@
+// Google Benchmark microbenchmarks of the renderer's CPU paths: OBJ and glTF ingest, asset reads from loose files
+// and from an archive, vertex deduplication, mip filtering, memory type lookup, culling and the per-frame matrix
+// update. Usage: RendererBenchmarks [--benchmark_filter=REGEX] [--benchmark_out=FILE --benchmark_out_format=json];
+// BenchmarkCompare compares two such JSON files.
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "../renderer/asset_archive.h"
+#include "../renderer/async_file_reader.h"
+#include "../renderer/camera.h"
+#include "../renderer/frustum_culling.h"
+#include "../renderer/gltf.h"
+#include "../renderer/memory_types.h"
+#include "../renderer/mesh.h"
+#include "../renderer/texture.h"
+#include "../renderer/texture_streaming.h"
+
+#include <benchmark/benchmark.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifndef REPO_HOME
+#define REPO_HOME "./"
+#endif
+
+namespace {
+    const std::string MODEL_PATH = std::string(REPO_HOME) + "models/viking_room.obj";
+
+    // Loaded once: the dedupe benchmark starts from the model's triangle list rather than from the file.
+    const Mesh& viewerModel()
+    {
+        static const Mesh mesh = loadObjMesh(MODEL_PATH);
+        return mesh;
+    }
+
+    // The viewer model written out as a .glb. Interleaved, its vertices are stored exactly like Vertex and its indices
+    // are 32-bit, so loadGltfModel uses both in place; otherwise positions and texture coordinates are separate
+    // accessors, as most exporters write them, and get converted. Written once per layout.
+    const std::string& viewerModelGlb(bool interleaved)
+    {
+        static std::string paths[2];
+        std::string&       path = paths[interleaved];
+        if (!path.empty())
+        {
+            return path;
+        }
+
+        const Mesh&          mesh  = viewerModel();
+        std::string          count = std::to_string(mesh.vertices.size());
+        std::vector<uint8_t> binary;
+        auto                 append = [&binary](const void* data, size_t size) {
+            auto* bytes = static_cast<const uint8_t*>(data);
+            binary.insert(binary.end(), bytes, bytes + size);
+        };
+
+        glm::vec3 low  = mesh.vertices[0].pos;
+        glm::vec3 high = mesh.vertices[0].pos;
+        for (const Vertex& vertex : mesh.vertices)
+        {
+            low  = glm::min(low, vertex.pos);
+            high = glm::max(high, vertex.pos);
+        }
+        std::string bounds = ",\"min\":[" + std::to_string(low.x) + "," + std::to_string(low.y) + "," +
+                             std::to_string(low.z) + "],\"max\":[" + std::to_string(high.x) + "," +
+                             std::to_string(high.y) + "," + std::to_string(high.z) + "]";
+
+        std::string views;
+        std::string accessors;
+        std::string attributes;
+        if (interleaved)
+        {
+            append(mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+            views = "{\"buffer\":0,\"byteLength\":" + std::to_string(binary.size()) + ",\"byteStride\":" +
+                    std::to_string(sizeof(Vertex)) + "},";
+            accessors = "{\"bufferView\":0,\"componentType\":5126,\"count\":" + count + ",\"type\":\"VEC3\"" +
+                        bounds + "},{\"bufferView\":0,\"byteOffset\":" + std::to_string(offsetof(Vertex, color)) +
+                        ",\"componentType\":5126,\"count\":" + count + ",\"type\":\"VEC3\"},{\"bufferView\":0," +
+                        "\"byteOffset\":" + std::to_string(offsetof(Vertex, texCoord)) +
+                        ",\"componentType\":5126,\"count\":" + count + ",\"type\":\"VEC2\"},";
+            attributes = "\"POSITION\":0,\"COLOR_0\":1,\"TEXCOORD_0\":2";
+        }
+        else
+        {
+            for (const Vertex& vertex : mesh.vertices)
+            {
+                append(&vertex.pos, sizeof(vertex.pos));
+            }
+            size_t positionBytes = binary.size();
+            for (const Vertex& vertex : mesh.vertices)
+            {
+                append(&vertex.texCoord, sizeof(vertex.texCoord));
+            }
+            views = "{\"buffer\":0,\"byteLength\":" + std::to_string(positionBytes) + "},{\"buffer\":0," +
+                    "\"byteOffset\":" + std::to_string(positionBytes) +
+                    ",\"byteLength\":" + std::to_string(binary.size() - positionBytes) + "},";
+            accessors = "{\"bufferView\":0,\"componentType\":5126,\"count\":" + count + ",\"type\":\"VEC3\"" +
+                        bounds + "},{\"bufferView\":1,\"componentType\":5126,\"count\":" + count +
+                        ",\"type\":\"VEC2\"},";
+            attributes = "\"POSITION\":0,\"TEXCOORD_0\":1";
+        }
+
+        std::string indexView     = interleaved ? "1" : "2";
+        std::string indexAccessor = interleaved ? "3" : "2";
+        size_t      indexOffset   = binary.size();
+        append(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+        binary.resize((binary.size() + 3) & ~size_t(3), 0);
+
+        std::string json = "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}]," +
+                           std::string("\"nodes\":[{\"mesh\":0}],\"meshes\":[{\"primitives\":[{\"attributes\":{") +
+                           attributes + "},\"indices\":" + indexAccessor + "}]}],\"buffers\":[{\"byteLength\":" +
+                           std::to_string(binary.size()) + "}],\"bufferViews\":[" + views +
+                           "{\"buffer\":0,\"byteOffset\":" + std::to_string(indexOffset) + ",\"byteLength\":" +
+                           std::to_string(mesh.indices.size() * sizeof(uint32_t)) + "}],\"accessors\":[" + accessors +
+                           "{\"bufferView\":" + indexView + ",\"componentType\":5125,\"count\":" +
+                           std::to_string(mesh.indices.size()) + ",\"type\":\"SCALAR\"}]}";
+        json.resize((json.size() + 3) & ~size_t(3), ' ');
+
+        // The GLB header, then the JSON and binary chunks.
+        uint32_t header[] = {
+            0x46546C67u, 2u, static_cast<uint32_t>(12 + 8 + json.size() + 8 + binary.size()),
+            static_cast<uint32_t>(json.size()), 0x4E4F534Au};
+        uint32_t binaryHeader[] = {static_cast<uint32_t>(binary.size()), 0x004E4942u};
+
+        path = (std::filesystem::temp_directory_path() /
+                (interleaved ? "viewer_model_interleaved.glb" : "viewer_model_separate.glb"))
+                   .string();
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(json.data(), json.size());
+        file.write(reinterpret_cast<const char*>(binaryHeader), sizeof(binaryHeader));
+        file.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+        if (!file)
+        {
+            throw std::runtime_error("failed to write " + path + "!");
+        }
+        return path;
+    }
+
+    // What the viewer reads at startup, plus the second texture.
+    const std::vector<std::string> ARCHIVED_ASSETS = {
+        "models/viking_room.obj",
+        "textures/viking_room.png",
+        "textures/statue.jpg",
+    };
+
+    // ARCHIVED_ASSETS packed into a temporary archive once, compressed as AssetPacker does by default.
+    const std::string& assetArchive()
+    {
+        static const std::string path = []
+        {
+            std::vector<ArchiveInput> files;
+            for (const std::string& name : ARCHIVED_ASSETS)
+            {
+                files.push_back({name, std::string(REPO_HOME) + name});
+            }
+
+            std::string archive = (std::filesystem::temp_directory_path() / "renderer_benchmarks.vpak").string();
+            writeAssetArchive(archive, files, true);
+            return archive;
+        }();
+        return path;
+    }
+
+    // Drops a file's pages from the page cache, so the next read comes from the device. Only Linux lets an
+    // unprivileged process do that; elsewhere this returns false and cold runs are really warm.
+    bool evictFromPageCache(const std::string& path)
+    {
+#if defined(__linux__)
+        int file = open(path.c_str(), O_RDONLY);
+        if (file < 0)
+        {
+            return false;
+        }
+        // Dirty pages are not dropped, and the archive may have just been written.
+        fdatasync(file);
+        bool evicted = posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED) == 0;
+        close(file);
+        return evicted;
+#else
+        (void)path;
+        return false;
+#endif
+    }
+
+    std::string cacheLabel(bool cold, bool evicted)
+    {
+        return !cold ? "warm" : evicted ? "cold" : "cold, page cache not dropped";
+    }
+
+    // Volumes scattered through a cube the camera looks into from outside, as in CullingBenchmark.
+    const BoundingSpheres& scatteredSpheres(size_t count)
+    {
+        static BoundingSpheres spheres;
+        if (spheres.size() != count)
+        {
+            std::mt19937                          random(1);
+            std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+            std::uniform_real_distribution<float> size(0.5f, 2.0f);
+
+            spheres = {};
+            for (size_t i = 0; i < count; i++)
+            {
+                spheres.push_back(glm::vec4(position(random), position(random), position(random), size(random)));
+            }
+        }
+        return spheres;
+    }
+
+    FrustumPlanes benchmarkFrustum()
+    {
+        SceneView view = makeSceneView(0.0f, glm::vec3(150.0f, 0.0f, 0.0f), 16.0f / 9.0f, 200.0f);
+        return extractFrustumPlanes(view.proj * view.view);
+    }
+
+    void BM_LoadObjMesh(benchmark::State& state)
+    {
+        size_t corners = 0;
+        for (auto _ : state)
+        {
+            Mesh mesh = loadObjMesh(MODEL_PATH);
+            corners   = mesh.indices.size();
+            benchmark::DoNotOptimize(mesh.vertices.data());
+        }
+        state.SetItemsProcessed(state.iterations() * corners);
+    }
+    BENCHMARK(BM_LoadObjMesh)->Unit(benchmark::kMillisecond);
+
+    // The argument is whether the file's vertices are interleaved like Vertex; compare with BM_LoadObjMesh, which
+    // reads the same triangles.
+    void BM_LoadGltfModel(benchmark::State& state)
+    {
+        const std::string& path    = viewerModelGlb(state.range(0) != 0);
+        size_t             corners = 0;
+        for (auto _ : state)
+        {
+            Model model = loadGltfModel(path);
+            corners     = model.indices.size();
+            benchmark::DoNotOptimize(model.vertices.data());
+        }
+        state.SetItemsProcessed(state.iterations() * corners);
+        state.SetLabel(state.range(0) ? "mapped" : "converted");
+    }
+    BENCHMARK(BM_LoadGltfModel)->Arg(1)->Arg(0)->Unit(benchmark::kMillisecond);
+
+    // The argument is whether the page cache is dropped before every iteration. Reads ARCHIVED_ASSETS as the viewer
+    // does without --archive: each from its own file, one after the other.
+    void BM_ReadLooseAssets(benchmark::State& state)
+    {
+        bool   cold    = state.range(0) != 0;
+        bool   evicted = true;
+        size_t bytes   = 0;
+        for (auto _ : state)
+        {
+            if (cold)
+            {
+                state.PauseTiming();
+                for (const std::string& name : ARCHIVED_ASSETS)
+                {
+                    evicted = evictFromPageCache(std::string(REPO_HOME) + name) && evicted;
+                }
+                state.ResumeTiming();
+            }
+
+            bytes = 0;
+            for (const std::string& name : ARCHIVED_ASSETS)
+            {
+                std::ifstream     file(std::string(REPO_HOME) + name, std::ios::ate | std::ios::binary);
+                std::vector<char> contents(static_cast<size_t>(file.tellg()));
+                file.seekg(0);
+                file.read(contents.data(), contents.size());
+                bytes += contents.size();
+                benchmark::DoNotOptimize(contents.data());
+            }
+        }
+        state.SetBytesProcessed(state.iterations() * bytes);
+        state.SetLabel(cacheLabel(cold, evicted));
+    }
+    BENCHMARK(BM_ReadLooseAssets)->Arg(1)->Arg(0)->Unit(benchmark::kMillisecond);
+
+    // The argument is whether the page cache is dropped before every iteration. Opens the archive and reads the same
+    // assets out of it with every read in flight at once, decompressing the ones stored as LZ4.
+    void BM_ReadArchivedAssets(benchmark::State& state)
+    {
+        bool               cold    = state.range(0) != 0;
+        bool               evicted = true;
+        const std::string& path    = assetArchive();
+        AsyncFileReader    reader;
+        size_t             bytes = 0;
+        for (auto _ : state)
+        {
+            if (cold)
+            {
+                state.PauseTiming();
+                evicted = evictFromPageCache(path) && evicted;
+                state.ResumeTiming();
+            }
+
+            AssetArchive                      archive(path, reader);
+            std::vector<std::vector<uint8_t>> contents(archive.entries().size());
+            std::vector<ArchiveRead>          reads;
+            bytes = 0;
+            for (size_t i = 0; i < contents.size(); i++)
+            {
+                contents[i].resize(archive.entries()[i].size);
+                reads.push_back({&archive.entries()[i], contents[i].data()});
+                bytes += contents[i].size();
+            }
+            archive.read(reads);
+            benchmark::DoNotOptimize(contents.data());
+        }
+        state.SetBytesProcessed(state.iterations() * bytes);
+        state.SetLabel(std::string(reader.backend()) + ", " + cacheLabel(cold, evicted));
+    }
+    BENCHMARK(BM_ReadArchivedAssets)->Arg(1)->Arg(0)->Unit(benchmark::kMillisecond);
+
+    void BM_IndexVertices(benchmark::State& state)
+    {
+        const Mesh&         model = viewerModel();
+        std::vector<Vertex> corners;
+        corners.reserve(model.indices.size());
+        for (uint32_t index : model.indices)
+        {
+            corners.push_back(model.vertices[index]);
+        }
+
+        for (auto _ : state)
+        {
+            Mesh mesh = indexVertices(corners);
+            benchmark::DoNotOptimize(mesh.indices.data());
+        }
+        state.SetItemsProcessed(state.iterations() * corners.size());
+    }
+    BENCHMARK(BM_IndexVertices)->Unit(benchmark::kMillisecond);
+
+    // Arguments are the size of level 0 and whether it is sRGB.
+    void BM_GenerateMipChain(benchmark::State& state)
+    {
+        uint32_t size = static_cast<uint32_t>(state.range(0));
+        bool     srgb = state.range(1) != 0;
+
+        TextureData::Level base{size, size, std::vector<uint8_t>(size_t(size) * size * 4)};
+        std::mt19937       random(1);
+        for (uint8_t& value : base.pixels)
+        {
+            value = static_cast<uint8_t>(random());
+        }
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            TextureData texture;
+            texture.levels.push_back(base);
+            state.ResumeTiming();
+
+            generateMipChain(texture, srgb);
+            benchmark::DoNotOptimize(texture.levels.back().pixels.data());
+        }
+        state.SetBytesProcessed(state.iterations() * base.pixels.size());
+    }
+    BENCHMARK(BM_GenerateMipChain)->Args({1024, 1})->Args({1024, 0})->Args({4096, 1})->Unit(benchmark::kMillisecond);
+
+    // What a streamed texture filters before the first frame: its tail, levels no larger than 128 texels, from an
+    // sRGB level 0 of the given size. Stopping the worker that fills in the finer levels is not measured.
+    void BM_StreamedMipChainTail(benchmark::State& state)
+    {
+        uint32_t size = static_cast<uint32_t>(state.range(0));
+
+        TextureData::Level base{size, size, std::vector<uint8_t>(size_t(size) * size * 4)};
+        std::mt19937       random(1);
+        for (uint8_t& value : base.pixels)
+        {
+            value = static_cast<uint8_t>(random());
+        }
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            TextureData texture;
+            texture.levels.push_back(base);
+            state.ResumeTiming();
+
+            std::optional<StreamedMipChain> chain;
+            chain.emplace(std::move(texture), 128, true);
+            benchmark::DoNotOptimize(chain->texture().levels.back().pixels.data());
+
+            state.PauseTiming();
+            chain.reset();
+            state.ResumeTiming();
+        }
+        state.SetBytesProcessed(state.iterations() * base.pixels.size());
+    }
+    BENCHMARK(BM_StreamedMipChainTail)->Arg(1024)->Arg(4096)->Unit(benchmark::kMillisecond);
+
+    // A discrete GPU's usual heaps: device local, host visible and coherent, and host cached.
+    void BM_FindMemoryType(benchmark::State& state)
+    {
+        VkPhysicalDeviceMemoryProperties properties{};
+        VkMemoryPropertyFlags            types[] = {
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+                VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        };
+        for (VkMemoryPropertyFlags flags : types)
+        {
+            properties.memoryTypes[properties.memoryTypeCount++].propertyFlags = flags;
+        }
+
+        VkMemoryPropertyFlags wanted = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(findMemoryTypeIndex(properties, 0xFFFFFFFFu, wanted));
+        }
+    }
+    BENCHMARK(BM_FindMemoryType);
+
+    // The argument is the number of spheres.
+    void BM_CullSpheres(benchmark::State& state)
+    {
+        const BoundingSpheres& spheres = scatteredSpheres(static_cast<size_t>(state.range(0)));
+        FrustumPlanes          planes  = benchmarkFrustum();
+        std::vector<uint32_t>  visible(spheres.size());
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(cullSpheres(planes, spheres, 0, spheres.size(), visible.data()));
+        }
+        state.SetItemsProcessed(state.iterations() * spheres.size());
+        state.SetLabel(cullingInstructionSet());
+    }
+    BENCHMARK(BM_CullSpheres)->Arg(1 << 14)->Arg(1 << 20);
+
+    // Arguments are the number of spheres and of threads.
+    void BM_FrustumCuller(benchmark::State& state)
+    {
+        const BoundingSpheres& spheres = scatteredSpheres(static_cast<size_t>(state.range(0)));
+        FrustumPlanes          planes  = benchmarkFrustum();
+        ThreadPool             pool(static_cast<uint32_t>(state.range(1)) - 1);
+        FrustumCuller          culler(pool);
+        std::vector<uint32_t>  visible;
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(culler.cull(planes, spheres, visible));
+        }
+        state.SetItemsProcessed(state.iterations() * spheres.size());
+    }
+    BENCHMARK(BM_FrustumCuller)
+        ->Args({1 << 20, 1})
+        ->Args({1 << 20, std::max(2u, std::thread::hardware_concurrency())})
+        ->UseRealTime();
+
+    // What updateUniformBuffer() and the CPU culling pass compute every frame.
+    void BM_SceneMatrices(benchmark::State& state)
+    {
+        float time = 0.0f;
+        for (auto _ : state)
+        {
+            glm::vec3 eye  = scriptedCameraPosition(glm::vec3(2.0f, 2.0f, 2.0f), time, 20.0f);
+            SceneView view = makeSceneView(time, eye, 16.0f / 9.0f, 2.0f);
+            benchmark::DoNotOptimize(extractFrustumPlanes(view.proj * view.view));
+            time += 1.0f / 60.0f;
+        }
+    }
+    BENCHMARK(BM_SceneMatrices);
+} // namespace
@@ -1,21 +1,97 @@
 find_package(Vulkan COMPONENTS glslc)
 find_program(glslc_executable NAMES glslc HINTS Vulkan::glslc)
+find_program(spirv_opt_executable NAMES spirv-opt HINTS ENV VULKAN_SDK PATH_SUFFIXES bin)
 
+# compile_shader(<target> [EMBED] [ENV <env>] [FORMAT <format>] [OPTIMIZE NONE|PERFORMANCE|SIZE] SOURCES <files>...)
+#
+# EMBED additionally generates <source>.h in the binary directory holding the SPIR-V as a constexpr uint32_t array
+# named after the source path (shaders/vertex.vert -> shaders_vertex_vert), and adds the binary directory to the
+# target's include path. It requires FORMAT bin.
+#
+# OPTIMIZE selects the glslc optimization level (-O0, -O or -Os), NONE by default. Debug configurations keep
+# source-level debug info (-g); other configurations strip it with spirv-opt when the tool is available.
 function(compile_shader target)
-    cmake_parse_arguments(PARSE_ARGV 1 arg "" "ENV;FORMAT" "SOURCES")
+    cmake_parse_arguments(PARSE_ARGV 1 arg "EMBED" "ENV;FORMAT;OPTIMIZE" "SOURCES")
+
+    if(arg_EMBED AND NOT arg_FORMAT STREQUAL "bin")
+        message(FATAL_ERROR "compile_shader: EMBED requires FORMAT bin")
+    endif()
+
+    if(NOT arg_OPTIMIZE OR arg_OPTIMIZE STREQUAL "NONE")
+        set(optimize_flag -O0)
+    elseif(arg_OPTIMIZE STREQUAL "PERFORMANCE")
+        set(optimize_flag -O)
+    elseif(arg_OPTIMIZE STREQUAL "SIZE")
+        set(optimize_flag -Os)
+    else()
+        message(FATAL_ERROR "compile_shader: unknown OPTIMIZE mode ${arg_OPTIMIZE}")
+    endif()
+
+    # spirv-opt only understands binary modules; text formats are written straight from glslc.
+    set(strip_debug OFF)
+    if(spirv_opt_executable AND (NOT arg_FORMAT OR arg_FORMAT STREQUAL "bin"))
+        set(strip_debug ON)
+    elseif(NOT spirv_opt_executable)
+        message(STATUS "compile_shader: spirv-opt not found, SPIR-V debug info is not stripped for ${target}")
+    endif()
+
     foreach(source ${arg_SOURCES})
+        get_filename_component(source_directory ${source} DIRECTORY)
+        file(MAKE_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR}/${source_directory})
+
+        if(strip_debug)
+            set(glslc_output ${source}.unstripped.${arg_FORMAT})
+            set(glslc_byproducts BYPRODUCTS ${glslc_output})
+            set(strip_command
+                COMMAND
+                    ${spirv_opt_executable}
+                    $<$<NOT:$<CONFIG:Debug>>:--strip-debug>
+                    ${glslc_output}
+                    -o ${source}.${arg_FORMAT})
+        else()
+            set(glslc_output ${source}.${arg_FORMAT})
+            set(glslc_byproducts)
+            set(strip_command)
+        endif()
+
         add_custom_command(
             OUTPUT ${source}.${arg_FORMAT}
+            ${glslc_byproducts}
             DEPENDS ${source}
             DEPFILE ${source}.d
             COMMAND
                 ${glslc_executable}
                 $<$<BOOL:${arg_ENV}>:--target-env=${arg_ENV}>
                 $<$<BOOL:${arg_FORMAT}>:-mfmt=${arg_FORMAT}>
+                ${optimize_flag}
+                $<$<CONFIG:Debug>:-g>
                 -MD -MF ${source}.d
-                -o ${source}.${arg_FORMAT}
+                -MT ${source}.${arg_FORMAT}
+                -o ${glslc_output}
                 ${CMAKE_CURRENT_SOURCE_DIR}/${source}
+            ${strip_command}
         )
         target_sources(${target} PRIVATE ${source}.${arg_FORMAT})
+
+        if(arg_EMBED)
+            string(MAKE_C_IDENTIFIER ${source} symbol)
+            add_custom_command(
+                OUTPUT ${source}.h
+                DEPENDS
+                    ${CMAKE_CURRENT_BINARY_DIR}/${source}.${arg_FORMAT}
+                    ${CMAKE_CURRENT_FUNCTION_LIST_DIR}/spirv_to_header.cmake
+                COMMAND
+                    ${CMAKE_COMMAND}
+                    -DINPUT=${CMAKE_CURRENT_BINARY_DIR}/${source}.${arg_FORMAT}
+                    -DOUTPUT=${CMAKE_CURRENT_BINARY_DIR}/${source}.h
+                    -DSYMBOL=${symbol}
+                    -P ${CMAKE_CURRENT_FUNCTION_LIST_DIR}/spirv_to_header.cmake
+            )
+            target_sources(${target} PRIVATE ${source}.h)
+        endif()
     endforeach()
-endfunction()
\ No newline at end of file
+
+    if(arg_EMBED)
+        target_include_directories(${target} PRIVATE ${CMAKE_CURRENT_BINARY_DIR})
+    endif()
+endfunction()
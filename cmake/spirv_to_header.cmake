@@ -0,0 +1,37 @@
+# Converts a SPIR-V binary into a C++ header exposing the module as a constexpr uint32_t array.
+#
+# Usage: cmake -DINPUT=<module.bin> -DOUTPUT=<module.h> -DSYMBOL=<identifier> -P spirv_to_header.cmake
+
+foreach(required INPUT OUTPUT SYMBOL)
+    if(NOT DEFINED ${required})
+        message(FATAL_ERROR "spirv_to_header: ${required} must be defined")
+    endif()
+endforeach()
+
+file(READ ${INPUT} spirv HEX)
+string(LENGTH "${spirv}" spirv_length)
+math(EXPR spirv_remainder "${spirv_length} % 8")
+if(spirv_length EQUAL 0 OR NOT spirv_remainder EQUAL 0)
+    message(FATAL_ERROR "spirv_to_header: ${INPUT} is not a SPIR-V module")
+endif()
+
+# SPIR-V is a stream of little-endian 32-bit words, so every group of four bytes is swapped into one literal.
+string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1," words "${spirv}")
+string(REPEAT "0x[0-9a-f]+," 8 line_pattern)
+string(REGEX REPLACE "(${line_pattern})" "\\1\n    " words "${words}")
+string(REPLACE ",0x" ", 0x" words "${words}")
+string(STRIP "${words}" words)
+
+math(EXPR spirv_bytes "${spirv_length} / 2")
+message(STATUS "${SYMBOL}: ${spirv_bytes} bytes of SPIR-V")
+
+file(WRITE ${OUTPUT}
+"// Generated from ${INPUT} by spirv_to_header.cmake. Do not edit.
+#pragma once
+
+#include <cstdint>
+
+inline constexpr uint32_t ${SYMBOL}[] = {
+    ${words}
+};
+")
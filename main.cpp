@@ -1,51 +1,140 @@
 #define GLFW_INCLUDE_VULKAN
-#define STB_IMAGE_IMPLEMENTATION
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
-#define TINYOBJLOADER_IMPLEMENTATION
-#define GLM_ENABLE_EXPERIMENTAL
+#include "renderer/asset_archive.h"
+#include "renderer/async_file_reader.h"
+#include "renderer/benchmark_report.h"
+#include "renderer/bvh.h"
+#include "renderer/camera.h"
+#include "renderer/cpu_profiler.h"
+#include "renderer/deletion_queue.h"
+#include "renderer/descriptor_allocator.h"
+#include "renderer/frame_arena.h"
+#include "renderer/frustum.h"
+#include "renderer/frustum_culling.h"
+#include "renderer/gltf.h"
+#include "renderer/gpu_profiler.h"
+#include "renderer/heap_allocations.h"
+#include "renderer/host_allocator.h"
+#include "renderer/image_sequence_writer.h"
+#include "renderer/light_clusters.h"
+#include "renderer/memory_types.h"
+#include "renderer/mesh.h"
+#include "renderer/quality_controller.h"
+#include "renderer/render_graph.h"
+#include "renderer/simd.h"
+#include "renderer/startup_timer.h"
+#include "renderer/texture.h"
+#include "renderer/texture_streaming.h"
+#include "shaders/cull.comp.h"
+#include "shaders/fragment.frag.h"
+#include "shaders/hiz.comp.h"
+#include "shaders/vertex.vert.h"
+
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtx/hash.hpp>
-#include <stb_image.h>
-#include <tiny_obj_loader.h>
 
 #include <GLFW/glfw3.h>
 
 #include <algorithm> // Necessary for std::min/std::max
 #include <array>
+#include <chrono>
+#include <cmath>
 #include <cstdint> // Necessary for UINT32_MAX
 #include <cstdlib>
 #include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <optional>
+#include <random>
 #include <set>
 #include <stdexcept>
 #include <string>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #ifndef REPO_HOME
 #define REPO_HOME = "./"
 #endif
 
+#ifndef SHADER_OPTIMIZATION
+#define SHADER_OPTIMIZATION "unknown"
+#endif
+
 const std::string s_REPO_HOME  = std::string(REPO_HOME);
 const std::string MODEL_PATH   = s_REPO_HOME + std::string("models/viking_room.obj");
 const std::string TEXTURE_PATH = s_REPO_HOME + std::string("textures/viking_room.png");
 
+// Taken during static initialization, as close to process start as portable code gets. Startup phases are timed
+// from here.
+const auto PROCESS_START = std::chrono::steady_clock::now();
+
 const int MAX_FRAMES_IN_FLIGHT = 2;
 
 constexpr uint32_t WIDTH  = 800;
 constexpr uint32_t HEIGHT = 600;
 
+// Simulated time between headless and benchmark frames, in seconds.
+constexpr float SIMULATED_FRAME_STEP = 1.0f / 60.0f;
+
+// Benchmark runs fly the camera once around the scene in this many simulated seconds.
+constexpr float CAMERA_PATH_PERIOD = 20.0f;
+
+// Room in each image's light index buffer, as an average per cluster. Clusters past it lose lights, which the
+// benchmark report counts.
+constexpr uint32_t LIGHT_INDICES_PER_CLUSTER = 64;
+
+// Each light circles its own point at this radius and angular speed (radians per second).
+constexpr float LIGHT_ORBIT_RADIUS = 1.0f;
+constexpr float LIGHT_ORBIT_SPEED  = 1.0f;
+
+// Timestamp pairs per frame for --gpu-profile, more than the frame graph has passes, and the number of frames its
+// rolling times average over.
+constexpr uint32_t GPU_PROFILER_MAX_SCOPES = 16;
+constexpr uint32_t GPU_PROFILE_WINDOW      = 60;
+
+// Frames the --gpu-profile CSV keeps, the most recent ones, unless a benchmark runs longer. The history is allocated
+// at startup so that the frame loop never grows it.
+constexpr uint32_t GPU_PROFILE_HISTORY_FRAMES = 3600;
+
+// Frames a benchmark renders before it starts measuring.
+constexpr uint32_t BENCHMARK_WARMUP_FRAMES = 10;
+
+// Scratch memory for each frame in flight: light cluster pairs and BVH traversal stacks. Frames needing more spill
+// to the heap, which the debug build's allocation check reports.
+constexpr size_t FRAME_ARENA_SIZE = size_t(4) << 20;
+
+// Debug builds fail once a frame after this many allocates on the render thread. The first frames are allowed to
+// grow pools and containers to their working size. Allocations inside Vulkan calls are counted apart and reported: the
+// loader, layers and driver allocate as they see fit, and --host-allocator reports what they route through the
+// callbacks.
+constexpr uint32_t ALLOCATION_FREE_AFTER_FRAMES = 10;
+
+// Presents on a new swap chain before the one it replaced goes to the deletion queue; see retirePresentedSwapChains().
+constexpr uint32_t PRESENTS_BEFORE_SWAP_CHAIN_RETIRES = 2;
+
+// Sets in a descriptor allocator's first pool; each pool chained after it doubles that, up to a limit.
+constexpr uint32_t DESCRIPTOR_SETS_PER_POOL = 16;
+
+// Slots in the bindless texture array, unless the device allows fewer update-after-bind sampled images per stage.
+constexpr uint32_t BINDLESS_TEXTURE_CAPACITY = 4096;
+
+// A streamed texture's levels no larger than this are uploaded before the first frame and stay for the whole run.
+constexpr uint32_t STREAMING_TAIL_SIZE = 128;
+// Frames in a row a streamed level must go unwanted before it is evicted.
+constexpr uint32_t STREAMING_EVICTION_FRAMES = 120;
+
 const std::vector<const char*> validationLayers = {"VK_LAYER_KHRONOS_validation"};
 const std::vector<const char*> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
 #ifdef NDEBUG
-constexpr bool enableValidationLayers = false;
+constexpr bool enableValidationLayers     = false;
+constexpr bool enableFrameAllocationCheck = false;
 #else
-constexpr bool enableValidationLayers = true;
+constexpr bool enableValidationLayers     = true;
+constexpr bool enableFrameAllocationCheck = true;
 #endif
 
 VkResult CreateDebugUtilsMessengerEXT(
@@ -77,6 +166,155 @@ void DestroyDebugUtilsMessengerEXT(
     }
 }
 
+// Mirrors the specialization constants declared in fragment.frag.
+struct ShaderVariant
+{
+    VkBool32 useVertexColor;
+    VkBool32 useTexture;
+    // Not part of the variant name: set when lights are requested.
+    VkBool32 useLighting = VK_FALSE;
+    // Not part of the variant name either: the size of the material texture array, above 1 only with bindless
+    // textures.
+    uint32_t textureCount = 1;
+    // Nor this: set with texture streaming, whose uniform buffer clamps the texture's level of detail.
+    VkBool32 clampTextureLod = VK_FALSE;
+
+    static std::array<VkSpecializationMapEntry, 5> getMapEntries()
+    {
+        std::array<VkSpecializationMapEntry, 5> mapEntries{};
+
+        mapEntries[0].constantID = 0;
+        mapEntries[0].offset     = offsetof(ShaderVariant, useVertexColor);
+        mapEntries[0].size       = sizeof(VkBool32);
+
+        mapEntries[1].constantID = 1;
+        mapEntries[1].offset     = offsetof(ShaderVariant, useTexture);
+        mapEntries[1].size       = sizeof(VkBool32);
+
+        mapEntries[2].constantID = 2;
+        mapEntries[2].offset     = offsetof(ShaderVariant, useLighting);
+        mapEntries[2].size       = sizeof(VkBool32);
+
+        mapEntries[3].constantID = 3;
+        mapEntries[3].offset     = offsetof(ShaderVariant, textureCount);
+        mapEntries[3].size       = sizeof(uint32_t);
+
+        mapEntries[4].constantID = 4;
+        mapEntries[4].offset     = offsetof(ShaderVariant, clampTextureLod);
+        mapEntries[4].size       = sizeof(VkBool32);
+
+        return mapEntries;
+    }
+
+    static ShaderVariant fromName(const std::string& name)
+    {
+        if (name == "full")
+        {
+            return {VK_TRUE, VK_TRUE};
+        }
+        if (name == "texture")
+        {
+            return {VK_FALSE, VK_TRUE};
+        }
+        if (name == "color")
+        {
+            return {VK_TRUE, VK_FALSE};
+        }
+        if (name == "flat")
+        {
+            return {VK_FALSE, VK_FALSE};
+        }
+
+        throw std::invalid_argument("unknown shader variant: " + name);
+    }
+};
+
+struct ApplicationOptions
+{
+    // A Wavefront OBJ, or a glTF 2.0 model when it ends in .glb or .gltf. A glTF model's own base color texture
+    // replaces the default one.
+    std::string modelPath = MODEL_PATH;
+    // When set, the model and the texture are read out of this archive, written by AssetPacker, instead of from their
+    // own files; entries are named by their path relative to the repository. glTF models still map their own file.
+    std::string archivePath;
+    // When set, SPIR-V is loaded from <shaderDirectory>/<name>.bin instead of the modules embedded at build time.
+    std::string shaderDirectory;
+    // Prints SPIR-V sizes and shader module / pipeline creation times whenever the pipeline is built.
+    bool reportPipeline = false;
+    // Loaded models carry constant white vertex colors, so the default variant only samples the texture.
+    std::string   shaderVariantName = "texture";
+    ShaderVariant shaderVariant     = ShaderVariant::fromName(shaderVariantName);
+    // Draws the model this many times at the same depth so every layer is shaded (fill-rate stress).
+    uint32_t overdraw = 1;
+    // When non-zero, renders this many frames after a short warmup, prints frame-time statistics and exits. The
+    // animation then advances by a fixed step per frame and the camera follows a scripted path, so every run renders
+    // the same frames.
+    uint32_t benchmarkFrames = 0;
+    // When set, the benchmark's frame, CPU, GPU and present-to-present time statistics are also written here as JSON.
+    std::string benchmarkJsonPath;
+    // When set, the benchmark fails if its statistics regressed by more than regressionThreshold percent against the
+    // JSON report stored here.
+    std::string baselinePath;
+    double      regressionThreshold = 5.0;
+    // Number of model instances laid out on a grid around the origin.
+    uint32_t objectCount = 1;
+    // Frustum-culls objects in a compute pass and draws the survivors with indirect draws.
+    bool gpuDriven = false;
+    // Adds two-phase occlusion culling against a hierarchical depth pyramid. Implies gpuDriven.
+    bool hiz = false;
+    // Frustum-culls objects on the CPU every frame and draws the survivors with indirect draws written straight into
+    // host-visible buffers. The alternative to gpuDriven for measuring CPU-side scene management.
+    bool cpuCulling = false;
+    // With cpuCulling, walks a bounding volume hierarchy over the objects instead of testing each one. Implies
+    // cpuCulling.
+    bool bvhCulling = false;
+    // "grid" lays objects out on a plane; "lattice" stacks them in a cube so most of them are occluded.
+    std::string layout = "grid";
+    // When non-zero, render resolution, MSAA and sample shading adapt to keep GPU frame time under this budget (ms).
+    double targetFrameTime = 0.0;
+    // Prints the compiled frame graph: passes, the barriers recorded in front of each and transient memory.
+    bool reportGraph = false;
+    // Renders into offscreen images without a window, surface or swap chain, advancing animation by a fixed step
+    // per frame instead of wall-clock time. Needs benchmarkFrames to know when to stop.
+    bool headless = false;
+    // When set, renders benchmarkFrames headless frames and writes each to <outputDirectory>/frame_NNNNN.png.
+    std::string outputDirectory;
+    // Frames the CPU may submit ahead of the GPU. Headless rendering cycles through one more image than this, each
+    // with its own readback buffer, so copying a finished frame out never waits on the frame being rendered.
+    uint32_t framesInFlight = MAX_FRAMES_IN_FLIGHT;
+    // Number of moving point lights. When non-zero, they are assigned to a clustered grid on the CPU every frame and
+    // the fragment shader lights each fragment with the lights of its cluster.
+    uint32_t lightCount = 0;
+    // When set, times every frame graph pass with GPU timestamps, counts primitives and shader invocations where the
+    // device supports pipeline statistics, prints rolling per-pass times on exit and writes every frame to this CSV.
+    std::string gpuProfilePath;
+    // When set, writes the CPU profiler's zones from every thread to this file as Chrome trace JSON on exit.
+    std::string cpuTracePath;
+    // Prints how long each startup phase took and the time from process start to the first presented frame.
+    bool reportStartup = false;
+    // When set, the startup phase times are also written here as JSON. Implies reportStartup.
+    std::string startupJsonPath;
+    // When set, startup fails if any phase regressed by more than regressionThreshold percent against the JSON report
+    // stored here. Implies reportStartup.
+    std::string startupBaselinePath;
+    // Passes VkAllocationCallbacks to every Vulkan object the application creates, serving small command- and
+    // object-scoped driver allocations from pools, and prints the driver's host memory use and allocation rate.
+    bool hostAllocator = false;
+    // Number of materials the objects cycle through. Each is its own view of the texture, so materials differ in their
+    // descriptors rather than their pixels. Draws are recorded material by material.
+    uint32_t materialCount = 1;
+    // Binds every material's texture once, in a partially bound, update-after-bind array (descriptor indexing, core
+    // in Vulkan 1.2) that shaders index with the object's material. Without it each material has its own descriptor
+    // set, bound before its draws, so indirect draws are limited to one material.
+    bool bindless = false;
+    // Uploads only the texture's smallest levels before the first frame. Finer ones stream in, one per frame, once the
+    // nearest visible object is close enough to need them, and are evicted again when it no longer is.
+    bool textureStreaming = false;
+    // The most texel memory streaming keeps resident, in MiB. Implies textureStreaming. The smallest levels stay
+    // even when they alone are over it.
+    double textureBudget = 256.0;
+};
+
 struct QueueFamilyIndices
 {
     std::optional<uint32_t> graphicsFamily;
@@ -92,70 +330,106 @@ struct SwapChainSupportDetails
     std::vector<VkPresentModeKHR>   presentModes;
 };
 
-struct Vertex
+VkVertexInputBindingDescription vertexBindingDescription()
 {
-    glm::vec3 pos;
-    glm::vec3 color;
-    glm::vec2 texCoord;
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding   = 0;
+    bindingDescription.stride    = sizeof(Vertex);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-    bool operator==(const Vertex& other) const
-    {
-        return pos == other.pos && color == other.color && texCoord == other.texCoord;
-    }
+    return bindingDescription;
+}
 
-    static VkVertexInputBindingDescription getBindingDescription()
-    {
-        VkVertexInputBindingDescription bindingDescription{};
-        bindingDescription.binding   = 0;
-        bindingDescription.stride    = sizeof(Vertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+std::array<VkVertexInputAttributeDescription, 3> vertexAttributeDescriptions()
+{
+    std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
 
-        return bindingDescription;
-    }
+    attributeDescriptions[0].binding  = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format   = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[0].offset   = offsetof(Vertex, pos);
 
-    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions()
-    {
-        std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+    attributeDescriptions[1].binding  = 0;
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format   = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[1].offset   = offsetof(Vertex, color);
 
-        attributeDescriptions[0].binding  = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format   = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[0].offset   = offsetof(Vertex, pos);
+    attributeDescriptions[2].binding  = 0;
+    attributeDescriptions[2].location = 2;
+    attributeDescriptions[2].format   = VK_FORMAT_R32G32_SFLOAT;
+    attributeDescriptions[2].offset   = offsetof(Vertex, texCoord);
 
-        attributeDescriptions[1].binding  = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format   = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset   = offsetof(Vertex, color);
+    return attributeDescriptions;
+}
 
-        attributeDescriptions[2].binding  = 0;
-        attributeDescriptions[2].location = 2;
-        attributeDescriptions[2].format   = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[2].offset   = offsetof(Vertex, texCoord);
+struct UniformBufferObject
+{
+    alignas(16) glm::mat4  model;
+    alignas(16) glm::mat4  view;
+    alignas(16) glm::mat4  proj;
+    alignas(16) glm::vec4  frustumPlanes[6];
+    uint32_t               objectCount;
+    // Tiles across, tiles down, depth slices and light count.
+    alignas(16) glm::uvec4 clusterGrid;
+    // Tiles per pixel in x and y, then the depth slice mapping from LightClusters.
+    alignas(16) glm::vec4  clusterScale;
+    // The finest level of the texture's views a streamed texture has uploaded.
+    float                  textureMinLod;
+};
 
-        return attributeDescriptions;
-    }
+// Matches PointLight in fragment.frag: view-space center and radius, then color.
+struct PointLight
+{
+    glm::vec4 positionRadius;
+    glm::vec4 color;
 };
 
-namespace std {
-    template <>
-    struct hash<Vertex>
-    {
-        size_t operator()(Vertex const& vertex) const
-        {
-            return ((hash<glm::vec3>()(vertex.pos) ^ (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
-                   (hash<glm::vec2>()(vertex.texCoord) << 1);
-        }
-    };
-} // namespace std
+// Per-object transform, bounds and draw arguments, laid out for std430 storage buffers.
+struct ObjectData
+{
+    glm::mat4 model;
+    glm::vec4 boundingSphere;
+    uint32_t  indexCount;
+    uint32_t  firstIndex;
+    int32_t   vertexOffset;
+    uint32_t  material;
+};
 
-struct UniformBufferObject
+// Matches the phase push constant in cull.comp.
+enum class CullPhase : uint32_t
+{
+    // Frustum culling only, everything is drawn in one pass.
+    Frustum,
+    // Draws objects that were visible last frame and are inside the frustum.
+    Early,
+    // Tests every object against the depth pyramid built from the early pass and draws the newly visible ones.
+    Late,
+};
+
+// Layout of the draw count buffer: one count per draw list followed by culling counters.
+struct CullStatistics
+{
+    uint32_t earlyDraws;
+    uint32_t lateDraws;
+    uint32_t occluded;
+    uint32_t frustumCulled;
+};
+
+struct HiZPushConstants
 {
-    alignas(16) glm::mat4 model;
-    alignas(16) glm::mat4 view;
-    alignas(16) glm::mat4 proj;
+    glm::ivec2 sourceSize;
+    glm::ivec2 destinationSize;
+    uint32_t   level;
 };
 
 class HelloTriangleApplication {
+    // Only present with --host-allocator. allocator points at its callbacks and is passed to every create, allocate,
+    // destroy and free call; it is null when the driver allocates for itself. Declared first so it outlives every
+    // member that could hold memory from it.
+    std::optional<HostAllocator> hostAllocator;
+    const VkAllocationCallbacks* allocator = nullptr;
+
+    ApplicationOptions           options;
     GLFWwindow*                  window;
     VkInstance                   instance;
     VkDebugUtilsMessengerEXT     debugMessenger;
@@ -164,13 +438,14 @@ class HelloTriangleApplication {
     VkQueue                      graphicsQueue;
     VkSurfaceKHR                 surface;
     VkQueue                      presentQueue;
-    VkSwapchainKHR               swapChain;
+    VkSwapchainKHR               swapChain = VK_NULL_HANDLE;
     std::vector<VkImage>         swapChainImages;
     VkFormat                     swapChainImageFormat;
     VkExtent2D                   swapChainExtent;
     std::vector<VkImageView>     swapChainImageViews;
     VkRenderPass                 renderPass;
     VkDescriptorSetLayout        descriptorSetLayout;
+    VkDescriptorSetLayout        materialDescriptorSetLayout;
     VkPipelineLayout             pipelineLayout;
     VkPipeline                   graphicsPipeline;
     std::vector<VkFramebuffer>   swapChainFramebuffers;
@@ -181,43 +456,242 @@ class HelloTriangleApplication {
     std::vector<VkDeviceMemory>  uniformBuffersMemory;
     std::vector<VkCommandBuffer> commandBuffers;
     std::vector<VkSemaphore>     imageAvailableSemaphores;
+    // One per swap chain image: acquiring an image again means the present that waited on its semaphore is done.
     std::vector<VkSemaphore>     renderFinishedSemaphores;
+    // Replaced swap chains and the semaphores their presents waited on, which the present engine may hold after the
+    // frames that rendered to them have finished. They go to the deletion queue once the new swap chain has shown
+    // PRESENTS_BEFORE_SWAP_CHAIN_RETIRES frames.
+    std::vector<VkSwapchainKHR>  retiredSwapChains;
+    std::vector<VkSemaphore>     retiredPresentSemaphores;
+    uint32_t                     presentsSinceRecreation = 0;
     std::vector<VkFence>         inFlightFences;
     std::vector<VkFence>         imagesInFlight;
     VkBuffer                     vertexBuffer;
     VkDeviceMemory               vertexBufferMemory;
-    VkDescriptorPool             descriptorPool;
     std::vector<VkDescriptorSet> descriptorSets;
     VkImage                      textureImage;
     VkDeviceMemory               textureImageMemory;
     VkImageView                  textureImageView;
     VkSampler                    textureSampler;
-    VkImage                      depthImage;
-    VkDeviceMemory               depthImageMemory;
+    std::vector<VkImageView>     materialImageViews;
+    VkDescriptorPool             bindlessDescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet              bindlessDescriptorSet  = VK_NULL_HANDLE;
+    // Only present with --texture-streaming, which keeps the whole chain in streamedMips to upload from. The image
+    // holds levels [textureFirstLevel, mipLevels) and the views show those from textureVisibleLevel on; the ones in
+    // between are allocated but not uploaded yet. Both are 0 without streaming.
+    std::optional<MipResidency>     textureResidency;
+    std::optional<StreamedMipChain> streamedMips;
+    uint32_t                     textureFirstLevel   = 0;
+    uint32_t                     textureVisibleLevel = 0;
+    float                        textureUvDensity    = 0.0f;
     VkImageView                  depthImageView;
     uint32_t                     mipLevels;
-    std::vector<Vertex>          vertices;
-    std::vector<uint32_t>        indices;
-    VkImage                      colorImage;
-    VkDeviceMemory               colorImageMemory;
+    // The model's vertices and indices may point into its mapped file, which lives as long as the model does.
+    Model                        model;
+    // Read out of options.archivePath before the model and the texture are decoded, and dropped once they are.
+    std::vector<uint8_t>         archivedModel;
+    std::vector<uint8_t>         archivedTexture;
     VkImageView                  colorImageView;
-
-    VkSampleCountFlagBits msaaSamples        = VK_SAMPLE_COUNT_1_BIT;
-    size_t                currentFrame       = 0;
-    bool                  framebufferResized = false;
+    glm::vec4                    meshBoundingSphere;
+    std::vector<ObjectData>      objects;
+    VkBuffer                     objectBuffer;
+    VkDeviceMemory               objectBufferMemory;
+    VkDescriptorSetLayout        cullDescriptorSetLayout;
+    VkPipelineLayout             cullPipelineLayout;
+    VkPipeline                   cullPipeline;
+    std::vector<VkDescriptorSet> cullDescriptorSets;
+    std::vector<VkBuffer>        drawCommandBuffers;
+    std::vector<VkDeviceMemory>  drawCommandBuffersMemory;
+    std::vector<VkBuffer>        drawCountBuffers;
+    std::vector<VkDeviceMemory>  drawCountBuffersMemory;
+    std::vector<VkBuffer>        cullStatsBuffers;
+    std::vector<VkDeviceMemory>  cullStatsBuffersMemory;
+    std::vector<CullStatistics*> cullStatsData;
+    BoundingSpheres              objectBounds;
+    std::vector<uint32_t>        visibleObjects;
+    FrustumPlanes                objectFrustum;
+    std::vector<void*>           drawCommandData;
+    std::vector<uint32_t*>       drawCountData;
+    std::vector<uint32_t>        drawCommandsWritten;
+    Bvh                          sceneBvh;
+    Bvh                          meshBvh;
+    VkBuffer                     visibilityBuffer;
+    VkDeviceMemory               visibilityBufferMemory;
+    VkRenderPass                 lateRenderPass;
+    VkImage                      depthPyramid;
+    VkDeviceMemory               depthPyramidMemory;
+    VkImageView                  depthPyramidView;
+    std::vector<VkImageView>     depthPyramidMipViews;
+    uint32_t                     depthPyramidLevels;
+    VkExtent2D                   depthPyramidExtent;
+    VkSampler                    depthPyramidSampler;
+    VkDescriptorSetLayout        hizDescriptorSetLayout;
+    VkPipelineLayout             hizPipelineLayout;
+    VkPipeline                   hizPipeline;
+    std::vector<VkDescriptorSet> hizDescriptorSets;
+    glm::vec3                    cameraPosition;
+    float                        sceneRadius;
+    VkExtent2D                   renderExtent;
+    VkImageView                  sceneImageView;
+    VkQueryPool                  timestampQueryPool;
+    std::vector<bool>            timestampsWritten;
+    std::vector<double>          benchmarkCpuTimes;
+    std::vector<double>          benchmarkGpuTimes;
+    std::vector<double>          presentIntervals;
+    RenderGraph::Resource        sceneTarget;
+    std::vector<VkDeviceMemory>  offscreenImagesMemory;
+    std::vector<VkBuffer>        readbackBuffers;
+    std::vector<VkDeviceMemory>  readbackBuffersMemory;
+    std::vector<void*>           readbackData;
+    std::vector<uint32_t>        readbackFrames;
+    std::vector<bool>            readbackPending;
+    LightClusters                lightClusters;
+    BoundingSpheres              lightSpheres;
+    std::vector<glm::vec4>       lightOrbits;
+    std::vector<glm::vec4>       lightColors;
+    std::vector<VkBuffer>        lightBuffers;
+    std::vector<VkDeviceMemory>  lightBuffersMemory;
+    std::vector<void*>           lightData;
+    std::vector<VkBuffer>        clusterBuffers;
+    std::vector<VkDeviceMemory>  clusterBuffersMemory;
+    std::vector<void*>           clusterData;
+    std::vector<VkBuffer>        lightIndexBuffers;
+    std::vector<VkDeviceMemory>  lightIndexBuffersMemory;
+    std::vector<void*>           lightIndexData;
+
+    VkSampleCountFlagBits msaaSamples                = VK_SAMPLE_COUNT_1_BIT;
+    size_t                currentFrame               = 0;
+    bool                  framebufferResized         = false;
+    bool                  multiDrawIndirectSupported = false;
+    bool                  drawIndirectCountSupported = false;
+    double                commandBufferRecordTime    = 0.0;
+    CullStatistics        cullStatsTotal             = {};
+    uint32_t              cullStatsFrames            = 0;
+    VkSampleCountFlagBits maxMsaaSamples             = VK_SAMPLE_COUNT_1_BIT;
+    bool                  sampleShading              = true;
+    float                 renderScale                = 1.0f;
+    double                timestampPeriod            = 0.0;
+    uint64_t              timestampMask              = UINT64_MAX;
+    bool                  qualityChangePending       = false;
+    bool                  frameTimestamps            = false;
+    double                gpuFrameTimeTotal          = 0.0;
+    uint32_t              gpuFrameTimeSamples        = 0;
+    uint32_t              framesRendered             = 0;
+    uint32_t              swapChainRecreations       = 0;
+    uint64_t              uncountedFrameAllocations  = 0;
+    uint64_t              swapChainFrameAllocations  = 0;
+    uint32_t              swapChainAllocationFrames  = 0;
+    double                cpuCullingTime             = 0.0;
+    glm::mat4             sceneToClip                = glm::mat4(1.0f);
+    glm::mat4             sceneToView                = glm::mat4(1.0f);
+    float                 sceneNearPlane             = 0.0f;
+    float                 projectionScale            = 0.0f;
+    double                lightClusteringTime        = 0.0;
+    uint64_t              lightIndicesTotal          = 0;
+    uint64_t              lightIndicesDropped        = 0;
+    uint32_t              lightFrames                = 0;
+    bool                  pipelineStatisticsEnabled  = false;
+    float                 profilerTimestampPeriod    = 0.0f;
+    uint32_t              profilerTimestampValidBits = 0;
+    bool                  timelineSemaphoreSupported = false;
+    uint32_t              bindlessTextureCapacity    = 0;
+    uint32_t              materialSetBinds           = 0;
+    std::vector<bool>     staleCommandBuffers;
+    uint32_t              commandBufferRerecords     = 0;
+    uint32_t              textureStreamSteps         = 0;
+    uint32_t              textureLevelsUploaded      = 0;
+    uint64_t              textureBytesUploaded       = 0;
+    uint32_t              textureReallocations       = 0;
+    VkDeviceSize          textureAllocatedBytes      = 0;
+    VkDeviceSize          textureAllocatedPeak       = 0;
+
+    // Queried once in pickPhysicalDevice().
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+
+    // One per frame in flight, reset once the frame's fence has signalled.
+    std::vector<std::unique_ptr<FrameArena>> frameArenas;
+
+    // Destroys replaced resources once the submissions that used them have finished, so nothing waits for the device
+    // to go idle. frameSubmissions holds each frame slot's last submission, finished once the slot's fence signals.
+    DeletionQueue         deletionQueue;
+    std::vector<uint64_t> frameSubmissions;
+
+    // Sets that refer to resources sized to the swap chain come from swapChainDescriptors, whose pools are retired
+    // with it. Sets whose contents never change, such as a material's, are written once and shared by
+    // descriptorCache. descriptorsAtFirstFrame separates the frame loop's descriptor work from startup's.
+    DescriptorAllocator  swapChainDescriptors;
+    DescriptorCache      descriptorCache;
+    DescriptorStatistics descriptorsAtFirstFrame;
+
+    // When the previous benchmark frame was presented.
+    std::optional<std::chrono::steady_clock::time_point> lastPresentTime;
+
+    StartupTimer startupTimer{PROCESS_START};
+
+    // The host allocator's counters and framesRendered when the main loop started, or when a benchmark's warmup
+    // ended; the per-frame allocation rates are measured from here.
+    HostAllocator::Statistics hostAllocationsAtStart{};
+    uint32_t                  hostAllocationFramesAtStart = 0;
+
+    // Only present with --target-ms.
+    std::optional<QualityController> qualityController;
+    // Only present with --output.
+    std::optional<ImageSequenceWriter> imageWriter;
+    // Only present with --gpu-profile.
+    std::optional<GpuProfiler> gpuProfiler;
+    // Only present with --cpu-cull. The culler keeps a reference to the pool, so it is declared after it.
+    std::optional<ThreadPool>    cullingPool;
+    std::optional<FrustumCuller> frustumCuller;
+
+    // Records every frame and owns the color, depth and scene attachments that colorImageView, depthImageView and
+    // sceneImageView point into. Rebuilt with the swap chain.
+    RenderGraph frameGraph;
 
   public:
+    explicit HelloTriangleApplication(ApplicationOptions options)
+        : options(std::move(options))
+    {
+    }
+
     void run()
     {
+        CPU_THREAD_NAME("render");
+
+        startupTimer.beginPhase("window");
         initWindow();
         initVulkan();
         mainLoop();
         cleanup();
+
+        // Every object created through the callbacks has been destroyed, so anything still live was never freed.
+        if (hostAllocator)
+        {
+            for (uint32_t scope = 0; scope < HostAllocator::scopeCount; scope++)
+            {
+                size_t live = hostAllocator->statistics()[scope].liveBytes;
+                if (live > 0)
+                {
+                    std::cout << "[MEMORY] \t" << live << " bytes of " << HostAllocator::scopeName(scope)
+                              << " scope still allocated after cleanup" << std::endl;
+                }
+            }
+        }
+
+        if (!options.cpuTracePath.empty())
+        {
+            CpuProfiler::writeChromeTrace(options.cpuTracePath);
+            std::cout << "[PROFILE] \tCPU trace written to " << options.cpuTracePath << std::endl;
+        }
     }
 
   private:
     void initWindow()
     {
+        if (options.headless)
+        {
+            return;
+        }
+
         glfwInit();
 
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
@@ -226,6 +700,7 @@ class HelloTriangleApplication {
         window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
         glfwSetWindowUserPointer(window, this);
         glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+        glfwSetMouseButtonCallback(window, mouseButtonCallback);
     }
 
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height)
@@ -235,51 +710,326 @@ class HelloTriangleApplication {
         app->framebufferResized = true;
     }
 
+    static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
+    {
+        auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+
+        if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
+        {
+            app->pickObject();
+        }
+    }
+
     void initVulkan()
     {
+        CPU_ZONE("initVulkan");
+
+        createHostAllocator();
+        // createInstance() splits its time between "validation layers" and "instance", and createTextureImage()
+        // between "texture decode" and "texture upload". readArchivedAssets() adds an "asset read" phase.
         createInstance();
         setupDebugMessenger();
+        startupTimer.beginPhase("surface");
         createSurface();
+        startupTimer.beginPhase("device pick");
         pickPhysicalDevice();
+        startupTimer.beginPhase("device");
         createLogicalDevice();
+        queryFrameTimestamps();
+        createQualityController();
+        createGpuProfiler();
+        createImageWriter();
+        createFrustumCuller();
+        startupTimer.beginPhase("swap chain");
         createSwapChain();
         createImageViews();
-        createRenderPass();
+        createRenderPasses();
+        startupTimer.beginPhase("pipelines");
         createDescriptorSetLayout();
         createGraphicsPipeline();
+        createCullPipeline();
         createCommandPool();
-        createColorResources();
-        createDepthResources();
-        createFramebuffers();
+        createDepthPyramid();
+        // The model comes first: a glTF model may bring its own texture.
+        readArchivedAssets();
+        startupTimer.beginPhase("model load");
+        loadModel();
+        startupTimer.beginPhase("texture decode");
         createTextureImage();
         createTextureImageView();
         createTextureSampler();
-        loadModel();
+        createDepthPyramidSampler();
+        startupTimer.beginPhase("scene buffers");
         createVertexBuffer();
         createIndexBuffer();
+        createObjectBuffer();
+        buildBvhs();
+        createLights();
         createUniformBuffers();
-        createDescriptorPool();
+        createLightBuffers();
+        createIndirectBuffers();
+        createReadbackBuffers();
+        startupTimer.beginPhase("frame graph");
+        createFrameGraph();
+        createFramebuffers();
+        createDescriptorAllocators();
+        createBindlessDescriptorSet();
         createDescriptorSets();
+        createTimestampQueryPool();
+        createProfilerQueryPools();
+        startupTimer.beginPhase("command buffers");
         createCommandBuffers();
         createSyncObjects();
+        startupTimer.beginPhase("first frame");
     }
 
-    void createColorResources()
+    // Describes the frame as passes over the swap chain image, the attachments and the culling buffers. The graph
+    // derives every barrier and layout transition from these declarations and creates the attachments itself.
+    void createFrameGraph()
     {
-        VkFormat colorFormat = swapChainImageFormat;
+        CPU_ZONE("createFrameGraph");
 
-        createImage(
-            swapChainExtent.width,
-            swapChainExtent.height,
-            1,
-            msaaSamples,
-            colorFormat,
-            VK_IMAGE_TILING_OPTIMAL,
-            VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            colorImage,
-            colorImageMemory);
-        colorImageView = createImageView(colorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+        // The pyramid build reads every sample of the depth attachment through a multisampled sampler.
+        if (options.hiz && msaaSamples == VK_SAMPLE_COUNT_1_BIT)
+        {
+            throw std::runtime_error("Hi-Z culling requires a multisampled depth buffer!");
+        }
+
+        bool multisampled = msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+
+        const ResourceAccess colorAttachment = {
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+        const ResourceAccess depthAttachment = {
+            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+        const ResourceAccess computeRead = {
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT,
+            VK_IMAGE_LAYOUT_GENERAL};
+        const ResourceAccess computeWrite = {
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_GENERAL};
+        const ResourceAccess indirectRead  = {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT};
+        const ResourceAccess transferRead  = {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT};
+        const ResourceAccess transferWrite = {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT};
+
+        // The first access to the swap chain image must not start before the acquire semaphore's wait stage.
+        // Headless frames leave their image ready to be copied out instead of presented.
+        VkPipelineStageFlags acquireStage =
+            qualityController ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        VkImageLayout finalLayout =
+            options.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+        RenderGraph::Resource swapChainTarget = frameGraph.importImage(
+            "swap chain",
+            swapChainImages,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            {acquireStage, 0},
+            ResourceAccess{VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, finalLayout});
+
+        // Without MSAA the scene renders straight into its target and there is nothing to resolve.
+        RenderGraph::Resource colorTarget = 0;
+        if (multisampled)
+        {
+            colorTarget = frameGraph.createImage(
+                "multisampled color",
+                {swapChainImageFormat,
+                 renderExtent,
+                 1,
+                 msaaSamples,
+                 VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT});
+        }
+
+        // Hi-Z samples the depth buffer, which rules out lazily allocated memory for it.
+        VkImageUsageFlags depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                       (options.hiz ? VK_IMAGE_USAGE_SAMPLED_BIT
+                                                    : VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+        RenderGraph::Resource depthTarget = frameGraph.createImage(
+            "depth",
+            {findDepthFormat(), renderExtent, 1, msaaSamples, depthUsage, VK_IMAGE_ASPECT_DEPTH_BIT});
+
+        // With adaptive quality the scene is rendered at renderExtent and blitted onto the swap chain image.
+        RenderGraph::Resource target = swapChainTarget;
+        if (qualityController)
+        {
+            sceneTarget = frameGraph.createImage(
+                "scene",
+                {swapChainImageFormat,
+                 renderExtent,
+                 1,
+                 VK_SAMPLE_COUNT_1_BIT,
+                 VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT});
+            target = sceneTarget;
+        }
+
+        RenderGraph::Resource drawCommands = 0;
+        RenderGraph::Resource drawCounts   = 0;
+        RenderGraph::Resource visibility   = 0;
+        RenderGraph::Resource pyramid      = 0;
+
+        // CPU-culled draws are written by the host before submission, which the submit itself makes visible.
+        if (options.gpuDriven || options.cpuCulling)
+        {
+            drawCommands = frameGraph.importBuffer("draw commands", drawCommandBuffers);
+            drawCounts   = frameGraph.importBuffer("draw counts", drawCountBuffers);
+        }
+
+        if (options.gpuDriven)
+        {
+            RenderGraph::PassBuilder reset = frameGraph.addPass(
+                "cull reset",
+                [this](VkCommandBuffer commandBuffer, uint32_t frame) { recordCullReset(commandBuffer, frame); });
+            reset.write(drawCounts, transferWrite, true);
+            if (!drawIndirectCountSupported)
+            {
+                reset.write(drawCommands, transferWrite, true);
+            }
+
+            CullPhase                firstPhase = options.hiz ? CullPhase::Early : CullPhase::Frustum;
+            RenderGraph::PassBuilder cull       = frameGraph.addPass(
+                options.hiz ? "early cull" : "frustum cull",
+                [this, firstPhase](VkCommandBuffer commandBuffer, uint32_t frame)
+                { recordCullDispatch(commandBuffer, frame, firstPhase); });
+            cull.write(drawCounts, computeWrite).write(drawCommands, computeWrite);
+
+            if (options.hiz)
+            {
+                // Both persist across frames: the early cull reads what the previous frame's late phase left behind.
+                visibility = frameGraph.importBuffer("visibility", {visibilityBuffer});
+                pyramid    = frameGraph.importImage(
+                    "depth pyramid",
+                    {depthPyramid},
+                    VK_IMAGE_ASPECT_COLOR_BIT,
+                    computeRead);
+
+                cull.read(visibility, computeRead).read(pyramid, computeRead);
+            }
+        }
+
+        auto addScenePass = [&](const std::string& name, VkRenderPass pass, uint32_t drawList, bool loadPrevious)
+        {
+            RenderGraph::PassBuilder scene = frameGraph.addPass(
+                name,
+                [this, pass, drawList](VkCommandBuffer commandBuffer, uint32_t frame)
+                { recordScenePass(commandBuffer, frame, pass, drawList); });
+
+            scene.write(multisampled ? colorTarget : target, colorAttachment, !loadPrevious);
+            scene.write(depthTarget, depthAttachment, !loadPrevious);
+            if (multisampled)
+            {
+                // The resolve rewrites the whole target, so its previous contents never matter.
+                scene.write(target, colorAttachment, true);
+            }
+            if (options.gpuDriven || options.cpuCulling)
+            {
+                scene.read(drawCommands, indirectRead).read(drawCounts, indirectRead);
+            }
+        };
+
+        addScenePass("scene", renderPass, 0, false);
+
+        if (options.hiz)
+        {
+            // Second phase: objects hidden last frame are re-tested against this frame's depth and drawn on top.
+            frameGraph
+                .addPass(
+                    "depth pyramid",
+                    [this](VkCommandBuffer commandBuffer, uint32_t) { recordDepthPyramid(commandBuffer); })
+                .read(
+                    depthTarget,
+                    {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                     VK_ACCESS_SHADER_READ_BIT,
+                     VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL})
+                .write(pyramid, computeWrite);
+
+            frameGraph
+                .addPass(
+                    "late cull",
+                    [this](VkCommandBuffer commandBuffer, uint32_t frame)
+                    { recordCullDispatch(commandBuffer, frame, CullPhase::Late); })
+                .read(pyramid, computeRead)
+                .write(visibility, computeWrite)
+                .write(drawCounts, computeWrite)
+                .write(drawCommands, computeWrite);
+
+            addScenePass("late scene", lateRenderPass, 1, true);
+        }
+
+        if (options.gpuDriven)
+        {
+            RenderGraph::Resource cullStats = frameGraph.importBuffer(
+                "culling statistics",
+                cullStatsBuffers,
+                ResourceAccess{VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT});
+
+            frameGraph
+                .addPass(
+                    "culling statistics",
+                    [this](VkCommandBuffer commandBuffer, uint32_t frame)
+                    { recordCullStatistics(commandBuffer, frame); })
+                .read(drawCounts, transferRead)
+                .write(cullStats, transferWrite)
+                .sideEffect();
+        }
+
+        if (qualityController)
+        {
+            frameGraph
+                .addPass(
+                    "upscale",
+                    [this](VkCommandBuffer commandBuffer, uint32_t frame) { recordUpscale(commandBuffer, frame); })
+                .read(sceneTarget, {transferRead.stages, transferRead.access, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL})
+                .write(
+                    swapChainTarget,
+                    {transferWrite.stages, transferWrite.access, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL},
+                    true);
+        }
+
+        if (imageWriter)
+        {
+            RenderGraph::Resource readback = frameGraph.importBuffer(
+                "readback",
+                readbackBuffers,
+                ResourceAccess{VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT});
+
+            frameGraph
+                .addPass(
+                    "readback",
+                    [this](VkCommandBuffer commandBuffer, uint32_t frame) { recordReadback(commandBuffer, frame); })
+                .read(swapChainTarget, {transferRead.stages, transferRead.access, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL})
+                .write(readback, transferWrite, true)
+                .sideEffect();
+        }
+
+        frameGraph.compile(device, physicalDevice, allocator);
+
+        colorImageView = multisampled ? frameGraph.view(colorTarget) : VK_NULL_HANDLE;
+        depthImageView = frameGraph.view(depthTarget);
+        sceneImageView = qualityController ? frameGraph.view(sceneTarget) : VK_NULL_HANDLE;
+
+        if (options.reportGraph)
+        {
+            reportFrameGraph();
+        }
+    }
+
+    void reportFrameGraph()
+    {
+        for (const std::string& line : frameGraph.describe())
+        {
+            std::cout << "[GRAPH] \t" << line << std::endl;
+        }
+
+        const RenderGraph::Statistics& stats = frameGraph.statistics();
+        std::cout << "[GRAPH] \t" << stats.passes << " passes (" << stats.culledPasses << " culled), "
+                  << stats.barrierBatches << " barrier batches with " << stats.imageBarriers << " image and "
+                  << stats.bufferBarriers << " buffer barriers; transient images " << stats.transientBytesRequested
+                  << " bytes requested, " << stats.transientBytesAllocated << " allocated ("
+                  << stats.lazilyAllocatedBytes << " lazily)" << std::endl;
     }
 
     VkSampleCountFlagBits getMaxUsableSampleCount()
@@ -317,106 +1067,498 @@ class HelloTriangleApplication {
         return VK_SAMPLE_COUNT_1_BIT;
     }
 
-    void loadModel()
+    static bool isGltfPath(const std::string& path) { return path.ends_with(".glb") || path.ends_with(".gltf"); }
+
+    // Archives name their entries by path relative to the repository.
+    static std::string archiveEntryName(const std::string& path)
+    {
+        return path.starts_with(s_REPO_HOME) ? path.substr(s_REPO_HOME.size()) : path;
+    }
+
+    // Reads the model and the texture out of the archive with all their reads in flight together, for loadModel()
+    // and createTextureImage() to decode from memory.
+    void readArchivedAssets()
     {
-        tinyobj::attrib_t                attrib;
-        std::vector<tinyobj::shape_t>    shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string                      warn, err;
+        CPU_ZONE("readArchivedAssets");
 
-        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH.c_str()))
+        if (options.archivePath.empty())
         {
-            throw std::runtime_error(warn + err);
+            return;
         }
+        startupTimer.beginPhase("asset read");
 
-        std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+        AsyncFileReader reader;
+        AssetArchive    archive(options.archivePath, reader);
 
-        for (const auto& shape : shapes)
+        std::vector<ArchiveRead> reads;
+        auto                     readInto = [&](const std::string& path, std::vector<uint8_t>& bytes)
         {
-            for (const auto& index : shape.mesh.indices)
+            const ArchiveEntry* entry = archive.find(archiveEntryName(path));
+            if (!entry)
             {
-                Vertex vertex{};
+                throw std::runtime_error(
+                    "failed to find " + archiveEntryName(path) + " in " + options.archivePath + "!");
+            }
+            bytes.resize(entry->size);
+            reads.push_back({entry, bytes.data()});
+        };
+        if (!isGltfPath(options.modelPath))
+        {
+            readInto(options.modelPath, archivedModel);
+        }
+        readInto(TEXTURE_PATH, archivedTexture);
+        archive.read(reads);
 
-                vertex.pos = {
-                    attrib.vertices[3 * index.vertex_index + 0],
-                    attrib.vertices[3 * index.vertex_index + 1],
-                    attrib.vertices[3 * index.vertex_index + 2]};
+        if (options.reportStartup)
+        {
+            uint64_t size       = 0;
+            uint64_t storedSize = 0;
+            for (const ArchiveRead& read : reads)
+            {
+                size += read.entry->size;
+                storedSize += read.entry->storedSize;
+            }
+            std::cout << "[ARCHIVE] \t" << reads.size() << " entries, " << size / 1024 << " KiB (" << storedSize / 1024
+                      << " KiB stored) read through " << reader.backend() << std::endl;
+        }
+    }
 
-                vertex.texCoord = {
-                    attrib.texcoords[2 * index.texcoord_index + 0],
-                    attrib.texcoords[2 * index.texcoord_index + 1]};
+    void loadModel()
+    {
+        CPU_ZONE("loadModel");
 
-                vertex.color = {1.0f, 1.0f, 1.0f};
+        const std::string& path = options.modelPath;
+        if (isGltfPath(path))
+        {
+            model = loadGltfModel(path);
+        }
+        else if (!archivedModel.empty())
+        {
+            std::string_view text(reinterpret_cast<const char*>(archivedModel.data()), archivedModel.size());
+            model         = modelFromMesh(parseObjMesh(text));
+            archivedModel = {};
+        }
+        else
+        {
+            model = modelFromMesh(loadObjMesh(path));
+        }
+        meshBoundingSphere = model.boundingSphere;
 
-                if (uniqueVertices.count(vertex) == 0)
-                {
-                    uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex);
-                }
+        if (options.textureStreaming)
+        {
+            textureUvDensity = meshUvDensity(model.vertices, model.indices);
+        }
 
-                indices.push_back(uniqueVertices[vertex]);
-            }
+        if (options.reportStartup)
+        {
+            std::cout << "[MODEL] \t" << model.vertices.size() << " vertices ("
+                      << (model.verticesMapped() ? "mapped" : "converted") << "), " << model.indices.size()
+                      << " indices (" << (model.indicesMapped() ? "mapped" : "converted") << ")"
+                      << (model.texture ? ", embedded texture" : "") << std::endl;
         }
     }
 
-    void createDepthResources()
+    void createObjectBuffer()
     {
-        VkFormat depthFormat = findDepthFormat();
-        createImage(
-            swapChainExtent.width,
-            swapChainExtent.height,
-            1,
-            msaaSamples,
-            depthFormat,
-            VK_IMAGE_TILING_OPTIMAL,
-            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+        CPU_ZONE("createObjectBuffer");
+
+        constexpr float spacing = 2.5f;
+
+        // Objects fill a square grid (or a cube for the lattice layout) centred on the origin, one model instance
+        // per cell. In the lattice the outer shell hides nearly everything behind it.
+        bool     lattice = options.layout == "lattice";
+        double   root    = lattice ? std::cbrt(static_cast<double>(options.objectCount))
+                                   : std::sqrt(static_cast<double>(options.objectCount));
+        uint32_t side    = static_cast<uint32_t>(std::ceil(root));
+        float    offset  = (side - 1) * spacing * 0.5f;
+
+        objects.resize(options.objectCount);
+        for (uint32_t i = 0; i < options.objectCount; i++)
+        {
+            glm::vec3 position(
+                (i % side) * spacing - offset,
+                (i / side % side) * spacing - offset,
+                lattice ? (i / (side * side)) * spacing - offset : 0.0f);
+
+            ObjectData& object    = objects[i];
+            object.model          = glm::translate(glm::mat4(1.0f), position);
+            object.boundingSphere = glm::vec4(glm::vec3(meshBoundingSphere) + position, meshBoundingSphere.w);
+            object.indexCount     = static_cast<uint32_t>(model.indices.size());
+            object.firstIndex     = 0;
+            object.vertexOffset   = 0;
+            object.material       = i % options.materialCount;
+
+            objectBounds.push_back(object.boundingSphere);
+        }
+        visibleObjects.reserve(objects.size());
+
+        VkDeviceSize bufferSize = sizeof(objects[0]) * objects.size();
+
+        VkBuffer       stagingBuffer;
+        VkDeviceMemory stagingBufferMemory;
+        createBuffer(
+            bufferSize,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            stagingBuffer,
+            stagingBufferMemory);
+
+        void* data;
+        vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
+        memcpy(data, objects.data(), (size_t)bufferSize);
+        vkUnmapMemory(device, stagingBufferMemory);
+
+        createBuffer(
+            bufferSize,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            depthImage,
-            depthImageMemory);
-        depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+            objectBuffer,
+            objectBufferMemory);
 
-        transitionImageLayout(
-            depthImage,
-            depthFormat,
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-            1);
+        copyBuffer(stagingBuffer, objectBuffer, bufferSize);
+
+        deletionQueue.retire(stagingBuffer);
+        deletionQueue.retire(stagingBufferMemory);
+
+        sceneRadius = glm::length(glm::vec3(offset, offset, lattice ? offset : 0.0f)) + meshBoundingSphere.w;
+
+        // The grid keeps the original close-up view; the lattice camera backs off until the whole cube fits.
+        cameraPosition = glm::vec3(2.0f, 2.0f, 2.0f);
+        if (lattice)
+        {
+            cameraPosition = glm::normalize(cameraPosition) * (sceneRadius / std::sin(glm::radians(22.5f)));
+        }
+
+        if (options.gpuDriven)
+        {
+            createVisibilityBuffer();
+        }
     }
 
-    VkFormat findSupportedFormat(
-        const std::vector<VkFormat>& candidates,
-        VkImageTiling                tiling,
-        VkFormatFeatureFlags         features)
+    // The scene hierarchy holds each object's bounding sphere as a box, in the same space as the objects' bounds.
+    // The mesh hierarchy holds the model's triangles in its own space and is shared by every instance for picking.
+    void buildBvhs()
     {
-        for (VkFormat format : candidates)
+        CPU_ZONE("buildBvhs");
+
+        std::vector<Aabb> objectBoxes(objects.size());
+        for (size_t i = 0; i < objects.size(); i++)
         {
-            VkFormatProperties props;
-            vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+            glm::vec3 center = glm::vec3(objects[i].boundingSphere);
+            glm::vec3 extent = glm::vec3(objects[i].boundingSphere.w);
+            objectBoxes[i]   = {center - extent, center + extent};
+        }
+        sceneBvh.build(objectBoxes);
 
-            if (tiling == VK_IMAGE_TILING_LINEAR && (props.linearTilingFeatures & features) == features)
+        std::vector<Aabb> triangleBoxes(model.indices.size() / 3);
+        for (size_t i = 0; i < triangleBoxes.size(); i++)
+        {
+            for (size_t corner = 0; corner < 3; corner++)
             {
-                return format;
+                triangleBoxes[i].grow(model.vertices[model.indices[i * 3 + corner]].pos);
             }
-            else if (tiling == VK_IMAGE_TILING_OPTIMAL && (props.optimalTilingFeatures & features) == features)
+        }
+        meshBvh.build(triangleBoxes);
+    }
+
+    // Lights circle fixed points scattered over the scene: through the whole cube for the lattice, in a layer just
+    // above the grid otherwise. They live in the same space as the objects and turn with them.
+    void createLights()
+    {
+        std::mt19937                          random(1);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::uniform_real_distribution<float> radius(1.5f, 4.0f);
+        std::uniform_real_distribution<float> channel(0.2f, 1.0f);
+
+        float     height = options.layout == "lattice" ? sceneRadius : meshBoundingSphere.w;
+        glm::vec3 extent(sceneRadius, sceneRadius, height);
+
+        for (uint32_t i = 0; i < options.lightCount; i++)
+        {
+            glm::vec3 center = glm::vec3(unit(random), unit(random), unit(random)) * extent;
+            if (options.layout != "lattice")
             {
-                return format;
+                center.z = (center.z + 1.0f) * height;
             }
-        }
 
-        throw std::runtime_error("failed to find supported format!");
+            lightOrbits.push_back(glm::vec4(center, unit(random) * glm::pi<float>()));
+            lightSpheres.push_back(glm::vec4(center, radius(random)));
+            lightColors.push_back(glm::vec4(channel(random), channel(random), channel(random), 1.0f));
+        }
     }
 
-    VkFormat findDepthFormat()
+    // One flag per object recording whether it passed the late culling phase, i.e. was visible last frame.
+    void createVisibilityBuffer()
     {
-        return findSupportedFormat(
-            {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
-            VK_IMAGE_TILING_OPTIMAL,
-            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+        VkDeviceSize bufferSize = sizeof(uint32_t) * objects.size();
+
+        createBuffer(
+            bufferSize,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            visibilityBuffer,
+            visibilityBufferMemory);
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        vkCmdFillBuffer(commandBuffer, visibilityBuffer, 0, VK_WHOLE_SIZE, 0);
+        endSingleTimeCommands(commandBuffer);
     }
 
-    bool hasStencilComponent(VkFormat format)
+    void createIndirectBuffers()
     {
-        return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
+        if (options.cpuCulling)
+        {
+            createHostIndirectBuffers();
+            return;
+        }
+        if (!options.gpuDriven)
+        {
+            return;
+        }
+
+        // Two-phase culling writes the early and late draw lists back to back.
+        uint32_t     drawListCount = options.hiz ? 2 : 1;
+        VkDeviceSize commandsSize  = sizeof(VkDrawIndexedIndirectCommand) * objects.size() * drawListCount;
+
+        drawCommandBuffers.resize(swapChainImages.size());
+        drawCommandBuffersMemory.resize(swapChainImages.size());
+        drawCountBuffers.resize(swapChainImages.size());
+        drawCountBuffersMemory.resize(swapChainImages.size());
+        cullStatsBuffers.resize(swapChainImages.size());
+        cullStatsBuffersMemory.resize(swapChainImages.size());
+        cullStatsData.resize(swapChainImages.size());
+
+        for (size_t i = 0; i < swapChainImages.size(); i++)
+        {
+            createBuffer(
+                commandsSize,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                drawCommandBuffers[i],
+                drawCommandBuffersMemory[i]);
+
+            createBuffer(
+                sizeof(CullStatistics),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                drawCountBuffers[i],
+                drawCountBuffersMemory[i]);
+
+            // Read back once the image's fence has signalled, so the counters stay mapped.
+            createBuffer(
+                sizeof(CullStatistics),
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                cullStatsBuffers[i],
+                cullStatsBuffersMemory[i]);
+
+            void* data;
+            vkMapMemory(device, cullStatsBuffersMemory[i], 0, sizeof(CullStatistics), 0, &data);
+            cullStatsData[i]  = static_cast<CullStatistics*>(data);
+            *cullStatsData[i] = {};
+        }
+    }
+
+    // CPU culling writes the draw commands and count for an image once its previous frame has finished, so both stay
+    // mapped. Starting zeroed means every slot past the first frame's list is already an empty draw.
+    void createHostIndirectBuffers()
+    {
+        VkDeviceSize commandsSize = sizeof(VkDrawIndexedIndirectCommand) * objects.size();
+
+        drawCommandBuffers.resize(swapChainImages.size());
+        drawCommandBuffersMemory.resize(swapChainImages.size());
+        drawCountBuffers.resize(swapChainImages.size());
+        drawCountBuffersMemory.resize(swapChainImages.size());
+        drawCommandData.resize(swapChainImages.size());
+        drawCountData.resize(swapChainImages.size());
+        drawCommandsWritten.assign(swapChainImages.size(), 0);
+
+        for (size_t i = 0; i < swapChainImages.size(); i++)
+        {
+            createBuffer(
+                commandsSize,
+                VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                drawCommandBuffers[i],
+                drawCommandBuffersMemory[i]);
+            createBuffer(
+                sizeof(uint32_t),
+                VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                drawCountBuffers[i],
+                drawCountBuffersMemory[i]);
+
+            void* data;
+            vkMapMemory(device, drawCommandBuffersMemory[i], 0, commandsSize, 0, &drawCommandData[i]);
+            vkMapMemory(device, drawCountBuffersMemory[i], 0, sizeof(uint32_t), 0, &data);
+            drawCountData[i] = static_cast<uint32_t*>(data);
+
+            memset(drawCommandData[i], 0, static_cast<size_t>(commandsSize));
+            *drawCountData[i] = 0;
+        }
+    }
+
+    // The pyramid is the largest power-of-two size not above the swap chain extent, so every level halves exactly.
+    // Level 0 conservatively covers the full-resolution depth, each texel holding the farthest depth beneath it.
+    void createDepthPyramid()
+    {
+        if (!options.gpuDriven)
+        {
+            return;
+        }
+
+        auto previousPowerOfTwo = [](uint32_t value)
+        {
+            uint32_t result = 1;
+            while (result * 2 <= value)
+            {
+                result *= 2;
+            }
+            return result;
+        };
+
+        depthPyramidExtent.width  = previousPowerOfTwo(renderExtent.width);
+        depthPyramidExtent.height = previousPowerOfTwo(renderExtent.height);
+
+        uint32_t largestSide = std::max(depthPyramidExtent.width, depthPyramidExtent.height);
+        depthPyramidLevels   = static_cast<uint32_t>(std::floor(std::log2(largestSide))) + 1;
+
+        createImage(
+            depthPyramidExtent.width,
+            depthPyramidExtent.height,
+            depthPyramidLevels,
+            VK_SAMPLE_COUNT_1_BIT,
+            VK_FORMAT_R32_SFLOAT,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            depthPyramid,
+            depthPyramidMemory);
+        depthPyramidView =
+            createImageView(depthPyramid, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, depthPyramidLevels);
+
+        depthPyramidMipViews.resize(depthPyramidLevels);
+        for (uint32_t level = 0; level < depthPyramidLevels; level++)
+        {
+            depthPyramidMipViews[level] =
+                createImageView(depthPyramid, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 1, level);
+        }
+
+        // The pyramid stays in GENERAL: it is written as a storage image and sampled by the culling shader. Until
+        // the first build it holds the far plane so nothing is reported as occluded.
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+
+        VkImageSubresourceRange pyramidRange{};
+        pyramidRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        pyramidRange.levelCount = depthPyramidLevels;
+        pyramidRange.layerCount = 1;
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout           = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image               = depthPyramid;
+        barrier.subresourceRange    = pyramidRange;
+        barrier.srcAccessMask       = 0;
+        barrier.dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            0,
+            nullptr,
+            0,
+            nullptr,
+            1,
+            &barrier);
+
+        VkClearColorValue farPlane = {
+            {1.0f, 1.0f, 1.0f, 1.0f}
+        };
+        vkCmdClearColorImage(commandBuffer, depthPyramid, VK_IMAGE_LAYOUT_GENERAL, &farPlane, 1, &pyramidRange);
+
+        barrier.oldLayout     = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            0,
+            nullptr,
+            0,
+            nullptr,
+            1,
+            &barrier);
+
+        endSingleTimeCommands(commandBuffer);
+    }
+
+    void createDepthPyramidSampler()
+    {
+        if (!options.gpuDriven)
+        {
+            return;
+        }
+
+        // Levels are selected explicitly and hold conservative maxima, so neither filtering nor mip blending apply.
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType                   = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter               = VK_FILTER_NEAREST;
+        samplerInfo.minFilter               = VK_FILTER_NEAREST;
+        samplerInfo.mipmapMode              = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.anisotropyEnable        = VK_FALSE;
+        samplerInfo.unnormalizedCoordinates = VK_FALSE;
+        samplerInfo.compareEnable           = VK_FALSE;
+        samplerInfo.minLod                  = 0.0f;
+        samplerInfo.maxLod                  = VK_LOD_CLAMP_NONE;
+
+        if (vkCreateSampler(device, &samplerInfo, allocator, &depthPyramidSampler) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create depth pyramid sampler!");
+        }
+    }
+
+    VkFormat findSupportedFormat(
+        const std::vector<VkFormat>& candidates,
+        VkImageTiling                tiling,
+        VkFormatFeatureFlags         features)
+    {
+        for (VkFormat format : candidates)
+        {
+            VkFormatProperties props;
+            vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+
+            if (tiling == VK_IMAGE_TILING_LINEAR && (props.linearTilingFeatures & features) == features)
+            {
+                return format;
+            }
+            else if (tiling == VK_IMAGE_TILING_OPTIMAL && (props.optimalTilingFeatures & features) == features)
+            {
+                return format;
+            }
+        }
+
+        throw std::runtime_error("failed to find supported format!");
+    }
+
+    VkFormat findDepthFormat()
+    {
+        return findSupportedFormat(
+            {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | (options.hiz ? VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT : 0));
     }
 
     void createTextureSampler()
@@ -443,18 +1585,37 @@ class HelloTriangleApplication {
         samplerInfo.maxLod                  = static_cast<float>(mipLevels);
         samplerInfo.mipLodBias              = 0.0f; // Optional
 
-        if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS)
+        if (vkCreateSampler(device, &samplerInfo, allocator, &textureSampler) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create texture sampler!");
         }
     }
 
+    // A streamed texture's views cover every level its image holds, uploaded or not; the fragment shader clamps to the
+    // uploaded ones through the uniform buffer, so uploading a level changes neither the views nor the command buffers.
     void createTextureImageView()
     {
-        textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+        uint32_t levelCount = mipLevels - textureFirstLevel;
+
+        auto createView = [&]()
+        { return createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, levelCount); };
+
+        textureImageView = createView();
+
+        // A view per further material is enough to give each material its own descriptors.
+        materialImageViews.assign(1, textureImageView);
+        for (uint32_t material = 1; material < options.materialCount; material++)
+        {
+            materialImageViews.push_back(createView());
+        }
     }
 
-    VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels)
+    VkImageView createImageView(
+        VkImage            image,
+        VkFormat           format,
+        VkImageAspectFlags aspectFlags,
+        uint32_t           mipLevels,
+        uint32_t           baseMipLevel = 0)
     {
         VkImageViewCreateInfo viewInfo{};
         viewInfo.sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -468,13 +1629,13 @@ class HelloTriangleApplication {
         viewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
 
         viewInfo.subresourceRange.aspectMask     = aspectFlags;
-        viewInfo.subresourceRange.baseMipLevel   = 0;
+        viewInfo.subresourceRange.baseMipLevel   = baseMipLevel;
         viewInfo.subresourceRange.levelCount     = mipLevels;
         viewInfo.subresourceRange.baseArrayLayer = 0;
         viewInfo.subresourceRange.layerCount     = 1;
 
         VkImageView imageView;
-        if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS)
+        if (vkCreateImageView(device, &viewInfo, allocator, &imageView) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create texture image view!");
         }
@@ -484,17 +1645,33 @@ class HelloTriangleApplication {
 
     void createTextureImage()
     {
-        int          texWidth, texHeight, texChannels;
-        stbi_uc*     pixels    = stbi_load(TEXTURE_PATH.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-        VkDeviceSize imageSize = texWidth * texHeight * 4;
+        CPU_ZONE("createTextureImage");
 
-        if (!pixels)
+        TextureData texture = model.texture               ? std::move(*model.texture)
+                              : !archivedTexture.empty() ? decodeTexture(archivedTexture.data(), archivedTexture.size())
+                                                         : loadTexture(TEXTURE_PATH);
+        mipLevels           = mipLevelCount(texture.width(), texture.height());
+        model.texture.reset();
+        archivedTexture = {};
+
+        if (options.textureStreaming)
         {
-            throw std::runtime_error("failed to load texture image!");
+            createStreamedTexture(std::move(texture));
+            return;
         }
 
-        mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
+        // Blitting between levels needs linear filtering; without it the chain is filtered on the CPU and uploaded
+        // together with level 0.
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_R8G8B8A8_SRGB, &formatProperties);
+        bool blitMipmaps = formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        if (!blitMipmaps)
+        {
+            generateMipChain(texture, true);
+        }
+        startupTimer.beginPhase("texture upload");
 
+        VkDeviceSize   imageSize = texture.byteSize();
         VkBuffer       stagingBuffer;
         VkDeviceMemory stagingBufferMemory;
         createBuffer(
@@ -506,14 +1683,16 @@ class HelloTriangleApplication {
 
         void* data;
         vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-        memcpy(data, pixels, static_cast<size_t>(imageSize));
+        for (const TextureData::Level& level : texture.levels)
+        {
+            memcpy(data, level.pixels.data(), level.pixels.size());
+            data = static_cast<uint8_t*>(data) + level.pixels.size();
+        }
         vkUnmapMemory(device, stagingBufferMemory);
 
-        stbi_image_free(pixels);
-
         createImage(
-            texWidth,
-            texHeight,
+            texture.width(),
+            texture.height(),
             mipLevels,
             VK_SAMPLE_COUNT_1_BIT,
             VK_FORMAT_R8G8B8A8_SRGB,
@@ -530,26 +1709,360 @@ class HelloTriangleApplication {
             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
             mipLevels);
 
-        copyBufferToImage(
-            stagingBuffer,
-            textureImage,
-            static_cast<uint32_t>(texWidth),
-            static_cast<uint32_t>(texHeight));
+        copyBufferToImage(stagingBuffer, textureImage, texture);
+
+        deletionQueue.retire(stagingBuffer);
+        deletionQueue.retire(stagingBufferMemory);
+
+        if (blitMipmaps)
+        {
+            generateMipmaps(
+                textureImage,
+                static_cast<int32_t>(texture.width()),
+                static_cast<int32_t>(texture.height()),
+                mipLevels);
+        }
+        else
+        {
+            transitionImageLayout(
+                textureImage,
+                VK_FORMAT_R8G8B8A8_SRGB,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                mipLevels);
+        }
+    }
+
+    // Keeps the whole chain to stream from, filtered on the CPU: a level cannot be blitted from a finer one that is not
+    // resident. Only the tail is filtered and uploaded before the first frame; the finer levels are filtered in the
+    // background while frames run.
+    void createStreamedTexture(TextureData texture)
+    {
+        streamedMips.emplace(std::move(texture), STREAMING_TAIL_SIZE, true);
+        startupTimer.beginPhase("texture upload");
+
+        std::vector<size_t> levelBytes;
+        for (const TextureData::Level& level : streamedMips->texture().levels)
+        {
+            levelBytes.push_back(size_t(level.width) * level.height * 4);
+        }
 
-        generateMipmaps(textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels);
+        uint32_t tailLevel = streamedMips->tailLevel();
+        textureResidency.emplace(
+            std::move(levelBytes),
+            tailLevel,
+            static_cast<size_t>(options.textureBudget * 1024.0 * 1024.0),
+            STREAMING_EVICTION_FRAMES);
+
+        // Nothing is resident yet.
+        textureImage        = VK_NULL_HANDLE;
+        textureFirstLevel   = mipLevels;
+        textureVisibleLevel = mipLevels;
+        updateStreamedTexture(tailLevel, tailLevel);
     }
 
-    void generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels)
+    // Makes levels [firstLevel, mipLevels) the allocated ones and [visibleLevel, mipLevels) the uploaded ones, in one
+    // submission. A new first level means a new image, which the levels still visible are copied into from the old
+    // one; levels becoming visible are uploaded from streamedMips, which must have filtered them. Levels allocated but
+    // not uploaded wait in the shader read layout like the rest, since the views cover them, and go through the
+    // transfer destination layout only while they are uploaded. The old image and the staging buffer are retired, so
+    // nothing waits: frames already submitted keep reading the old image until they finish. The views are left to the
+    // caller.
+    void updateStreamedTexture(uint32_t firstLevel, uint32_t visibleLevel)
     {
-        // Check if image format supports linear blitting
-        VkFormatProperties formatProperties;
-        vkGetPhysicalDeviceFormatProperties(physicalDevice, imageFormat, &formatProperties);
+        CPU_ZONE("updateStreamedTexture");
+
+        const TextureData& chain = streamedMips->texture();
+
+        // Levels [keptLevel, mipLevels) are on the GPU already, and [visibleLevel, keptLevel) need uploading.
+        uint32_t       keptLevel  = std::max(textureVisibleLevel, visibleLevel);
+        bool           reallocate = firstLevel != textureFirstLevel;
+        VkImage        oldImage   = textureImage;
+        VkDeviceMemory oldMemory  = textureImageMemory;
+        uint32_t       oldFirst   = textureFirstLevel;
+
+        if (reallocate)
+        {
+            const TextureData::Level& level = chain.levels[firstLevel];
+            createImage(
+                level.width,
+                level.height,
+                mipLevels - firstLevel,
+                VK_SAMPLE_COUNT_1_BIT,
+                VK_FORMAT_R8G8B8A8_SRGB,
+                VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                textureImage,
+                textureImageMemory);
+            textureFirstLevel = firstLevel;
+            textureReallocations++;
+
+            VkMemoryRequirements memRequirements;
+            vkGetImageMemoryRequirements(device, textureImage, &memRequirements);
+            textureAllocatedBytes = memRequirements.size;
+            textureAllocatedPeak  = std::max(textureAllocatedPeak, textureAllocatedBytes);
+        }
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+
+        if (reallocate)
+        {
+            recordTextureBarrier(
+                commandBuffer,
+                textureImage,
+                0,
+                mipLevels - firstLevel,
+                VK_IMAGE_LAYOUT_UNDEFINED,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                0,
+                VK_ACCESS_TRANSFER_WRITE_BIT);
+
+            if (keptLevel < mipLevels)
+            {
+                // The frames reading the old image were submitted earlier; their reads only have to finish before
+                // the layout changes.
+                recordTextureBarrier(
+                    commandBuffer,
+                    oldImage,
+                    keptLevel - oldFirst,
+                    mipLevels - keptLevel,
+                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                    0,
+                    VK_ACCESS_TRANSFER_READ_BIT);
+
+                std::vector<VkImageCopy> copies;
+                for (uint32_t level = keptLevel; level < mipLevels; level++)
+                {
+                    VkImageCopy copy{};
+                    copy.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - oldFirst, 0, 1};
+                    copy.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - firstLevel, 0, 1};
+                    copy.extent         = {chain.levels[level].width, chain.levels[level].height, 1};
+                    copies.push_back(copy);
+                }
+
+                vkCmdCopyImage(
+                    commandBuffer,
+                    oldImage,
+                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    textureImage,
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    static_cast<uint32_t>(copies.size()),
+                    copies.data());
+            }
+        }
+
+        VkBuffer       stagingBuffer       = VK_NULL_HANDLE;
+        VkDeviceMemory stagingBufferMemory = VK_NULL_HANDLE;
+        if (visibleLevel < keptLevel)
+        {
+            VkDeviceSize uploadSize = 0;
+            for (uint32_t level = visibleLevel; level < keptLevel; level++)
+            {
+                uploadSize += chain.levels[level].pixels.size();
+            }
+
+            createBuffer(
+                uploadSize,
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                stagingBuffer,
+                stagingBufferMemory);
+
+            void* data;
+            vkMapMemory(device, stagingBufferMemory, 0, uploadSize, 0, &data);
+
+            std::vector<VkBufferImageCopy> regions;
+            VkDeviceSize                   offset = 0;
+            for (uint32_t level = visibleLevel; level < keptLevel; level++)
+            {
+                const TextureData::Level& source = chain.levels[level];
+                memcpy(static_cast<uint8_t*>(data) + offset, source.pixels.data(), source.pixels.size());
+
+                VkBufferImageCopy region{};
+                region.bufferOffset     = offset;
+                region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - textureFirstLevel, 0, 1};
+                region.imageExtent      = {source.width, source.height, 1};
+                regions.push_back(region);
+
+                offset += source.pixels.size();
+            }
+            vkUnmapMemory(device, stagingBufferMemory);
+
+            // Frames in flight clamp above these levels, so only their layout has to wait for them.
+            if (!reallocate)
+            {
+                recordTextureBarrier(
+                    commandBuffer,
+                    textureImage,
+                    visibleLevel - textureFirstLevel,
+                    keptLevel - visibleLevel,
+                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                    0,
+                    VK_ACCESS_TRANSFER_WRITE_BIT);
+            }
+
+            vkCmdCopyBufferToImage(
+                commandBuffer,
+                stagingBuffer,
+                textureImage,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                static_cast<uint32_t>(regions.size()),
+                regions.data());
+
+            textureLevelsUploaded += keptLevel - visibleLevel;
+            textureBytesUploaded += uploadSize;
+        }
+
+        // Everything the views cover returns to the shader read layout: after a reallocation the whole image, the
+        // levels not uploaded yet included, otherwise just the uploaded ones.
+        uint32_t readableBegin = reallocate ? firstLevel : visibleLevel;
+        uint32_t readableEnd   = reallocate ? mipLevels : keptLevel;
+        if (readableBegin < readableEnd)
+        {
+            recordTextureBarrier(
+                commandBuffer,
+                textureImage,
+                readableBegin - textureFirstLevel,
+                readableEnd - readableBegin,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_ACCESS_SHADER_READ_BIT);
+        }
+
+        endSingleTimeCommands(commandBuffer);
+
+        if (stagingBuffer != VK_NULL_HANDLE)
+        {
+            deletionQueue.retire(stagingBuffer);
+            deletionQueue.retire(stagingBufferMemory);
+        }
+        if (reallocate && oldImage != VK_NULL_HANDLE)
+        {
+            deletionQueue.retire(oldImage);
+            deletionQueue.retire(oldMemory);
+        }
+
+        textureVisibleLevel = visibleLevel;
+    }
+
+    // One barrier over levels [baseLevel, baseLevel + levelCount) of a streamed texture image. The destination stage
+    // follows from the access: transfers, or the fragment shader for reads.
+    void recordTextureBarrier(
+        VkCommandBuffer      commandBuffer,
+        VkImage              image,
+        uint32_t             baseLevel,
+        uint32_t             levelCount,
+        VkImageLayout        oldLayout,
+        VkImageLayout        newLayout,
+        VkPipelineStageFlags srcStage,
+        VkAccessFlags        srcAccess,
+        VkAccessFlags        dstAccess)
+    {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask       = srcAccess;
+        barrier.dstAccessMask       = dstAccess;
+        barrier.oldLayout           = oldLayout;
+        barrier.newLayout           = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image               = image;
+        barrier.subresourceRange    = {VK_IMAGE_ASPECT_COLOR_BIT, baseLevel, levelCount, 0, 1};
+
+        VkPipelineStageFlags dstStage = dstAccess == VK_ACCESS_SHADER_READ_BIT ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+                                                                               : VK_PIPELINE_STAGE_TRANSFER_BIT;
+        vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    // Asks for the level the nearest visible object needs and moves the texture one step towards the residency
+    // decided for it: an eviction, or one more level uploaded, into a larger image if need be. Only a new image brings
+    // new views, and every command buffer is re-recorded with them before it is next submitted.
+    void streamTexture()
+    {
+        if (!textureResidency)
+        {
+            return;
+        }
+
+        CPU_ZONE("streamTexture");
+
+        // Every object is the same mesh at the same scale, so the nearest visible one needs the finest level.
+        std::optional<float> nearest;
+        for (const ObjectData& object : objects)
+        {
+            glm::vec3 center(object.boundingSphere);
+            float     radius = object.boundingSphere.w;
+
+            bool inside = true;
+            for (const glm::vec4& plane : objectFrustum)
+            {
+                inside = inside && glm::dot(glm::vec3(plane), center) + plane.w >= -radius;
+            }
+            if (inside)
+            {
+                float depth = std::max(-(sceneToView * glm::vec4(center, 1.0f)).z - radius, sceneNearPlane);
+                nearest     = std::min(depth, nearest.value_or(depth));
+            }
+        }
+
+        uint32_t textureSize   = streamedMips->texture().width();
+        float    pixelsPerUnit = nearest ? projectionScale * renderExtent.height * 0.5f / *nearest : 0.0f;
+        uint32_t wantedLevel   = wantedMipLevel(textureSize, textureUvDensity, pixelsPerUnit, mipLevels);
+        uint32_t firstLevel    = textureResidency->update(wantedLevel);
+
+        // Evicted levels disappear at once; missing ones arrive one per frame, coarsest first, and only once they have
+        // been filtered.
+        uint32_t visibleLevel = textureVisibleLevel;
+        if (firstLevel > visibleLevel)
+        {
+            visibleLevel = firstLevel;
+        }
+        else if (firstLevel < visibleLevel && visibleLevel - 1 >= streamedMips->readyLevel())
+        {
+            visibleLevel--;
+        }
+
+        if (firstLevel == textureFirstLevel && visibleLevel == textureVisibleLevel)
+        {
+            return;
+        }
+
+        // A step creates a staging buffer, and an image and views when the first level moves, and retires the old ones.
+        UncountedHeapAllocations streamingStep;
+        bool                     reallocate = firstLevel != textureFirstLevel;
+        updateStreamedTexture(firstLevel, visibleLevel);
+        textureStreamSteps++;
+
+        // An upload only moves the uniform buffer's clamp. A new image needs new views, which every command buffer is
+        // re-recorded with.
+        if (!reallocate)
+        {
+            return;
+        }
 
-        if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+        for (size_t material = 1; material < materialImageViews.size(); material++)
         {
-            throw std::runtime_error("texture image format does not support linear blitting!");
+            deletionQueue.retire(materialImageViews[material]);
         }
+        deletionQueue.retire(textureImageView);
+        createTextureImageView();
+
+        // Cached material sets refer to the old views, and a new view may come back with an old one's handle.
+        descriptorCache.clear(&deletionQueue);
+        staleCommandBuffers.assign(commandBuffers.size(), true);
+    }
 
+    // The caller has checked that the image's format supports linear filtering in blits.
+    void generateMipmaps(VkImage image, int32_t texWidth, int32_t texHeight, uint32_t mipLevels)
+    {
         VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
         VkImageMemoryBarrier barrier{};
@@ -673,19 +2186,63 @@ class HelloTriangleApplication {
         return commandBuffer;
     }
 
+    // Submits without waiting. The barrier makes the commands' writes visible to everything submitted to the queue
+    // later, and the command buffer and whatever the caller retires afterwards go once the submission has finished.
     void endSingleTimeCommands(VkCommandBuffer commandBuffer)
     {
-        vkEndCommandBuffer(commandBuffer);
-
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers    = &commandBuffer;
+        VkMemoryBarrier barrier{};
+        barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
 
-        vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(graphicsQueue);
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            0,
+            1,
+            &barrier,
+            0,
+            nullptr,
+            0,
+            nullptr);
+
+        vkEndCommandBuffer(commandBuffer);
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers    = &commandBuffer;
+
+        if (submitGraphics(submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to submit single-use command buffer!");
+        }
+
+        deletionQueue.retire(commandPool, commandBuffer);
+    }
 
-        vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+    // Submits batch to the graphics queue as the deletion queue's next submission. With a timeline, a second batch
+    // signals it; a semaphore signal covers every command submitted before it on the queue, so the value is reached
+    // once batch has finished.
+    VkResult submitGraphics(const VkSubmitInfo& batch, VkFence fence)
+    {
+        uint64_t    submission = deletionQueue.nextSubmission();
+        VkSemaphore timeline   = deletionQueue.timeline();
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues    = &submission;
+
+        std::array<VkSubmitInfo, 2> batches{batch, VkSubmitInfo{}};
+        batches[1].sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        batches[1].pNext                = &timelineInfo;
+        batches[1].signalSemaphoreCount = 1;
+        batches[1].pSignalSemaphores    = &timeline;
+
+        uint32_t batchCount = timeline != VK_NULL_HANDLE ? 2 : 1;
+        return vkQueueSubmit(graphicsQueue, batchCount, batches.data(), fence);
     }
 
     void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
@@ -720,26 +2277,10 @@ class HelloTriangleApplication {
         barrier.subresourceRange.levelCount     = mipLevels;
         barrier.subresourceRange.baseArrayLayer = 0;
         barrier.subresourceRange.layerCount     = 1;
-        barrier.srcAccessMask                   = 0; // TODO
-        barrier.dstAccessMask                   = 0; // TODO
 
         VkPipelineStageFlags sourceStage;
         VkPipelineStageFlags destinationStage;
 
-        if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
-        {
-            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-
-            if (hasStencilComponent(format))
-            {
-                barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
-            }
-        }
-        else
-        {
-            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        }
-
         if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
         {
             barrier.srcAccessMask = 0;
@@ -757,16 +2298,6 @@ class HelloTriangleApplication {
             sourceStage      = VK_PIPELINE_STAGE_TRANSFER_BIT;
             destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
         }
-        else if (
-            oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
-        {
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask =
-                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-            sourceStage      = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destinationStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        }
         else
         {
             throw std::invalid_argument("unsupported layout transition!");
@@ -777,24 +2308,41 @@ class HelloTriangleApplication {
         endSingleTimeCommands(commandBuffer);
     }
 
-    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+    // Copies each of texture's levels from buffer, where they lie back to back, to the image's level of that index.
+    void copyBufferToImage(VkBuffer buffer, VkImage image, const TextureData& texture)
     {
         VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
-        VkBufferImageCopy region{};
-        region.bufferOffset      = 0;
-        region.bufferRowLength   = 0;
-        region.bufferImageHeight = 0;
+        std::vector<VkBufferImageCopy> regions;
+        VkDeviceSize                   offset = 0;
+        for (uint32_t i = 0; i < texture.levels.size(); i++)
+        {
+            const TextureData::Level& level = texture.levels[i];
+
+            VkBufferImageCopy region{};
+            region.bufferOffset      = offset;
+            region.bufferRowLength   = 0;
+            region.bufferImageHeight = 0;
 
-        region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel       = 0;
-        region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount     = 1;
+            region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel       = i;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount     = 1;
 
-        region.imageOffset = {0, 0, 0};
-        region.imageExtent = {width, height, 1};
+            region.imageOffset = {0, 0, 0};
+            region.imageExtent = {level.width, level.height, 1};
+
+            regions.push_back(region);
+            offset += level.pixels.size();
+        }
 
-        vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        vkCmdCopyBufferToImage(
+            commandBuffer,
+            buffer,
+            image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(regions.size()),
+            regions.data());
 
         endSingleTimeCommands(commandBuffer);
     }
@@ -826,7 +2374,7 @@ class HelloTriangleApplication {
         imageInfo.samples       = numSamples;
         imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
 
-        if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+        if (vkCreateImage(device, &imageInfo, allocator, &image) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create image!");
         }
@@ -839,7 +2387,7 @@ class HelloTriangleApplication {
         allocInfo.allocationSize  = memRequirements.size;
         allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
 
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
+        if (vkAllocateMemory(device, &allocInfo, allocator, &imageMemory) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to allocate image memory!");
         }
@@ -847,26 +2395,140 @@ class HelloTriangleApplication {
         vkBindImageMemory(device, image, imageMemory, 0);
     }
 
-    void createDescriptorPool()
+    void createImageWriter()
     {
-        std::array<VkDescriptorPoolSize, 2> poolSizes{};
-        poolSizes[0].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        poolSizes[0].descriptorCount = static_cast<uint32_t>(swapChainImages.size());
-        poolSizes[1].type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSizes[1].descriptorCount = static_cast<uint32_t>(swapChainImages.size());
+        if (options.outputDirectory.empty())
+        {
+            return;
+        }
 
-        VkDescriptorPoolCreateInfo poolInfo{};
-        poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-        poolInfo.pPoolSizes    = poolSizes.data();
-        poolInfo.maxSets       = static_cast<uint32_t>(swapChainImages.size());
+        // The render thread keeps one core; the queue holds enough frames to keep every worker busy.
+        uint32_t workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        imageWriter.emplace(options.outputDirectory, workerCount, workerCount * 2);
+    }
+
+    void createFrustumCuller()
+    {
+        if (!options.cpuCulling)
+        {
+            return;
+        }
+
+        // The render thread takes part in every loop, so it counts as one of the threads.
+        cullingPool.emplace(std::max(1u, std::thread::hardware_concurrency()) - 1);
+        frustumCuller.emplace(*cullingPool);
+    }
+
+    // One buffer per swap chain image, mapped for the application's lifetime. Cached memory is preferred since the
+    // CPU reads every byte back.
+    void createReadbackBuffers()
+    {
+        if (!imageWriter)
+        {
+            return;
+        }
+
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+        VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        VkMemoryPropertyFlags cached     = properties | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+        {
+            if ((memoryProperties.memoryTypes[i].propertyFlags & cached) == cached)
+            {
+                properties = cached;
+                break;
+            }
+        }
+
+        VkDeviceSize imageSize = VkDeviceSize(swapChainExtent.width) * swapChainExtent.height * 4;
+
+        readbackBuffers.resize(swapChainImages.size());
+        readbackBuffersMemory.resize(swapChainImages.size());
+        readbackData.resize(swapChainImages.size());
+        readbackFrames.assign(swapChainImages.size(), 0);
+        readbackPending.assign(swapChainImages.size(), false);
+
+        for (size_t i = 0; i < swapChainImages.size(); i++)
+        {
+            createBuffer(
+                imageSize,
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                properties,
+                readbackBuffers[i],
+                readbackBuffersMemory[i]);
+            vkMapMemory(device, readbackBuffersMemory[i], 0, imageSize, 0, &readbackData[i]);
+        }
+    }
+
+    // Called once the image's fence has signalled, so the copy into the readback buffer is complete.
+    void collectReadback(uint32_t imageIndex)
+    {
+        if (!imageWriter || !readbackPending[imageIndex])
+        {
+            return;
+        }
 
-        if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        CPU_ZONE("collectReadback");
+
+        imageWriter->submit(
+            readbackFrames[imageIndex],
+            readbackData[imageIndex],
+            swapChainExtent.width,
+            swapChainExtent.height);
+        readbackPending[imageIndex] = false;
+    }
+
+    // Hands every outstanding frame to the writer, oldest first. Every frame in flight must have finished.
+    void collectReadbacks()
+    {
+        if (!imageWriter)
+        {
+            return;
+        }
+
+        std::vector<uint32_t> pending;
+        for (uint32_t i = 0; i < readbackPending.size(); i++)
+        {
+            if (readbackPending[i])
+            {
+                pending.push_back(i);
+            }
+        }
+
+        std::sort(
+            pending.begin(),
+            pending.end(),
+            [this](uint32_t a, uint32_t b) { return readbackFrames[a] < readbackFrames[b]; });
+        for (uint32_t imageIndex : pending)
         {
-            throw std::runtime_error("failed to create descriptor pool!");
+            collectReadback(imageIndex);
         }
     }
 
+    // The pools grow as sets are allocated, so nothing here depends on the swap chain or the scene.
+    void createDescriptorAllocators()
+    {
+        // The graphics set holds a uniform buffer and four storage buffers, the culling set a uniform buffer, four
+        // storage buffers and the depth pyramid, and each depth pyramid level's set a sampler and two storage images.
+        swapChainDescriptors.create(
+            device,
+            {{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f},
+             {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4.0f},
+             {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f},
+             {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2.0f}},
+            DESCRIPTOR_SETS_PER_POOL,
+            allocator);
+
+        // Material sets hold one texture.
+        descriptorCache.create(
+            device,
+            {{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f}},
+            DESCRIPTOR_SETS_PER_POOL,
+            allocator);
+    }
+
     void createUniformBuffers()
     {
         VkDeviceSize bufferSize = sizeof(UniformBufferObject);
@@ -885,36 +2547,174 @@ class HelloTriangleApplication {
         }
     }
 
+    // Every image gets its own lights, cluster ranges and light indices, written by the CPU each frame through
+    // persistent mappings. They exist even without lights so the fragment shader's bindings are always valid.
+    void createLightBuffers()
+    {
+        VkDeviceSize lightsSize   = sizeof(PointLight) * std::max(1u, options.lightCount);
+        VkDeviceSize clustersSize = sizeof(LightClusters::Range) * LightClusters::clusterCount;
+        VkDeviceSize indicesSize  = sizeof(uint32_t) * lightIndexCapacity();
+
+        lightClusters.reserveIndices(lightIndexCapacity());
+
+        lightBuffers.resize(swapChainImages.size());
+        lightBuffersMemory.resize(swapChainImages.size());
+        lightData.resize(swapChainImages.size());
+        clusterBuffers.resize(swapChainImages.size());
+        clusterBuffersMemory.resize(swapChainImages.size());
+        clusterData.resize(swapChainImages.size());
+        lightIndexBuffers.resize(swapChainImages.size());
+        lightIndexBuffersMemory.resize(swapChainImages.size());
+        lightIndexData.resize(swapChainImages.size());
+
+        auto createMappedBuffer = [this](VkDeviceSize size, VkBuffer& buffer, VkDeviceMemory& memory, void*& data)
+        {
+            createBuffer(
+                size,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                buffer,
+                memory);
+            vkMapMemory(device, memory, 0, size, 0, &data);
+            memset(data, 0, static_cast<size_t>(size));
+        };
+
+        for (size_t i = 0; i < swapChainImages.size(); i++)
+        {
+            createMappedBuffer(lightsSize, lightBuffers[i], lightBuffersMemory[i], lightData[i]);
+            createMappedBuffer(clustersSize, clusterBuffers[i], clusterBuffersMemory[i], clusterData[i]);
+            createMappedBuffer(indicesSize, lightIndexBuffers[i], lightIndexBuffersMemory[i], lightIndexData[i]);
+        }
+    }
+
+    size_t lightIndexCapacity() const
+    {
+        return static_cast<size_t>(LightClusters::clusterCount) *
+               std::clamp(options.lightCount, 1u, LIGHT_INDICES_PER_CLUSTER);
+    }
+
     void createDescriptorSetLayout()
     {
         VkDescriptorSetLayoutBinding uboLayoutBinding{};
         uboLayoutBinding.binding         = 0;
         uboLayoutBinding.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
         uboLayoutBinding.descriptorCount = 1;
-        uboLayoutBinding.stageFlags      = VK_SHADER_STAGE_VERTEX_BIT;
+        uboLayoutBinding.stageFlags      = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 
-        VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-        samplerLayoutBinding.binding            = 1;
-        samplerLayoutBinding.descriptorCount    = 1;
-        samplerLayoutBinding.descriptorType     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        samplerLayoutBinding.pImmutableSamplers = nullptr;
-        samplerLayoutBinding.stageFlags         = VK_SHADER_STAGE_FRAGMENT_BIT;
+        VkDescriptorSetLayoutBinding objectLayoutBinding{};
+        objectLayoutBinding.binding         = 2;
+        objectLayoutBinding.descriptorCount = 1;
+        objectLayoutBinding.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        objectLayoutBinding.stageFlags      = VK_SHADER_STAGE_VERTEX_BIT;
 
-        std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
-        VkDescriptorSetLayoutCreateInfo             layoutInfo{};
+        // Clustered lighting: 3 = lights, 4 = cluster ranges, 5 = light indices.
+        std::array<VkDescriptorSetLayoutBinding, 3> lightBindings{};
+        for (uint32_t i = 0; i < lightBindings.size(); i++)
+        {
+            lightBindings[i].binding         = 3 + i;
+            lightBindings[i].descriptorCount = 1;
+            lightBindings[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            lightBindings[i].stageFlags      = VK_SHADER_STAGE_FRAGMENT_BIT;
+        }
+
+        // Binding 1, the texture, moved to the material set.
+        std::array<VkDescriptorSetLayoutBinding, 5> bindings = {
+            uboLayoutBinding,
+            objectLayoutBinding,
+            lightBindings[0],
+            lightBindings[1],
+            lightBindings[2]};
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
         layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
         layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
         layoutInfo.pBindings    = bindings.data();
 
-        if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+        if (vkCreateDescriptorSetLayout(device, &layoutInfo, allocator, &descriptorSetLayout) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create descriptor set layout!");
         }
+
+        // Set 1, per material: 0 = texture. With bindless textures there is one set and binding 0 is an array of
+        // every material's texture.
+        VkDescriptorSetLayoutBinding samplerLayoutBinding{};
+        samplerLayoutBinding.binding            = 0;
+        samplerLayoutBinding.descriptorCount    = options.bindless ? bindlessTextureCapacity : 1;
+        samplerLayoutBinding.descriptorType     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        samplerLayoutBinding.pImmutableSamplers = nullptr;
+        samplerLayoutBinding.stageFlags         = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        VkDescriptorBindingFlags bindlessFlags =
+            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+        bindingFlagsInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsInfo.bindingCount  = 1;
+        bindingFlagsInfo.pBindingFlags = &bindlessFlags;
+
+        VkDescriptorSetLayoutCreateInfo materialLayoutInfo{};
+        materialLayoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        materialLayoutInfo.pNext        = options.bindless ? &bindingFlagsInfo : nullptr;
+        materialLayoutInfo.flags =
+            options.bindless ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT : 0;
+        materialLayoutInfo.bindingCount = 1;
+        materialLayoutInfo.pBindings    = &samplerLayoutBinding;
+
+        if (vkCreateDescriptorSetLayout(device, &materialLayoutInfo, allocator, &materialDescriptorSetLayout) !=
+            VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create material descriptor set layout!");
+        }
+
+        // Culling: 0 = uniforms with frustum planes, 1 = objects, 2 = draw commands, 3 = draw counts and statistics,
+        // 4 = per-object visibility, 5 = depth pyramid.
+        std::array<VkDescriptorSetLayoutBinding, 6> cullBindings{};
+        for (uint32_t i = 0; i < cullBindings.size(); i++)
+        {
+            cullBindings[i].binding         = i;
+            cullBindings[i].descriptorCount = 1;
+            cullBindings[i].descriptorType =
+                i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            cullBindings[i].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        cullBindings[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+        VkDescriptorSetLayoutCreateInfo cullLayoutInfo{};
+        cullLayoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        cullLayoutInfo.bindingCount = static_cast<uint32_t>(cullBindings.size());
+        cullLayoutInfo.pBindings    = cullBindings.data();
+
+        if (vkCreateDescriptorSetLayout(device, &cullLayoutInfo, allocator, &cullDescriptorSetLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create culling descriptor set layout!");
+        }
+
+        // Depth pyramid reduction: 0 = multisampled depth, 1 = previous level, 2 = level being written.
+        std::array<VkDescriptorSetLayoutBinding, 3> hizBindings{};
+        for (uint32_t i = 0; i < hizBindings.size(); i++)
+        {
+            hizBindings[i].binding         = i;
+            hizBindings[i].descriptorCount = 1;
+            hizBindings[i].descriptorType =
+                i == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            hizBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+
+        VkDescriptorSetLayoutCreateInfo hizLayoutInfo{};
+        hizLayoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        hizLayoutInfo.bindingCount = static_cast<uint32_t>(hizBindings.size());
+        hizLayoutInfo.pBindings    = hizBindings.data();
+
+        if (vkCreateDescriptorSetLayout(device, &hizLayoutInfo, allocator, &hizDescriptorSetLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create depth pyramid descriptor set layout!");
+        }
     }
 
     void createIndexBuffer()
     {
-        VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+        CPU_ZONE("createIndexBuffer");
+
+        VkDeviceSize bufferSize = sizeof(model.indices[0]) * model.indices.size();
 
         VkBuffer       stagingBuffer;
         VkDeviceMemory stagingBufferMemory;
@@ -927,7 +2727,7 @@ class HelloTriangleApplication {
 
         void* data;
         vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, indices.data(), (size_t)bufferSize);
+        memcpy(data, model.indices.data(), (size_t)bufferSize);
         vkUnmapMemory(device, stagingBufferMemory);
 
         createBuffer(
@@ -939,24 +2739,19 @@ class HelloTriangleApplication {
 
         copyBuffer(stagingBuffer, indexBuffer, bufferSize);
 
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        deletionQueue.retire(stagingBuffer);
+        deletionQueue.retire(stagingBufferMemory);
     }
 
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
     {
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+        int32_t memoryType = findMemoryTypeIndex(memoryProperties, typeFilter, properties);
+        if (memoryType < 0)
         {
-            if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
-            {
-                return i;
-            }
+            throw std::runtime_error("failed to find suitable memory type!");
         }
 
-        throw std::runtime_error("failed to find suitable memory type!");
+        return static_cast<uint32_t>(memoryType);
     }
 
     void createBuffer(
@@ -972,7 +2767,7 @@ class HelloTriangleApplication {
         bufferInfo.usage       = usage;
         bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-        if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+        if (vkCreateBuffer(device, &bufferInfo, allocator, &buffer) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create buffer!");
         }
@@ -985,7 +2780,7 @@ class HelloTriangleApplication {
         allocInfo.allocationSize  = memRequirements.size;
         allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
 
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
+        if (vkAllocateMemory(device, &allocInfo, allocator, &bufferMemory) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to allocate buffer memory!");
         }
@@ -995,7 +2790,9 @@ class HelloTriangleApplication {
 
     void createVertexBuffer()
     {
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+        CPU_ZONE("createVertexBuffer");
+
+        VkDeviceSize bufferSize = sizeof(model.vertices[0]) * model.vertices.size();
 
         VkBuffer       stagingBuffer;
         VkDeviceMemory stagingBufferMemory;
@@ -1008,7 +2805,7 @@ class HelloTriangleApplication {
 
         void* data;
         vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, vertices.data(), (size_t)bufferSize);
+        memcpy(data, model.vertices.data(), (size_t)bufferSize);
         vkUnmapMemory(device, stagingBufferMemory);
 
         createBuffer(
@@ -1020,134 +2817,325 @@ class HelloTriangleApplication {
 
         copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
 
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        deletionQueue.retire(stagingBuffer);
+        deletionQueue.retire(stagingBufferMemory);
     }
 
+    // Hands everything sized to the swap chain to the deletion queue; frames still in flight may be using it.
     void cleanupSwapChain()
     {
-        vkDestroyImageView(device, colorImageView, nullptr);
-        vkDestroyImage(device, colorImage, nullptr);
-        vkFreeMemory(device, colorImageMemory, nullptr);
+        frameGraph.destroy(&deletionQueue);
+
+        if (frameTimestamps)
+        {
+            deletionQueue.retire(timestampQueryPool);
+        }
+
+        // Its results are collected before the swap chain goes, so its queries are finished with.
+        if (gpuProfiler)
+        {
+            gpuProfiler->destroy();
+        }
 
-        vkDestroyImageView(device, depthImageView, nullptr);
-        vkDestroyImage(device, depthImage, nullptr);
-        vkFreeMemory(device, depthImageMemory, nullptr);
+        if (options.gpuDriven)
+        {
+            for (size_t i = 0; i < depthPyramidMipViews.size(); i++)
+            {
+                deletionQueue.retire(depthPyramidMipViews[i]);
+            }
+            deletionQueue.retire(depthPyramidView);
+            deletionQueue.retire(depthPyramid);
+            deletionQueue.retire(depthPyramidMemory);
+        }
 
         for (size_t i = 0; i < swapChainFramebuffers.size(); i++)
         {
-            vkDestroyFramebuffer(device, swapChainFramebuffers[i], nullptr);
+            deletionQueue.retire(swapChainFramebuffers[i]);
         }
 
-        vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+        for (size_t i = 0; i < commandBuffers.size(); i++)
+        {
+            deletionQueue.retire(commandPool, commandBuffers[i]);
+        }
+
+        deletionQueue.retire(graphicsPipeline);
+        deletionQueue.retire(pipelineLayout);
+        deletionQueue.retire(renderPass);
 
-        vkDestroyPipeline(device, graphicsPipeline, nullptr);
-        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-        vkDestroyRenderPass(device, renderPass, nullptr);
+        if (options.hiz)
+        {
+            deletionQueue.retire(lateRenderPass);
+        }
 
         for (size_t i = 0; i < swapChainImageViews.size(); i++)
         {
-            vkDestroyImageView(device, swapChainImageViews[i], nullptr);
+            deletionQueue.retire(swapChainImageViews[i]);
+        }
+
+        if (options.headless)
+        {
+            for (size_t i = 0; i < swapChainImages.size(); i++)
+            {
+                deletionQueue.retire(swapChainImages[i]);
+                deletionQueue.retire(offscreenImagesMemory[i]);
+            }
+        }
+        else
+        {
+            // Still valid for createSwapChain() to pass as the old swap chain. Its last presents may still be queued,
+            // so it waits for the new one to present before it is retired.
+            retiredSwapChains.push_back(swapChain);
+            retiredPresentSemaphores.insert(
+                retiredPresentSemaphores.end(),
+                renderFinishedSemaphores.begin(),
+                renderFinishedSemaphores.end());
+            renderFinishedSemaphores.clear();
         }
 
-        vkDestroySwapchainKHR(device, swapChain, nullptr);
+        for (size_t i = 0; i < readbackBuffers.size(); i++)
+        {
+            deletionQueue.retire(readbackBuffers[i]);
+            deletionQueue.retire(readbackBuffersMemory[i]);
+        }
+        readbackBuffers.clear();
 
         for (size_t i = 0; i < swapChainImages.size(); i++)
         {
-            vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-            vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
+            deletionQueue.retire(uniformBuffers[i]);
+            deletionQueue.retire(uniformBuffersMemory[i]);
         }
 
-        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+        for (size_t i = 0; i < lightBuffers.size(); i++)
+        {
+            deletionQueue.retire(lightBuffers[i]);
+            deletionQueue.retire(lightBuffersMemory[i]);
+            deletionQueue.retire(clusterBuffers[i]);
+            deletionQueue.retire(clusterBuffersMemory[i]);
+            deletionQueue.retire(lightIndexBuffers[i]);
+            deletionQueue.retire(lightIndexBuffersMemory[i]);
+        }
+
+        for (size_t i = 0; i < drawCommandBuffers.size(); i++)
+        {
+            deletionQueue.retire(drawCommandBuffers[i]);
+            deletionQueue.retire(drawCommandBuffersMemory[i]);
+            deletionQueue.retire(drawCountBuffers[i]);
+            deletionQueue.retire(drawCountBuffersMemory[i]);
+        }
+
+        for (size_t i = 0; i < cullStatsBuffers.size(); i++)
+        {
+            deletionQueue.retire(cullStatsBuffers[i]);
+            deletionQueue.retire(cullStatsBuffersMemory[i]);
+        }
+
+        swapChainDescriptors.reset(&deletionQueue);
     }
 
     void recreateSwapChain()
     {
+        CPU_ZONE("recreateSwapChain");
+
+        swapChainRecreations++;
+        presentsSinceRecreation = 0;
+
         int width = 0, height = 0;
-        while (width == 0 || height == 0)
+        while (!options.headless && (width == 0 || height == 0))
         {
             glfwGetFramebufferSize(window, &width, &height);
             glfwWaitEvents();
         }
 
-        vkDeviceWaitIdle(device);
+        // The old resources outlive the frames still using them in the deletion queue, so only reading back results
+        // needs those frames to finish: the readback buffers and profiler queries are about to go.
+        if (imageWriter || gpuProfiler)
+        {
+            vkWaitForFences(
+                device,
+                static_cast<uint32_t>(inFlightFences.size()),
+                inFlightFences.data(),
+                VK_TRUE,
+                UINT64_MAX);
+        }
 
+        collectReadbacks();
+        collectGpuProfiles();
         cleanupSwapChain();
 
+        if (qualityChangePending)
+        {
+            applyQualityLevel();
+            reportQualityLevel();
+            qualityChangePending = false;
+        }
+
         createSwapChain();
         createImageViews();
-        createRenderPass();
+        createRenderPasses();
         createGraphicsPipeline();
-        createColorResources();
-        createDepthResources();
-        createFramebuffers();
+        createDepthPyramid();
         createUniformBuffers();
-        createDescriptorPool();
+        createLightBuffers();
+        createIndirectBuffers();
+        createReadbackBuffers();
+        createFrameGraph();
+        createFramebuffers();
         createDescriptorSets();
+        createTimestampQueryPool();
+        createProfilerQueryPools();
         createCommandBuffers();
+
+        // The fences recorded for the old images say nothing about the new ones.
+        imagesInFlight.assign(swapChainImages.size(), VK_NULL_HANDLE);
     }
 
     void createDescriptorSets()
     {
-        std::vector<VkDescriptorSetLayout> layouts(swapChainImages.size(), descriptorSetLayout);
+        descriptorSets.resize(swapChainImages.size());
+        for (size_t i = 0; i < swapChainImages.size(); i++)
+        {
+            descriptorSets[i] = swapChainDescriptors.allocate(
+                descriptorSetLayout,
+                DescriptorBindings()
+                    .buffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniformBuffers[i], 0, sizeof(UniformBufferObject))
+                    .buffer(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, objectBuffer)
+                    .buffer(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, lightBuffers[i])
+                    .buffer(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, clusterBuffers[i])
+                    .buffer(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, lightIndexBuffers[i]));
+        }
+
+        if (options.gpuDriven)
+        {
+            createCullDescriptorSets();
+        }
+
+        if (options.hiz)
+        {
+            createHiZDescriptorSets();
+        }
+    }
+
+    // Looked up wherever a material is bound; the cache allocates and writes its set the first time and returns the
+    // same set after that, across swap chain recreations too.
+    VkDescriptorSet materialDescriptorSet(uint32_t material)
+    {
+        return descriptorCache.get(
+            materialDescriptorSetLayout,
+            DescriptorBindings().image(
+                0,
+                VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                materialImageViews[material],
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                textureSampler));
+    }
+
+    // One set for the whole run holding every material's texture at the material's index. Slots past the last
+    // material stay unwritten, which partial binding allows, and update-after-bind lets textures be added while
+    // recorded command buffers use the set.
+    void createBindlessDescriptorSet()
+    {
+        if (!options.bindless)
+        {
+            return;
+        }
+
+        VkDescriptorPoolSize poolSize{};
+        poolSize.type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        poolSize.descriptorCount = bindlessTextureCapacity;
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+        poolInfo.maxSets       = 1;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes    = &poolSize;
+
+        if (vkCreateDescriptorPool(device, &poolInfo, allocator, &bindlessDescriptorPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create bindless descriptor pool!");
+        }
 
         VkDescriptorSetAllocateInfo allocInfo{};
         allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        allocInfo.descriptorPool     = descriptorPool;
-        allocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImages.size());
-        allocInfo.pSetLayouts        = layouts.data();
+        allocInfo.descriptorPool     = bindlessDescriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts        = &materialDescriptorSetLayout;
 
-        descriptorSets.resize(swapChainImages.size());
-        if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+        if (vkAllocateDescriptorSets(device, &allocInfo, &bindlessDescriptorSet) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate bindless descriptor set!");
+        }
+
+        std::vector<VkDescriptorImageInfo> imageInfos(materialImageViews.size());
+        for (size_t material = 0; material < materialImageViews.size(); material++)
         {
-            throw std::runtime_error("failed to allocate descriptor sets!");
+            imageInfos[material].sampler     = textureSampler;
+            imageInfos[material].imageView   = materialImageViews[material];
+            imageInfos[material].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
         }
 
+        VkWriteDescriptorSet write{};
+        write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet          = bindlessDescriptorSet;
+        write.dstBinding      = 0;
+        write.dstArrayElement = 0;
+        write.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.descriptorCount = static_cast<uint32_t>(imageInfos.size());
+        write.pImageInfo      = imageInfos.data();
+
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+    }
+
+    void createCullDescriptorSets()
+    {
+        cullDescriptorSets.resize(swapChainImages.size());
         for (size_t i = 0; i < swapChainImages.size(); i++)
         {
-            VkDescriptorBufferInfo bufferInfo{};
-            bufferInfo.buffer = uniformBuffers[i];
-            bufferInfo.offset = 0;
-            bufferInfo.range  = sizeof(UniformBufferObject);
-
-            VkDescriptorImageInfo imageInfo{};
-            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            imageInfo.imageView   = textureImageView;
-            imageInfo.sampler     = textureSampler;
-
-            std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-
-            descriptorWrites[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[0].dstSet          = descriptorSets[i];
-            descriptorWrites[0].dstBinding      = 0;
-            descriptorWrites[0].dstArrayElement = 0;
-            descriptorWrites[0].descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            descriptorWrites[0].descriptorCount = 1;
-            descriptorWrites[0].pBufferInfo     = &bufferInfo;
-
-            descriptorWrites[1].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[1].dstSet          = descriptorSets[i];
-            descriptorWrites[1].dstBinding      = 1;
-            descriptorWrites[1].dstArrayElement = 0;
-            descriptorWrites[1].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            descriptorWrites[1].descriptorCount = 1;
-            descriptorWrites[1].pImageInfo      = &imageInfo;
-
-            vkUpdateDescriptorSets(
-                device,
-                static_cast<uint32_t>(descriptorWrites.size()),
-                descriptorWrites.data(),
-                0,
-                nullptr);
+            cullDescriptorSets[i] = swapChainDescriptors.allocate(
+                cullDescriptorSetLayout,
+                DescriptorBindings()
+                    .buffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniformBuffers[i], 0, sizeof(UniformBufferObject))
+                    .buffer(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, objectBuffer)
+                    .buffer(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, drawCommandBuffers[i])
+                    .buffer(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, drawCountBuffers[i])
+                    .buffer(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, visibilityBuffer)
+                    .image(
+                        5,
+                        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                        depthPyramidView,
+                        VK_IMAGE_LAYOUT_GENERAL,
+                        depthPyramidSampler));
+        }
+    }
+
+    void createHiZDescriptorSets()
+    {
+        hizDescriptorSets.resize(depthPyramidLevels);
+        for (uint32_t level = 0; level < depthPyramidLevels; level++)
+        {
+            // Level 0 reduces the depth buffer itself, so its source binding is never read.
+            VkImageView source = depthPyramidMipViews[level == 0 ? 0 : level - 1];
+
+            hizDescriptorSets[level] = swapChainDescriptors.allocate(
+                hizDescriptorSetLayout,
+                DescriptorBindings()
+                    .image(
+                        0,
+                        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                        depthImageView,
+                        VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                        depthPyramidSampler)
+                    .image(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, source, VK_IMAGE_LAYOUT_GENERAL)
+                    .image(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, depthPyramidMipViews[level], VK_IMAGE_LAYOUT_GENERAL));
         }
     }
 
     void createSyncObjects()
     {
-        imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+        imageAvailableSemaphores.resize(options.framesInFlight);
+        inFlightFences.resize(options.framesInFlight);
         imagesInFlight.resize(swapChainImages.size(), VK_NULL_HANDLE);
+        frameSubmissions.assign(options.framesInFlight, 0);
 
         VkSemaphoreCreateInfo semaphoreInfo{};
         semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -1156,20 +3144,29 @@ class HelloTriangleApplication {
         fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
         fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        for (size_t i = 0; i < options.framesInFlight; i++)
         {
-            if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-                vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-                vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
+            if (vkCreateSemaphore(device, &semaphoreInfo, allocator, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
+                vkCreateFence(device, &fenceInfo, allocator, &inFlightFences[i]) != VK_SUCCESS)
             {
 
                 throw std::runtime_error("failed to create synchronization objects for a frame!");
             }
         }
+
+        frameArenas.resize(options.framesInFlight);
+        for (auto& arena : frameArenas)
+        {
+            arena = std::make_unique<FrameArena>(FRAME_ARENA_SIZE);
+        }
     }
 
     void createCommandBuffers()
     {
+        CPU_ZONE("createCommandBuffers");
+
+        auto recordStart = std::chrono::steady_clock::now();
+
         commandBuffers.resize(swapChainFramebuffers.size());
         VkCommandBufferAllocateInfo allocInfo{};
         allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -1184,59 +3181,356 @@ class HelloTriangleApplication {
 
         for (size_t i = 0; i < commandBuffers.size(); i++)
         {
-            VkCommandBufferBeginInfo beginInfo{};
-            beginInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-            beginInfo.flags            = 0;       // Optional
-            beginInfo.pInheritanceInfo = nullptr; // Optional
+            recordCommandBuffer(i);
+        }
+        staleCommandBuffers.assign(commandBuffers.size(), false);
 
-            if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS)
-            {
-                throw std::runtime_error("failed to begin recording command buffer!");
-            }
+        auto recordEnd          = std::chrono::steady_clock::now();
+        commandBufferRecordTime = std::chrono::duration<double, std::milli>(recordEnd - recordStart).count();
+    }
 
-            VkRenderPassBeginInfo renderPassInfo{};
-            renderPassInfo.sType             = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassInfo.renderPass        = renderPass;
-            renderPassInfo.framebuffer       = swapChainFramebuffers[i];
-            renderPassInfo.renderArea.offset = {0, 0};
-            renderPassInfo.renderArea.extent = swapChainExtent;
+    // Records the whole frame for swap chain image i. Re-recording needs the command pool to allow resetting single
+    // command buffers, and the buffer's last submission to have finished.
+    void recordCommandBuffer(size_t i)
+    {
+        materialSetBinds = 0;
 
-            std::array<VkClearValue, 2> clearValues{};
-            clearValues[0].color = {
-                {0.0f, 0.0f, 0.0f, 1.0f}
-            };
-            clearValues[1].depthStencil = {1.0f, 0};
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags            = 0;       // Optional
+        beginInfo.pInheritanceInfo = nullptr; // Optional
 
-            renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-            renderPassInfo.pClearValues    = clearValues.data();
+        if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to begin recording command buffer!");
+        }
 
-            vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        uint32_t firstTimestamp = static_cast<uint32_t>(i) * 2;
+        if (frameTimestamps)
+        {
+            vkCmdResetQueryPool(commandBuffers[i], timestampQueryPool, firstTimestamp, 2);
+            vkCmdWriteTimestamp(
+                commandBuffers[i],
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                timestampQueryPool,
+                firstTimestamp);
+        }
 
-            vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        if (gpuProfiler)
+        {
+            gpuProfiler->beginFrame(commandBuffers[i], static_cast<uint32_t>(i));
+            frameGraph.execute(
+                commandBuffers[i],
+                static_cast<uint32_t>(i),
+                [this](VkCommandBuffer commandBuffer, uint32_t frame, const std::string& pass)
+                { gpuProfiler->beginScope(commandBuffer, frame, pass); },
+                [this](VkCommandBuffer commandBuffer, uint32_t frame, const std::string&)
+                { gpuProfiler->endScope(commandBuffer, frame); });
+        }
+        else
+        {
+            frameGraph.execute(commandBuffers[i], static_cast<uint32_t>(i));
+        }
+
+        if (frameTimestamps)
+        {
+            vkCmdWriteTimestamp(
+                commandBuffers[i],
+                VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                timestampQueryPool,
+                firstTimestamp + 1);
+        }
+
+        if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to record command buffer!");
+        }
+    }
+
+    void recordScenePass(VkCommandBuffer commandBuffer, size_t imageIndex, VkRenderPass pass, uint32_t drawList)
+    {
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType             = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass        = pass;
+        renderPassInfo.framebuffer       = swapChainFramebuffers[imageIndex];
+        renderPassInfo.renderArea.offset = {0, 0};
+        renderPassInfo.renderArea.extent = renderExtent;
+
+        std::array<VkClearValue, 2> clearValues{};
+        clearValues[0].color = {
+            {0.0f, 0.0f, 0.0f, 1.0f}
+        };
+        clearValues[1].depthStencil = {1.0f, 0};
+
+        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+        renderPassInfo.pClearValues    = clearValues.data();
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+
+        VkBuffer     vertexBuffers[] = {vertexBuffer};
+        VkDeviceSize offsets[]       = {0};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+
+        vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+        vkCmdBindDescriptorSets(
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout,
+            0,
+            1,
+            &descriptorSets[imageIndex],
+            0,
+            nullptr);
+
+        // Bindless textures are bound once for every material; otherwise indirect draws are limited to the first.
+        if (options.bindless || options.gpuDriven || options.cpuCulling)
+        {
+            bindMaterial(commandBuffer, 0);
+        }
+
+        if (options.gpuDriven || options.cpuCulling)
+        {
+            recordIndirectDraws(commandBuffer, imageIndex, drawList);
+        }
+        else
+        {
+            // The object index doubles as firstInstance so the vertex shader finds the object's transform. Objects
+            // cycle through the materials, so material by material visits every materialCount-th object.
+            for (uint32_t layer = 0; layer < options.overdraw; layer++)
+            {
+                for (uint32_t material = 0; material < options.materialCount; material++)
+                {
+                    if (!options.bindless)
+                    {
+                        bindMaterial(commandBuffer, material);
+                    }
+
+                    for (uint32_t object = material; object < objects.size(); object += options.materialCount)
+                    {
+                        vkCmdDrawIndexed(
+                            commandBuffer,
+                            objects[object].indexCount,
+                            1,
+                            objects[object].firstIndex,
+                            objects[object].vertexOffset,
+                            object);
+                    }
+                }
+            }
+        }
+
+        vkCmdEndRenderPass(commandBuffer);
+    }
+
+    // Binds set 1: the material's own set, or the bindless set, which holds every material.
+    void bindMaterial(VkCommandBuffer commandBuffer, uint32_t material)
+    {
+        VkDescriptorSet set = options.bindless ? bindlessDescriptorSet : materialDescriptorSet(material);
+        vkCmdBindDescriptorSets(
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout,
+            1,
+            1,
+            &set,
+            0,
+            nullptr);
+        materialSetBinds++;
+    }
+
+    void recordCullReset(VkCommandBuffer commandBuffer, size_t imageIndex)
+    {
+        vkCmdFillBuffer(commandBuffer, drawCountBuffers[imageIndex], 0, VK_WHOLE_SIZE, 0);
+        if (!drawIndirectCountSupported)
+        {
+            // Without a GPU-side count every slot is drawn, so slots past the compacted list must stay empty.
+            vkCmdFillBuffer(commandBuffer, drawCommandBuffers[imageIndex], 0, VK_WHOLE_SIZE, 0);
+        }
+    }
+
+    void recordCullDispatch(VkCommandBuffer commandBuffer, size_t imageIndex, CullPhase phase)
+    {
+        uint32_t phaseConstant = static_cast<uint32_t>(phase);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+        vkCmdBindDescriptorSets(
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            cullPipelineLayout,
+            0,
+            1,
+            &cullDescriptorSets[imageIndex],
+            0,
+            nullptr);
+        vkCmdPushConstants(
+            commandBuffer,
+            cullPipelineLayout,
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            0,
+            sizeof(phaseConstant),
+            &phaseConstant);
+        vkCmdDispatch(commandBuffer, (static_cast<uint32_t>(objects.size()) + 63) / 64, 1, 1);
+    }
 
-            VkBuffer     vertexBuffers[] = {vertexBuffer};
-            VkDeviceSize offsets[]       = {0};
-            vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
+    void recordCullStatistics(VkCommandBuffer commandBuffer, size_t imageIndex)
+    {
+        VkBufferCopy statsRegion{};
+        statsRegion.size = sizeof(CullStatistics);
+        vkCmdCopyBuffer(commandBuffer, drawCountBuffers[imageIndex], cullStatsBuffers[imageIndex], 1, &statsRegion);
+    }
+
+    void recordReadback(VkCommandBuffer commandBuffer, size_t imageIndex)
+    {
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent                 = {swapChainExtent.width, swapChainExtent.height, 1};
+
+        vkCmdCopyImageToBuffer(
+            commandBuffer,
+            swapChainImages[imageIndex],
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            readbackBuffers[imageIndex],
+            1,
+            &region);
+    }
+
+    void recordDepthPyramid(VkCommandBuffer commandBuffer)
+    {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, hizPipeline);
+
+        VkMemoryBarrier levelBarrier{};
+        levelBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-            vkCmdBindIndexBuffer(commandBuffers[i], indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+        HiZPushConstants constants{};
+        constants.sourceSize = glm::ivec2(renderExtent.width, renderExtent.height);
+
+        for (uint32_t level = 0; level < depthPyramidLevels; level++)
+        {
+            constants.destinationSize = glm::ivec2(
+                std::max(depthPyramidExtent.width >> level, 1u),
+                std::max(depthPyramidExtent.height >> level, 1u));
+            constants.level = level;
 
             vkCmdBindDescriptorSets(
-                commandBuffers[i],
-                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                pipelineLayout,
+                commandBuffer,
+                VK_PIPELINE_BIND_POINT_COMPUTE,
+                hizPipelineLayout,
                 0,
                 1,
-                &descriptorSets[i],
+                &hizDescriptorSets[level],
                 0,
                 nullptr);
+            vkCmdPushConstants(
+                commandBuffer,
+                hizPipelineLayout,
+                VK_SHADER_STAGE_COMPUTE_BIT,
+                0,
+                sizeof(constants),
+                &constants);
+            vkCmdDispatch(
+                commandBuffer,
+                (constants.destinationSize.x + 7) / 8,
+                (constants.destinationSize.y + 7) / 8,
+                1);
+
+            // Makes this level visible to the next reduction. The frame graph orders the last level before the
+            // late cull, since it only tracks the pyramid as a whole.
+            if (level + 1 < depthPyramidLevels)
+            {
+                vkCmdPipelineBarrier(
+                    commandBuffer,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    0,
+                    1,
+                    &levelBarrier,
+                    0,
+                    nullptr,
+                    0,
+                    nullptr);
+            }
+
+            constants.sourceSize = constants.destinationSize;
+        }
+    }
 
-            vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+    // Scales the scene image rendered at renderExtent onto the swap chain image. The frame graph moves both images
+    // into transfer layouts beforehand and the swap chain image to PRESENT_SRC afterwards.
+    void recordUpscale(VkCommandBuffer commandBuffer, size_t imageIndex)
+    {
+        VkImageBlit blit{};
+        blit.srcOffsets[1]                 = {static_cast<int32_t>(renderExtent.width),
+                                              static_cast<int32_t>(renderExtent.height),
+                                              1};
+        blit.srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel       = 0;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount     = 1;
+        blit.dstOffsets[1]                 = {static_cast<int32_t>(swapChainExtent.width),
+                                              static_cast<int32_t>(swapChainExtent.height),
+                                              1};
+        blit.dstSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel       = 0;
+        blit.dstSubresource.baseArrayLayer = 0;
+        blit.dstSubresource.layerCount     = 1;
+
+        vkCmdBlitImage(
+            commandBuffer,
+            frameGraph.image(sceneTarget),
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            swapChainImages[imageIndex],
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1,
+            &blit,
+            VK_FILTER_LINEAR);
+    }
 
-            vkCmdEndRenderPass(commandBuffers[i]);
+    void recordIndirectDraws(VkCommandBuffer commandBuffer, size_t imageIndex, uint32_t drawList)
+    {
+        uint32_t     maxDrawCount = static_cast<uint32_t>(objects.size());
+        VkDeviceSize stride       = sizeof(VkDrawIndexedIndirectCommand);
+        VkDeviceSize listOffset   = drawList * maxDrawCount * stride;
 
-            if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS)
+        // Overdraw repeats the whole list, as the direct path repeats its draws.
+        for (uint32_t layer = 0; layer < options.overdraw; layer++)
+        {
+            if (drawIndirectCountSupported)
+            {
+                vkCmdDrawIndexedIndirectCount(
+                    commandBuffer,
+                    drawCommandBuffers[imageIndex],
+                    listOffset,
+                    drawCountBuffers[imageIndex],
+                    drawList * sizeof(uint32_t),
+                    maxDrawCount,
+                    static_cast<uint32_t>(stride));
+            }
+            else if (multiDrawIndirectSupported)
+            {
+                vkCmdDrawIndexedIndirect(
+                    commandBuffer,
+                    drawCommandBuffers[imageIndex],
+                    listOffset,
+                    maxDrawCount,
+                    static_cast<uint32_t>(stride));
+            }
+            else
             {
-                throw std::runtime_error("failed to record command buffer!");
+                for (uint32_t draw = 0; draw < maxDrawCount; draw++)
+                {
+                    vkCmdDrawIndexedIndirect(
+                        commandBuffer,
+                        drawCommandBuffers[imageIndex],
+                        listOffset + draw * stride,
+                        1,
+                        0);
+                }
             }
         }
     }
@@ -1248,9 +3542,10 @@ class HelloTriangleApplication {
         VkCommandPoolCreateInfo poolInfo{};
         poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-        poolInfo.flags            = 0; // Optional
+        // Streaming re-records single command buffers when the texture's views change.
+        poolInfo.flags = options.textureStreaming ? VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT : 0;
 
-        if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+        if (vkCreateCommandPool(device, &poolInfo, allocator, &commandPool) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create command pool!");
         }
@@ -1262,56 +3557,78 @@ class HelloTriangleApplication {
 
         for (size_t i = 0; i < swapChainImageViews.size(); i++)
         {
-            std::array<VkImageView, 3> attachments = {colorImageView, depthImageView, swapChainImageViews[i]};
+            VkImageView                target      = qualityController ? sceneImageView : swapChainImageViews[i];
+            std::array<VkImageView, 3> attachments = {colorImageView, depthImageView, target};
+
+            // Matches createRenderPass: without MSAA the target is the color attachment itself.
+            if (msaaSamples == VK_SAMPLE_COUNT_1_BIT)
+            {
+                attachments[0] = target;
+            }
 
             VkFramebufferCreateInfo framebufferInfo{};
             framebufferInfo.sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
             framebufferInfo.renderPass      = renderPass;
-            framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+            framebufferInfo.attachmentCount = msaaSamples == VK_SAMPLE_COUNT_1_BIT ? 2 : 3;
             framebufferInfo.pAttachments    = attachments.data();
-            framebufferInfo.width           = swapChainExtent.width;
-            framebufferInfo.height          = swapChainExtent.height;
+            framebufferInfo.width           = renderExtent.width;
+            framebufferInfo.height          = renderExtent.height;
             framebufferInfo.layers          = 1;
 
-            if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS)
+            if (vkCreateFramebuffer(device, &framebufferInfo, allocator, &swapChainFramebuffers[i]) != VK_SUCCESS)
             {
                 throw std::runtime_error("failed to create framebuffer!");
             }
         }
     }
 
-    void createRenderPass()
+    void createRenderPasses()
+    {
+        renderPass = createRenderPass(false);
+
+        if (options.hiz)
+        {
+            lateRenderPass = createRenderPass(true);
+        }
+    }
+
+    // loadPrevious builds the Hi-Z late pass, which continues on top of the early pass's color and depth. Both
+    // passes share framebuffers since they only differ in load operations.
+    //
+    // Attachments begin and end in the layout the subpass uses and the pass declares no external dependencies: the
+    // frame graph records every transition and barrier around it.
+    VkRenderPass createRenderPass(bool loadPrevious)
     {
+        bool               multisampled = msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+        VkAttachmentLoadOp loadOp       = loadPrevious ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+
+        // Multisampled color and depth only outlive the pass when the Hi-Z late pass continues on them; otherwise
+        // they are never written back and may stay in lazily allocated memory.
+        VkAttachmentStoreOp intermediateStoreOp =
+            options.hiz ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
         VkAttachmentDescription colorAttachment{};
         colorAttachment.format         = swapChainImageFormat;
         colorAttachment.samples        = msaaSamples;
-        colorAttachment.finalLayout    = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-        colorAttachment.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        colorAttachment.storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.loadOp         = loadOp;
+        colorAttachment.storeOp        = multisampled ? intermediateStoreOp : VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        colorAttachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.initialLayout  = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.finalLayout    = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
         VkAttachmentReference colorAttachmentRef{};
         colorAttachmentRef.attachment = 0;
         colorAttachmentRef.layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
-        VkSubpassDependency dependency{};
-        dependency.srcSubpass    = VK_SUBPASS_EXTERNAL;
-        dependency.dstSubpass    = 0;
-        dependency.srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.srcAccessMask = 0;
-        dependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
         VkAttachmentDescription depthAttachment{};
         depthAttachment.format         = findDepthFormat();
         depthAttachment.samples        = msaaSamples;
-        depthAttachment.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depthAttachment.storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.loadOp         = loadOp;
+        depthAttachment.storeOp        = intermediateStoreOp;
         depthAttachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        depthAttachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.initialLayout  = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
         depthAttachment.finalLayout    = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
         VkAttachmentReference depthAttachmentRef{};
@@ -1325,8 +3642,8 @@ class HelloTriangleApplication {
         colorAttachmentResolve.storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachmentResolve.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        colorAttachmentResolve.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachmentResolve.finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        colorAttachmentResolve.initialLayout  = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachmentResolve.finalLayout    = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
         VkAttachmentReference colorAttachmentResolveRef{};
         colorAttachmentResolveRef.attachment = 2;
@@ -1337,38 +3654,39 @@ class HelloTriangleApplication {
         subpass.colorAttachmentCount    = 1;
         subpass.pColorAttachments       = &colorAttachmentRef;
         subpass.pDepthStencilAttachment = &depthAttachmentRef;
-        subpass.pResolveAttachments     = &colorAttachmentResolveRef;
+        subpass.pResolveAttachments     = multisampled ? &colorAttachmentResolveRef : nullptr;
 
         std::array<VkAttachmentDescription, 3> attachments = {colorAttachment, depthAttachment, colorAttachmentResolve};
         VkRenderPassCreateInfo                 renderPassInfo{};
         renderPassInfo.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.attachmentCount = multisampled ? 3 : 2;
         renderPassInfo.pAttachments    = attachments.data();
         renderPassInfo.subpassCount    = 1;
         renderPassInfo.pSubpasses      = &subpass;
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies   = &dependency;
-        dependency.srcStageMask =
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        dependency.dstStageMask =
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
-        if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+        VkRenderPass pass;
+        if (vkCreateRenderPass(device, &renderPassInfo, allocator, &pass) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create render pass!");
         }
+
+        return pass;
     }
 
     VkShaderModule createShaderModule(const std::vector<char>& code)
+    {
+        return createShaderModule(reinterpret_cast<const uint32_t*>(code.data()), code.size());
+    }
+
+    VkShaderModule createShaderModule(const uint32_t* code, size_t codeSize)
     {
         VkShaderModuleCreateInfo createInfo{};
         createInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode    = reinterpret_cast<const uint32_t*>(code.data());
+        createInfo.codeSize = codeSize;
+        createInfo.pCode    = code;
 
         VkShaderModule shaderModule;
-        if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+        if (vkCreateShaderModule(device, &createInfo, allocator, &shaderModule) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create shader module!");
         }
@@ -1397,11 +3715,32 @@ class HelloTriangleApplication {
 
     void createGraphicsPipeline()
     {
-        auto vertShaderCode = readFile(std::string("shaders/vertex.vert.bin"));
-        auto fragShaderCode = readFile(std::string("shaders/fragment.frag.bin"));
+        CPU_ZONE("createGraphicsPipeline");
+
+        VkShaderModule vertShaderModule;
+        VkShaderModule fragShaderModule;
+        size_t         vertShaderSize;
+        size_t         fragShaderSize;
+
+        auto moduleStart = std::chrono::steady_clock::now();
+        if (options.shaderDirectory.empty())
+        {
+            vertShaderSize   = sizeof(shaders_vertex_vert);
+            fragShaderSize   = sizeof(shaders_fragment_frag);
+            vertShaderModule = createShaderModule(shaders_vertex_vert, vertShaderSize);
+            fragShaderModule = createShaderModule(shaders_fragment_frag, fragShaderSize);
+        }
+        else
+        {
+            auto vertShaderCode = readFile(options.shaderDirectory + "/vertex.vert.bin");
+            auto fragShaderCode = readFile(options.shaderDirectory + "/fragment.frag.bin");
 
-        VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-        VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+            vertShaderSize   = vertShaderCode.size();
+            fragShaderSize   = fragShaderCode.size();
+            vertShaderModule = createShaderModule(vertShaderCode);
+            fragShaderModule = createShaderModule(fragShaderCode);
+        }
+        auto moduleEnd = std::chrono::steady_clock::now();
 
         VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
         vertShaderStageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -1409,16 +3748,29 @@ class HelloTriangleApplication {
         vertShaderStageInfo.module = vertShaderModule;
         vertShaderStageInfo.pName  = "main";
 
+        auto specializationEntries = ShaderVariant::getMapEntries();
+
+        // The fragment shader's texture array matches set 1's binding.
+        ShaderVariant variant = options.shaderVariant;
+        variant.textureCount  = options.bindless ? bindlessTextureCapacity : 1;
+
+        VkSpecializationInfo specializationInfo{};
+        specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+        specializationInfo.pMapEntries   = specializationEntries.data();
+        specializationInfo.dataSize      = sizeof(ShaderVariant);
+        specializationInfo.pData         = &variant;
+
         VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-        fragShaderStageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        fragShaderStageInfo.stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
-        fragShaderStageInfo.module = fragShaderModule;
-        fragShaderStageInfo.pName  = "main";
+        fragShaderStageInfo.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        fragShaderStageInfo.stage               = VK_SHADER_STAGE_FRAGMENT_BIT;
+        fragShaderStageInfo.module              = fragShaderModule;
+        fragShaderStageInfo.pName               = "main";
+        fragShaderStageInfo.pSpecializationInfo = &specializationInfo;
 
         VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
-        auto bindingDescription   = Vertex::getBindingDescription();
-        auto attributeDescription = Vertex::getAttributeDescriptions();
+        auto bindingDescription   = vertexBindingDescription();
+        auto attributeDescription = vertexAttributeDescriptions();
 
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         vertexInputInfo.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -1435,14 +3787,14 @@ class HelloTriangleApplication {
         VkViewport viewport{};
         viewport.x        = 0.0f;
         viewport.y        = 0.0f;
-        viewport.width    = (float)swapChainExtent.width;
-        viewport.height   = (float)swapChainExtent.height;
+        viewport.width    = (float)renderExtent.width;
+        viewport.height   = (float)renderExtent.height;
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
 
         VkRect2D scissor{};
         scissor.offset = {0, 0};
-        scissor.extent = swapChainExtent;
+        scissor.extent = renderExtent;
 
         VkPipelineViewportStateCreateInfo viewportState{};
         viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
@@ -1466,7 +3818,7 @@ class HelloTriangleApplication {
 
         VkPipelineMultisampleStateCreateInfo multisampling{};
         multisampling.sType                 = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        multisampling.sampleShadingEnable   = VK_TRUE; // enable sample shading in the pipeline
+        multisampling.sampleShadingEnable   = sampleShading; // enable sample shading in the pipeline
         multisampling.minSampleShading      = .2f;     // min fraction for sample shading; closer to one is smoother
         multisampling.rasterizationSamples  = msaaSamples;
         multisampling.minSampleShading      = 1.0f;     // Optional
@@ -1500,7 +3852,7 @@ class HelloTriangleApplication {
         depthStencil.sType                 = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
         depthStencil.depthTestEnable       = VK_TRUE;
         depthStencil.depthWriteEnable      = VK_TRUE;
-        depthStencil.depthCompareOp        = VK_COMPARE_OP_LESS;
+        depthStencil.depthCompareOp        = options.overdraw > 1 ? VK_COMPARE_OP_LESS_OR_EQUAL : VK_COMPARE_OP_LESS;
         depthStencil.depthBoundsTestEnable = VK_FALSE;
         depthStencil.minDepthBounds        = 0.0f; // Optional
         depthStencil.maxDepthBounds        = 1.0f; // Optional
@@ -1515,14 +3867,17 @@ class HelloTriangleApplication {
         dynamicState.dynamicStateCount = 2;
         dynamicState.pDynamicStates    = dynamicStates;
 
+        // Set 0 changes per swap chain image, set 1 per material.
+        std::array<VkDescriptorSetLayout, 2> setLayouts = {descriptorSetLayout, materialDescriptorSetLayout};
+
         VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
         pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount         = 1;
-        pipelineLayoutInfo.pSetLayouts            = &descriptorSetLayout;
+        pipelineLayoutInfo.setLayoutCount         = static_cast<uint32_t>(setLayouts.size());
+        pipelineLayoutInfo.pSetLayouts            = setLayouts.data();
         pipelineLayoutInfo.pushConstantRangeCount = 0;       // Optional
         pipelineLayoutInfo.pPushConstantRanges    = nullptr; // Optional
 
-        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, allocator, &pipelineLayout) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create pipeline layout!");
         }
@@ -1546,14 +3901,135 @@ class HelloTriangleApplication {
         pipelineInfo.basePipelineIndex   = -1;             // Optional
         pipelineInfo.pDepthStencilState  = &depthStencil;
 
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) !=
+        auto pipelineStart = std::chrono::steady_clock::now();
+        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, allocator, &graphicsPipeline) !=
             VK_SUCCESS)
         {
             throw std::runtime_error("failed to create graphics pipeline!");
         }
+        auto pipelineEnd = std::chrono::steady_clock::now();
+
+        if (options.reportPipeline)
+        {
+            using milliseconds = std::chrono::duration<double, std::milli>;
+
+            std::cout << "[PIPELINE] \t" << (options.shaderDirectory.empty() ? SHADER_OPTIMIZATION : "disk")
+                      << " SPIR-V: vertex " << vertShaderSize << " bytes, fragment " << fragShaderSize
+                      << " bytes; shader modules " << milliseconds(moduleEnd - moduleStart).count()
+                      << " ms; vkCreateGraphicsPipelines " << milliseconds(pipelineEnd - pipelineStart).count()
+                      << " ms" << std::endl;
+        }
+
+        vkDestroyShaderModule(device, fragShaderModule, allocator);
+        vkDestroyShaderModule(device, vertShaderModule, allocator);
+    }
+
+    void createCullPipeline()
+    {
+        if (!options.gpuDriven)
+        {
+            return;
+        }
+
+        CPU_ZONE("createCullPipeline");
+
+        VkShaderModule cullShaderModule;
+        if (options.shaderDirectory.empty())
+        {
+            cullShaderModule = createShaderModule(shaders_cull_comp, sizeof(shaders_cull_comp));
+        }
+        else
+        {
+            cullShaderModule = createShaderModule(readFile(options.shaderDirectory + "/cull.comp.bin"));
+        }
+
+        VkPipelineShaderStageCreateInfo cullShaderStageInfo{};
+        cullShaderStageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        cullShaderStageInfo.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+        cullShaderStageInfo.module = cullShaderModule;
+        cullShaderStageInfo.pName  = "main";
+
+        VkPushConstantRange phaseRange{};
+        phaseRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        phaseRange.offset     = 0;
+        phaseRange.size       = sizeof(uint32_t);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount         = 1;
+        pipelineLayoutInfo.pSetLayouts            = &cullDescriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges    = &phaseRange;
+
+        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, allocator, &cullPipelineLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create culling pipeline layout!");
+        }
 
-        vkDestroyShaderModule(device, fragShaderModule, nullptr);
-        vkDestroyShaderModule(device, vertShaderModule, nullptr);
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType  = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage  = cullShaderStageInfo;
+        pipelineInfo.layout = cullPipelineLayout;
+
+        if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, allocator, &cullPipeline) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create culling pipeline!");
+        }
+
+        vkDestroyShaderModule(device, cullShaderModule, allocator);
+
+        if (options.hiz)
+        {
+            createHiZPipeline();
+        }
+    }
+
+    void createHiZPipeline()
+    {
+        VkShaderModule hizShaderModule;
+        if (options.shaderDirectory.empty())
+        {
+            hizShaderModule = createShaderModule(shaders_hiz_comp, sizeof(shaders_hiz_comp));
+        }
+        else
+        {
+            hizShaderModule = createShaderModule(readFile(options.shaderDirectory + "/hiz.comp.bin"));
+        }
+
+        VkPipelineShaderStageCreateInfo hizShaderStageInfo{};
+        hizShaderStageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        hizShaderStageInfo.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+        hizShaderStageInfo.module = hizShaderModule;
+        hizShaderStageInfo.pName  = "main";
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset     = 0;
+        pushConstantRange.size       = sizeof(HiZPushConstants);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount         = 1;
+        pipelineLayoutInfo.pSetLayouts            = &hizDescriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges    = &pushConstantRange;
+
+        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, allocator, &hizPipelineLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create depth pyramid pipeline layout!");
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType  = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage  = hizShaderStageInfo;
+        pipelineInfo.layout = hizPipelineLayout;
+
+        if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, allocator, &hizPipeline) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create depth pyramid pipeline!");
+        }
+
+        vkDestroyShaderModule(device, hizShaderModule, allocator);
     }
 
     void createImageViews()
@@ -1569,6 +4045,14 @@ class HelloTriangleApplication {
 
     void createSwapChain()
     {
+        CPU_ZONE("createSwapChain");
+
+        if (options.headless)
+        {
+            createOffscreenImages();
+            return;
+        }
+
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
 
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
@@ -1592,6 +4076,22 @@ class HelloTriangleApplication {
         createInfo.imageArrayLayers = 1;
         createInfo.imageUsage       = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
+        if (qualityController)
+        {
+            VkFormatProperties formatProperties;
+            vkGetPhysicalDeviceFormatProperties(physicalDevice, surfaceFormat.format, &formatProperties);
+
+            VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                                VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+            if ((formatProperties.optimalTilingFeatures & blitFeatures) != blitFeatures ||
+                !(swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+            {
+                throw std::runtime_error("adaptive quality requires a swap chain that can be blitted to!");
+            }
+
+            createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        }
+
         QueueFamilyIndices indices              = findQueueFamilies(physicalDevice);
         uint32_t           queueFamilyIndices[] = {indices.graphicsFamily.value(), indices.presentFamily.value()};
 
@@ -1612,9 +4112,9 @@ class HelloTriangleApplication {
         createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
         createInfo.presentMode    = presentMode;
         createInfo.clipped        = VK_TRUE;
-        createInfo.oldSwapchain   = VK_NULL_HANDLE;
+        createInfo.oldSwapchain   = swapChain;
 
-        if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS)
+        if (vkCreateSwapchainKHR(device, &createInfo, allocator, &swapChain) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create swap chain!");
         }
@@ -1623,70 +4123,526 @@ class HelloTriangleApplication {
         swapChainImages.resize(imageCount);
         vkGetSwapchainImagesKHR(device, swapChain, &imageCount, swapChainImages.data());
 
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        renderFinishedSemaphores.resize(imageCount);
+        for (VkSemaphore& semaphore : renderFinishedSemaphores)
+        {
+            if (vkCreateSemaphore(device, &semaphoreInfo, allocator, &semaphore) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create present semaphore!");
+            }
+        }
+
         swapChainImageFormat = surfaceFormat.format;
         swapChainExtent      = extent;
+
+        renderExtent.width  = std::max(1u, static_cast<uint32_t>(extent.width * renderScale));
+        renderExtent.height = std::max(1u, static_cast<uint32_t>(extent.height * renderScale));
     }
 
-    void createSurface()
+    // Headless stand-in for the swap chain: color images the frame graph renders into exactly as it would into swap
+    // chain images. There is no acquire, so one more image than frames in flight keeps the GPU from waiting on the
+    // image it is about to reuse.
+    void createOffscreenImages()
     {
-        if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS)
+        uint32_t imageCount = options.framesInFlight + 1;
+
+        swapChainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+        swapChainExtent      = {WIDTH, HEIGHT};
+
+        swapChainImages.resize(imageCount);
+        offscreenImagesMemory.resize(imageCount);
+        for (uint32_t i = 0; i < imageCount; i++)
         {
-            throw std::runtime_error("failed to create window surface!");
+            createImage(
+                swapChainExtent.width,
+                swapChainExtent.height,
+                1,
+                VK_SAMPLE_COUNT_1_BIT,
+                swapChainImageFormat,
+                VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                swapChainImages[i],
+                offscreenImagesMemory[i]);
         }
+
+        renderExtent.width  = std::max(1u, static_cast<uint32_t>(swapChainExtent.width * renderScale));
+        renderExtent.height = std::max(1u, static_cast<uint32_t>(swapChainExtent.height * renderScale));
     }
 
-    void createLogicalDevice()
+    // Valid bits of timestamps written on the graphics queue; 0 when it cannot write them.
+    uint32_t graphicsTimestampValidBits()
     {
-        QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
 
-        std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+        return queueFamilies[findQueueFamilies(physicalDevice).graphicsFamily.value()].timestampValidBits;
+    }
 
-        float queuePriority = 1.0f;
-        for (uint32_t queueFamily : uniqueQueueFamilies)
+    // Adaptive quality and benchmarks time every command buffer on the GPU. Benchmarks go without GPU times on
+    // devices that cannot write timestamps on the graphics queue.
+    void queryFrameTimestamps()
+    {
+        if (options.targetFrameTime <= 0.0 && options.benchmarkFrames == 0)
         {
-            VkDeviceQueueCreateInfo queueCreateInfo{};
-            queueCreateInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-            queueCreateInfo.queueFamilyIndex = queueFamily;
-            queueCreateInfo.queueCount       = 1;
-            queueCreateInfo.pQueuePriorities = &queuePriority;
-            queueCreateInfos.push_back(queueCreateInfo);
+            return;
         }
 
-        VkPhysicalDeviceFeatures deviceFeatures{};
-        deviceFeatures.samplerAnisotropy = VK_TRUE;
-        deviceFeatures.sampleRateShading = VK_TRUE; // enable sample shading feature for the device
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
 
-        VkDeviceCreateInfo createInfo{};
-        createInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        createInfo.queueCreateInfoCount    = static_cast<uint32_t>(queueCreateInfos.size());
-        createInfo.pQueueCreateInfos       = queueCreateInfos.data();
-        createInfo.pEnabledFeatures        = &deviceFeatures;
-        createInfo.enabledExtensionCount   = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        uint32_t validBits = graphicsTimestampValidBits();
+        frameTimestamps    = validBits > 0;
+        timestampPeriod    = properties.limits.timestampPeriod;
+        timestampMask      = validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+    }
 
-        if (enableValidationLayers)
-        {
-            createInfo.enabledLayerCount   = static_cast<uint32_t>(validationLayers.size());
-            createInfo.ppEnabledLayerNames = validationLayers.data();
-        }
-        else
+    void createQualityController()
+    {
+        maxMsaaSamples = msaaSamples;
+
+        if (options.targetFrameTime <= 0.0)
         {
-            createInfo.enabledLayerCount = 0;
+            return;
         }
 
-        if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS)
+        if (!frameTimestamps)
         {
-            throw std::runtime_error("failed to create logical device!");
+            throw std::runtime_error("adaptive quality requires timestamp queries on the graphics queue!");
         }
 
-        vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
-        vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+        // Hi-Z reads the depth attachment as a multisampled image, so it needs at least 2x.
+        constexpr uint32_t qualityWindow = 30;
+        constexpr float    minimumScale  = 0.5f;
+        uint32_t           minSamples    = options.hiz ? 2 : 1;
+
+        qualityController.emplace(
+            buildQualityLadder(maxMsaaSamples, minSamples, minimumScale),
+            options.targetFrameTime,
+            qualityWindow);
+        applyQualityLevel();
     }
 
-    void pickPhysicalDevice()
+    void applyQualityLevel()
     {
-        physicalDevice       = VK_NULL_HANDLE;
+        const QualityLevel& level = qualityController->current();
+
+        msaaSamples   = static_cast<VkSampleCountFlagBits>(level.sampleCount);
+        sampleShading = level.sampleShading;
+        renderScale   = level.renderScale;
+    }
+
+    void reportQualityLevel()
+    {
+        const QualityLevel& level = qualityController->current();
+
+        std::cout << "[QUALITY] \tGPU " << qualityController->lastWindowMean() << " ms against a "
+                  << options.targetFrameTime << " ms budget: level " << qualityController->currentIndex() + 1 << "/"
+                  << qualityController->levelCount() << ", render scale " << level.renderScale << ", "
+                  << level.sampleCount << "x MSAA, sample shading " << (level.sampleShading ? "on" : "off")
+                  << std::endl;
+    }
+
+    void createHostAllocator()
+    {
+        if (!options.hostAllocator)
+        {
+            return;
+        }
+
+        hostAllocator.emplace();
+        allocator = hostAllocator->callbacks();
+    }
+
+    void resetHostAllocationRates()
+    {
+        if (hostAllocator)
+        {
+            hostAllocationsAtStart      = hostAllocator->statistics();
+            hostAllocationFramesAtStart = framesRendered;
+        }
+    }
+
+    // Driver host memory per allocation scope: what is live and its peak, then how many allocations and bytes each
+    // frame cost since hostAllocationsAtStart and how many of those allocations the pools served.
+    void reportHostAllocations()
+    {
+        if (!hostAllocator)
+        {
+            return;
+        }
+
+        HostAllocator::Statistics stats    = hostAllocator->statistics();
+        uint32_t                  frames   = framesRendered - hostAllocationFramesAtStart;
+        double                    perFrame = frames > 0 ? 1.0 / frames : 0.0;
+
+        for (uint32_t scope = 0; scope < HostAllocator::scopeCount; scope++)
+        {
+            const HostAllocator::ScopeStatistics& now    = stats[scope];
+            const HostAllocator::ScopeStatistics& before = hostAllocationsAtStart[scope];
+
+            uint64_t allocations = now.allocations - before.allocations;
+            uint64_t bytes       = now.bytesAllocated - before.bytesAllocated;
+            uint64_t pooled      = now.pooled - before.pooled;
+
+            std::cout << "[MEMORY] \t" << HostAllocator::scopeName(scope) << " scope: " << now.liveBytes
+                      << " bytes live in " << now.allocations - now.frees << " allocations (peak " << now.peakBytes
+                      << " bytes, " << now.internalBytes << " bytes internal); per frame " << allocations * perFrame
+                      << " allocations, " << bytes * perFrame << " bytes";
+            if (allocations > 0)
+            {
+                std::cout << ", " << 100.0 * pooled / allocations << "% pooled";
+            }
+            std::cout << std::endl;
+        }
+        std::cout << "[MEMORY] \t" << frames << " frames; pools hold " << hostAllocator->poolCapacity() << " bytes"
+                  << std::endl;
+    }
+
+    // Frames that needed more scratch than FRAME_ARENA_SIZE took the rest from the heap.
+    void reportFrameArenas()
+    {
+        for (size_t frame = 0; frame < frameArenas.size(); frame++)
+        {
+            const FrameArena& arena = *frameArenas[frame];
+            if (arena.overflows() > 0)
+            {
+                std::cout << "[MEMORY] \tframe arena " << frame << " overflowed " << arena.overflows()
+                          << " times; frames needed up to " << arena.peakUsed() << " of its " << arena.capacity()
+                          << " bytes" << std::endl;
+            }
+        }
+    }
+
+    // Debug builds only: what the frame loop allocated where the check does not fail it, from the first frame the
+    // check applies to.
+    void reportFrameAllocations()
+    {
+        if (!enableFrameAllocationCheck)
+        {
+            return;
+        }
+
+        std::cout << "[MEMORY] \tframe loop: " << uncountedFrameAllocations
+                  << " allocations inside Vulkan calls, texture streaming and command buffer re-recording, "
+                  << swapChainFrameAllocations << " in the " << swapChainAllocationFrames
+                  << " frames that recreated the swap chain" << std::endl;
+    }
+
+    DescriptorStatistics descriptorStatistics() const
+    {
+        DescriptorStatistics swapChain = swapChainDescriptors.statistics();
+        DescriptorStatistics cache     = descriptorCache.statistics();
+
+        DescriptorStatistics total;
+        total.allocations = swapChain.allocations + cache.allocations;
+        total.cacheHits   = cache.cacheHits;
+        total.updates     = swapChain.updates + cache.updates;
+        total.pools       = swapChain.pools + cache.pools;
+        return total;
+    }
+
+    // Startup's descriptor work, then the frame loop's, which only swap chain recreation adds to.
+    void reportDescriptors()
+    {
+        DescriptorStatistics total   = descriptorStatistics();
+        DescriptorStatistics startup = descriptorsAtFirstFrame;
+
+        std::cout << "[DESCRIPTORS] \tstartup: " << startup.allocations << " sets allocated, " << startup.cacheHits
+                  << " cache hits, " << startup.updates << " vkUpdateDescriptorSets calls, " << startup.pools
+                  << " pools" << std::endl;
+
+        uint64_t allocations = total.allocations - startup.allocations;
+        uint64_t cacheHits   = total.cacheHits - startup.cacheHits;
+        uint64_t updates     = total.updates - startup.updates;
+        double   frames      = std::max(1u, framesRendered);
+        std::cout << "[DESCRIPTORS] \t" << framesRendered << " frames: " << allocations / frames
+                  << " sets allocated, " << cacheHits / frames << " cache hits, " << updates / frames
+                  << " vkUpdateDescriptorSets calls per frame; " << total.pools - startup.pools
+                  << " pools created, " << descriptorCache.size() << " cached sets" << std::endl;
+    }
+
+    // Where streaming left the texture and what it took to get there. Texel bytes are what the budget counts;
+    // allocated bytes include the driver's alignment and padding.
+    void reportTextureStreaming()
+    {
+        if (!textureResidency)
+        {
+            return;
+        }
+
+        constexpr double mib = 1024.0 * 1024.0;
+
+        const MipResidency& residency = *textureResidency;
+        std::cout << "[STREAMING] \tresident: levels " << textureVisibleLevel << "-" << mipLevels - 1 << " of "
+                  << mipLevels << ", " << residency.bytes(textureVisibleLevel) / mib << " MiB of texels, "
+                  << textureAllocatedBytes / mib << " MiB allocated (peak " << textureAllocatedPeak / mib
+                  << " MiB); full chain " << residency.bytes(0) / mib << " MiB, budget " << options.textureBudget
+                  << " MiB allows levels from " << residency.budgetLevel() << std::endl;
+        std::cout << "[STREAMING] \t" << textureLevelsUploaded << " levels uploaded (" << textureBytesUploaded / mib
+                  << " MiB, the tail included), " << textureStreamSteps << " streaming steps, " << textureReallocations
+                  << " image allocations, " << residency.evictions() << " evictions, " << commandBufferRerecords
+                  << " command buffers re-recorded" << std::endl;
+
+        std::optional<double> firstFrame = startupTimer.timeToFirstFrame();
+        if (firstFrame)
+        {
+            std::cout << "[STREAMING] \ttime to first frame: " << *firstFrame << " ms, with levels "
+                      << residency.tailLevel() << "-" << mipLevels - 1 << " uploaded" << std::endl;
+        }
+    }
+
+    // Debug builds fail the frame that just ran if it allocated on the render thread, unless it was one of the first
+    // or recreated the swap chain, which rebuilds half the renderer. Either way its uncounted allocations and those of
+    // a recreation are added up for reportFrameAllocations().
+    void checkFrameAllocations(uint64_t allocations, uint64_t uncountedAllocations, bool recreatedSwapChain)
+    {
+        if (!enableFrameAllocationCheck || framesRendered <= ALLOCATION_FREE_AFTER_FRAMES)
+        {
+            return;
+        }
+
+        uncountedFrameAllocations += uncountedAllocations;
+        if (recreatedSwapChain)
+        {
+            swapChainFrameAllocations += allocations;
+            swapChainAllocationFrames++;
+            return;
+        }
+        if (allocations == 0)
+        {
+            return;
+        }
+
+        throw std::runtime_error(
+            "failed to keep frame " + std::to_string(framesRendered - 1) + " off the heap: " +
+            std::to_string(allocations) + " allocations!");
+    }
+
+    void createGpuProfiler()
+    {
+        if (options.gpuProfilePath.empty())
+        {
+            return;
+        }
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+        profilerTimestampValidBits = graphicsTimestampValidBits();
+        if (profilerTimestampValidBits == 0)
+        {
+            throw std::runtime_error("GPU profiling requires timestamp queries on the graphics queue!");
+        }
+
+        profilerTimestampPeriod = properties.limits.timestampPeriod;
+        gpuProfiler.emplace();
+    }
+
+    // One set of query pools per swap chain image, since each image has its own pre-recorded command buffer.
+    void createProfilerQueryPools()
+    {
+        if (!gpuProfiler)
+        {
+            return;
+        }
+
+        gpuProfiler->create(
+            device,
+            static_cast<uint32_t>(swapChainImages.size()),
+            GPU_PROFILER_MAX_SCOPES,
+            profilerTimestampPeriod,
+            profilerTimestampValidBits,
+            pipelineStatisticsEnabled,
+            GPU_PROFILE_WINDOW,
+            std::max(GPU_PROFILE_HISTORY_FRAMES, options.benchmarkFrames + BENCHMARK_WARMUP_FRAMES),
+            allocator);
+    }
+
+    // Reads whatever the GPU has finished; callers have waited for every frame in flight.
+    void collectGpuProfiles()
+    {
+        if (!gpuProfiler)
+        {
+            return;
+        }
+
+        for (uint32_t i = 0; i < swapChainImages.size(); i++)
+        {
+            gpuProfiler->collect(i);
+        }
+    }
+
+    void createTimestampQueryPool()
+    {
+        if (!frameTimestamps)
+        {
+            return;
+        }
+
+        // Two timestamps, at the start and end of each swap chain image's command buffer.
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = static_cast<uint32_t>(swapChainImages.size()) * 2;
+
+        if (vkCreateQueryPool(device, &queryPoolInfo, allocator, &timestampQueryPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+
+        timestampsWritten.assign(swapChainImages.size(), false);
+    }
+
+    void createSurface()
+    {
+        if (options.headless)
+        {
+            return;
+        }
+
+        if (glfwCreateWindowSurface(instance, window, allocator, &surface) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create window surface!");
+        }
+    }
+
+    void createLogicalDevice()
+    {
+        CPU_ZONE("createLogicalDevice");
+
+        QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+
+        std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+
+        float queuePriority = 1.0f;
+        for (uint32_t queueFamily : uniqueQueueFamilies)
+        {
+            VkDeviceQueueCreateInfo queueCreateInfo{};
+            queueCreateInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            queueCreateInfo.queueFamilyIndex = queueFamily;
+            queueCreateInfo.queueCount       = 1;
+            queueCreateInfo.pQueuePriorities = &queuePriority;
+            queueCreateInfos.push_back(queueCreateInfo);
+        }
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+        // Vulkan 1.2 structures may only be chained when the device itself supports 1.2.
+        bool vulkan12 = properties.apiVersion >= VK_API_VERSION_1_2;
+
+        VkPhysicalDeviceVulkan12Features supportedFeatures12{};
+        supportedFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+        VkPhysicalDeviceFeatures2 supportedFeatures{};
+        supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supportedFeatures.pNext = vulkan12 ? &supportedFeatures12 : nullptr;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+
+        if ((options.gpuDriven || options.cpuCulling) && !supportedFeatures.features.drawIndirectFirstInstance)
+        {
+            throw std::runtime_error("indirect drawing requires drawIndirectFirstInstance!");
+        }
+
+        multiDrawIndirectSupported = supportedFeatures.features.multiDrawIndirect;
+        drawIndirectCountSupported = vulkan12 && supportedFeatures12.drawIndirectCount;
+        timelineSemaphoreSupported = vulkan12 && supportedFeatures12.timelineSemaphore;
+
+        if (options.bindless)
+        {
+            if (!vulkan12 || !supportedFeatures12.descriptorBindingPartiallyBound ||
+                !supportedFeatures12.descriptorBindingSampledImageUpdateAfterBind ||
+                !supportedFeatures.features.shaderSampledImageArrayDynamicIndexing)
+            {
+                throw std::runtime_error(
+                    "bindless textures require partially bound, update-after-bind sampled images!");
+            }
+
+            VkPhysicalDeviceVulkan12Properties properties12{};
+            properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+
+            VkPhysicalDeviceProperties2 properties2{};
+            properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+            properties2.pNext = &properties12;
+            vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+            // A combined image sampler counts against both the sampled image and the sampler limits.
+            bindlessTextureCapacity = std::min(
+                {BINDLESS_TEXTURE_CAPACITY,
+                 properties12.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                 properties12.maxPerStageDescriptorUpdateAfterBindSamplers,
+                 properties12.maxDescriptorSetUpdateAfterBindSampledImages,
+                 properties12.maxDescriptorSetUpdateAfterBindSamplers});
+            if (options.materialCount > bindlessTextureCapacity)
+            {
+                throw std::runtime_error(
+                    "bindless textures support at most " + std::to_string(bindlessTextureCapacity) + " materials!");
+            }
+        }
+        pipelineStatisticsEnabled  =
+            !options.gpuProfilePath.empty() && supportedFeatures.features.pipelineStatisticsQuery;
+
+        VkPhysicalDeviceVulkan12Features deviceFeatures12{};
+        deviceFeatures12.sType             = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        deviceFeatures12.drawIndirectCount = drawIndirectCountSupported;
+        deviceFeatures12.timelineSemaphore = timelineSemaphoreSupported;
+        deviceFeatures12.descriptorBindingPartiallyBound              = options.bindless;
+        deviceFeatures12.descriptorBindingSampledImageUpdateAfterBind = options.bindless;
+
+        VkPhysicalDeviceFeatures2 deviceFeatures{};
+        deviceFeatures.sType                              = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        deviceFeatures.pNext                              = vulkan12 ? &deviceFeatures12 : nullptr;
+        deviceFeatures.features.samplerAnisotropy         = VK_TRUE;
+        deviceFeatures.features.sampleRateShading         = VK_TRUE; // enable sample shading feature for the device
+        deviceFeatures.features.multiDrawIndirect         = multiDrawIndirectSupported;
+        deviceFeatures.features.drawIndirectFirstInstance = supportedFeatures.features.drawIndirectFirstInstance;
+        deviceFeatures.features.pipelineStatisticsQuery   = pipelineStatisticsEnabled;
+        deviceFeatures.features.shaderSampledImageArrayDynamicIndexing = options.bindless;
+
+        std::vector<const char*> extensions = getRequiredDeviceExtensions();
+
+        VkDeviceCreateInfo createInfo{};
+        createInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext                   = &deviceFeatures;
+        createInfo.queueCreateInfoCount    = static_cast<uint32_t>(queueCreateInfos.size());
+        createInfo.pQueueCreateInfos       = queueCreateInfos.data();
+        createInfo.pEnabledFeatures        = nullptr;
+        createInfo.enabledExtensionCount   = static_cast<uint32_t>(extensions.size());
+        createInfo.ppEnabledExtensionNames = extensions.data();
+
+        if (enableValidationLayers)
+        {
+            createInfo.enabledLayerCount   = static_cast<uint32_t>(validationLayers.size());
+            createInfo.ppEnabledLayerNames = validationLayers.data();
+        }
+        else
+        {
+            createInfo.enabledLayerCount = 0;
+        }
+
+        if (vkCreateDevice(physicalDevice, &createInfo, allocator, &device) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create logical device!");
+        }
+
+        vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
+        vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+
+        deletionQueue.create(device, timelineSemaphoreSupported, allocator);
+    }
+
+    void pickPhysicalDevice()
+    {
+        CPU_ZONE("pickPhysicalDevice");
+
+        physicalDevice       = VK_NULL_HANDLE;
         uint32_t deviceCount = 0;
 
         vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
@@ -1713,6 +4669,9 @@ class HelloTriangleApplication {
         {
             throw std::runtime_error("failed to find a suitable GPU!");
         }
+
+        // Fixed for the device's lifetime, so every allocation can pick its memory type without asking again.
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
     }
 
     bool isDeviceSuitable(VkPhysicalDevice device)
@@ -1721,8 +4680,8 @@ class HelloTriangleApplication {
 
         bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-        bool swapChainAdequate = false;
-        if (extensionsSupported)
+        bool swapChainAdequate = options.headless;
+        if (extensionsSupported && !options.headless)
         {
             SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
             swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
@@ -1742,7 +4701,8 @@ class HelloTriangleApplication {
         std::vector<VkExtensionProperties> availableExtensions(extensionCount);
         vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-        std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+        std::vector<const char*> extensions = getRequiredDeviceExtensions();
+        std::set<std::string>    requiredExtensions(extensions.begin(), extensions.end());
 
         for (const auto& extension : availableExtensions)
         {
@@ -1752,6 +4712,12 @@ class HelloTriangleApplication {
         return requiredExtensions.empty();
     }
 
+    // Headless rendering never presents, so it needs no swap chain support.
+    std::vector<const char*> getRequiredDeviceExtensions()
+    {
+        return options.headless ? std::vector<const char*>() : deviceExtensions;
+    }
+
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device)
     {
         QueueFamilyIndices indices;
@@ -1770,8 +4736,16 @@ class HelloTriangleApplication {
                 indices.graphicsFamily = i;
             }
 
+            // Without a surface nothing is presented; the graphics queue stands in for the present queue.
             VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            if (options.headless)
+            {
+                presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+            }
+            else
+            {
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            }
 
             if (presentSupport)
             {
@@ -1867,10 +4841,14 @@ class HelloTriangleApplication {
 
     void createInstance()
     {
+        CPU_ZONE("createInstance");
+
+        startupTimer.beginPhase("validation layers");
         if (enableValidationLayers && !checkValidationLayerSupport())
         {
             throw std::runtime_error("validation layers requested, but not available!");
         }
+        startupTimer.beginPhase("instance");
 
         VkApplicationInfo appInfo{};
         appInfo.sType              = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -1878,7 +4856,7 @@ class HelloTriangleApplication {
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName        = "No Engine";
         appInfo.engineVersion      = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion         = VK_API_VERSION_1_0;
+        appInfo.apiVersion         = VK_API_VERSION_1_2;
 
         VkInstanceCreateInfo createInfo{};
         createInfo.sType            = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -1914,7 +4892,7 @@ class HelloTriangleApplication {
             createInfo.pNext = nullptr;
         }
 
-        if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS)
+        if (vkCreateInstance(&createInfo, allocator, &instance) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create instance!");
         }
@@ -1922,157 +4900,928 @@ class HelloTriangleApplication {
 
     void mainLoop()
     {
-        while (!glfwWindowShouldClose(window))
-        {
-            glfwPollEvents();
-            drawFrame();
-        }
-
-        vkDeviceWaitIdle(device);
-    }
-
-    void drawFrame()
-    {
-        uint32_t imageIndex;
+        // Batch output wants every frame of the sequence, so nothing is thrown away as warm-up.
+        const uint32_t warmupFrames = imageWriter ? 0 : BENCHMARK_WARMUP_FRAMES;
 
-        VkResult result = vkAcquireNextImageKHR(
-            device,
-            swapChain,
-            UINT64_MAX,
-            imageAvailableSemaphores[currentFrame],
-            VK_NULL_HANDLE,
-            &imageIndex);
+        std::vector<double> frameTimes;
+        uint32_t            frameNumber = 0;
+        auto                batchStart  = std::chrono::steady_clock::now();
+        auto                lastFrame   = batchStart;
 
-        if (result == VK_ERROR_OUT_OF_DATE_KHR)
-        {
-            recreateSwapChain();
-            return;
-        }
-        else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+        // Every per-frame sample fits from the start, so recording one never reallocates.
+        if (options.benchmarkFrames > 0)
         {
-            throw std::runtime_error("failed to acquire swap chain image!");
+            frameTimes.reserve(options.benchmarkFrames);
+            benchmarkCpuTimes.reserve(options.benchmarkFrames + warmupFrames);
+            benchmarkGpuTimes.reserve(options.benchmarkFrames + warmupFrames);
+            presentIntervals.reserve(options.benchmarkFrames + warmupFrames);
         }
 
-        // Check if a previous frame is using this image (i.e. there is its fence to wait on)
-        if (imagesInFlight[imageIndex] != VK_NULL_HANDLE)
+        resetHostAllocationRates();
+        descriptorsAtFirstFrame = descriptorStatistics();
+
+        while (options.headless || !glfwWindowShouldClose(window))
         {
-            vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
-        }
-        // Mark the image as now being in use by this frame
-        imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+            if (!options.headless)
+            {
+                CPU_ZONE("glfwPollEvents");
+                glfwPollEvents();
+            }
 
-        updateUniformBuffer(imageIndex);
+            uint64_t heapAllocations      = threadHeapAllocations();
+            uint64_t uncountedAllocations = threadUncountedHeapAllocations();
+            uint32_t recreations          = swapChainRecreations;
+            drawFrame();
+            checkFrameAllocations(
+                threadHeapAllocations() - heapAllocations,
+                threadUncountedHeapAllocations() - uncountedAllocations,
+                swapChainRecreations != recreations);
 
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            if (options.benchmarkFrames > 0)
+            {
+                auto now = std::chrono::steady_clock::now();
+                if (frameNumber == warmupFrames)
+                {
+                    cullStatsTotal      = {};
+                    cullStatsFrames     = 0;
+                    gpuFrameTimeTotal   = 0.0;
+                    gpuFrameTimeSamples = 0;
+                    benchmarkCpuTimes.clear();
+                    benchmarkGpuTimes.clear();
+                    presentIntervals.clear();
+                    cpuCullingTime      = 0.0;
+                    lightClusteringTime = 0.0;
+                    lightIndicesTotal   = 0;
+                    lightIndicesDropped = 0;
+                    lightFrames         = 0;
+                    resetHostAllocationRates();
+                }
+                if (frameNumber++ >= warmupFrames)
+                {
+                    frameTimes.push_back(std::chrono::duration<double, std::milli>(now - lastFrame).count());
+                }
+                lastFrame = now;
 
-        VkSemaphore          waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-        VkPipelineStageFlags waitStages[]     = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount         = 1;
-        submitInfo.pWaitSemaphores            = waitSemaphores;
-        submitInfo.pWaitDstStageMask          = waitStages;
-        submitInfo.commandBufferCount         = 1;
-        submitInfo.pCommandBuffers            = &commandBuffers[imageIndex];
+                if (frameTimes.size() == options.benchmarkFrames)
+                {
+                    break;
+                }
+            }
+        }
 
-        VkSemaphore signalSemaphores[]  = {renderFinishedSemaphores[currentFrame]};
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores    = signalSemaphores;
+        vkDeviceWaitIdle(device);
 
-        vkResetFences(device, 1, &inFlightFences[currentFrame]);
+        reportStartup();
+        reportHostAllocations();
+        reportFrameArenas();
+        reportFrameAllocations();
+        reportDescriptors();
+        reportTextureStreaming();
 
-        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
+        if (imageWriter)
         {
-            throw std::runtime_error("failed to submit draw command buffer!");
+            collectReadbacks();
+            imageWriter->finish();
+            reportBatch(std::chrono::duration<double>(std::chrono::steady_clock::now() - batchStart).count());
         }
 
-        VkPresentInfoKHR presentInfo{};
-        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-
-        presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores    = signalSemaphores;
-
-        VkSwapchainKHR swapChains[] = {swapChain};
-        presentInfo.swapchainCount  = 1;
-        presentInfo.pSwapchains     = swapChains;
-        presentInfo.pImageIndices   = &imageIndex;
+        if (!frameTimes.empty())
+        {
+            reportFrameTimes(frameTimes);
+        }
 
-        result = vkQueuePresentKHR(presentQueue, &presentInfo);
+        if (gpuProfiler)
+        {
+            collectGpuProfiles();
+            reportGpuProfile();
+        }
 
-        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized)
+        if (!frameTimes.empty())
         {
-            framebufferResized = false;
-            recreateSwapChain();
+            reportBenchmarkStatistics(frameTimes, warmupFrames);
+        }
+    }
+
+    // Percentiles of every per-frame measurement, written to JSON and checked against the baseline when asked.
+    void reportBenchmarkStatistics(const std::vector<double>& frameTimes, uint32_t warmupFrames)
+    {
+        const char* submission = options.gpuDriven    ? "gpu-driven"
+                                 : options.bvhCulling ? "cpu-bvh"
+                                 : options.cpuCulling ? "cpu-culled"
+                                                      : "cpu-submitted";
+
+        BenchmarkReport report;
+        report.config = {
+            {"variant", options.shaderVariantName},
+            {"overdraw", std::to_string(options.overdraw)},
+            {"msaa_samples", std::to_string(msaaSamples)},
+            {"resolution", std::to_string(swapChainExtent.width) + "x" + std::to_string(swapChainExtent.height)},
+            {"headless", options.headless ? "true" : "false"},
+            {"model", std::filesystem::path(options.modelPath).filename().string()},
+            {"archive", options.archivePath.empty() ? "off" : "on"},
+            {"objects", std::to_string(objects.size())},
+            {"layout", options.layout},
+            {"submission", submission},
+            {"lights", std::to_string(options.lightCount)},
+            {"materials", std::to_string(options.materialCount)},
+            {"bindless", options.bindless ? "true" : "false"},
+            {"texture_budget_mib", options.textureStreaming ? std::to_string(options.textureBudget) : "off"},
+            {"target_ms", std::to_string(options.targetFrameTime)},
+            {"frames", std::to_string(options.benchmarkFrames)},
+            {"warmup_frames", std::to_string(warmupFrames)},
+            {"simulated_step_s", std::to_string(SIMULATED_FRAME_STEP)},
+        };
+        report.metrics = {
+            {"frame_time_ms", summarizeFrameTimes(frameTimes)},
+            {"cpu_time_ms", summarizeFrameTimes(benchmarkCpuTimes)},
+            {"gpu_time_ms", summarizeFrameTimes(benchmarkGpuTimes)},
+            {"present_interval_ms", summarizeFrameTimes(presentIntervals)},
+        };
+
+        for (const auto& [metric, stats] : report.metrics)
+        {
+            if (stats.count == 0)
+            {
+                continue;
+            }
+            std::cout << "[BENCHMARK] \t" << metric << ": min " << stats.min << ", mean " << stats.mean << ", p50 "
+                      << stats.p50 << ", p95 " << stats.p95 << ", p99 " << stats.p99 << ", max " << stats.max << " ("
+                      << stats.count << " samples)" << std::endl;
+        }
+
+        if (!options.benchmarkJsonPath.empty())
+        {
+            report.writeJson(options.benchmarkJsonPath);
+            std::cout << "[BENCHMARK] \treport written to " << options.benchmarkJsonPath << std::endl;
+        }
+
+        if (!options.baselinePath.empty())
+        {
+            checkRegressions("[BENCHMARK] \t", "benchmark", report, options.baselinePath);
+        }
+    }
+
+    // Throws when any statistic of report regressed by more than regressionThreshold percent against the report
+    // stored at baselinePath; what names the run in the error.
+    void checkRegressions(
+        const char*            prefix,
+        const std::string&     what,
+        const BenchmarkReport& report,
+        const std::string&     baselinePath)
+    {
+        BenchmarkReport baseline = BenchmarkReport::readJson(baselinePath);
+        for (const std::string& difference : configDifferences(baseline, report))
+        {
+            std::cout << prefix << "warning: baseline differs in " << difference << std::endl;
+        }
+
+        std::vector<BenchmarkRegression> regressions =
+            findRegressions(baseline, report, options.regressionThreshold / 100.0);
+        for (const BenchmarkRegression& regression : regressions)
+        {
+            std::cout << prefix << "regression: " << regression.metric << " " << regression.statistic << " "
+                      << regression.baseline << " -> " << regression.current << " ms" << std::endl;
+        }
+
+        if (!regressions.empty())
+        {
+            throw std::runtime_error(
+                what + " regressed by more than " + std::to_string(options.regressionThreshold) + "% against " +
+                baselinePath + "!");
+        }
+        std::cout << prefix << "no regressions against " << baselinePath << std::endl;
+    }
+
+    // Every startup phase in the order it ran and the time to the first frame, written to JSON and checked against
+    // the baseline when asked. Each phase is a metric with a single sample.
+    void reportStartup()
+    {
+        if (!options.reportStartup)
+        {
+            return;
+        }
+
+        std::optional<double> firstFrame = startupTimer.timeToFirstFrame();
+        if (!firstFrame)
+        {
+            std::cout << "[STARTUP] \tno frame was shown, so startup never finished" << std::endl;
+            return;
+        }
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+        // Everything here changes how much work startup does, so runs are only comparable when it all matches.
+        BenchmarkReport report;
+        report.config = {
+            {"device", properties.deviceName},
+            {"driver_version", std::to_string(properties.driverVersion)},
+            {"validation", enableValidationLayers ? "true" : "false"},
+            {"headless", options.headless ? "true" : "false"},
+            {"shaders", options.shaderDirectory.empty() ? SHADER_OPTIMIZATION : "disk"},
+            {"msaa_samples", std::to_string(msaaSamples)},
+            {"model", std::filesystem::path(options.modelPath).filename().string()},
+            {"archive", options.archivePath.empty() ? "off" : "on"},
+            {"objects", std::to_string(objects.size())},
+            {"layout", options.layout},
+            {"gpu_driven", options.gpuDriven ? "true" : "false"},
+            {"hiz", options.hiz ? "true" : "false"},
+            {"lights", std::to_string(options.lightCount)},
+            {"texture_budget_mib", options.textureStreaming ? std::to_string(options.textureBudget) : "off"},
+        };
+
+        for (const StartupTimer::Phase& phase : startupTimer.phases())
+        {
+            std::cout << "[STARTUP] \t" << phase.name << ": " << phase.duration << " ms (from " << phase.start
+                      << " ms)" << std::endl;
+
+            std::string metric = phase.name;
+            std::replace(metric.begin(), metric.end(), ' ', '_');
+            report.metrics.emplace_back(metric + "_ms", summarizeFrameTimes({phase.duration}));
+        }
+        std::cout << "[STARTUP] \ttime to first frame: " << *firstFrame << " ms" << std::endl;
+        report.metrics.emplace_back("time_to_first_frame_ms", summarizeFrameTimes({*firstFrame}));
+
+        if (!options.startupJsonPath.empty())
+        {
+            report.writeJson(options.startupJsonPath);
+            std::cout << "[STARTUP] \treport written to " << options.startupJsonPath << std::endl;
+        }
+
+        if (!options.startupBaselinePath.empty())
+        {
+            checkRegressions("[STARTUP] \t", "startup", report, options.startupBaselinePath);
+        }
+    }
+
+    // Every pass's rolling GPU time, then the history the profiler kept to the CSV file.
+    void reportGpuProfile()
+    {
+        for (const GpuProfiler::ScopeTiming& timing : gpuProfiler->timings())
+        {
+            std::cout << "[PROFILE] \t" << timing.name << ": mean " << timing.meanTime << " ms, max "
+                      << timing.maxTime << " ms over the last " << GPU_PROFILE_WINDOW << " frames";
+            if (gpuProfiler->pipelineStatisticsEnabled())
+            {
+                const GpuProfiler::PipelineStatistics& stats = timing.lastStatistics;
+                std::cout << "; last frame " << stats.inputPrimitives << " primitives in, " << stats.clippingPrimitives
+                          << " clipped, " << stats.vertexInvocations << " vertex, " << stats.fragmentInvocations
+                          << " fragment and " << stats.computeInvocations << " compute invocations";
+            }
+            std::cout << std::endl;
+        }
+
+        gpuProfiler->writeCsv(options.gpuProfilePath);
+        std::cout << "[PROFILE] \tper-frame GPU times written to " << options.gpuProfilePath;
+        if (gpuProfiler->droppedFrames() > 0)
+        {
+            std::cout << ", without the " << gpuProfiler->droppedFrames() << " oldest frames";
+        }
+        std::cout << std::endl;
+    }
+
+    // Throughput includes draining the encoders, so it is the rate a whole sequence is actually produced at.
+    void reportBatch(double seconds)
+    {
+        ImageSequenceWriter::Statistics stats = imageWriter->statistics();
+
+        std::cout << "[BATCH] \t" << stats.framesWritten << " frames written to " << options.outputDirectory << " in "
+                  << seconds << " s: " << stats.framesWritten / seconds << " frames/s sustained with "
+                  << options.framesInFlight << " frames in flight and " << imageWriter->workerCount()
+                  << " encoder threads" << std::endl;
+        std::cout << "[BATCH] \tencoder queue depth mean " << stats.meanQueueDepth << ", max " << stats.maxQueueDepth
+                  << "; render thread blocked on the encoders for " << stats.blockedTime << " ms" << std::endl;
+
+        if (stats.failedFrames > 0)
+        {
+            throw std::runtime_error("failed to write " + std::to_string(stats.failedFrames) + " frames!");
+        }
+    }
+
+    void reportFrameTimes(const std::vector<double>& frameTimes)
+    {
+        double total = 0.0;
+        for (double frameTime : frameTimes)
+        {
+            total += frameTime;
+        }
+
+        auto [minTime, maxTime] = std::minmax_element(frameTimes.begin(), frameTimes.end());
+
+        const char* submission = options.gpuDriven    ? " GPU-driven"
+                                 : options.cpuCulling ? " CPU-culled"
+                                                      : " CPU-submitted";
+
+        std::cout << "[BENCHMARK] \tvariant " << options.shaderVariantName << ", overdraw " << options.overdraw << ", "
+                  << msaaSamples << "x MSAA, " << swapChainExtent.width << "x" << swapChainExtent.height
+                  << (options.headless ? " headless, " : ", ") << objects.size() << submission << " objects: "
+                  << frameTimes.size() << " frames, mean " << total / frameTimes.size() << " ms, min " << *minTime
+                  << " ms, max " << *maxTime << " ms; command buffer recording " << commandBufferRecordTime << " ms"
+                  << std::endl;
+        std::cout << "[BENCHMARK] \t" << options.materialCount << (options.bindless ? " bindless" : "")
+                  << " materials: " << materialSetBinds << " material set binds per frame" << std::endl;
+
+        if (qualityController && gpuFrameTimeSamples > 0)
+        {
+            const QualityLevel& level = qualityController->current();
+            std::cout << "[BENCHMARK] \tadaptive quality: mean GPU time " << gpuFrameTimeTotal / gpuFrameTimeSamples
+                      << " ms for a " << options.targetFrameTime << " ms budget, " << qualityController->changeCount()
+                      << " level changes, settled at " << renderExtent.width << "x" << renderExtent.height
+                      << " (scale " << level.renderScale << "), sample shading "
+                      << (level.sampleShading ? "on" : "off") << std::endl;
+        }
+
+        if (cullStatsFrames > 0)
+        {
+            double frames = static_cast<double>(cullStatsFrames);
+            std::cout << "[BENCHMARK] \t" << options.layout << " layout" << (options.hiz ? ", Hi-Z" : "")
+                      << " culling per frame: " << cullStatsTotal.earlyDraws / frames << " early draws, "
+                      << cullStatsTotal.lateDraws / frames << " late draws, " << cullStatsTotal.occluded / frames
+                      << " occluded, " << cullStatsTotal.frustumCulled / frames << " outside the frustum"
+                      << std::endl;
+        }
+
+        if (frustumCuller && cullStatsFrames > 0)
+        {
+            // The hierarchy is walked on the render thread alone.
+            double      frameTime = cpuCullingTime / cullStatsFrames;
+            uint32_t    threads   = options.bvhCulling ? 1 : cullingPool->threadCount();
+            const char* method    = options.bvhCulling ? "BVH" : cullingInstructionSet();
+            std::cout << "[BENCHMARK] \tCPU culling (" << method << ", " << threads << " threads): " << frameTime
+                      << " ms per frame, " << objects.size() / frameTime / 1e3 / threads << " M objects/s per core"
+                      << std::endl;
+        }
+
+        if (lightFrames > 0)
+        {
+            double frames = static_cast<double>(lightFrames);
+            std::cout << "[BENCHMARK] \tclustered lighting (" << simdInstructionSet() << "): " << options.lightCount
+                      << " lights, assignment " << lightClusteringTime / frames << " ms per frame, "
+                      << lightIndicesTotal / frames / LightClusters::clusterCount << " lights per cluster, "
+                      << lightIndicesDropped / frames << " dropped" << std::endl;
+        }
+    }
+
+    void drawFrame()
+    {
+        CPU_ZONE("drawFrame");
+
+        // Once this frame slot's previous submission has finished, nothing it allocated from the slot's arena is in use
+        // any more.
+        {
+            CPU_ZONE("wait for frame fence");
+            UncountedHeapAllocations driver;
+            vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+        }
+        frameArenas[currentFrame]->reset();
+
+        // The fence also covers every earlier submission, so whatever was retired before this slot's last frame can
+        // go; with a timeline the queue reads the newer progress itself.
+        {
+            CPU_ZONE("collect retired resources");
+            UncountedHeapAllocations driver;
+            deletionQueue.reached(frameSubmissions[currentFrame]);
+            deletionQueue.collect();
+        }
+
+        uint32_t imageIndex;
+        VkResult result = VK_SUCCESS;
+
+        if (options.headless)
+        {
+            // Offscreen images are used round-robin; the fence wait below keeps one from being reused too early.
+            imageIndex = framesRendered % static_cast<uint32_t>(swapChainImages.size());
+        }
+        else
+        {
+            CPU_ZONE("vkAcquireNextImageKHR");
+            UncountedHeapAllocations driver;
+            result = vkAcquireNextImageKHR(
+                device,
+                swapChain,
+                UINT64_MAX,
+                imageAvailableSemaphores[currentFrame],
+                VK_NULL_HANDLE,
+                &imageIndex);
+        }
+
+        if (result == VK_ERROR_OUT_OF_DATE_KHR)
+        {
+            recreateSwapChain();
+            return;
+        }
+        else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+        {
+            throw std::runtime_error("failed to acquire swap chain image!");
+        }
+
+        // Check if a previous frame is using this image (i.e. there is its fence to wait on)
+        if (imagesInFlight[imageIndex] != VK_NULL_HANDLE)
+        {
+            {
+                CPU_ZONE("wait for image fence");
+                UncountedHeapAllocations driver;
+                vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+            }
+
+            // The image's previous submission has finished, so its culling counters are complete.
+            if (options.gpuDriven)
+            {
+                const CullStatistics& stats = *cullStatsData[imageIndex];
+                cullStatsTotal.earlyDraws += stats.earlyDraws;
+                cullStatsTotal.lateDraws += stats.lateDraws;
+                cullStatsTotal.occluded += stats.occluded;
+                cullStatsTotal.frustumCulled += stats.frustumCulled;
+                cullStatsFrames++;
+            }
+
+            if (frameTimestamps && timestampsWritten[imageIndex])
+            {
+                sampleGpuFrameTime(imageIndex);
+            }
+
+            if (gpuProfiler)
+            {
+                gpuProfiler->collect(imageIndex);
+            }
+
+            // Likewise its readback copy: hand it to the encoders before this frame overwrites the buffer.
+            collectReadback(imageIndex);
+        }
+        // Mark the image as now being in use by this frame
+        imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+
+        // The render thread's own work for the frame, from here to the submit, without the waits around it.
+        auto cpuStart = std::chrono::steady_clock::now();
+
+        // Streaming goes by the previous frame's view, so that this frame's uniform buffer already clamps to the levels
+        // it leaves uploaded.
+        streamTexture();
+        updateUniformBuffer(imageIndex);
+        cullObjectsOnCpu(imageIndex);
+
+        // The image's previous submission has finished, so its command buffer can be recorded again.
+        if (staleCommandBuffers[imageIndex])
+        {
+            UncountedHeapAllocations rerecord;
+            recordCommandBuffer(imageIndex);
+            staleCommandBuffers[imageIndex] = false;
+            commandBufferRerecords++;
+        }
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+        // When GPU time is measured the whole command buffer waits for the image, so the timestamps do not include
+        // time spent blocked on presentation.
+        bool                 timed            = frameTimestamps || gpuProfiler;
+        VkSemaphore          waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
+        VkPipelineStageFlags waitStages[]     = {
+            timed ? VK_PIPELINE_STAGE_ALL_COMMANDS_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+        submitInfo.waitSemaphoreCount         = options.headless ? 0 : 1;
+        submitInfo.pWaitSemaphores            = waitSemaphores;
+        submitInfo.pWaitDstStageMask          = waitStages;
+        submitInfo.commandBufferCount         = 1;
+        submitInfo.pCommandBuffers            = &commandBuffers[imageIndex];
+
+        VkSemaphore signalSemaphores[]  = {options.headless ? VK_NULL_HANDLE : renderFinishedSemaphores[imageIndex]};
+        submitInfo.signalSemaphoreCount = options.headless ? 0 : 1;
+        submitInfo.pSignalSemaphores    = signalSemaphores;
+
+        {
+            CPU_ZONE("vkQueueSubmit");
+            UncountedHeapAllocations driver;
+            vkResetFences(device, 1, &inFlightFences[currentFrame]);
+            if (submitGraphics(submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to submit draw command buffer!");
+            }
+            frameSubmissions[currentFrame] = deletionQueue.lastSubmission();
+        }
+
+        // Headless frames are never presented; the first one counts as shown once it is submitted.
+        if (options.headless)
+        {
+            startupTimer.markFirstFrame();
+        }
+
+        if (options.benchmarkFrames > 0)
+        {
+            auto cpuEnd = std::chrono::steady_clock::now();
+            benchmarkCpuTimes.push_back(std::chrono::duration<double, std::milli>(cpuEnd - cpuStart).count());
+        }
+
+        if (frameTimestamps)
+        {
+            timestampsWritten[imageIndex] = true;
+        }
+        if (gpuProfiler)
+        {
+            gpuProfiler->submitted(imageIndex, framesRendered);
+        }
+        if (imageWriter)
+        {
+            readbackFrames[imageIndex]  = framesRendered;
+            readbackPending[imageIndex] = true;
+        }
+        framesRendered++;
+
+        if (!options.headless)
+        {
+            CPU_ZONE("vkQueuePresentKHR");
+
+            VkPresentInfoKHR presentInfo{};
+            presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+
+            presentInfo.waitSemaphoreCount = 1;
+            presentInfo.pWaitSemaphores    = signalSemaphores;
+
+            VkSwapchainKHR swapChains[] = {swapChain};
+            presentInfo.swapchainCount  = 1;
+            presentInfo.pSwapchains     = swapChains;
+            presentInfo.pImageIndices   = &imageIndex;
+
+            {
+                UncountedHeapAllocations driver;
+                result = vkQueuePresentKHR(presentQueue, &presentInfo);
+            }
+            startupTimer.markFirstFrame();
+            presentsSinceRecreation++;
+            retirePresentedSwapChains();
+
+            if (options.benchmarkFrames > 0)
+            {
+                auto presentTime = std::chrono::steady_clock::now();
+                if (lastPresentTime)
+                {
+                    presentIntervals.push_back(
+                        std::chrono::duration<double, std::milli>(presentTime - *lastPresentTime).count());
+                }
+                lastPresentTime = presentTime;
+            }
+        }
+
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized ||
+            qualityChangePending)
+        {
+            framebufferResized = false;
+            recreateSwapChain();
         }
         else if (result != VK_SUCCESS)
         {
             throw std::runtime_error("failed to present swap chain image!");
         }
 
-        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        currentFrame = (currentFrame + 1) % options.framesInFlight;
+    }
+
+    // Presents are not fenced, so a replaced swap chain is kept until a frame submitted after the new one's first
+    // present: the present engine has moved on to the new swap chain by then, and the deletion queue destroys the old
+    // one with everything its presents waited on once that frame's fence signals.
+    void retirePresentedSwapChains()
+    {
+        if (retiredSwapChains.empty() || presentsSinceRecreation < PRESENTS_BEFORE_SWAP_CHAIN_RETIRES)
+        {
+            return;
+        }
 
-        vkQueueWaitIdle(presentQueue);
+        for (VkSwapchainKHR retired : retiredSwapChains)
+        {
+            deletionQueue.retire(retired);
+        }
+        for (VkSemaphore semaphore : retiredPresentSemaphores)
+        {
+            deletionQueue.retire(semaphore);
+        }
+        retiredSwapChains.clear();
+        retiredPresentSemaphores.clear();
+    }
+
+    // Culls against the planes updateUniformBuffer just extracted and writes the survivors' draws for imageIndex,
+    // whose previous frame has finished with them. Only the slots the last list used are cleared behind the new one.
+    void cullObjectsOnCpu(uint32_t imageIndex)
+    {
+        if (!frustumCuller)
+        {
+            return;
+        }
+
+        CPU_ZONE("cullObjectsOnCpu");
+
+        auto   cullStart = std::chrono::steady_clock::now();
+        size_t visible   = options.bvhCulling
+                               ? sceneBvh.cullFrustum(objectFrustum, visibleObjects, frameArenas[currentFrame].get())
+                               : frustumCuller->cull(objectFrustum, objectBounds, visibleObjects);
+
+        auto* commands = static_cast<VkDrawIndexedIndirectCommand*>(drawCommandData[imageIndex]);
+        for (size_t draw = 0; draw < visible; draw++)
+        {
+            // The object index doubles as firstInstance so the vertex shader finds the object's transform.
+            uint32_t          index  = visibleObjects[draw];
+            const ObjectData& object = objects[index];
+            commands[draw]           = {object.indexCount, 1, object.firstIndex, object.vertexOffset, index};
+        }
+        if (!drawIndirectCountSupported && drawCommandsWritten[imageIndex] > visible)
+        {
+            std::fill(commands + visible, commands + drawCommandsWritten[imageIndex], VkDrawIndexedIndirectCommand{});
+        }
+        drawCommandsWritten[imageIndex] = static_cast<uint32_t>(visible);
+        *drawCountData[imageIndex]      = static_cast<uint32_t>(visible);
+
+        auto cullEnd = std::chrono::steady_clock::now();
+        cpuCullingTime += std::chrono::duration<double, std::milli>(cullEnd - cullStart).count();
+
+        cullStatsTotal.earlyDraws += static_cast<uint32_t>(visible);
+        cullStatsTotal.frustumCulled += static_cast<uint32_t>(objects.size() - visible);
+        cullStatsFrames++;
+    }
+
+    // Casts a ray from the camera through the cursor against the scene as last drawn and reports the object hit.
+    void pickObject()
+    {
+        double cursorX, cursorY;
+        int    width, height;
+        glfwGetCursorPos(window, &cursorX, &cursorY);
+        glfwGetWindowSize(window, &width, &height);
+        if (width == 0 || height == 0)
+        {
+            return;
+        }
+
+        // Window y grows downwards like Vulkan's clip space, which the flipped projection already accounts for.
+        glm::vec2 ndc(2.0 * cursorX / width - 1.0, 2.0 * cursorY / height - 1.0);
+        glm::mat4 clipToScene = glm::inverse(sceneToClip);
+        glm::vec4 nearPoint   = clipToScene * glm::vec4(ndc, 0.0f, 1.0f);
+        glm::vec4 farPoint    = clipToScene * glm::vec4(ndc, 1.0f, 1.0f);
+
+        // The ray spans the near plane to the far plane, so hits come back as a fraction of that span.
+        Ray ray;
+        ray.origin    = glm::vec3(nearPoint) / nearPoint.w;
+        ray.direction = glm::vec3(farPoint) / farPoint.w - ray.origin;
+
+        std::optional<Bvh::Hit> hit = sceneBvh.intersect(
+            ray,
+            1.0f,
+            [this](uint32_t object, const Ray& sceneRay, float maxDistance)
+            { return intersectObject(object, sceneRay, maxDistance); });
+
+        if (hit)
+        {
+            std::cout << "[PICK] \tobject " << hit->primitive << " at distance "
+                      << hit->distance * glm::length(ray.direction) << std::endl;
+        }
+        else
+        {
+            std::cout << "[PICK] \tnothing under the cursor" << std::endl;
+        }
+    }
+
+    // Every object instances the same mesh, so the ray is moved into the mesh's space rather than the other way round.
+    // Distances carry over unchanged since the direction is transformed along with the origin.
+    std::optional<float> intersectObject(uint32_t object, const Ray& ray, float maxDistance)
+    {
+        glm::mat4 sceneToObject = glm::inverse(objects[object].model);
+
+        Ray local;
+        local.origin    = glm::vec3(sceneToObject * glm::vec4(ray.origin, 1.0f));
+        local.direction = glm::vec3(sceneToObject * glm::vec4(ray.direction, 0.0f));
+
+        std::optional<Bvh::Hit> hit = meshBvh.intersect(
+            local,
+            maxDistance,
+            [this](uint32_t triangle, const Ray& meshRay, float)
+            {
+                return intersectTriangle(
+                    meshRay,
+                    model.vertices[model.indices[triangle * 3]].pos,
+                    model.vertices[model.indices[triangle * 3 + 1]].pos,
+                    model.vertices[model.indices[triangle * 3 + 2]].pos);
+            });
+
+        return hit ? std::optional<float>(hit->distance) : std::nullopt;
+    }
+
+    void sampleGpuFrameTime(uint32_t imageIndex)
+    {
+        std::array<uint64_t, 2> timestamps{};
+        VkResult                result;
+        {
+            UncountedHeapAllocations driver;
+            result = vkGetQueryPoolResults(
+                device,
+                timestampQueryPool,
+                imageIndex * 2,
+                2,
+                sizeof(timestamps),
+                timestamps.data(),
+                sizeof(uint64_t),
+                VK_QUERY_RESULT_64_BIT);
+        }
+        if (result != VK_SUCCESS)
+        {
+            return;
+        }
+
+        uint64_t ticks     = (timestamps[1] - timestamps[0]) & timestampMask;
+        double   frameTime = ticks * timestampPeriod / 1e6;
+
+        gpuFrameTimeTotal += frameTime;
+        gpuFrameTimeSamples++;
+
+        if (options.benchmarkFrames > 0)
+        {
+            benchmarkGpuTimes.push_back(frameTime);
+        }
+
+        if (qualityController && qualityController->addFrameTime(frameTime))
+        {
+            qualityChangePending = true;
+        }
     }
 
     void updateUniformBuffer(uint32_t currentImage)
     {
+        CPU_ZONE("updateUniformBuffer");
+
         static auto startTime = std::chrono::high_resolution_clock::now();
 
         auto  currentTime = std::chrono::high_resolution_clock::now();
         float time        = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
 
+        // Headless and benchmark runs are reproducible: frame N always shows the scene at the same moment, seen from
+        // the same point of the camera path.
+        glm::vec3 eye = cameraPosition;
+        if (options.headless || options.benchmarkFrames > 0)
+        {
+            time = framesRendered * SIMULATED_FRAME_STEP;
+            eye  = scriptedCameraPosition(cameraPosition, time, CAMERA_PATH_PERIOD);
+        }
+
+        float     aspect = swapChainExtent.width / (float)swapChainExtent.height;
+        SceneView view   = makeSceneView(time, eye, aspect, sceneRadius);
+
         UniformBufferObject ubo{};
-        ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(10.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.view  = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.proj =
-            glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float)swapChainExtent.height, 0.1f, 10.0f);
+        ubo.model = view.model;
+        ubo.view  = view.view;
+        ubo.proj  = view.proj;
+
+        // Object bounds live in the space before ubo.model, so the planes include it.
+        sceneToClip     = ubo.proj * ubo.view * ubo.model;
+        sceneToView     = ubo.view * ubo.model;
+        sceneNearPlane  = view.nearPlane;
+        projectionScale = ubo.proj[1][1];
+        objectFrustum   = extractFrustumPlanes(sceneToClip);
+        std::copy(objectFrustum.begin(), objectFrustum.end(), ubo.frustumPlanes);
+        ubo.objectCount = static_cast<uint32_t>(objects.size());
+
+        // The scene is drawn at renderExtent, so that is the pixel grid the fragment shader's tiles divide.
+        lightClusters.setProjection(ubo.proj, view.nearPlane, view.farPlane);
+        ubo.clusterGrid  =
+            glm::uvec4(LightClusters::tilesX, LightClusters::tilesY, LightClusters::depthSlices, options.lightCount);
+        ubo.clusterScale = glm::vec4(
+            static_cast<float>(LightClusters::tilesX) / renderExtent.width,
+            static_cast<float>(LightClusters::tilesY) / renderExtent.height,
+            lightClusters.sliceScale(),
+            lightClusters.sliceBias());
+        ubo.textureMinLod = static_cast<float>(textureVisibleLevel - textureFirstLevel);
+
+        {
+            UncountedHeapAllocations driver;
+            void*                    data;
+            vkMapMemory(device, uniformBuffersMemory[currentImage], 0, sizeof(ubo), 0, &data);
+            memcpy(data, &ubo, sizeof(ubo));
+            vkUnmapMemory(device, uniformBuffersMemory[currentImage]);
+        }
 
-        ubo.proj[1][1] *= -1;
+        updateLights(currentImage, time, sceneToView);
+    }
 
-        void* data;
-        vkMapMemory(device, uniformBuffersMemory[currentImage], 0, sizeof(ubo), 0, &data);
-        memcpy(data, &ubo, sizeof(ubo));
-        vkUnmapMemory(device, uniformBuffersMemory[currentImage]);
+    // Moves the lights along their orbits, assigns them to clusters and writes the lights, cluster ranges and light
+    // indices for currentImage, whose previous frame has finished with them.
+    void updateLights(uint32_t currentImage, float time, const glm::mat4& sceneToView)
+    {
+        if (options.lightCount == 0)
+        {
+            return;
+        }
+
+        auto assignStart = std::chrono::steady_clock::now();
+
+        for (uint32_t i = 0; i < options.lightCount; i++)
+        {
+            const glm::vec4& orbit = lightOrbits[i];
+            float            angle = time * LIGHT_ORBIT_SPEED + orbit.w;
+            lightSpheres.x[i]      = orbit.x + LIGHT_ORBIT_RADIUS * std::cos(angle);
+            lightSpheres.y[i]      = orbit.y + LIGHT_ORBIT_RADIUS * std::sin(angle);
+        }
+
+        size_t written =
+            lightClusters.assign(lightSpheres, sceneToView, lightIndexCapacity(), frameArenas[currentFrame].get());
+
+        auto* lights = static_cast<PointLight*>(lightData[currentImage]);
+        for (uint32_t i = 0; i < options.lightCount; i++)
+        {
+            lights[i] = {lightClusters.viewLights()[i], lightColors[i]};
+        }
+        memcpy(
+            clusterData[currentImage],
+            lightClusters.ranges().data(),
+            sizeof(LightClusters::Range) * LightClusters::clusterCount);
+        memcpy(lightIndexData[currentImage], lightClusters.indices().data(), sizeof(uint32_t) * written);
+
+        auto assignEnd = std::chrono::steady_clock::now();
+        lightClusteringTime += std::chrono::duration<double, std::milli>(assignEnd - assignStart).count();
+        lightIndicesTotal += written;
+        lightIndicesDropped += lightClusters.droppedIndices();
+        lightFrames++;
     }
 
     void cleanup()
     {
+        CPU_ZONE("cleanup");
+
         cleanupSwapChain();
 
-        vkDestroySampler(device, textureSampler, nullptr);
-        vkDestroyImageView(device, textureImageView, nullptr);
+        if (bindlessDescriptorPool != VK_NULL_HANDLE)
+        {
+            vkDestroyDescriptorPool(device, bindlessDescriptorPool, allocator);
+        }
+
+        vkDestroySampler(device, textureSampler, allocator);
+        for (size_t material = 1; material < materialImageViews.size(); material++)
+        {
+            vkDestroyImageView(device, materialImageViews[material], allocator);
+        }
+        vkDestroyImageView(device, textureImageView, allocator);
+
+        vkDestroyImage(device, textureImage, allocator);
+        vkFreeMemory(device, textureImageMemory, allocator);
+
+        swapChainDescriptors.destroy();
+        descriptorCache.destroy();
+
+        vkDestroyDescriptorSetLayout(device, descriptorSetLayout, allocator);
+        vkDestroyDescriptorSetLayout(device, materialDescriptorSetLayout, allocator);
+        vkDestroyDescriptorSetLayout(device, cullDescriptorSetLayout, allocator);
+        vkDestroyDescriptorSetLayout(device, hizDescriptorSetLayout, allocator);
 
-        vkDestroyImage(device, textureImage, nullptr);
-        vkFreeMemory(device, textureImageMemory, nullptr);
+        if (options.gpuDriven)
+        {
+            vkDestroyPipeline(device, cullPipeline, allocator);
+            vkDestroyPipelineLayout(device, cullPipelineLayout, allocator);
+            vkDestroySampler(device, depthPyramidSampler, allocator);
+
+            vkDestroyBuffer(device, visibilityBuffer, allocator);
+            vkFreeMemory(device, visibilityBufferMemory, allocator);
+        }
+
+        if (options.hiz)
+        {
+            vkDestroyPipeline(device, hizPipeline, allocator);
+            vkDestroyPipelineLayout(device, hizPipelineLayout, allocator);
+        }
 
-        vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+        vkDestroyBuffer(device, objectBuffer, allocator);
+        vkFreeMemory(device, objectBufferMemory, allocator);
 
-        vkDestroyBuffer(device, indexBuffer, nullptr);
-        vkFreeMemory(device, indexBufferMemory, nullptr);
+        vkDestroyBuffer(device, indexBuffer, allocator);
+        vkFreeMemory(device, indexBufferMemory, allocator);
 
-        vkDestroyBuffer(device, vertexBuffer, nullptr);
-        vkFreeMemory(device, vertexBufferMemory, nullptr);
+        vkDestroyBuffer(device, vertexBuffer, allocator);
+        vkFreeMemory(device, vertexBufferMemory, allocator);
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        for (size_t i = 0; i < options.framesInFlight; i++)
         {
-            vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
-            vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
-            vkDestroyFence(device, inFlightFences[i], nullptr);
+            vkDestroySemaphore(device, imageAvailableSemaphores[i], allocator);
+            vkDestroyFence(device, inFlightFences[i], allocator);
         }
 
-        vkDestroyCommandPool(device, commandPool, nullptr);
+        // Everything retired goes now that the device is idle, command buffers before their pool and the last swap
+        // chain with the ones it replaced.
+        presentsSinceRecreation = PRESENTS_BEFORE_SWAP_CHAIN_RETIRES;
+        retirePresentedSwapChains();
+        deletionQueue.destroy();
 
-        vkDestroyDevice(device, nullptr);
+        vkDestroyCommandPool(device, commandPool, allocator);
+
+        vkDestroyDevice(device, allocator);
 
         if (enableValidationLayers)
         {
-            DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
+            DestroyDebugUtilsMessengerEXT(instance, debugMessenger, allocator);
         }
 
-        vkDestroySurfaceKHR(instance, surface, nullptr);
-        vkDestroyInstance(instance, nullptr);
+        if (!options.headless)
+        {
+            vkDestroySurfaceKHR(instance, surface, allocator);
+        }
+        vkDestroyInstance(instance, allocator);
 
-        glfwDestroyWindow(window);
-        glfwTerminate();
+        if (!options.headless)
+        {
+            glfwDestroyWindow(window);
+            glfwTerminate();
+        }
 
         physicalDevice = VK_NULL_HANDLE;
     }
@@ -2109,11 +5858,16 @@ class HelloTriangleApplication {
 
     std::vector<const char*> getRequiredExtensions()
     {
-        uint32_t     glfwExtensionCount = 0;
-        const char** glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        std::vector<const char*> extensions;
 
-        std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        if (!options.headless)
+        {
+            uint32_t     glfwExtensionCount = 0;
+            const char** glfwExtensions;
+            glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+            extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        }
 
         if (enableValidationLayers)
         {
@@ -2175,7 +5929,7 @@ class HelloTriangleApplication {
         VkDebugUtilsMessengerCreateInfoEXT createInfo;
         populateDebugMessengerCreateInfo(&createInfo);
 
-        if (CreateDebugUtilsMessengerEXT(instance, &createInfo, nullptr, &debugMessenger) != VK_SUCCESS)
+        if (CreateDebugUtilsMessengerEXT(instance, &createInfo, allocator, &debugMessenger) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to set up debug messenger!");
         }
@@ -2210,12 +5964,203 @@ class HelloTriangleApplication {
     }
 };
 
-int main()
+ApplicationOptions parseOptions(int argc, char* argv[])
 {
-    HelloTriangleApplication app;
+    ApplicationOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--shader-dir" && i + 1 < argc)
+        {
+            options.shaderDirectory = argv[++i];
+        }
+        else if (arg == "--report-pipeline")
+        {
+            options.reportPipeline = true;
+        }
+        else if (arg == "--variant" && i + 1 < argc)
+        {
+            options.shaderVariantName = argv[++i];
+            options.shaderVariant     = ShaderVariant::fromName(options.shaderVariantName);
+        }
+        else if (arg == "--overdraw" && i + 1 < argc)
+        {
+            options.overdraw = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--frames" && i + 1 < argc)
+        {
+            options.benchmarkFrames = std::max(0, std::stoi(argv[++i]));
+        }
+        else if (arg == "--objects" && i + 1 < argc)
+        {
+            options.objectCount = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--gpu-driven")
+        {
+            options.gpuDriven = true;
+        }
+        else if (arg == "--hiz")
+        {
+            options.hiz       = true;
+            options.gpuDriven = true;
+        }
+        else if (arg == "--cpu-cull")
+        {
+            options.cpuCulling = true;
+        }
+        else if (arg == "--bvh")
+        {
+            options.bvhCulling = true;
+            options.cpuCulling = true;
+        }
+        else if (arg == "--target-ms" && i + 1 < argc)
+        {
+            options.targetFrameTime = std::max(0.0, std::stod(argv[++i]));
+        }
+        else if (arg == "--headless")
+        {
+            options.headless = true;
+        }
+        else if (arg == "--output" && i + 1 < argc)
+        {
+            options.outputDirectory = argv[++i];
+            options.headless        = true;
+        }
+        else if (arg == "--frames-in-flight" && i + 1 < argc)
+        {
+            options.framesInFlight = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--lights" && i + 1 < argc)
+        {
+            options.lightCount = std::max(0, std::stoi(argv[++i]));
+        }
+        else if (arg == "--benchmark-json" && i + 1 < argc)
+        {
+            options.benchmarkJsonPath = argv[++i];
+        }
+        else if (arg == "--compare-baseline" && i + 1 < argc)
+        {
+            options.baselinePath = argv[++i];
+        }
+        else if (arg == "--regression-threshold" && i + 1 < argc)
+        {
+            options.regressionThreshold = std::max(0.0, std::stod(argv[++i]));
+        }
+        else if (arg == "--gpu-profile" && i + 1 < argc)
+        {
+            options.gpuProfilePath = argv[++i];
+        }
+        else if (arg == "--cpu-trace" && i + 1 < argc)
+        {
+#if defined(RENDERER_CPU_PROFILER)
+            options.cpuTracePath = argv[++i];
+#else
+            throw std::invalid_argument("--cpu-trace needs a build with CPU_PROFILER on");
+#endif
+        }
+        else if (arg == "--host-allocator")
+        {
+            options.hostAllocator = true;
+        }
+        else if (arg == "--report-startup")
+        {
+            options.reportStartup = true;
+        }
+        else if (arg == "--startup-json" && i + 1 < argc)
+        {
+            options.startupJsonPath = argv[++i];
+            options.reportStartup   = true;
+        }
+        else if (arg == "--startup-baseline" && i + 1 < argc)
+        {
+            options.startupBaselinePath = argv[++i];
+            options.reportStartup       = true;
+        }
+        else if (arg == "--materials" && i + 1 < argc)
+        {
+            options.materialCount = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--bindless")
+        {
+            options.bindless = true;
+        }
+        else if (arg == "--texture-streaming")
+        {
+            options.textureStreaming = true;
+        }
+        else if (arg == "--texture-budget" && i + 1 < argc)
+        {
+            options.textureBudget    = std::max(0.0, std::stod(argv[++i]));
+            options.textureStreaming = true;
+        }
+        else if (arg == "--model" && i + 1 < argc)
+        {
+            options.modelPath = argv[++i];
+        }
+        else if (arg == "--archive" && i + 1 < argc)
+        {
+            options.archivePath = argv[++i];
+        }
+        else if (arg == "--report-graph")
+        {
+            options.reportGraph = true;
+        }
+        else if (arg == "--layout" && i + 1 < argc)
+        {
+            options.layout = argv[++i];
+            if (options.layout != "grid" && options.layout != "lattice")
+            {
+                throw std::invalid_argument("unknown object layout: " + options.layout);
+            }
+        }
+        else
+        {
+            throw std::invalid_argument("unknown or incomplete option: " + arg);
+        }
+    }
+
+    if (options.cpuCulling && options.gpuDriven)
+    {
+        throw std::invalid_argument("--cpu-cull and --gpu-driven each cull on their own, pick one");
+    }
+
+    if (options.materialCount > 1 && !options.bindless && (options.gpuDriven || options.cpuCulling))
+    {
+        throw std::invalid_argument(
+            "--materials above 1 with indirect draws needs --bindless: descriptor sets cannot change between draws");
+    }
+
+    if (options.textureStreaming && options.bindless)
+    {
+        throw std::invalid_argument(
+            "--texture-streaming cannot be combined with --bindless: streaming replaces the texture's views, which "
+            "the bindless set cannot change while frames are in flight");
+    }
+
+    // Applied after the loop so --variant cannot reset them.
+    options.shaderVariant.useLighting     = options.lightCount > 0 ? VK_TRUE : VK_FALSE;
+    options.shaderVariant.clampTextureLod = options.textureStreaming ? VK_TRUE : VK_FALSE;
+
+    if (options.headless && options.benchmarkFrames == 0)
+    {
+        throw std::invalid_argument("--headless needs --frames to know when to stop");
+    }
 
+    if ((!options.benchmarkJsonPath.empty() || !options.baselinePath.empty()) && options.benchmarkFrames == 0)
+    {
+        throw std::invalid_argument("--benchmark-json and --compare-baseline need --frames to run a benchmark");
+    }
+
+    return options;
+}
+
+int main(int argc, char* argv[])
+{
     try
     {
+        HelloTriangleApplication app(parseOptions(argc, argv));
         app.run();
     }
     catch (const std::exception& e)
@@ -0,0 +1,289 @@
+#include "asset_archive.h"
+
+#include "cpu_profiler.h"
+
+#include <lz4.h>
+#include <lz4hc.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr char ARCHIVE_MAGIC[4] = {'V', 'P', 'A', 'K'};
+
+    struct ArchiveHeader
+    {
+        char     magic[4];
+        uint32_t version;
+        uint64_t entryCount;
+        uint64_t tocOffset;
+        uint64_t tocSize;
+    };
+
+    // The fixed part of a table of contents entry; the name follows it.
+    struct TocRecord
+    {
+        uint64_t offset;
+        uint64_t storedSize;
+        uint64_t size;
+        uint32_t compression;
+        uint32_t nameLength;
+    };
+
+    uint64_t alignUp(uint64_t offset)
+    {
+        return (offset + ARCHIVE_ALIGNMENT - 1) / ARCHIVE_ALIGNMENT * ARCHIVE_ALIGNMENT;
+    }
+
+    std::vector<char> readWholeFile(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::ate | std::ios::binary);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("failed to open " + path + "!");
+        }
+
+        std::vector<char> bytes(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(bytes.data(), bytes.size());
+        return bytes;
+    }
+
+    // Only worth it when it saves an eighth.
+    bool compressLz4(std::vector<char>& bytes)
+    {
+        if (bytes.empty() || bytes.size() > LZ4_MAX_INPUT_SIZE)
+        {
+            return false;
+        }
+
+        int               size = static_cast<int>(bytes.size());
+        std::vector<char> compressed(LZ4_compressBound(size));
+        int               compressedSize = LZ4_compress_HC(
+            bytes.data(),
+            compressed.data(),
+            size,
+            static_cast<int>(compressed.size()),
+            LZ4HC_CLEVEL_MAX);
+        if (compressedSize <= 0 || static_cast<size_t>(compressedSize) > bytes.size() - bytes.size() / 8)
+        {
+            return false;
+        }
+
+        compressed.resize(compressedSize);
+        bytes = std::move(compressed);
+        return true;
+    }
+} // namespace
+
+std::vector<ArchiveEntry> writeAssetArchive(
+    const std::string&            path,
+    std::span<const ArchiveInput> files,
+    bool                          compress)
+{
+    std::ofstream archive(path, std::ios::binary | std::ios::trunc);
+    if (!archive.is_open())
+    {
+        throw std::runtime_error("failed to create " + path + "!");
+    }
+
+    // The header goes in last, once the table's place is known.
+    std::vector<char>         padding(ARCHIVE_ALIGNMENT, 0);
+    std::vector<ArchiveEntry> entries;
+    uint64_t                  offset = ARCHIVE_ALIGNMENT;
+    archive.write(padding.data(), ARCHIVE_ALIGNMENT);
+
+    for (const ArchiveInput& input : files)
+    {
+        std::vector<char> bytes = readWholeFile(input.path);
+        ArchiveEntry      entry{input.name, offset, 0, bytes.size(), ArchiveCompression::None};
+        if (compress && compressLz4(bytes))
+        {
+            entry.compression = ArchiveCompression::Lz4;
+        }
+        entry.storedSize = bytes.size();
+        entries.push_back(entry);
+
+        archive.write(bytes.data(), bytes.size());
+        uint64_t end = alignUp(offset + bytes.size());
+        archive.write(padding.data(), end - offset - bytes.size());
+        offset = end;
+    }
+
+    uint64_t tocOffset = offset;
+    for (const ArchiveEntry& entry : entries)
+    {
+        TocRecord record{
+            entry.offset,
+            entry.storedSize,
+            entry.size,
+            static_cast<uint32_t>(entry.compression),
+            static_cast<uint32_t>(entry.name.size())};
+        archive.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        archive.write(entry.name.data(), entry.name.size());
+        offset += sizeof(record) + entry.name.size();
+    }
+
+    ArchiveHeader header{};
+    std::memcpy(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+    header.version    = ARCHIVE_VERSION;
+    header.entryCount = entries.size();
+    header.tocOffset  = tocOffset;
+    header.tocSize    = offset - tocOffset;
+    archive.seekp(0);
+    archive.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    archive.close();
+    if (!archive)
+    {
+        throw std::runtime_error("failed to write " + path + "!");
+    }
+    return entries;
+}
+
+AssetArchive::AssetArchive(const std::string& path, AsyncFileReader& reader)
+    : path(path)
+    , reader(reader)
+{
+#if defined(_WIN32)
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+#else
+    file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0)
+#endif
+    {
+        throw std::runtime_error("failed to open " + path + "!");
+    }
+
+    try
+    {
+        ArchiveHeader header;
+        FileRead      headerRead{0, sizeof(header), &header};
+        reader.read(file, {&headerRead, 1});
+        if (std::memcmp(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0 || header.version != ARCHIVE_VERSION)
+        {
+            throw std::runtime_error(path + " is not a version " + std::to_string(ARCHIVE_VERSION) + " archive!");
+        }
+
+        std::vector<uint8_t> bytes(header.tocSize);
+        FileRead             tocRead{header.tocOffset, bytes.size(), bytes.data()};
+        reader.read(file, {&tocRead, 1});
+
+        size_t position = 0;
+        for (uint64_t i = 0; i < header.entryCount; i++)
+        {
+            TocRecord record;
+            if (bytes.size() - position < sizeof(record))
+            {
+                throw std::runtime_error("failed to read the table of contents of " + path + "!");
+            }
+            std::memcpy(&record, bytes.data() + position, sizeof(record));
+            position += sizeof(record);
+
+            if (bytes.size() - position < record.nameLength ||
+                record.compression > static_cast<uint32_t>(ArchiveCompression::Lz4) ||
+                (record.compression == static_cast<uint32_t>(ArchiveCompression::None) &&
+                 record.storedSize != record.size))
+            {
+                throw std::runtime_error("failed to read the table of contents of " + path + "!");
+            }
+
+            std::string name(reinterpret_cast<const char*>(bytes.data() + position), record.nameLength);
+            position += record.nameLength;
+            toc.push_back(
+                {std::move(name),
+                 record.offset,
+                 record.storedSize,
+                 record.size,
+                 static_cast<ArchiveCompression>(record.compression)});
+        }
+    }
+    catch (...)
+    {
+#if defined(_WIN32)
+        CloseHandle(file);
+#else
+        close(file);
+#endif
+        throw;
+    }
+}
+
+AssetArchive::~AssetArchive()
+{
+#if defined(_WIN32)
+    CloseHandle(file);
+#else
+    close(file);
+#endif
+}
+
+const ArchiveEntry* AssetArchive::find(std::string_view name) const
+{
+    auto entry = std::find_if(toc.begin(), toc.end(), [name](const ArchiveEntry& entry) { return entry.name == name; });
+    return entry == toc.end() ? nullptr : &*entry;
+}
+
+void AssetArchive::read(std::span<const ArchiveRead> reads) const
+{
+    CPU_ZONE("AssetArchive::read");
+
+    // Compressed entries are read back to back into one scratch buffer.
+    size_t scratchSize = 0;
+    for (const ArchiveRead& read : reads)
+    {
+        if (read.entry->compression != ArchiveCompression::None)
+        {
+            scratchSize += read.entry->storedSize;
+        }
+    }
+
+    std::vector<uint8_t>  scratch(scratchSize);
+    std::vector<FileRead> fileReads;
+    size_t                scratchOffset = 0;
+    for (const ArchiveRead& read : reads)
+    {
+        void* destination = read.destination;
+        if (read.entry->compression != ArchiveCompression::None)
+        {
+            destination = scratch.data() + scratchOffset;
+            scratchOffset += read.entry->storedSize;
+        }
+        fileReads.push_back({read.entry->offset, static_cast<size_t>(read.entry->storedSize), destination});
+    }
+
+    reader.read(file, fileReads);
+
+    scratchOffset = 0;
+    for (const ArchiveRead& read : reads)
+    {
+        if (read.entry->compression == ArchiveCompression::None)
+        {
+            continue;
+        }
+
+        CPU_ZONE("decompress LZ4");
+        int size = LZ4_decompress_safe(
+            reinterpret_cast<const char*>(scratch.data() + scratchOffset),
+            static_cast<char*>(read.destination),
+            static_cast<int>(read.entry->storedSize),
+            static_cast<int>(read.entry->size));
+        if (size < 0 || static_cast<uint64_t>(size) != read.entry->size)
+        {
+            throw std::runtime_error("failed to decompress " + read.entry->name + " from " + path + "!");
+        }
+        scratchOffset += read.entry->storedSize;
+    }
+}
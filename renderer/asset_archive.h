@@ -0,0 +1,81 @@
+#pragma once
+
+#include "async_file_reader.h"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A packed asset archive: many files in one, so loading several of them opens a single file and has all their reads in
+// flight at once.
+//
+// The layout, little-endian: a header (the magic "VPAK", the format version, the entry count, and the offset and
+// size of the table of contents), each file's bytes starting on an ARCHIVE_ALIGNMENT boundary, then the table of
+// contents: per entry its offset, stored size, size, compression, and name prefixed by its length. Names are paths
+// relative to the directory the files were packed from, with forward slashes, e.g. "models/viking_room.obj".
+constexpr uint32_t ARCHIVE_VERSION = 1;
+// A page, and a multiple of any disk's sector size, so no two files share one.
+constexpr uint64_t ARCHIVE_ALIGNMENT = 4096;
+
+enum class ArchiveCompression : uint32_t
+{
+    None = 0,
+    // The LZ4 block format; storedSize is the compressed size.
+    Lz4 = 1,
+};
+
+struct ArchiveEntry
+{
+    std::string        name;
+    uint64_t           offset;
+    uint64_t           storedSize;
+    uint64_t           size;
+    ArchiveCompression compression;
+};
+
+// A file to pack, stored under name and read from path.
+struct ArchiveInput
+{
+    std::string name;
+    std::string path;
+};
+
+// Writes files into a new archive at path and returns its table of contents. With compress, a file is stored LZ4
+// compressed when that saves at least an eighth of it, which already compressed formats such as PNG rarely allow.
+std::vector<ArchiveEntry> writeAssetArchive(
+    const std::string&            path,
+    std::span<const ArchiveInput> files,
+    bool                          compress);
+
+// One entry's contents, decompressed, to destination, which holds entry->size bytes.
+struct ArchiveRead
+{
+    const ArchiveEntry* entry;
+    void*               destination;
+};
+
+// An archive opened for reading through reader, which has to outlive it.
+class AssetArchive {
+  public:
+    AssetArchive(const std::string& path, AsyncFileReader& reader);
+    ~AssetArchive();
+
+    AssetArchive(const AssetArchive&)            = delete;
+    AssetArchive& operator=(const AssetArchive&) = delete;
+
+    const std::vector<ArchiveEntry>& entries() const { return toc; }
+    // Null when there is no entry called name.
+    const ArchiveEntry* find(std::string_view name) const;
+
+    // Issues the reads of every entry together and returns once all have arrived. Uncompressed entries go straight
+    // to their destinations; compressed ones are read into scratch memory and decompressed from there.
+    void read(std::span<const ArchiveRead> reads) const;
+
+  private:
+    std::string               path;
+    AsyncFileReader&          reader;
+    FileHandle                file;
+    std::vector<ArchiveEntry> toc;
+};
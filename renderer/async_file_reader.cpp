@@ -0,0 +1,220 @@
+#include "async_file_reader.h"
+
+#include "cpu_profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(RENDERER_IO_URING)
+#include <liburing.h>
+#endif
+
+namespace {
+    // Blocking reads only need enough threads to keep the device busy, not one per piece.
+    constexpr uint32_t MAX_READ_THREADS = 8;
+
+    // Reads until size bytes have arrived; false on an error or the end of the file.
+    bool readFully(FileHandle file, uint64_t offset, size_t size, uint8_t* destination)
+    {
+        while (size > 0)
+        {
+#if defined(_WIN32)
+            OVERLAPPED overlapped{};
+            overlapped.Offset     = static_cast<DWORD>(offset);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+            DWORD read = 0;
+            if (!ReadFile(file, destination, static_cast<DWORD>(size), &read, &overlapped) || read == 0)
+            {
+                return false;
+            }
+#else
+            ssize_t read = pread(file, destination, size, static_cast<off_t>(offset));
+            if (read < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (read <= 0)
+            {
+                return false;
+            }
+#endif
+            offset += static_cast<uint64_t>(read);
+            size -= static_cast<size_t>(read);
+            destination += read;
+        }
+        return true;
+    }
+} // namespace
+
+struct AsyncFileReader::Ring
+{
+#if defined(RENDERER_IO_URING)
+    io_uring ring;
+#endif
+};
+
+AsyncFileReader::AsyncFileReader(uint32_t queueDepth)
+    : queueDepth(std::max(1u, queueDepth))
+{
+#if defined(RENDERER_IO_URING)
+    auto candidate = std::make_unique<Ring>();
+    if (io_uring_queue_init(this->queueDepth, &candidate->ring, 0) == 0)
+    {
+        ring = std::move(candidate);
+    }
+#endif
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+#if defined(RENDERER_IO_URING)
+    if (ring)
+    {
+        io_uring_queue_exit(&ring->ring);
+    }
+#endif
+}
+
+void AsyncFileReader::read(FileHandle file, std::span<const FileRead> reads)
+{
+    CPU_ZONE("AsyncFileReader::read");
+
+    std::vector<Piece> pieces;
+    for (const FileRead& read : reads)
+    {
+        auto* destination = static_cast<uint8_t*>(read.destination);
+        for (size_t done = 0; done < read.size; done += READ_PIECE)
+        {
+            pieces.push_back({read.offset + done, std::min(READ_PIECE, read.size - done), destination + done});
+        }
+    }
+    std::sort(pieces.begin(), pieces.end(), [](const Piece& a, const Piece& b) { return a.offset < b.offset; });
+
+    if (ring)
+    {
+        readThroughRing(file, pieces);
+    }
+    else
+    {
+        readThroughThreads(file, pieces);
+    }
+}
+
+const char* AsyncFileReader::backend() const
+{
+    return ring ? "io_uring" : "pread";
+}
+
+void AsyncFileReader::readThroughRing([[maybe_unused]] FileHandle file, [[maybe_unused]] std::vector<Piece>& pieces)
+{
+#if defined(RENDERER_IO_URING)
+    // Pieces still to submit, taken from the back so they go out in file order. A short read goes back on with what
+    // is left of it.
+    std::vector<Piece*> pending;
+    for (size_t i = pieces.size(); i-- > 0;)
+    {
+        pending.push_back(&pieces[i]);
+    }
+
+    uint32_t inFlight = 0;
+    int      error    = 0;
+    while (!pending.empty() || inFlight > 0)
+    {
+        while (!pending.empty() && inFlight < queueDepth)
+        {
+            io_uring_sqe* sqe = io_uring_get_sqe(&ring->ring);
+            if (!sqe)
+            {
+                break;
+            }
+
+            Piece* piece = pending.back();
+            pending.pop_back();
+            io_uring_prep_read(sqe, file, piece->destination, static_cast<unsigned>(piece->size), piece->offset);
+            io_uring_sqe_set_data(sqe, piece);
+            inFlight++;
+        }
+
+        int submitted = io_uring_submit_and_wait(&ring->ring, 1);
+        if (submitted < 0 && submitted != -EINTR)
+        {
+            throw std::runtime_error("failed to submit file reads: error " + std::to_string(-submitted) + "!");
+        }
+
+        io_uring_cqe* cqe;
+        unsigned      head;
+        unsigned      completed = 0;
+        io_uring_for_each_cqe(&ring->ring, head, cqe)
+        {
+            auto* piece = static_cast<Piece*>(io_uring_cqe_get_data(cqe));
+            completed++;
+
+            if (cqe->res <= 0)
+            {
+                // Past the end of the file unless the kernel says otherwise.
+                error = cqe->res < 0 ? -cqe->res : EIO;
+            }
+            else if (static_cast<size_t>(cqe->res) < piece->size)
+            {
+                piece->offset += static_cast<uint64_t>(cqe->res);
+                piece->size -= static_cast<size_t>(cqe->res);
+                piece->destination += cqe->res;
+                pending.push_back(piece);
+            }
+        }
+        io_uring_cq_advance(&ring->ring, completed);
+        inFlight -= completed;
+
+        // Reads already submitted still write their destinations, so they are waited for before giving up.
+        if (error)
+        {
+            pending.clear();
+        }
+    }
+
+    if (error)
+    {
+        throw std::runtime_error("failed to read from a file: error " + std::to_string(error) + "!");
+    }
+#endif
+}
+
+void AsyncFileReader::readThroughThreads(FileHandle file, const std::vector<Piece>& pieces)
+{
+    if (!threads)
+    {
+        threads = std::make_unique<ThreadPool>(std::min(queueDepth, MAX_READ_THREADS) - 1);
+    }
+
+    std::atomic<bool> failed = false;
+    threads->parallelFor(
+        pieces.size(),
+        1,
+        [&](size_t begin, size_t end, size_t)
+        {
+            for (size_t i = begin; i < end && !failed; i++)
+            {
+                if (!readFully(file, pieces[i].offset, pieces[i].size, pieces[i].destination))
+                {
+                    failed = true;
+                }
+            }
+        });
+
+    if (failed)
+    {
+        throw std::runtime_error("failed to read from a file!");
+    }
+}
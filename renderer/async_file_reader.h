@@ -0,0 +1,63 @@
+#pragma once
+
+#include "thread_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#if defined(_WIN32)
+using FileHandle = void*;
+#else
+using FileHandle = int;
+#endif
+
+// size bytes of a file starting at offset, read to destination.
+struct FileRead
+{
+    uint64_t offset;
+    size_t   size;
+    void*    destination;
+};
+
+// Reads many ranges of a file at once. Every range is split into pieces of at most READ_PIECE bytes, and up to
+// queueDepth pieces are in flight together, so the device sees a deep queue even for a single large read.
+//
+// Built with RENDERER_IO_URING, the pieces are submitted to an io_uring and their completions reaped as they come in;
+// when the kernel refuses to set one up (too old, or blocked by a sandbox) or on other platforms, a pool of threads
+// calls pread() on them instead. Destinations are written directly, so they can be mapped staging memory.
+class AsyncFileReader {
+  public:
+    static constexpr size_t READ_PIECE = size_t(1) << 20;
+
+    explicit AsyncFileReader(uint32_t queueDepth = 64);
+    ~AsyncFileReader();
+
+    AsyncFileReader(const AsyncFileReader&)            = delete;
+    AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+    // Returns once every read has completed. Throws when one fails or runs past the end of the file.
+    void read(FileHandle file, std::span<const FileRead> reads);
+
+    // "io_uring" or "pread".
+    const char* backend() const;
+
+  private:
+    struct Piece
+    {
+        uint64_t offset;
+        size_t   size;
+        uint8_t* destination;
+    };
+
+    void readThroughRing(FileHandle file, std::vector<Piece>& pieces);
+    void readThroughThreads(FileHandle file, const std::vector<Piece>& pieces);
+
+    struct Ring;
+    std::unique_ptr<Ring> ring;
+    uint32_t              queueDepth;
+    // Created on first use, and only when there is no ring.
+    std::unique_ptr<ThreadPool> threads;
+};
@@ -0,0 +1,512 @@
+#include "benchmark_report.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+    const char* statisticNames[] = {"count", "min", "mean", "p50", "p95", "p99", "max"};
+
+    double* statistic(FrameStatistics& stats, const std::string& name)
+    {
+        double* values[] = {nullptr, &stats.min, &stats.mean, &stats.p50, &stats.p95, &stats.p99, &stats.max};
+        for (size_t i = 1; i < std::size(statisticNames); i++)
+        {
+            if (name == statisticNames[i])
+            {
+                return values[i];
+            }
+        }
+        return nullptr;
+    }
+
+    void writeString(std::ostream& out, const std::string& text)
+    {
+        out << '"';
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out << '\\';
+            }
+            out << c;
+        }
+        out << '"';
+    }
+
+    // Just enough JSON for the files writeJson() and Google Benchmark produce; escapes in strings only protect the
+    // next character, so \u sequences come out undecoded.
+    class Parser {
+      public:
+        Parser(std::string text, std::string path)
+            : text(std::move(text))
+            , path(std::move(path))
+        {
+        }
+
+        // Calls member(key) for each key of the object at the cursor; member must consume the value.
+        template <typename Function>
+        void object(Function member)
+        {
+            expect('{');
+            if (peek() == '}')
+            {
+                position++;
+                return;
+            }
+
+            for (;;)
+            {
+                std::string key = string();
+                expect(':');
+                member(key);
+
+                char next = peek();
+                position++;
+                if (next == '}')
+                {
+                    return;
+                }
+                if (next != ',')
+                {
+                    fail("expected ',' or '}'");
+                }
+            }
+        }
+
+        // Calls element() for each element of the array at the cursor; element must consume the value.
+        template <typename Function>
+        void array(Function element)
+        {
+            expect('[');
+            if (peek() == ']')
+            {
+                position++;
+                return;
+            }
+
+            for (;;)
+            {
+                element();
+
+                char next = peek();
+                position++;
+                if (next == ']')
+                {
+                    return;
+                }
+                if (next != ',')
+                {
+                    fail("expected ',' or ']'");
+                }
+            }
+        }
+
+        std::string string()
+        {
+            expect('"');
+            std::string result;
+            while (position < text.size() && text[position] != '"')
+            {
+                if (text[position] == '\\')
+                {
+                    position++;
+                }
+                if (position < text.size())
+                {
+                    result += text[position++];
+                }
+            }
+            expect('"');
+            return result;
+        }
+
+        double number()
+        {
+            peek();
+            size_t      length = 0;
+            const char* start  = text.c_str() + position;
+            double      value  = 0.0;
+            try
+            {
+                value = std::stod(start, &length);
+            }
+            catch (const std::exception&)
+            {
+                fail("expected a number");
+            }
+            position += length;
+            return value;
+        }
+
+        // true, false or null, which reads as false.
+        bool boolean()
+        {
+            peek();
+            for (const char* word : {"true", "false", "null"})
+            {
+                size_t length = std::strlen(word);
+                if (text.compare(position, length, word) == 0)
+                {
+                    position += length;
+                    return word[0] == 't';
+                }
+            }
+            fail("expected true, false or null");
+        }
+
+        // Consumes a value of any type.
+        void skip()
+        {
+            char next = peek();
+            if (next == '{')
+            {
+                object([&](const std::string&) { skip(); });
+            }
+            else if (next == '[')
+            {
+                array([&] { skip(); });
+            }
+            else if (next == '"')
+            {
+                string();
+            }
+            else if (next == 't' || next == 'f' || next == 'n')
+            {
+                boolean();
+            }
+            else
+            {
+                number();
+            }
+        }
+
+        void end()
+        {
+            if (peek() != '\0')
+            {
+                fail("trailing characters");
+            }
+        }
+
+        [[noreturn]] void fail(const std::string& reason) const
+        {
+            throw std::runtime_error(
+                "failed to parse benchmark report " + path + " at offset " + std::to_string(position) + ": " + reason +
+                "!");
+        }
+
+      private:
+        // The next non-space character, or '\0' at the end.
+        char peek()
+        {
+            while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position])))
+            {
+                position++;
+            }
+            return position < text.size() ? text[position] : '\0';
+        }
+
+        void expect(char c)
+        {
+            if (peek() != c)
+            {
+                fail(std::string("expected '") + c + "'");
+            }
+            position++;
+        }
+
+        std::string text;
+        std::string path;
+        size_t      position = 0;
+    };
+    // One entry of Google Benchmark's "benchmarks" array: a repetition of a benchmark, or an aggregate over them.
+    struct GoogleBenchmarkRun
+    {
+        std::string name;
+        std::string runType;
+        std::string timeUnit = "ns";
+        double      realTime = 0.0;
+        bool        failed   = false;
+    };
+
+    double millisecondsPer(const std::string& timeUnit)
+    {
+        if (timeUnit == "ns")
+        {
+            return 1e-6;
+        }
+        if (timeUnit == "us")
+        {
+            return 1e-3;
+        }
+        if (timeUnit == "ms")
+        {
+            return 1.0;
+        }
+        if (timeUnit == "s")
+        {
+            return 1e3;
+        }
+        throw std::runtime_error("failed to read benchmark report: unknown time unit " + timeUnit + "!");
+    }
+} // namespace
+
+FrameStatistics summarizeFrameTimes(std::vector<double> samples)
+{
+    FrameStatistics stats;
+    if (samples.empty())
+    {
+        return stats;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    auto percentile = [&](double p)
+    {
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * samples.size()));
+        return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+    };
+
+    double total = 0.0;
+    for (double sample : samples)
+    {
+        total += sample;
+    }
+
+    stats.count = samples.size();
+    stats.min   = samples.front();
+    stats.mean  = total / samples.size();
+    stats.p50   = percentile(50.0);
+    stats.p95   = percentile(95.0);
+    stats.p99   = percentile(99.0);
+    stats.max   = samples.back();
+    return stats;
+}
+
+void BenchmarkReport::writeJson(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        throw std::runtime_error("failed to open benchmark report " + path + "!");
+    }
+
+    file.precision(17);
+    file << "{\n  \"config\": {";
+    for (size_t i = 0; i < config.size(); i++)
+    {
+        file << (i == 0 ? "\n    " : ",\n    ");
+        writeString(file, config[i].first);
+        file << ": ";
+        writeString(file, config[i].second);
+    }
+    file << "\n  },\n  \"metrics\": {";
+    for (size_t i = 0; i < metrics.size(); i++)
+    {
+        FrameStatistics stats = metrics[i].second;
+
+        file << (i == 0 ? "\n    " : ",\n    ");
+        writeString(file, metrics[i].first);
+        file << ": {\"count\": " << stats.count;
+        for (size_t name = 1; name < std::size(statisticNames); name++)
+        {
+            file << ", \"" << statisticNames[name] << "\": " << *statistic(stats, statisticNames[name]);
+        }
+        file << "}";
+    }
+    file << "\n  }\n}\n";
+
+    if (!file)
+    {
+        throw std::runtime_error("failed to write benchmark report " + path + "!");
+    }
+}
+
+BenchmarkReport BenchmarkReport::readJson(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        throw std::runtime_error("failed to open benchmark report " + path + "!");
+    }
+
+    BenchmarkReport report;
+    Parser          parser(std::string(std::istreambuf_iterator<char>(file), {}), path);
+
+    // Google Benchmark output: the real times of each benchmark's repetitions become the samples of one metric.
+    std::vector<std::pair<std::string, std::vector<double>>> repetitions;
+
+    parser.object(
+        [&](const std::string& section)
+        {
+            if (section == "context")
+            {
+                parser.object(
+                    [&](const std::string& key)
+                    {
+                        if (key == "host_name" || key == "num_cpus" || key == "library_build_type")
+                        {
+                            report.config.emplace_back(key, key == "num_cpus" ? std::to_string(int(parser.number()))
+                                                                               : parser.string());
+                        }
+                        else
+                        {
+                            parser.skip();
+                        }
+                    });
+            }
+            else if (section == "benchmarks")
+            {
+                parser.array(
+                    [&]
+                    {
+                        GoogleBenchmarkRun run;
+                        parser.object(
+                            [&](const std::string& key)
+                            {
+                                if (key == "run_name")
+                                {
+                                    run.name = parser.string();
+                                }
+                                else if (key == "run_type")
+                                {
+                                    run.runType = parser.string();
+                                }
+                                else if (key == "time_unit")
+                                {
+                                    run.timeUnit = parser.string();
+                                }
+                                else if (key == "real_time")
+                                {
+                                    run.realTime = parser.number();
+                                }
+                                else if (key == "error_occurred")
+                                {
+                                    run.failed = parser.boolean();
+                                }
+                                else
+                                {
+                                    parser.skip();
+                                }
+                            });
+                        if (run.runType != "iteration" || run.failed)
+                        {
+                            return;
+                        }
+
+                        auto entry = std::find_if(
+                            repetitions.begin(),
+                            repetitions.end(),
+                            [&](const auto& existing) { return existing.first == run.name; });
+                        if (entry == repetitions.end())
+                        {
+                            entry = repetitions.insert(repetitions.end(), {run.name, {}});
+                        }
+                        entry->second.push_back(run.realTime * millisecondsPer(run.timeUnit));
+                    });
+            }
+            else if (section == "config")
+            {
+                parser.object([&](const std::string& key) { report.config.emplace_back(key, parser.string()); });
+            }
+            else if (section == "metrics")
+            {
+                parser.object(
+                    [&](const std::string& metric)
+                    {
+                        FrameStatistics stats;
+                        parser.object(
+                            [&](const std::string& name)
+                            {
+                                double value = parser.number();
+                                if (name == "count")
+                                {
+                                    stats.count = static_cast<size_t>(value);
+                                }
+                                else if (double* field = statistic(stats, name))
+                                {
+                                    *field = value;
+                                }
+                                else
+                                {
+                                    parser.fail("unknown statistic " + name);
+                                }
+                            });
+                        report.metrics.emplace_back(metric, stats);
+                    });
+            }
+            else
+            {
+                parser.fail("unknown section " + section);
+            }
+        });
+    parser.end();
+
+    for (auto& [name, samples] : repetitions)
+    {
+        report.metrics.emplace_back(name, summarizeFrameTimes(std::move(samples)));
+    }
+    return report;
+}
+
+std::vector<BenchmarkRegression> findRegressions(
+    const BenchmarkReport& baseline,
+    const BenchmarkReport& current,
+    double                 threshold)
+{
+    std::vector<BenchmarkRegression> regressions;
+
+    for (const auto& [metric, before] : baseline.metrics)
+    {
+        auto after = std::find_if(
+            current.metrics.begin(),
+            current.metrics.end(),
+            [&](const auto& entry) { return entry.first == metric; });
+        if (after == current.metrics.end() || before.count == 0 || after->second.count == 0)
+        {
+            continue;
+        }
+
+        FrameStatistics oldStats = before;
+        FrameStatistics newStats = after->second;
+        for (const char* name : {"mean", "p50", "p95", "p99"})
+        {
+            double oldValue = *statistic(oldStats, name);
+            double newValue = *statistic(newStats, name);
+            if (newValue > oldValue * (1.0 + threshold))
+            {
+                regressions.push_back({metric, name, oldValue, newValue});
+            }
+        }
+    }
+
+    return regressions;
+}
+
+std::vector<std::string> configDifferences(const BenchmarkReport& baseline, const BenchmarkReport& current)
+{
+    std::vector<std::string> differences;
+
+    for (const auto& [key, value] : baseline.config)
+    {
+        auto other = std::find_if(
+            current.config.begin(),
+            current.config.end(),
+            [&](const auto& entry) { return entry.first == key; });
+        if (other == current.config.end())
+        {
+            differences.push_back(key + ": " + value + " vs. missing");
+        }
+        else if (other->second != value)
+        {
+            differences.push_back(key + ": " + value + " vs. " + other->second);
+        }
+    }
+
+    return differences;
+}
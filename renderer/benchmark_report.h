@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Summary of one per-frame measurement, in milliseconds. Percentiles are nearest-rank, so each is a time some frame
+// actually took.
+struct FrameStatistics
+{
+    size_t count = 0;
+    double min   = 0.0;
+    double mean  = 0.0;
+    double p50   = 0.0;
+    double p95   = 0.0;
+    double p99   = 0.0;
+    double max   = 0.0;
+};
+
+FrameStatistics summarizeFrameTimes(std::vector<double> samples);
+
+// A benchmark run as it is stored in JSON: the settings it ran with and a summary per measurement, e.g.
+//
+//   {"config": {"variant": "texture", ...}, "metrics": {"frame_time_ms": {"count": 1000, "min": ..., ...}, ...}}
+//
+// readJson() also reads the JSON output of Google Benchmark (--benchmark_out_format=json): each benchmark becomes a
+// metric summarizing the real time of its repetitions in milliseconds, and the host name, CPU count and library
+// build type become the config. Run with --benchmark_repetitions for percentiles that mean something.
+struct BenchmarkReport
+{
+    std::vector<std::pair<std::string, std::string>>     config;
+    std::vector<std::pair<std::string, FrameStatistics>> metrics;
+
+    void                   writeJson(const std::string& path) const;
+    static BenchmarkReport readJson(const std::string& path);
+};
+
+struct BenchmarkRegression
+{
+    std::string metric;
+    std::string statistic;
+    double      baseline;
+    double      current;
+};
+
+// Compares the mean, p50, p95 and p99 of every metric both reports have; any that grew by more than threshold, a
+// fraction of the baseline, is a regression. Every metric is a time, so lower is better.
+std::vector<BenchmarkRegression> findRegressions(
+    const BenchmarkReport& baseline,
+    const BenchmarkReport& current,
+    double                 threshold);
+
+// Settings that differ between the reports, which make a comparison meaningless.
+std::vector<std::string> configDifferences(const BenchmarkReport& baseline, const BenchmarkReport& current);
@@ -0,0 +1,560 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <utility>
+
+namespace {
+    // Where the box sits against one plane: -1 entirely behind it, 1 entirely in front, 0 straddling it.
+    int classify(const glm::vec4& plane, const glm::vec3& min, const glm::vec3& max)
+    {
+        glm::vec3 center   = (min + max) * 0.5f;
+        glm::vec3 extent   = (max - min) * 0.5f;
+        float     distance = glm::dot(glm::vec3(plane), center) + plane.w;
+        float     reach    = glm::dot(glm::abs(glm::vec3(plane)), extent);
+
+        if (distance + reach < 0.0f)
+        {
+            return -1;
+        }
+        return distance - reach >= 0.0f ? 1 : 0;
+    }
+
+    // Distance at which the ray enters the box, or FLT_MAX when it misses it or only enters past maxDistance.
+    float enterDistance(
+        const glm::vec3& min,
+        const glm::vec3& max,
+        const Ray&       ray,
+        const glm::vec3& inverse,
+        float            maxDistance)
+    {
+        glm::vec3 t0 = (min - ray.origin) * inverse;
+        glm::vec3 t1 = (max - ray.origin) * inverse;
+
+        glm::vec3 near = glm::min(t0, t1);
+        glm::vec3 far  = glm::max(t0, t1);
+
+        float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+        float exit  = std::min(std::min(far.x, far.y), std::min(far.z, maxDistance));
+        return enter <= exit ? enter : FLT_MAX;
+    }
+} // namespace
+
+// Moller-Trumbore.
+std::optional<float> intersectTriangle(const Ray& ray, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    constexpr float epsilon = 1e-8f;
+
+    glm::vec3 edge1       = b - a;
+    glm::vec3 edge2       = c - a;
+    glm::vec3 p           = glm::cross(ray.direction, edge2);
+    float     determinant = glm::dot(edge1, p);
+    if (std::abs(determinant) < epsilon)
+    {
+        return std::nullopt;
+    }
+
+    float     inverse = 1.0f / determinant;
+    glm::vec3 t       = ray.origin - a;
+    float     u       = glm::dot(t, p) * inverse;
+    if (u < 0.0f || u > 1.0f)
+    {
+        return std::nullopt;
+    }
+
+    glm::vec3 q = glm::cross(t, edge1);
+    float     v = glm::dot(ray.direction, q) * inverse;
+    if (v < 0.0f || u + v > 1.0f)
+    {
+        return std::nullopt;
+    }
+
+    float distance = glm::dot(edge2, q) * inverse;
+    return distance >= 0.0f ? std::optional<float>(distance) : std::nullopt;
+}
+
+void Bvh::build(const std::vector<Aabb>& bounds)
+{
+    uint32_t primitiveCount = static_cast<uint32_t>(bounds.size());
+
+    primitiveBounds = bounds;
+    primitiveIndices.resize(primitiveCount);
+    std::iota(primitiveIndices.begin(), primitiveIndices.end(), 0u);
+    primitiveLeaves.assign(primitiveCount, invalid);
+    primitiveSlots.resize(primitiveCount);
+
+    nodes.assign(1, Node{});
+    parents.assign(1, invalid);
+
+    if (primitiveCount == 0)
+    {
+        setLeaf(0, invalid, 0);
+        return;
+    }
+
+    // Splitting a node leaves its box unchanged, so every box is final once the node's leaf is set up.
+    setLeaf(0, 0, primitiveCount);
+
+    std::vector<uint32_t> pending = {0};
+    while (!pending.empty())
+    {
+        uint32_t node = pending.back();
+        pending.pop_back();
+
+        subdivide(node);
+        if (!nodes[node].isLeaf())
+        {
+            pending.push_back(nodes[node].leftFirst + 1);
+            pending.push_back(nodes[node].leftFirst);
+        }
+    }
+}
+
+void Bvh::subdivide(uint32_t node)
+{
+    uint32_t first = nodes[node].leftFirst;
+    uint32_t count = nodes[node].count;
+    if (count <= 1)
+    {
+        return;
+    }
+
+    Aabb centroidBounds;
+    for (uint32_t slot = first; slot < first + count; slot++)
+    {
+        centroidBounds.grow(primitiveBounds[primitiveIndices[slot]].center());
+    }
+
+    struct Bin
+    {
+        Aabb     bounds;
+        uint32_t count = 0;
+    };
+
+    float    bestCost  = FLT_MAX;
+    int      bestAxis  = -1;
+    uint32_t bestSplit = 0;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+        if (extent <= 0.0f)
+        {
+            continue;
+        }
+
+        float                     scale = binCount / extent;
+        std::array<Bin, binCount> bins{};
+        for (uint32_t slot = first; slot < first + count; slot++)
+        {
+            const Aabb& box    = primitiveBounds[primitiveIndices[slot]];
+            float       offset = box.center()[axis] - centroidBounds.min[axis];
+            uint32_t    bin    = std::min(binCount - 1, uint32_t(offset * scale));
+            bins[bin].bounds.grow(box);
+            bins[bin].count++;
+        }
+
+        // Sweep from both ends so each split's cost is the area of either side times its primitive count.
+        std::array<float, binCount - 1> leftCost{};
+        Aabb                            left;
+        uint32_t                        leftCount = 0;
+        for (uint32_t split = 0; split < binCount - 1; split++)
+        {
+            left.grow(bins[split].bounds);
+            leftCount += bins[split].count;
+            leftCost[split] = left.surfaceArea() * leftCount;
+        }
+
+        Aabb     right;
+        uint32_t rightCount = 0;
+        for (uint32_t split = binCount - 1; split > 0; split--)
+        {
+            right.grow(bins[split].bounds);
+            rightCount += bins[split].count;
+
+            float cost = leftCost[split - 1] + right.surfaceArea() * rightCount;
+            if (cost < bestCost)
+            {
+                bestCost  = cost;
+                bestAxis  = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    // Splitting costs a box test on top of the children's primitives; a small node is cheaper kept as a leaf.
+    Aabb  nodeBounds = {nodes[node].min, nodes[node].max};
+    float leafCost   = nodeBounds.surfaceArea() * count;
+    if (count <= maxLeafSize && (bestAxis < 0 || bestCost + nodeBounds.surfaceArea() >= leafCost))
+    {
+        return;
+    }
+
+    auto     begin = primitiveIndices.begin() + first;
+    auto     end   = begin + count;
+    uint32_t leftCount;
+    if (bestAxis >= 0)
+    {
+        float scale  = binCount / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]);
+        auto  middle = std::partition(
+            begin,
+            end,
+            [&](uint32_t primitive)
+            {
+                float    offset = primitiveBounds[primitive].center()[bestAxis] - centroidBounds.min[bestAxis];
+                uint32_t bin    = std::min(binCount - 1, uint32_t(offset * scale));
+                return bin < bestSplit;
+            });
+        leftCount = static_cast<uint32_t>(middle - begin);
+    }
+    else
+    {
+        // Every centroid coincides, so no plane separates them; halve the node to keep leaves small.
+        leftCount = count / 2;
+    }
+
+    uint32_t pair = allocatePair(node);
+    setLeaf(pair, first, leftCount);
+    setLeaf(pair + 1, first + leftCount, count - leftCount);
+    nodes[node].leftFirst = pair;
+    nodes[node].count     = 0;
+}
+
+uint32_t Bvh::allocatePair(uint32_t parent)
+{
+    uint32_t pair = static_cast<uint32_t>(nodes.size());
+    nodes.resize(nodes.size() + 2);
+    parents.resize(parents.size() + 2, parent);
+    return pair;
+}
+
+void Bvh::setLeaf(uint32_t node, uint32_t first, uint32_t count)
+{
+    nodes[node].leftFirst = first;
+    nodes[node].count     = count;
+    for (uint32_t slot = first; slot < first + count; slot++)
+    {
+        primitiveLeaves[primitiveIndices[slot]] = node;
+        primitiveSlots[primitiveIndices[slot]]  = slot;
+    }
+    updateBounds(node);
+}
+
+void Bvh::updateBounds(uint32_t node)
+{
+    Node& n = nodes[node];
+    Aabb  box;
+    if (n.isLeaf())
+    {
+        for (uint32_t slot = n.leftFirst; slot < n.leftFirst + n.count; slot++)
+        {
+            box.grow(primitiveBounds[primitiveIndices[slot]]);
+        }
+    }
+    else
+    {
+        box.grow({nodes[n.leftFirst].min, nodes[n.leftFirst].max});
+        box.grow({nodes[n.leftFirst + 1].min, nodes[n.leftFirst + 1].max});
+    }
+    n.min = box.min;
+    n.max = box.max;
+}
+
+void Bvh::refit()
+{
+    // Children are always allocated after their parent, so a reverse sweep sees every child before its parent.
+    for (size_t node = nodes.size(); node-- > 0;)
+    {
+        updateBounds(static_cast<uint32_t>(node));
+    }
+}
+
+void Bvh::refitUpwards(uint32_t node)
+{
+    for (; node != invalid; node = parents[node])
+    {
+        updateBounds(node);
+    }
+}
+
+void Bvh::insert(uint32_t primitive, const Aabb& bounds)
+{
+    if (primitive >= primitiveBounds.size())
+    {
+        primitiveBounds.resize(primitive + 1);
+        primitiveLeaves.resize(primitive + 1, invalid);
+        primitiveSlots.resize(primitive + 1);
+    }
+    primitiveBounds[primitive] = bounds;
+
+    uint32_t slot = static_cast<uint32_t>(primitiveIndices.size());
+    primitiveIndices.push_back(primitive);
+
+    if (nodes.empty())
+    {
+        nodes.assign(1, Node{});
+        parents.assign(1, invalid);
+    }
+    if (nodes[0].isLeaf() && nodes[0].count == 0)
+    {
+        setLeaf(0, slot, 1);
+        return;
+    }
+
+    // Descend towards whichever child grows least by taking the new box, then pair it with the leaf found there.
+    uint32_t node = 0;
+    while (!nodes[node].isLeaf())
+    {
+        uint32_t best     = nodes[node].leftFirst;
+        float    bestGrow = FLT_MAX;
+        for (uint32_t child = nodes[node].leftFirst; child < nodes[node].leftFirst + 2; child++)
+        {
+            Aabb box   = {nodes[child].min, nodes[child].max};
+            Aabb grown = box;
+            grown.grow(bounds);
+
+            float grow = grown.surfaceArea() - box.surfaceArea();
+            if (grow < bestGrow)
+            {
+                best     = child;
+                bestGrow = grow;
+            }
+        }
+        node = best;
+    }
+
+    uint32_t pair = allocatePair(node);
+    setLeaf(pair, nodes[node].leftFirst, nodes[node].count);
+    setLeaf(pair + 1, slot, 1);
+    nodes[node].leftFirst = pair;
+    nodes[node].count     = 0;
+    refitUpwards(node);
+}
+
+void Bvh::remove(uint32_t primitive)
+{
+    if (primitive >= primitiveLeaves.size() || primitiveLeaves[primitive] == invalid)
+    {
+        return;
+    }
+
+    uint32_t leaf = primitiveLeaves[primitive];
+    Node&    n    = nodes[leaf];
+
+    // Swap the last primitive of the leaf into the freed slot so the leaf's range stays contiguous.
+    uint32_t slot          = primitiveSlots[primitive];
+    uint32_t moved         = primitiveIndices[n.leftFirst + n.count - 1];
+    primitiveIndices[slot] = moved;
+    primitiveSlots[moved]  = slot;
+    n.count--;
+    primitiveLeaves[primitive] = invalid;
+
+    if (n.count > 0)
+    {
+        refitUpwards(leaf);
+        return;
+    }
+    if (leaf == 0)
+    {
+        setLeaf(0, invalid, 0);
+        return;
+    }
+
+    // An empty leaf is dropped by moving its sibling up into the parent; the pair becomes unreachable.
+    uint32_t parent  = parents[leaf];
+    uint32_t pair    = nodes[parent].leftFirst;
+    uint32_t sibling = leaf == pair ? pair + 1 : pair;
+
+    nodes[parent] = nodes[sibling];
+    if (nodes[parent].isLeaf())
+    {
+        setLeaf(parent, nodes[parent].leftFirst, nodes[parent].count);
+    }
+    else
+    {
+        parents[nodes[parent].leftFirst]     = parent;
+        parents[nodes[parent].leftFirst + 1] = parent;
+    }
+
+    for (uint32_t dead = pair; dead < pair + 2; dead++)
+    {
+        nodes[dead].leftFirst = invalid;
+        nodes[dead].count     = 0;
+        updateBounds(dead);
+    }
+
+    refitUpwards(parents[parent]);
+}
+
+size_t Bvh::cullFrustum(
+    const FrustumPlanes&       planes,
+    std::vector<uint32_t>&     visible,
+    std::pmr::memory_resource* scratch) const
+{
+    visible.clear();
+    if (nodes.empty())
+    {
+        return 0;
+    }
+
+    // Each entry carries the planes its box still straddles; planes a parent is entirely inside are not retested.
+    constexpr uint32_t allPlanes = (1u << 6) - 1;
+
+    std::pmr::vector<std::pair<uint32_t, uint32_t>> stack(scratch);
+    std::pmr::vector<uint32_t>                      subtreeStack(scratch);
+    stack.push_back({0, allPlanes});
+    while (!stack.empty())
+    {
+        auto [node, planeMask] = stack.back();
+        stack.pop_back();
+
+        const Node& n = nodes[node];
+        if (n.isLeaf() && n.count == 0)
+        {
+            continue;
+        }
+
+        bool outside = false;
+        for (uint32_t plane = 0; plane < 6 && !outside; plane++)
+        {
+            if (planeMask & (1u << plane))
+            {
+                int side = classify(planes[plane], n.min, n.max);
+                outside  = side < 0;
+                if (side > 0)
+                {
+                    planeMask &= ~(1u << plane);
+                }
+            }
+        }
+        if (outside)
+        {
+            continue;
+        }
+
+        if (planeMask == 0)
+        {
+            emitSubtree(node, visible, subtreeStack);
+        }
+        else if (n.isLeaf())
+        {
+            for (uint32_t slot = n.leftFirst; slot < n.leftFirst + n.count; slot++)
+            {
+                const Aabb& box    = primitiveBounds[primitiveIndices[slot]];
+                bool        inside = true;
+                for (uint32_t plane = 0; plane < 6 && inside; plane++)
+                {
+                    inside = !(planeMask & (1u << plane)) || classify(planes[plane], box.min, box.max) >= 0;
+                }
+                if (inside)
+                {
+                    visible.push_back(primitiveIndices[slot]);
+                }
+            }
+        }
+        else
+        {
+            stack.push_back({n.leftFirst + 1, planeMask});
+            stack.push_back({n.leftFirst, planeMask});
+        }
+    }
+
+    return visible.size();
+}
+
+void Bvh::emitSubtree(uint32_t root, std::vector<uint32_t>& visible, std::pmr::vector<uint32_t>& stack) const
+{
+    stack.assign(1, root);
+    while (!stack.empty())
+    {
+        const Node& n = nodes[stack.back()];
+        stack.pop_back();
+
+        if (n.isLeaf())
+        {
+            for (uint32_t slot = n.leftFirst; slot < n.leftFirst + n.count; slot++)
+            {
+                visible.push_back(primitiveIndices[slot]);
+            }
+        }
+        else
+        {
+            stack.push_back(n.leftFirst + 1);
+            stack.push_back(n.leftFirst);
+        }
+    }
+}
+
+std::optional<Bvh::Hit> Bvh::intersect(const Ray& ray, float maxDistance, const IntersectFunction& intersect) const
+{
+    if (nodes.empty())
+    {
+        return std::nullopt;
+    }
+
+    glm::vec3          inverse      = 1.0f / ray.direction;
+    float              rootDistance = enterDistance(nodes[0].min, nodes[0].max, ray, inverse, maxDistance);
+    std::optional<Hit> closest;
+
+    std::vector<std::pair<uint32_t, float>> stack;
+    if (rootDistance != FLT_MAX)
+    {
+        stack.push_back({0, rootDistance});
+    }
+
+    while (!stack.empty())
+    {
+        auto [node, distance] = stack.back();
+        stack.pop_back();
+
+        // The closest hit may have moved in since this node was pushed.
+        if (distance > maxDistance)
+        {
+            continue;
+        }
+
+        const Node& n = nodes[node];
+        if (n.isLeaf())
+        {
+            for (uint32_t slot = n.leftFirst; slot < n.leftFirst + n.count; slot++)
+            {
+                std::optional<float> hit = intersect(primitiveIndices[slot], ray, maxDistance);
+                if (hit && *hit <= maxDistance)
+                {
+                    maxDistance = *hit;
+                    closest     = Hit{primitiveIndices[slot], *hit};
+                }
+            }
+            continue;
+        }
+
+        uint32_t near         = n.leftFirst;
+        uint32_t far          = n.leftFirst + 1;
+        float    nearDistance = enterDistance(nodes[near].min, nodes[near].max, ray, inverse, maxDistance);
+        float    farDistance  = enterDistance(nodes[far].min, nodes[far].max, ray, inverse, maxDistance);
+        if (farDistance < nearDistance)
+        {
+            std::swap(near, far);
+            std::swap(nearDistance, farDistance);
+        }
+
+        // Pushed far first so the near child is visited first.
+        if (farDistance != FLT_MAX)
+        {
+            stack.push_back({far, farDistance});
+        }
+        if (nearDistance != FLT_MAX)
+        {
+            stack.push_back({near, nearDistance});
+        }
+    }
+
+    return closest;
+}
+
+Aabb Bvh::bounds() const
+{
+    return nodes.empty() ? Aabb{} : Aabb{nodes[0].min, nodes[0].max};
+}
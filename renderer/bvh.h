@@ -0,0 +1,133 @@
+#pragma once
+
+#include "frustum.h"
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+// Axis-aligned box. A default-constructed box is empty: growing it by anything yields exactly that thing.
+struct Aabb
+{
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    void grow(const glm::vec3& point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void grow(const Aabb& box)
+    {
+        min = glm::min(min, box.min);
+        max = glm::max(max, box.max);
+    }
+
+    bool      empty() const { return min.x > max.x; }
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+
+    float surfaceArea() const
+    {
+        if (empty())
+        {
+            return 0.0f;
+        }
+        glm::vec3 size = max - min;
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+};
+
+struct Ray
+{
+    glm::vec3 origin;
+    glm::vec3 direction;
+};
+
+// Distance along the ray, in units of its direction's length, at which it hits the triangle (either side).
+std::optional<float> intersectTriangle(const Ray& ray, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+
+// Bounding volume hierarchy over primitives identified by index, e.g. scene instances or a mesh's triangles.
+//
+// Nodes live in one array, 32 bytes each, and siblings are allocated as adjacent pairs so a traversal step touches
+// one cache line for both children. build() splits by the surface area heuristic over binned centroids. Primitives
+// that move keep their place in the tree: setBounds() followed by refit() updates every box in one pass over the
+// array, which stays tight as long as the motion is coherent. insert() and remove() edit the tree locally; a
+// rebuild restores SAH quality and reclaims the nodes remove() leaves behind.
+class Bvh {
+  public:
+    struct Hit
+    {
+        uint32_t primitive;
+        float    distance;
+    };
+
+    // Returns the distance along the ray at which the primitive is hit, if it is hit before maxDistance.
+    using IntersectFunction =
+        std::function<std::optional<float>(uint32_t primitive, const Ray& ray, float maxDistance)>;
+
+    // Primitive i gets bounds[i].
+    void build(const std::vector<Aabb>& bounds);
+
+    void setBounds(uint32_t primitive, const Aabb& bounds) { primitiveBounds[primitive] = bounds; }
+    // Recomputes every node's box from the primitives' current bounds without changing the tree's shape.
+    void refit();
+
+    // primitive must not be in the tree; indices past the current range are allowed.
+    void insert(uint32_t primitive, const Aabb& bounds);
+    void remove(uint32_t primitive);
+
+    // Replaces visible with the primitives whose boxes are at least partly inside every plane and returns their
+    // count. Subtrees entirely inside the frustum are emitted without testing their primitives. The traversal stacks
+    // come from scratch, e.g. a frame's arena.
+    size_t cullFrustum(
+        const FrustumPlanes&       planes,
+        std::vector<uint32_t>&     visible,
+        std::pmr::memory_resource* scratch = std::pmr::get_default_resource()) const;
+
+    // Closest primitive the ray hits within maxDistance. Children are visited nearest first, so intersect is only
+    // called for primitives whose boxes the ray enters before the closest hit found so far.
+    std::optional<Hit> intersect(const Ray& ray, float maxDistance, const IntersectFunction& intersect) const;
+
+    size_t nodeCount() const { return nodes.size(); }
+    Aabb   bounds() const;
+
+  private:
+    // Interior nodes have count 0 and their children at leftFirst and leftFirst + 1. Leaves hold count primitives
+    // starting at primitiveIndices[leftFirst].
+    struct Node
+    {
+        glm::vec3 min;
+        uint32_t  leftFirst;
+        glm::vec3 max;
+        uint32_t  count;
+
+        bool isLeaf() const { return count > 0 || leftFirst == invalid; }
+    };
+
+    static constexpr uint32_t invalid     = UINT32_MAX;
+    static constexpr uint32_t binCount    = 16;
+    static constexpr uint32_t maxLeafSize = 8;
+
+    void     subdivide(uint32_t node);
+    void     updateBounds(uint32_t node);
+    void     refitUpwards(uint32_t node);
+    uint32_t allocatePair(uint32_t parent);
+    void     setLeaf(uint32_t node, uint32_t first, uint32_t count);
+    // stack is only scratch space, passed in so one can serve every subtree of a traversal.
+    void     emitSubtree(uint32_t node, std::vector<uint32_t>& visible, std::pmr::vector<uint32_t>& stack) const;
+
+    std::vector<Node>     nodes;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> primitiveIndices;
+    std::vector<Aabb>     primitiveBounds;
+    // Per primitive: the leaf holding it (invalid when not in the tree) and its slot in primitiveIndices.
+    std::vector<uint32_t> primitiveLeaves;
+    std::vector<uint32_t> primitiveSlots;
+};
@@ -0,0 +1,31 @@
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "camera.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+SceneView makeSceneView(float time, const glm::vec3& eye, float aspect, float sceneRadius)
+{
+    SceneView view;
+    view.model     = glm::rotate(glm::mat4(1.0f), time * glm::radians(10.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    view.view      = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    view.nearPlane = 0.1f;
+    view.farPlane  = std::max(10.0f, glm::length(eye) + sceneRadius);
+    view.proj      = glm::perspective(glm::radians(45.0f), aspect, view.nearPlane, view.farPlane);
+
+    view.proj[1][1] *= -1;
+
+    return view;
+}
+
+glm::vec3 scriptedCameraPosition(const glm::vec3& start, float time, float period)
+{
+    float     angle = glm::radians(360.0f) * time / period;
+    float     scale = 0.875f + 0.125f * std::cos(2.0f * angle);
+    glm::mat4 turn  = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 0.0f, 1.0f));
+
+    return glm::vec3(turn * glm::vec4(start, 1.0f)) * scale;
+}
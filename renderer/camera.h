@@ -0,0 +1,21 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// The matrices a frame of the scene is drawn with. proj has Vulkan's Y flip applied.
+struct SceneView
+{
+    glm::mat4 model;
+    glm::mat4 view;
+    glm::mat4 proj;
+    float     nearPlane;
+    float     farPlane;
+};
+
+// The scene turned about Z by 10 degrees per second of time and seen from eye, looking at the origin with Z up. The
+// far plane reaches past the far side of a scene of sceneRadius around the origin.
+SceneView makeSceneView(float time, const glm::vec3& eye, float aspect, float sceneRadius);
+
+// Circles the origin once per period at the height of start while moving in to three quarters of its distance and
+// back out twice per circle.
+glm::vec3 scriptedCameraPosition(const glm::vec3& start, float time, float period);
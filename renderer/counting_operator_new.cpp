@@ -0,0 +1,198 @@
+// Replaces the global operator new and delete with versions that count every allocation for threadHeapAllocations().
+// Debug builds only: release builds keep the standard library's.
+#if !defined(NDEBUG)
+
+#include "heap_allocations.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    void* allocate(std::size_t size)
+    {
+        countHeapAllocation();
+        for (;;)
+        {
+            if (void* memory = std::malloc(size ? size : 1))
+            {
+                return memory;
+            }
+            std::new_handler handler = std::get_new_handler();
+            if (!handler)
+            {
+                throw std::bad_alloc();
+            }
+            handler();
+        }
+    }
+
+    void* allocateAligned(std::size_t size, std::align_val_t alignment)
+    {
+        countHeapAllocation();
+        std::size_t align = static_cast<std::size_t>(alignment);
+        for (;;)
+        {
+#if defined(_MSC_VER)
+            void* memory = _aligned_malloc(size ? size : 1, align);
+#else
+            // aligned_alloc wants a size that is a multiple of the alignment.
+            void* memory = std::aligned_alloc(align, ((size ? size : 1) + align - 1) / align * align);
+#endif
+            if (memory)
+            {
+                return memory;
+            }
+            std::new_handler handler = std::get_new_handler();
+            if (!handler)
+            {
+                throw std::bad_alloc();
+            }
+            handler();
+        }
+    }
+
+    void release(void* memory)
+    {
+        std::free(memory);
+    }
+
+    void releaseAligned(void* memory)
+    {
+#if defined(_MSC_VER)
+        _aligned_free(memory);
+#else
+        std::free(memory);
+#endif
+    }
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocateAligned(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocateAligned(size, alignment);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocateAligned(size, alignment);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void operator delete(void* memory) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+    releaseAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+    releaseAligned(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+    releaseAligned(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept
+{
+    releaseAligned(memory);
+}
+
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    releaseAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    releaseAligned(memory);
+}
+
+#endif
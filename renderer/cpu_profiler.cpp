@@ -0,0 +1,149 @@
+#include "cpu_profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    struct Zone
+    {
+        const char* name;
+        int64_t     begin;
+        int64_t     end;
+    };
+
+    // Written by its thread alone; zonesWritten counts every zone ever recorded, so the ring holds the last
+    // min(zonesWritten, zonesPerThread) of them.
+    struct ThreadBuffer
+    {
+        uint32_t                threadId;
+        std::string             threadName;
+        std::unique_ptr<Zone[]> zones = std::make_unique<Zone[]>(CpuProfiler::zonesPerThread);
+        std::atomic<uint64_t>   zonesWritten{0};
+    };
+
+    // Buffers live until the process exits so zones of threads that have finished can still be exported.
+    struct Registry
+    {
+        std::mutex                                 mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    };
+
+    Registry& registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    ThreadBuffer& threadBuffer()
+    {
+        thread_local ThreadBuffer* buffer = nullptr;
+        if (!buffer)
+        {
+            Registry&                   entries = registry();
+            std::lock_guard<std::mutex> lock(entries.mutex);
+
+            auto created        = std::make_unique<ThreadBuffer>();
+            created->threadId   = static_cast<uint32_t>(entries.buffers.size());
+            created->threadName = "thread " + std::to_string(created->threadId);
+            buffer              = created.get();
+            entries.buffers.push_back(std::move(created));
+        }
+        return *buffer;
+    }
+
+    void writeEscaped(std::ostream& out, const std::string& text)
+    {
+        out << '"';
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out << '\\';
+            }
+            out << c;
+        }
+        out << '"';
+    }
+} // namespace
+
+void CpuProfiler::record(const char* name, int64_t begin, int64_t end)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    uint64_t      index  = buffer.zonesWritten.load(std::memory_order_relaxed);
+
+    buffer.zones[index % zonesPerThread] = {name, begin, end};
+    buffer.zonesWritten.store(index + 1, std::memory_order_release);
+}
+
+void CpuProfiler::setThreadName(std::string name)
+{
+    ThreadBuffer&               buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    buffer.threadName = std::move(name);
+}
+
+void CpuProfiler::writeChromeTrace(const std::string& path)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        throw std::runtime_error("failed to open CPU trace " + path + "!");
+    }
+
+    Registry&                   entries = registry();
+    std::lock_guard<std::mutex> lock(entries.mutex);
+
+    struct Range
+    {
+        const ThreadBuffer* buffer;
+        uint64_t            first;
+        uint64_t            last;
+    };
+
+    std::vector<Range> ranges;
+    int64_t            origin = INT64_MAX;
+    for (const auto& buffer : entries.buffers)
+    {
+        uint64_t last  = buffer->zonesWritten.load(std::memory_order_acquire);
+        uint64_t first = last > zonesPerThread ? last - zonesPerThread : 0;
+        for (uint64_t i = first; i < last; i++)
+        {
+            origin = std::min(origin, buffer->zones[i % zonesPerThread].begin);
+        }
+        ranges.push_back({buffer.get(), first, last});
+    }
+
+    // Complete ("X") events take microseconds; thread names are metadata ("M") events.
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    file.setf(std::ios::fixed);
+    file.precision(3);
+
+    bool first = true;
+    for (const Range& range : ranges)
+    {
+        file << (first ? "\n" : ",\n") << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << range.buffer->threadId
+             << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+        writeEscaped(file, range.buffer->threadName);
+        file << "}}";
+        first = false;
+
+        for (uint64_t i = range.first; i < range.last; i++)
+        {
+            const Zone& zone = range.buffer->zones[i % zonesPerThread];
+            file << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << range.buffer->threadId << ",\"name\":";
+            writeEscaped(file, zone.name);
+            file << ",\"ts\":" << (zone.begin - origin) / 1e3 << ",\"dur\":" << (zone.end - zone.begin) / 1e3 << "}";
+        }
+    }
+    file << "\n]}\n";
+
+    if (!file)
+    {
+        throw std::runtime_error("failed to write CPU trace " + path + "!");
+    }
+}
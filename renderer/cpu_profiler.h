@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Records named spans of CPU time ("zones") from any thread and exports them as Chrome trace event JSON, which
+// chrome://tracing and the Perfetto UI open.
+//
+// Each thread writes its zones into its own fixed-size ring buffer, created the first time it records, so recording
+// takes no lock and shares no cache lines with other threads; once a ring is full the oldest zones are overwritten.
+// Zones are recorded when they end, so nested zones appear child first, which the trace viewers do not mind.
+//
+// Instrument code with the CPU_ZONE and CPU_THREAD_NAME macros rather than the class: building without
+// RENDERER_CPU_PROFILER turns them into nothing.
+class CpuProfiler {
+  public:
+    static constexpr size_t zonesPerThread = size_t(1) << 16;
+
+    // Nanoseconds on the steady clock.
+    static int64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // name must outlive the profiler, e.g. a string literal.
+    static void record(const char* name, int64_t begin, int64_t end);
+    // Names the calling thread in the trace.
+    static void setThreadName(std::string name);
+
+    // Every thread's zones, with times relative to the earliest zone. Meant to run while the traced threads are idle:
+    // zones recorded meanwhile may be missing or torn.
+    static void writeChromeTrace(const std::string& path);
+};
+
+// Records the time from its construction to the end of its scope.
+class CpuZone {
+  public:
+    explicit CpuZone(const char* name)
+        : name(name)
+        , begin(CpuProfiler::now())
+    {
+    }
+    ~CpuZone() { CpuProfiler::record(name, begin, CpuProfiler::now()); }
+
+    CpuZone(const CpuZone&)            = delete;
+    CpuZone& operator=(const CpuZone&) = delete;
+
+  private:
+    const char* name;
+    int64_t     begin;
+};
+
+#if defined(RENDERER_CPU_PROFILER)
+#define CPU_ZONE_CONCAT_(a, b) a##b
+#define CPU_ZONE_CONCAT(a, b)  CPU_ZONE_CONCAT_(a, b)
+#define CPU_ZONE(name)         CpuZone CPU_ZONE_CONCAT(cpuZone, __LINE__)(name)
+#define CPU_THREAD_NAME(name)  CpuProfiler::setThreadName(name)
+#else
+#define CPU_ZONE(name)        ((void)0)
+#define CPU_THREAD_NAME(name) ((void)0)
+#endif
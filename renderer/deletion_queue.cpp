@@ -0,0 +1,226 @@
+#include "deletion_queue.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    // Non-dispatchable handles are pointers on 64-bit platforms and 64-bit integers elsewhere; either converts to and
+    // from uint64_t without loss.
+    template <typename Handle>
+    uint64_t handleBits(Handle handle)
+    {
+        return reinterpret_cast<uint64_t>(handle);
+    }
+
+    template <typename Handle>
+    Handle fromBits(uint64_t bits)
+    {
+        return reinterpret_cast<Handle>(bits);
+    }
+} // namespace
+
+void DeletionQueue::create(VkDevice device, bool timelineSemaphores, const VkAllocationCallbacks* allocator)
+{
+    this->device    = device;
+    this->allocator = allocator;
+
+    if (!timelineSemaphores)
+    {
+        return;
+    }
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue  = lastSubmitted;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (vkCreateSemaphore(device, &semaphoreInfo, allocator, &timelineSemaphore) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create deletion queue timeline semaphore!");
+    }
+}
+
+void DeletionQueue::destroy()
+{
+    for (size_t i = first; i < entries.size(); i++)
+    {
+        release(entries[i]);
+    }
+    entries.clear();
+    first     = 0;
+    completed = lastSubmitted;
+
+    if (timelineSemaphore != VK_NULL_HANDLE)
+    {
+        vkDestroySemaphore(device, timelineSemaphore, allocator);
+        timelineSemaphore = VK_NULL_HANDLE;
+    }
+}
+
+void DeletionQueue::reached(uint64_t submission)
+{
+    completed = std::max(completed, submission);
+}
+
+void DeletionQueue::collect()
+{
+    if (first == entries.size())
+    {
+        return;
+    }
+
+    if (timelineSemaphore != VK_NULL_HANDLE)
+    {
+        uint64_t value = 0;
+        if (vkGetSemaphoreCounterValue(device, timelineSemaphore, &value) == VK_SUCCESS)
+        {
+            reached(value);
+        }
+    }
+
+    while (first < entries.size() && entries[first].submission <= completed)
+    {
+        release(entries[first++]);
+    }
+    if (first == entries.size())
+    {
+        entries.clear();
+        first = 0;
+    }
+}
+
+void DeletionQueue::retire(VkBuffer buffer)
+{
+    push(VK_OBJECT_TYPE_BUFFER, handleBits(buffer));
+}
+
+void DeletionQueue::retire(VkImage image)
+{
+    push(VK_OBJECT_TYPE_IMAGE, handleBits(image));
+}
+
+void DeletionQueue::retire(VkImageView view)
+{
+    push(VK_OBJECT_TYPE_IMAGE_VIEW, handleBits(view));
+}
+
+void DeletionQueue::retire(VkDeviceMemory memory)
+{
+    push(VK_OBJECT_TYPE_DEVICE_MEMORY, handleBits(memory));
+}
+
+void DeletionQueue::retire(VkSampler sampler)
+{
+    push(VK_OBJECT_TYPE_SAMPLER, handleBits(sampler));
+}
+
+void DeletionQueue::retire(VkFramebuffer framebuffer)
+{
+    push(VK_OBJECT_TYPE_FRAMEBUFFER, handleBits(framebuffer));
+}
+
+void DeletionQueue::retire(VkRenderPass renderPass)
+{
+    push(VK_OBJECT_TYPE_RENDER_PASS, handleBits(renderPass));
+}
+
+void DeletionQueue::retire(VkPipeline pipeline)
+{
+    push(VK_OBJECT_TYPE_PIPELINE, handleBits(pipeline));
+}
+
+void DeletionQueue::retire(VkPipelineLayout layout)
+{
+    push(VK_OBJECT_TYPE_PIPELINE_LAYOUT, handleBits(layout));
+}
+
+void DeletionQueue::retire(VkDescriptorPool pool)
+{
+    push(VK_OBJECT_TYPE_DESCRIPTOR_POOL, handleBits(pool));
+}
+
+void DeletionQueue::retire(VkQueryPool pool)
+{
+    push(VK_OBJECT_TYPE_QUERY_POOL, handleBits(pool));
+}
+
+void DeletionQueue::retire(VkSwapchainKHR swapChain)
+{
+    push(VK_OBJECT_TYPE_SWAPCHAIN_KHR, handleBits(swapChain));
+}
+
+void DeletionQueue::retire(VkSemaphore semaphore)
+{
+    push(VK_OBJECT_TYPE_SEMAPHORE, handleBits(semaphore));
+}
+
+void DeletionQueue::retire(VkCommandPool pool, VkCommandBuffer commandBuffer)
+{
+    push(VK_OBJECT_TYPE_COMMAND_BUFFER, handleBits(commandBuffer), pool);
+}
+
+void DeletionQueue::push(VkObjectType type, uint64_t handle, VkCommandPool commandPool)
+{
+    if (handle != 0)
+    {
+        entries.push_back({type, handle, commandPool, lastSubmitted});
+    }
+}
+
+void DeletionQueue::release(const Entry& entry)
+{
+    switch (entry.type)
+    {
+    case VK_OBJECT_TYPE_BUFFER:
+        vkDestroyBuffer(device, fromBits<VkBuffer>(entry.handle), allocator);
+        break;
+    case VK_OBJECT_TYPE_IMAGE:
+        vkDestroyImage(device, fromBits<VkImage>(entry.handle), allocator);
+        break;
+    case VK_OBJECT_TYPE_IMAGE_VIEW:
+        vkDestroyImageView(device, fromBits<VkImageView>(entry.handle), allocator);
+        break;
+    case VK_OBJECT_TYPE_DEVICE_MEMORY:
+        vkFreeMemory(device, fromBits<VkDeviceMemory>(entry.handle), allocator);
+        break;
+    case VK_OBJECT_TYPE_SAMPLER:
+        vkDestroySampler(device, fromBits<VkSampler>(entry.handle), allocator);
+        break;
+    case VK_OBJECT_TYPE_FRAMEBUFFER:
+        vkDestroyFramebuffer(device, fromBits<VkFramebuffer>(entry.handle), allocator);
+        break;
+    case VK_OBJECT_TYPE_RENDER_PASS:
+        vkDestroyRenderPass(device, fromBits<VkRenderPass>(entry.handle), allocator);
+        break;
+    case VK_OBJECT_TYPE_PIPELINE:
+        vkDestroyPipeline(device, fromBits<VkPipeline>(entry.handle), allocator);
+        break;
+    case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+        vkDestroyPipelineLayout(device, fromBits<VkPipelineLayout>(entry.handle), allocator);
+        break;
+    case VK_OBJECT_TYPE_DESCRIPTOR_POOL:
+        vkDestroyDescriptorPool(device, fromBits<VkDescriptorPool>(entry.handle), allocator);
+        break;
+    case VK_OBJECT_TYPE_QUERY_POOL:
+        vkDestroyQueryPool(device, fromBits<VkQueryPool>(entry.handle), allocator);
+        break;
+    case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+        vkDestroySwapchainKHR(device, fromBits<VkSwapchainKHR>(entry.handle), allocator);
+        break;
+    case VK_OBJECT_TYPE_SEMAPHORE:
+        vkDestroySemaphore(device, fromBits<VkSemaphore>(entry.handle), allocator);
+        break;
+    case VK_OBJECT_TYPE_COMMAND_BUFFER:
+    {
+        VkCommandBuffer commandBuffer = fromBits<VkCommandBuffer>(entry.handle);
+        vkFreeCommandBuffers(device, entry.commandPool, 1, &commandBuffer);
+        break;
+    }
+    default:
+        break;
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Destroys Vulkan objects once the GPU has finished with them, so that replacing resources never needs the device
+// to go idle.
+//
+// Every queue submission is numbered in order. retire() tags an object with the number of the last submission made
+// so far, the last one that can still use it, and collect() destroys it once that submission has completed. When
+// the device has timeline semaphores each submission also signals timeline() with its number, and collect() reads
+// the counter. Without them the owner reports completions it has seen through fences with reached(); a completed
+// submission implies every earlier one on the same queue has completed too.
+class DeletionQueue {
+  public:
+    DeletionQueue() = default;
+
+    DeletionQueue(const DeletionQueue&)            = delete;
+    DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+    // allocator, when set, is used for the timeline semaphore and for destroying every retired object.
+    void create(VkDevice device, bool timelineSemaphores, const VkAllocationCallbacks* allocator = nullptr);
+    // Destroys whatever is still queued, so the device must be idle.
+    void destroy();
+
+    // Numbers a submission about to be made. With a timeline, the submission must signal timeline() with the result.
+    uint64_t    nextSubmission() { return ++lastSubmitted; }
+    uint64_t    lastSubmission() const { return lastSubmitted; }
+    VkSemaphore timeline() const { return timelineSemaphore; }
+
+    // submission, and every submission before it, has completed, e.g. because its fence has signalled.
+    void reached(uint64_t submission);
+    // Destroys every object whose submission has completed.
+    void collect();
+
+    void retire(VkBuffer buffer);
+    void retire(VkImage image);
+    void retire(VkImageView view);
+    void retire(VkDeviceMemory memory);
+    void retire(VkSampler sampler);
+    void retire(VkFramebuffer framebuffer);
+    void retire(VkRenderPass renderPass);
+    void retire(VkPipeline pipeline);
+    void retire(VkPipelineLayout layout);
+    void retire(VkDescriptorPool pool);
+    void retire(VkQueryPool pool);
+    void retire(VkSwapchainKHR swapChain);
+    void retire(VkSemaphore semaphore);
+    void retire(VkCommandPool pool, VkCommandBuffer commandBuffer);
+
+    // Objects waiting for their submission to complete.
+    size_t pending() const { return entries.size() - first; }
+
+  private:
+    struct Entry
+    {
+        VkObjectType  type;
+        uint64_t      handle;
+        VkCommandPool commandPool;
+        uint64_t      submission;
+    };
+
+    void push(VkObjectType type, uint64_t handle, VkCommandPool commandPool = VK_NULL_HANDLE);
+    void release(const Entry& entry);
+
+    VkDevice                     device            = VK_NULL_HANDLE;
+    const VkAllocationCallbacks* allocator         = nullptr;
+    VkSemaphore                  timelineSemaphore = VK_NULL_HANDLE;
+    uint64_t                     lastSubmitted     = 0;
+    uint64_t                     completed         = 0;
+
+    // Tags never decrease, so entries[first, end) are in completion order. The vector keeps its capacity when it
+    // empties, so retiring stops allocating once it has grown to the largest batch.
+    std::vector<Entry> entries;
+    size_t             first = 0;
+};
@@ -0,0 +1,271 @@
+#include "descriptor_allocator.h"
+
+#include "deletion_queue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    // Pools stop doubling here; a scene that needs more sets chains more pools of this size.
+    constexpr uint32_t maxSetsPerPool = 4096;
+
+    template <typename Handle>
+    uint64_t handleBits(Handle handle)
+    {
+        return reinterpret_cast<uint64_t>(handle);
+    }
+
+    void combine(size_t& seed, uint64_t value)
+    {
+        seed ^= std::hash<uint64_t>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+} // namespace
+
+DescriptorBindings& DescriptorBindings::buffer(
+    uint32_t         binding,
+    VkDescriptorType type,
+    VkBuffer         buffer,
+    VkDeviceSize     offset,
+    VkDeviceSize     range)
+{
+    bindings.push_back({binding, type, {buffer, offset, range}, {}});
+    return *this;
+}
+
+DescriptorBindings& DescriptorBindings::image(
+    uint32_t         binding,
+    VkDescriptorType type,
+    VkImageView      view,
+    VkImageLayout    layout,
+    VkSampler        sampler)
+{
+    bindings.push_back({binding, type, {}, {sampler, view, layout}});
+    return *this;
+}
+
+void DescriptorBindings::write(VkDevice device, VkDescriptorSet set) const
+{
+    std::vector<VkWriteDescriptorSet> writes(bindings.size());
+    for (size_t i = 0; i < bindings.size(); i++)
+    {
+        const Binding& binding = bindings[i];
+        bool           isImage = binding.buffer.buffer == VK_NULL_HANDLE;
+
+        writes[i].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet          = set;
+        writes[i].dstBinding      = binding.binding;
+        writes[i].dstArrayElement = 0;
+        writes[i].descriptorType  = binding.type;
+        writes[i].descriptorCount = 1;
+        writes[i].pBufferInfo     = isImage ? nullptr : &binding.buffer;
+        writes[i].pImageInfo      = isImage ? &binding.image : nullptr;
+    }
+
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+size_t DescriptorBindings::hash() const
+{
+    size_t seed = bindings.size();
+    for (const Binding& binding : bindings)
+    {
+        combine(seed, binding.binding);
+        combine(seed, binding.type);
+        combine(seed, handleBits(binding.buffer.buffer));
+        combine(seed, binding.buffer.offset);
+        combine(seed, binding.buffer.range);
+        combine(seed, handleBits(binding.image.sampler));
+        combine(seed, handleBits(binding.image.imageView));
+        combine(seed, binding.image.imageLayout);
+    }
+    return seed;
+}
+
+bool DescriptorBindings::operator==(const DescriptorBindings& other) const
+{
+    return std::equal(
+        bindings.begin(),
+        bindings.end(),
+        other.bindings.begin(),
+        other.bindings.end(),
+        [](const Binding& a, const Binding& b)
+        {
+            return a.binding == b.binding && a.type == b.type && a.buffer.buffer == b.buffer.buffer &&
+                   a.buffer.offset == b.buffer.offset && a.buffer.range == b.buffer.range &&
+                   a.image.sampler == b.image.sampler && a.image.imageView == b.image.imageView &&
+                   a.image.imageLayout == b.image.imageLayout;
+        });
+}
+
+void DescriptorAllocator::create(
+    VkDevice                     device,
+    std::vector<PoolRatio>       ratios,
+    uint32_t                     setsPerPool,
+    const VkAllocationCallbacks* allocator)
+{
+    this->device    = device;
+    this->allocator = allocator;
+    this->ratios    = std::move(ratios);
+    firstPoolSets   = std::clamp(setsPerPool, 1u, maxSetsPerPool);
+    nextPoolSets    = firstPoolSets;
+}
+
+void DescriptorAllocator::destroy(DeletionQueue* deletionQueue)
+{
+    for (VkDescriptorPool pool : pools)
+    {
+        if (deletionQueue)
+        {
+            deletionQueue->retire(pool);
+        }
+        else
+        {
+            vkDestroyDescriptorPool(device, pool, allocator);
+        }
+    }
+    pools.clear();
+    current      = 0;
+    nextPoolSets = firstPoolSets;
+}
+
+void DescriptorAllocator::reset(DeletionQueue* deletionQueue)
+{
+    if (deletionQueue)
+    {
+        destroy(deletionQueue);
+        return;
+    }
+
+    // Only the pools allocated from need resetting; the rest were reset earlier and never used since.
+    for (size_t i = 0; i < pools.size() && i <= current; i++)
+    {
+        vkResetDescriptorPool(device, pools[i], 0);
+    }
+    current = 0;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+{
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts        = &layout;
+
+    for (;;)
+    {
+        bool newPool = current == pools.size();
+        if (newPool)
+        {
+            pools.push_back(createPool());
+        }
+
+        allocInfo.descriptorPool = pools[current];
+
+        VkDescriptorSet set    = VK_NULL_HANDLE;
+        VkResult        result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+        if (result == VK_SUCCESS)
+        {
+            stats.allocations++;
+            return set;
+        }
+
+        // An exhausted pool is left for the next reset. A new one that cannot hold the set never will.
+        if ((result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) || newPool)
+        {
+            throw std::runtime_error("failed to allocate descriptor set!");
+        }
+        current++;
+    }
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout, const DescriptorBindings& bindings)
+{
+    VkDescriptorSet set = allocate(layout);
+    write(set, bindings);
+    return set;
+}
+
+void DescriptorAllocator::write(VkDescriptorSet set, const DescriptorBindings& bindings)
+{
+    bindings.write(device, set);
+    stats.updates++;
+}
+
+VkDescriptorPool DescriptorAllocator::createPool()
+{
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    poolSizes.reserve(ratios.size());
+    for (const PoolRatio& ratio : ratios)
+    {
+        uint32_t count = static_cast<uint32_t>(std::ceil(ratio.perSet * static_cast<float>(nextPoolSets)));
+        poolSizes.push_back({ratio.type, std::max(1u, count)});
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets       = nextPoolSets;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes    = poolSizes.data();
+
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(device, &poolInfo, allocator, &pool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+
+    stats.pools++;
+    nextPoolSets = std::min(nextPoolSets * 2, maxSetsPerPool);
+    return pool;
+}
+
+void DescriptorCache::create(
+    VkDevice                                    device,
+    std::vector<DescriptorAllocator::PoolRatio> ratios,
+    uint32_t                                    setsPerPool,
+    const VkAllocationCallbacks*                allocator)
+{
+    setAllocator.create(device, std::move(ratios), setsPerPool, allocator);
+}
+
+void DescriptorCache::destroy()
+{
+    sets.clear();
+    setAllocator.destroy();
+}
+
+void DescriptorCache::clear(DeletionQueue* deletionQueue)
+{
+    sets.clear();
+    setAllocator.reset(deletionQueue);
+}
+
+VkDescriptorSet DescriptorCache::get(VkDescriptorSetLayout layout, const DescriptorBindings& bindings)
+{
+    Key key{layout, bindings};
+    if (auto found = sets.find(key); found != sets.end())
+    {
+        hits++;
+        return found->second;
+    }
+
+    VkDescriptorSet set = setAllocator.allocate(layout, bindings);
+    sets.emplace(std::move(key), set);
+    return set;
+}
+
+DescriptorStatistics DescriptorCache::statistics() const
+{
+    DescriptorStatistics statistics = setAllocator.statistics();
+    statistics.cacheHits            = hits;
+    return statistics;
+}
+
+size_t DescriptorCache::KeyHash::operator()(const Key& key) const
+{
+    size_t seed = key.bindings.hash();
+    combine(seed, handleBits(key.layout));
+    return seed;
+}
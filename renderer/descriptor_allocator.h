@@ -0,0 +1,144 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class DeletionQueue;
+
+// Counters shared by DescriptorAllocator and DescriptorCache, over their whole lifetime.
+struct DescriptorStatistics
+{
+    uint64_t allocations = 0; // descriptor sets allocated
+    uint64_t cacheHits   = 0; // sets DescriptorCache returned without allocating or writing
+    uint64_t updates     = 0; // vkUpdateDescriptorSets calls
+    uint32_t pools       = 0; // pools created, including retired ones
+};
+
+// The contents of a descriptor set: one buffer or image descriptor per binding. Written with a single
+// vkUpdateDescriptorSets call, and hashable so identical sets can be shared.
+class DescriptorBindings {
+  public:
+    DescriptorBindings& buffer(
+        uint32_t         binding,
+        VkDescriptorType type,
+        VkBuffer         buffer,
+        VkDeviceSize     offset = 0,
+        VkDeviceSize     range  = VK_WHOLE_SIZE);
+    DescriptorBindings& image(
+        uint32_t         binding,
+        VkDescriptorType type,
+        VkImageView      view,
+        VkImageLayout    layout,
+        VkSampler        sampler = VK_NULL_HANDLE);
+
+    void   write(VkDevice device, VkDescriptorSet set) const;
+    size_t hash() const;
+    bool   operator==(const DescriptorBindings& other) const;
+
+  private:
+    struct Binding
+    {
+        uint32_t               binding;
+        VkDescriptorType       type;
+        VkDescriptorBufferInfo buffer;
+        VkDescriptorImageInfo  image;
+    };
+
+    std::vector<Binding> bindings;
+};
+
+// Allocates descriptor sets from a chain of pools that grows instead of being sized up front. When the current pool
+// runs out another is chained, each twice the size of the last up to a limit, and allocation moves on to it.
+//
+// reset() makes every pool available again at once: for transient sets, e.g. one allocator per frame slot reset when
+// the slot's fence has signalled. Passing a DeletionQueue instead retires the pools, for sets that frames still in
+// flight may be using, and the chain starts over with new ones.
+class DescriptorAllocator {
+  public:
+    // Descriptors of one type to reserve per set the pool can hold.
+    struct PoolRatio
+    {
+        VkDescriptorType type;
+        float            perSet;
+    };
+
+    DescriptorAllocator() = default;
+
+    DescriptorAllocator(const DescriptorAllocator&)            = delete;
+    DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+    // No pool is created until the first allocation. allocator, when set, is used for every pool.
+    void create(
+        VkDevice                     device,
+        std::vector<PoolRatio>       ratios,
+        uint32_t                     setsPerPool,
+        const VkAllocationCallbacks* allocator = nullptr);
+    // Every set from the allocator must be out of use, or handed to deletionQueue.
+    void destroy(DeletionQueue* deletionQueue = nullptr);
+    void reset(DeletionQueue* deletionQueue = nullptr);
+
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+    // Allocates a set and writes bindings into it.
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout, const DescriptorBindings& bindings);
+    void            write(VkDescriptorSet set, const DescriptorBindings& bindings);
+
+    const DescriptorStatistics& statistics() const { return stats; }
+
+  private:
+    VkDescriptorPool createPool();
+
+    VkDevice                      device    = VK_NULL_HANDLE;
+    const VkAllocationCallbacks*  allocator = nullptr;
+    std::vector<PoolRatio>        ratios;
+    uint32_t                      firstPoolSets = 0;
+    uint32_t                      nextPoolSets  = 0;
+
+    // pools[current] is the one being allocated from; the ones after it were reset and wait to be reused.
+    std::vector<VkDescriptorPool> pools;
+    size_t                        current = 0;
+    DescriptorStatistics          stats;
+};
+
+// Shares descriptor sets whose contents never change, e.g. a material's textures: a set is allocated and written
+// the first time its layout and bindings are asked for, and returned as is after that.
+//
+// Sets are kept for the cache's lifetime, so everything they refer to must outlive it, or the cache must be cleared
+// before it is destroyed: a recreated object may come back with the handle of the one it replaces.
+class DescriptorCache {
+  public:
+    void create(
+        VkDevice                                    device,
+        std::vector<DescriptorAllocator::PoolRatio> ratios,
+        uint32_t                                    setsPerPool,
+        const VkAllocationCallbacks*                allocator = nullptr);
+    void destroy();
+    // Forgets every set; deletionQueue, when set, receives the pools of sets frames may still be using.
+    void clear(DeletionQueue* deletionQueue = nullptr);
+
+    VkDescriptorSet get(VkDescriptorSetLayout layout, const DescriptorBindings& bindings);
+
+    size_t               size() const { return sets.size(); }
+    DescriptorStatistics statistics() const;
+
+  private:
+    struct Key
+    {
+        VkDescriptorSetLayout layout;
+        DescriptorBindings    bindings;
+
+        bool operator==(const Key& other) const { return layout == other.layout && bindings == other.bindings; }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+
+    DescriptorAllocator                               setAllocator;
+    std::unordered_map<Key, VkDescriptorSet, KeyHash> sets;
+    uint64_t                                          hits = 0;
+};
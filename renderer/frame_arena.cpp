@@ -0,0 +1,65 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <new>
+
+namespace {
+    size_t alignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+} // namespace
+
+FrameArena::FrameArena(size_t capacity)
+    : buffer(std::make_unique<std::byte[]>(capacity))
+    , size(capacity)
+{
+}
+
+FrameArena::~FrameArena()
+{
+    reset();
+}
+
+void FrameArena::reset()
+{
+    while (overflowBlocks)
+    {
+        Overflow* block = overflowBlocks;
+        overflowBlocks  = block->next;
+        std::pmr::new_delete_resource()->deallocate(block, block->size, block->alignment);
+    }
+
+    offset        = 0;
+    overflowBytes = 0;
+}
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment)
+{
+    // The buffer comes from operator new[], which aligns it for any fundamental type; offsets are aligned relative to
+    // its actual address so larger alignments work too.
+    uintptr_t base  = reinterpret_cast<uintptr_t>(buffer.get());
+    size_t    start = alignUp(base + offset, alignment) - base;
+    if (start + bytes <= size)
+    {
+        offset = start + bytes;
+        peak   = std::max(peak, offset + overflowBytes);
+        return buffer.get() + start;
+    }
+
+    alignment          = std::max(alignment, alignof(Overflow));
+    size_t headerSpace = alignUp(sizeof(Overflow), alignment);
+    size_t blockSize   = headerSpace + bytes;
+    auto*  block       = static_cast<std::byte*>(std::pmr::new_delete_resource()->allocate(blockSize, alignment));
+
+    overflowBlocks = new (block) Overflow{overflowBlocks, blockSize, alignment};
+    overflowBytes += bytes;
+    overflowCount++;
+    peak = std::max(peak, offset + overflowBytes);
+    return block + headerSpace;
+}
+
+void FrameArena::do_deallocate(void*, size_t, size_t)
+{
+    // Freed all at once by reset().
+}
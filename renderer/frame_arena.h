@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+
+// A linear allocator for the scratch memory of one frame in flight, usable by std::pmr containers.
+//
+// Allocating bumps an offset into a buffer reserved up front, and deallocating does nothing: everything goes at once
+// in reset(), which the owner calls when the frame that used the arena has finished, i.e. once its fence has
+// signalled. Containers built on the arena must not outlive that point. Requests that do not fit go to the heap and
+// are freed by the next reset(); overflows() counts them so the capacity can be raised.
+class FrameArena : public std::pmr::memory_resource {
+  public:
+    explicit FrameArena(size_t capacity);
+    ~FrameArena() override;
+
+    FrameArena(const FrameArena&)            = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void reset();
+
+    size_t   capacity() const { return size; }
+    size_t   used() const { return offset; }
+    // The most bytes any frame used since the arena was created, counting the ones that overflowed.
+    size_t   peakUsed() const { return peak; }
+    uint64_t overflows() const { return overflowCount; }
+
+  private:
+    // Overflow allocations are chained through a header in front of each, so releasing them needs no container.
+    struct Overflow
+    {
+        Overflow* next;
+        size_t    size;
+        size_t    alignment;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void  do_deallocate(void* memory, size_t bytes, size_t alignment) override;
+    bool  do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    std::unique_ptr<std::byte[]> buffer;
+    size_t                       size           = 0;
+    size_t                       offset         = 0;
+    size_t                       overflowBytes  = 0;
+    size_t                       peak           = 0;
+    uint64_t                     overflowCount  = 0;
+    Overflow*                    overflowBlocks = nullptr;
+};
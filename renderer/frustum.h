@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+
+// Frustum planes as (normal, distance) with normals pointing inwards: a point p is inside a plane when
+// dot(plane.xyz, p) + plane.w >= 0. Order is left, right, bottom, top, near, far.
+using FrustumPlanes = std::array<glm::vec4, 6>;
+
+// Extracts the planes bounding clip space (Gribb & Hartmann) in whatever space the matrix maps from, e.g. pass
+// proj * view to get world-space planes. Assumes GLM_FORCE_DEPTH_ZERO_TO_ONE clip depth.
+inline FrustumPlanes extractFrustumPlanes(const glm::mat4& matrix)
+{
+    auto row = [&matrix](int i) { return glm::vec4(matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]); };
+
+    FrustumPlanes planes = {
+        row(3) + row(0),
+        row(3) - row(0),
+        row(3) + row(1),
+        row(3) - row(1),
+        row(2),
+        row(3) - row(2),
+    };
+
+    for (auto& plane : planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    return planes;
+}
@@ -0,0 +1,192 @@
+#include "frustum_culling.h"
+
+#include "simd.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+
+namespace {
+    // True when (x, y, z) lies no further than reach[plane] behind any plane. Spheres pass their radius for every
+    // plane; boxes pass their extent projected onto each plane's normal.
+    bool insideAll(const FrustumPlanes& planes, float x, float y, float z, const float* reach)
+    {
+        for (size_t plane = 0; plane < planes.size(); plane++)
+        {
+            const glm::vec4& p = planes[plane];
+            if (p.x * x + p.y * y + p.z * z + p.w < -reach[plane])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+#if defined(RENDERER_SIMD)
+    size_t writeLanes(uint32_t mask, size_t first, uint32_t* visible)
+    {
+        size_t written = 0;
+        while (mask)
+        {
+            visible[written++] = static_cast<uint32_t>(first + std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+        return written;
+    }
+#endif
+} // namespace
+
+size_t cullSpheres(
+    const FrustumPlanes&   planes,
+    const BoundingSpheres& spheres,
+    size_t                 begin,
+    size_t                 end,
+    uint32_t*              visible)
+{
+    size_t written = 0;
+    size_t i       = begin;
+
+#if defined(RENDERER_SIMD)
+    for (; i + Lanes::width <= end; i += Lanes::width)
+    {
+        Lanes::Float x      = Lanes::load(&spheres.x[i]);
+        Lanes::Float y      = Lanes::load(&spheres.y[i]);
+        Lanes::Float z      = Lanes::load(&spheres.z[i]);
+        Lanes::Float radius = Lanes::load(&spheres.radius[i]);
+        Lanes::Float limit  = Lanes::multiply(radius, Lanes::broadcast(-1.0f));
+        Lanes::Float inside = Lanes::allTrue();
+
+        for (const glm::vec4& plane : planes)
+        {
+            Lanes::Float distance = Lanes::add(
+                Lanes::add(
+                    Lanes::multiply(Lanes::broadcast(plane.x), x),
+                    Lanes::multiply(Lanes::broadcast(plane.y), y)),
+                Lanes::add(Lanes::multiply(Lanes::broadcast(plane.z), z), Lanes::broadcast(plane.w)));
+            inside = Lanes::both(inside, Lanes::greaterEqual(distance, limit));
+        }
+
+        written += writeLanes(Lanes::bits(inside), i, visible + written);
+    }
+#endif
+
+    for (; i < end; i++)
+    {
+        float reach[6];
+        std::fill(std::begin(reach), std::end(reach), spheres.radius[i]);
+        if (insideAll(planes, spheres.x[i], spheres.y[i], spheres.z[i], reach))
+        {
+            visible[written++] = static_cast<uint32_t>(i);
+        }
+    }
+
+    return written;
+}
+
+size_t cullBoxes(const FrustumPlanes& planes, const BoundingBoxes& boxes, size_t begin, size_t end, uint32_t* visible)
+{
+    // A box reaches furthest towards a plane along the signs of its normal, so only the normal's magnitude matters.
+    std::array<glm::vec3, 6> normalMagnitudes;
+    for (size_t plane = 0; plane < planes.size(); plane++)
+    {
+        normalMagnitudes[plane] = glm::abs(glm::vec3(planes[plane]));
+    }
+
+    size_t written = 0;
+    size_t i       = begin;
+
+#if defined(RENDERER_SIMD)
+    for (; i + Lanes::width <= end; i += Lanes::width)
+    {
+        Lanes::Float x       = Lanes::load(&boxes.centerX[i]);
+        Lanes::Float y       = Lanes::load(&boxes.centerY[i]);
+        Lanes::Float z       = Lanes::load(&boxes.centerZ[i]);
+        Lanes::Float extentX = Lanes::load(&boxes.extentX[i]);
+        Lanes::Float extentY = Lanes::load(&boxes.extentY[i]);
+        Lanes::Float extentZ = Lanes::load(&boxes.extentZ[i]);
+        Lanes::Float inside  = Lanes::allTrue();
+
+        for (size_t plane = 0; plane < planes.size(); plane++)
+        {
+            const glm::vec4& p = planes[plane];
+            const glm::vec3& m = normalMagnitudes[plane];
+
+            Lanes::Float distance = Lanes::add(
+                Lanes::add(Lanes::multiply(Lanes::broadcast(p.x), x), Lanes::multiply(Lanes::broadcast(p.y), y)),
+                Lanes::add(Lanes::multiply(Lanes::broadcast(p.z), z), Lanes::broadcast(p.w)));
+            Lanes::Float reach = Lanes::add(
+                Lanes::add(
+                    Lanes::multiply(Lanes::broadcast(m.x), extentX),
+                    Lanes::multiply(Lanes::broadcast(m.y), extentY)),
+                Lanes::multiply(Lanes::broadcast(m.z), extentZ));
+            inside = Lanes::both(inside, Lanes::greaterEqual(Lanes::add(distance, reach), Lanes::broadcast(0.0f)));
+        }
+
+        written += writeLanes(Lanes::bits(inside), i, visible + written);
+    }
+#endif
+
+    for (; i < end; i++)
+    {
+        glm::vec3 extent(boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]);
+
+        float reach[6];
+        for (size_t plane = 0; plane < planes.size(); plane++)
+        {
+            reach[plane] = glm::dot(normalMagnitudes[plane], extent);
+        }
+        if (insideAll(planes, boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i], reach))
+        {
+            visible[written++] = static_cast<uint32_t>(i);
+        }
+    }
+
+    return written;
+}
+
+const char* cullingInstructionSet()
+{
+    return simdInstructionSet();
+}
+
+// Each chunk writes its survivors at its own offset, so the threads never share an output slot; the chunks are then
+// slid down into one list. Only the survivors move, which is cheap next to the tests themselves.
+template <typename Kernel>
+size_t FrustumCuller::run(size_t count, std::vector<uint32_t>& visible, Kernel kernel)
+{
+    visible.resize(count);
+    chunkCounts.assign((count + grain - 1) / grain, 0);
+
+    pool.parallelFor(
+        count,
+        grain,
+        [&](size_t begin, size_t end, size_t chunk) { chunkCounts[chunk] = kernel(begin, end, &visible[begin]); });
+
+    size_t written = 0;
+    for (size_t chunk = 0; chunk < chunkCounts.size(); chunk++)
+    {
+        uint32_t* first = &visible[chunk * grain];
+        std::copy(first, first + chunkCounts[chunk], visible.data() + written);
+        written += chunkCounts[chunk];
+    }
+
+    visible.resize(written);
+    return written;
+}
+
+size_t FrustumCuller::cull(const FrustumPlanes& planes, const BoundingSpheres& spheres, std::vector<uint32_t>& visible)
+{
+    return run(
+        spheres.size(),
+        visible,
+        [&](size_t begin, size_t end, uint32_t* output) { return cullSpheres(planes, spheres, begin, end, output); });
+}
+
+size_t FrustumCuller::cull(const FrustumPlanes& planes, const BoundingBoxes& boxes, std::vector<uint32_t>& visible)
+{
+    return run(
+        boxes.size(),
+        visible,
+        [&](size_t begin, size_t end, uint32_t* output) { return cullBoxes(planes, boxes, begin, end, output); });
+}
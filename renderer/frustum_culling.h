@@ -0,0 +1,95 @@
+#pragma once
+
+#include "frustum.h"
+#include "thread_pool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bounding volumes stored one component per array, so a SIMD register holds the same component of consecutive
+// volumes and a test over all six planes needs no shuffles.
+struct BoundingSpheres
+{
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> radius;
+
+    // sphere is (center, radius).
+    void push_back(const glm::vec4& sphere)
+    {
+        x.push_back(sphere.x);
+        y.push_back(sphere.y);
+        z.push_back(sphere.z);
+        radius.push_back(sphere.w);
+    }
+
+    size_t size() const { return x.size(); }
+};
+
+struct BoundingBoxes
+{
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> extentX;
+    std::vector<float> extentY;
+    std::vector<float> extentZ;
+
+    // extent is the half size along each axis.
+    void push_back(const glm::vec3& center, const glm::vec3& extent)
+    {
+        centerX.push_back(center.x);
+        centerY.push_back(center.y);
+        centerZ.push_back(center.z);
+        extentX.push_back(extent.x);
+        extentY.push_back(extent.y);
+        extentZ.push_back(extent.z);
+    }
+
+    size_t size() const { return centerX.size(); }
+};
+
+// The kernels test volumes [begin, end) and write the indices of those at least partly inside every plane to
+// visible, in ascending order, returning how many they wrote. visible needs room for end - begin indices.
+//
+// The instruction set is chosen at compile time: AVX2 when the compiler targets it, SSE2 on any other x86-64
+// build and plain C++ elsewhere.
+size_t cullSpheres(
+    const FrustumPlanes&   planes,
+    const BoundingSpheres& spheres,
+    size_t                 begin,
+    size_t                 end,
+    uint32_t*              visible);
+size_t cullBoxes(const FrustumPlanes& planes, const BoundingBoxes& boxes, size_t begin, size_t end, uint32_t* visible);
+
+// "AVX2", "SSE2" or "scalar".
+const char* cullingInstructionSet();
+
+// Runs the kernels over a thread pool and gathers the per-chunk results into one compacted index list.
+class FrustumCuller {
+  public:
+    // Chunks smaller than a few thousand volumes cost more to hand out than they take to test.
+    static constexpr size_t defaultGrain = 4096;
+
+    explicit FrustumCuller(ThreadPool& pool, size_t grain = defaultGrain)
+        : pool(pool)
+        , grain(grain)
+    {
+    }
+
+    // Replaces visible with the indices of the visible volumes in ascending order and returns their count.
+    size_t cull(const FrustumPlanes& planes, const BoundingSpheres& spheres, std::vector<uint32_t>& visible);
+    size_t cull(const FrustumPlanes& planes, const BoundingBoxes& boxes, std::vector<uint32_t>& visible);
+
+  private:
+    template <typename Kernel>
+    size_t run(size_t count, std::vector<uint32_t>& visible, Kernel kernel);
+
+    ThreadPool&         pool;
+    size_t              grain;
+    std::vector<size_t> chunkCounts;
+};
@@ -0,0 +1,382 @@
+#define CGLTF_IMPLEMENTATION
+#include "gltf.h"
+
+#include <cgltf.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    struct DataDeleter
+    {
+        void operator()(cgltf_data* data) const { cgltf_free(data); }
+    };
+
+    using GltfData = std::unique_ptr<cgltf_data, DataDeleter>;
+
+    // A mesh placed in the scene by a node.
+    struct MeshInstance
+    {
+        const cgltf_mesh* mesh;
+        glm::mat4         transform;
+    };
+
+    // A triangle primitive of a placed mesh, in the order the model lists them.
+    struct Primitive
+    {
+        const cgltf_primitive* primitive;
+        const MeshInstance*    instance;
+    };
+
+    void collectInstances(const cgltf_node* node, std::vector<MeshInstance>& instances)
+    {
+        if (node->mesh)
+        {
+            float world[16];
+            cgltf_node_transform_world(node, world);
+
+            glm::mat4 transform(1.0f);
+            for (int column = 0; column < 4; column++)
+            {
+                for (int row = 0; row < 4; row++)
+                {
+                    transform[column][row] = world[column * 4 + row];
+                }
+            }
+            instances.push_back({node->mesh, transform});
+        }
+
+        for (size_t i = 0; i < node->children_count; i++)
+        {
+            collectInstances(node->children[i], instances);
+        }
+    }
+
+    // The meshes the default scene places, or the first scene's. A file without scenes is just a list of meshes.
+    std::vector<MeshInstance> meshInstances(const cgltf_data& data)
+    {
+        std::vector<MeshInstance> instances;
+
+        const cgltf_scene* scene = data.scene ? data.scene : data.scenes_count > 0 ? &data.scenes[0] : nullptr;
+        if (scene)
+        {
+            for (size_t i = 0; i < scene->nodes_count; i++)
+            {
+                collectInstances(scene->nodes[i], instances);
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < data.meshes_count; i++)
+            {
+                instances.push_back({&data.meshes[i], glm::mat4(1.0f)});
+            }
+        }
+
+        return instances;
+    }
+
+    const cgltf_accessor* findAttribute(const cgltf_primitive& primitive, cgltf_attribute_type type)
+    {
+        for (size_t i = 0; i < primitive.attributes_count; i++)
+        {
+            if (primitive.attributes[i].type == type && primitive.attributes[i].index == 0)
+            {
+                return primitive.attributes[i].data;
+            }
+        }
+        return nullptr;
+    }
+
+    // Where the accessor's first element lies, or null when it has no data of its own.
+    const uint8_t* accessorData(const cgltf_accessor* accessor)
+    {
+        const cgltf_buffer_view* view = accessor->buffer_view;
+        if (accessor->is_sparse || !view || !view->buffer->data)
+        {
+            return nullptr;
+        }
+        return static_cast<const uint8_t*>(view->buffer->data) + view->offset + accessor->offset;
+    }
+
+    bool isFloats(const cgltf_accessor* accessor, cgltf_type type)
+    {
+        return accessor && accessor->component_type == cgltf_component_type_r_32f && accessor->type == type &&
+               !accessor->normalized;
+    }
+
+    // The primitive's vertices where they lie in the file, or nothing when they are not laid out like Vertex there.
+    std::span<const Vertex> mappedVertices(const cgltf_primitive& primitive, const MappedFile& file)
+    {
+        const cgltf_accessor* position = findAttribute(primitive, cgltf_attribute_type_position);
+        const cgltf_accessor* color    = findAttribute(primitive, cgltf_attribute_type_color);
+        const cgltf_accessor* texCoord = findAttribute(primitive, cgltf_attribute_type_texcoord);
+        if (!isFloats(position, cgltf_type_vec3) || !isFloats(color, cgltf_type_vec3) ||
+            !isFloats(texCoord, cgltf_type_vec2))
+        {
+            return {};
+        }
+
+        const uint8_t* data = accessorData(position);
+        if (!data || accessorData(color) != data + offsetof(Vertex, color) ||
+            accessorData(texCoord) != data + offsetof(Vertex, texCoord) || position->stride != sizeof(Vertex) ||
+            color->stride != sizeof(Vertex) || texCoord->stride != sizeof(Vertex) ||
+            color->count != position->count || texCoord->count != position->count)
+        {
+            return {};
+        }
+
+        size_t bytes = position->count * sizeof(Vertex);
+        if (reinterpret_cast<uintptr_t>(data) % alignof(Vertex) != 0 || !file.contains(data, bytes))
+        {
+            return {};
+        }
+        return {reinterpret_cast<const Vertex*>(data), position->count};
+    }
+
+    // The indices of every primitive where they lie in the file, when they are 32-bit and each primitive's follow
+    // the previous one's; nothing otherwise.
+    std::span<const uint32_t> mappedIndices(const std::vector<Primitive>& primitives, const MappedFile& file)
+    {
+        const uint32_t* first = nullptr;
+        size_t          count = 0;
+        for (const Primitive& primitive : primitives)
+        {
+            const cgltf_accessor* accessor = primitive.primitive->indices;
+            if (!accessor || accessor->component_type != cgltf_component_type_r_32u ||
+                accessor->stride != sizeof(uint32_t))
+            {
+                return {};
+            }
+
+            auto* data = reinterpret_cast<const uint32_t*>(accessorData(accessor));
+            if (!data || (first && data != first + count))
+            {
+                return {};
+            }
+
+            first = first ? first : data;
+            count += accessor->count;
+        }
+
+        if (reinterpret_cast<uintptr_t>(first) % alignof(uint32_t) != 0 ||
+            !file.contains(first, count * sizeof(uint32_t)))
+        {
+            return {};
+        }
+        return {first, count};
+    }
+
+    // Appends the primitive's vertices, transformed into the scene, and returns the index of the first.
+    uint32_t appendVertices(const Primitive& primitive, std::vector<Vertex>& vertices)
+    {
+        const cgltf_accessor* position = findAttribute(*primitive.primitive, cgltf_attribute_type_position);
+        const cgltf_accessor* color    = findAttribute(*primitive.primitive, cgltf_attribute_type_color);
+        const cgltf_accessor* texCoord = findAttribute(*primitive.primitive, cgltf_attribute_type_texcoord);
+
+        // Unpacking widens normalized integers too.
+        size_t             count           = position->count;
+        size_t             colorComponents = color ? cgltf_num_components(color->type) : 0;
+        std::vector<float> positions(count * 3);
+        std::vector<float> texCoords(texCoord ? count * 2 : 0);
+        std::vector<float> colors(count * colorComponents);
+        cgltf_accessor_unpack_floats(position, positions.data(), positions.size());
+        if (texCoord)
+        {
+            cgltf_accessor_unpack_floats(texCoord, texCoords.data(), std::min(texCoords.size(), texCoord->count * 2));
+        }
+        if (color)
+        {
+            cgltf_accessor_unpack_floats(color, colors.data(), std::min(colors.size(), color->count * colorComponents));
+        }
+
+        auto base = static_cast<uint32_t>(vertices.size());
+        vertices.resize(vertices.size() + count);
+        for (size_t i = 0; i < count; i++)
+        {
+            Vertex& vertex = vertices[base + i];
+
+            glm::vec4 local(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2], 1.0f);
+            vertex.pos      = glm::vec3(primitive.instance->transform * local);
+            vertex.color    = glm::vec3(1.0f);
+            vertex.texCoord = texCoord ? glm::vec2(texCoords[i * 2], texCoords[i * 2 + 1]) : glm::vec2(0.0f);
+            if (color)
+            {
+                // Alpha, if any, is dropped.
+                const float* rgb = &colors[i * colorComponents];
+                vertex.color     = glm::vec3(rgb[0], rgb[1], rgb[2]);
+            }
+        }
+
+        return base;
+    }
+
+    // Appends the primitive's indices, offset by base; a primitive without indices draws its vertices in order.
+    void appendIndices(
+        const cgltf_primitive& primitive,
+        uint32_t               base,
+        size_t                 vertexCount,
+        std::vector<uint32_t>& indices)
+    {
+        if (!primitive.indices)
+        {
+            for (size_t i = 0; i < vertexCount; i++)
+            {
+                indices.push_back(base + static_cast<uint32_t>(i));
+            }
+            return;
+        }
+
+        for (size_t i = 0; i < primitive.indices->count; i++)
+        {
+            indices.push_back(base + static_cast<uint32_t>(cgltf_accessor_read_index(primitive.indices, i)));
+        }
+    }
+
+    // Decodes an image embedded in a buffer view or a data URI, or loads it from a file next to the model.
+    TextureData loadImage(const cgltf_image& image, const cgltf_options& options, const std::string& modelPath)
+    {
+        if (image.buffer_view)
+        {
+            const cgltf_buffer_view& view = *image.buffer_view;
+            if (!view.buffer->data)
+            {
+                throw std::runtime_error("failed to find the data of an embedded glTF image!");
+            }
+            return decodeTexture(static_cast<const uint8_t*>(view.buffer->data) + view.offset, view.size);
+        }
+
+        if (!image.uri)
+        {
+            throw std::runtime_error("failed to find a glTF image's data!");
+        }
+
+        const char* base64 = std::strncmp(image.uri, "data:", 5) == 0 ? std::strstr(image.uri, ";base64,") : nullptr;
+        if (base64)
+        {
+            base64 += std::strlen(";base64,");
+
+            size_t length  = std::strlen(base64);
+            size_t padding = 0;
+            while (padding < 2 && padding < length && base64[length - 1 - padding] == '=')
+            {
+                padding++;
+            }
+            size_t size = length / 4 * 3 - padding;
+
+            void* decoded = nullptr;
+            if (cgltf_load_buffer_base64(&options, size, base64, &decoded) != cgltf_result_success)
+            {
+                throw std::runtime_error("failed to decode a glTF image's data URI!");
+            }
+            std::unique_ptr<void, decltype(&std::free)> owner(decoded, &std::free);
+            return decodeTexture(static_cast<const uint8_t*>(decoded), size);
+        }
+
+        std::string uri = image.uri;
+        uri.resize(cgltf_decode_uri(uri.data()));
+
+        size_t separator = modelPath.find_last_of("/\\");
+        return loadTexture(separator == std::string::npos ? uri : modelPath.substr(0, separator + 1) + uri);
+    }
+} // namespace
+
+Model loadGltfModel(const std::string& path)
+{
+    Model model;
+    model.file = MappedFile(path);
+
+    cgltf_options options{};
+    cgltf_data*   parsed = nullptr;
+    if (cgltf_parse(&options, model.file.data(), model.file.size(), &parsed) != cgltf_result_success)
+    {
+        throw std::runtime_error("failed to parse " + path + "!");
+    }
+    GltfData data(parsed);
+
+    // A .glb's buffer is pointed at its binary chunk, inside the mapping. Other buffers are read or decoded into
+    // memory of cgltf's, which goes with data, so anything in them is converted.
+    if (cgltf_load_buffers(&options, data.get(), path.c_str()) != cgltf_result_success ||
+        cgltf_validate(data.get()) != cgltf_result_success)
+    {
+        throw std::runtime_error("failed to load the buffers of " + path + "!");
+    }
+
+    std::vector<MeshInstance> instances = meshInstances(*data);
+    std::vector<Primitive>    primitives;
+    for (const MeshInstance& instance : instances)
+    {
+        for (size_t i = 0; i < instance.mesh->primitives_count; i++)
+        {
+            const cgltf_primitive& primitive = instance.mesh->primitives[i];
+            if (primitive.type == cgltf_primitive_type_triangles &&
+                findAttribute(primitive, cgltf_attribute_type_position))
+            {
+                primitives.push_back({&primitive, &instance});
+            }
+        }
+    }
+
+    if (primitives.empty())
+    {
+        throw std::runtime_error(path + " has no triangles!");
+    }
+
+    // Used where they lie only when every primitive shares them and none is moved by its node; otherwise each
+    // primitive gets vertices of its own.
+    bool shared = true;
+    for (const Primitive& primitive : primitives)
+    {
+        shared = shared && primitive.instance->transform == glm::mat4(1.0f) &&
+                 findAttribute(*primitive.primitive, cgltf_attribute_type_position) ==
+                     findAttribute(*primitives[0].primitive, cgltf_attribute_type_position);
+    }
+
+    model.vertices = shared ? mappedVertices(*primitives[0].primitive, model.file) : std::span<const Vertex>();
+    if (!model.vertices.empty())
+    {
+        model.indices = mappedIndices(primitives, model.file);
+        if (model.indices.empty())
+        {
+            for (const Primitive& primitive : primitives)
+            {
+                appendIndices(*primitive.primitive, 0, model.vertices.size(), model.ownedIndices);
+            }
+            model.indices = model.ownedIndices;
+        }
+    }
+    else
+    {
+        for (const Primitive& primitive : primitives)
+        {
+            size_t   vertexCount = findAttribute(*primitive.primitive, cgltf_attribute_type_position)->count;
+            uint32_t base        = appendVertices(primitive, model.ownedVertices);
+            appendIndices(*primitive.primitive, base, vertexCount, model.ownedIndices);
+        }
+        model.vertices = model.ownedVertices;
+        model.indices  = model.ownedIndices;
+    }
+
+    model.boundingSphere = computeBoundingSphere(model.vertices);
+
+    for (const Primitive& primitive : primitives)
+    {
+        const cgltf_material* material = primitive.primitive->material;
+        if (material && material->has_pbr_metallic_roughness &&
+            material->pbr_metallic_roughness.base_color_texture.texture &&
+            material->pbr_metallic_roughness.base_color_texture.texture->image)
+        {
+            const cgltf_image& image = *material->pbr_metallic_roughness.base_color_texture.texture->image;
+            model.texture            = loadImage(image, options, path);
+            break;
+        }
+    }
+
+    return model;
+}
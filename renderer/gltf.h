@@ -0,0 +1,17 @@
+#pragma once
+
+#include "mesh.h"
+
+#include <string>
+
+// Loads a glTF 2.0 model, .glb or .gltf, into one indexed triangle list: every triangle primitive of every mesh the
+// default scene places, transformed by its node. Other primitive types are skipped. Vertices without COLOR_0 are
+// white, and ones without TEXCOORD_0 sample the texture's corner.
+//
+// The file is memory-mapped, and a .glb's binary chunk is used where it lies. When every primitive draws from the
+// same vertices, stored exactly like Vertex (position, COLOR_0 and TEXCOORD_0 as floats, interleaved with Vertex's
+// stride and offsets) and placed untransformed, Model::vertices points at them; when the primitives' indices are
+// 32-bit and follow each other, Model::indices does too. Anything else is converted.
+//
+// The texture is the base color texture of the first primitive that has one, embedded in the file or next to it.
+Model loadGltfModel(const std::string& path);
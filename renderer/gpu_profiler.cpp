@@ -0,0 +1,331 @@
+#include "gpu_profiler.h"
+
+#include "heap_allocations.h"
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+    constexpr VkQueryPipelineStatisticFlags collectedStatistics =
+        VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+    static_assert(sizeof(GpuProfiler::PipelineStatistics) == 5 * sizeof(uint64_t), "one value per collected statistic");
+} // namespace
+
+void GpuProfiler::create(
+    VkDevice                     device,
+    uint32_t                     frameSlots,
+    uint32_t                     maxScopes,
+    float                        timestampPeriod,
+    uint32_t                     timestampValidBits,
+    bool                         pipelineStatistics,
+    uint32_t                     window,
+    uint32_t                     historyFrames,
+    const VkAllocationCallbacks* allocator)
+{
+    this->device       = device;
+    this->allocator    = allocator;
+    this->maxScopes    = maxScopes;
+    nanosecondsPerTick = timestampPeriod;
+    timestampMask      = timestampValidBits >= 64 ? UINT64_MAX : (uint64_t(1) << timestampValidBits) - 1;
+    statisticsEnabled  = pipelineStatistics;
+    windowSize         = std::max(1u, window);
+
+    // Every slot records at most maxScopes scopes and the frame adds one more sample for itself.
+    if (scopes.empty())
+    {
+        scopes.reserve(maxScopes + 1);
+        scopeIndex("frame");
+    }
+    if (historyCapacity == 0)
+    {
+        historyCapacity = static_cast<size_t>(std::max(1u, historyFrames)) * (maxScopes + 1);
+        history.reserve(historyCapacity);
+    }
+
+    timestampResults.resize(maxScopes * 2);
+    statisticsResults.resize(maxScopes);
+
+    slots.assign(frameSlots, Slot{});
+    for (Slot& slot : slots)
+    {
+        VkQueryPoolCreateInfo timestampInfo{};
+        timestampInfo.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        timestampInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+        timestampInfo.queryCount = maxScopes * 2;
+
+        if (vkCreateQueryPool(device, &timestampInfo, allocator, &slot.timestampPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create GPU profiler timestamp query pool!");
+        }
+
+        if (statisticsEnabled)
+        {
+            VkQueryPoolCreateInfo statisticsInfo{};
+            statisticsInfo.sType              = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            statisticsInfo.queryType          = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            statisticsInfo.queryCount         = maxScopes;
+            statisticsInfo.pipelineStatistics = collectedStatistics;
+
+            if (vkCreateQueryPool(device, &statisticsInfo, allocator, &slot.statisticsPool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create GPU profiler pipeline statistics query pool!");
+            }
+        }
+    }
+}
+
+void GpuProfiler::destroy()
+{
+    for (Slot& slot : slots)
+    {
+        vkDestroyQueryPool(device, slot.timestampPool, allocator);
+        if (slot.statisticsPool != VK_NULL_HANDLE)
+        {
+            vkDestroyQueryPool(device, slot.statisticsPool, allocator);
+        }
+    }
+    slots.clear();
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t slot)
+{
+    Slot& frameSlot = slots[slot];
+    frameSlot.scopes.clear();
+    frameSlot.open = false;
+
+    vkCmdResetQueryPool(commandBuffer, frameSlot.timestampPool, 0, maxScopes * 2);
+    if (statisticsEnabled)
+    {
+        vkCmdResetQueryPool(commandBuffer, frameSlot.statisticsPool, 0, maxScopes);
+    }
+}
+
+void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, uint32_t slot, const std::string& name)
+{
+    Slot& frameSlot = slots[slot];
+    if (frameSlot.open)
+    {
+        throw std::runtime_error("GPU profiler scopes cannot nest!");
+    }
+    if (frameSlot.scopes.size() == maxScopes)
+    {
+        throw std::runtime_error("too many GPU profiler scopes in one frame!");
+    }
+
+    uint32_t query = static_cast<uint32_t>(frameSlot.scopes.size());
+    frameSlot.scopes.push_back(scopeIndex(name));
+    frameSlot.open = true;
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frameSlot.timestampPool, query * 2);
+    if (statisticsEnabled)
+    {
+        vkCmdBeginQuery(commandBuffer, frameSlot.statisticsPool, query, 0);
+    }
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t slot)
+{
+    Slot&    frameSlot = slots[slot];
+    uint32_t query     = static_cast<uint32_t>(frameSlot.scopes.size()) - 1;
+    frameSlot.open     = false;
+
+    if (statisticsEnabled)
+    {
+        vkCmdEndQuery(commandBuffer, frameSlot.statisticsPool, query);
+    }
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frameSlot.timestampPool, query * 2 + 1);
+}
+
+void GpuProfiler::submitted(uint32_t slot, uint64_t frame)
+{
+    slots[slot].pending = true;
+    slots[slot].frame   = frame;
+}
+
+bool GpuProfiler::collect(uint32_t slot)
+{
+    Slot& frameSlot = slots[slot];
+    if (!frameSlot.pending || frameSlot.scopes.empty())
+    {
+        return false;
+    }
+    frameSlot.pending = false;
+
+    uint32_t queryCount = static_cast<uint32_t>(frameSlot.scopes.size());
+    if (!readResults(frameSlot, queryCount))
+    {
+        return false;
+    }
+    const uint64_t*           timestamps = timestampResults.data();
+    const PipelineStatistics* statistics = statisticsResults.data();
+
+    auto milliseconds = [this](uint64_t begin, uint64_t end)
+    { return static_cast<double>((end - begin) & timestampMask) * nanosecondsPerTick / 1e6; };
+
+    double             frameTime = 0.0;
+    PipelineStatistics frameStatistics;
+    for (uint32_t query = 0; query < queryCount; query++)
+    {
+        addSample(
+            frameSlot.frame,
+            frameSlot.scopes[query],
+            milliseconds(timestamps[query * 2], timestamps[query * 2 + 1]),
+            statistics[query]);
+
+        frameTime = std::max(frameTime, milliseconds(timestamps[0], timestamps[query * 2 + 1]));
+        frameStatistics.inputPrimitives += statistics[query].inputPrimitives;
+        frameStatistics.vertexInvocations += statistics[query].vertexInvocations;
+        frameStatistics.clippingPrimitives += statistics[query].clippingPrimitives;
+        frameStatistics.fragmentInvocations += statistics[query].fragmentInvocations;
+        frameStatistics.computeInvocations += statistics[query].computeInvocations;
+    }
+    addSample(frameSlot.frame, 0, frameTime, frameStatistics);
+
+    return true;
+}
+
+bool GpuProfiler::readResults(const Slot& slot, uint32_t queryCount)
+{
+    // Whatever the driver allocates while reading is its own.
+    UncountedHeapAllocations driver;
+
+    // No wait flag: the caller has seen the fence, and should the results still be missing the frame is skipped
+    // rather than waited for.
+    VkResult result = vkGetQueryPoolResults(
+        device,
+        slot.timestampPool,
+        0,
+        queryCount * 2,
+        queryCount * 2 * sizeof(uint64_t),
+        timestampResults.data(),
+        sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    std::fill_n(statisticsResults.data(), queryCount, PipelineStatistics{});
+    if (statisticsEnabled)
+    {
+        result = vkGetQueryPoolResults(
+            device,
+            slot.statisticsPool,
+            0,
+            queryCount,
+            queryCount * sizeof(PipelineStatistics),
+            statisticsResults.data(),
+            sizeof(PipelineStatistics),
+            VK_QUERY_RESULT_64_BIT);
+    }
+    return result == VK_SUCCESS;
+}
+
+std::vector<GpuProfiler::ScopeTiming> GpuProfiler::timings() const
+{
+    std::vector<ScopeTiming> result;
+    for (const Scope& scope : scopes)
+    {
+        result.push_back(scope.timing);
+    }
+    return result;
+}
+
+void GpuProfiler::writeCsv(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        throw std::runtime_error("failed to open GPU profile " + path + "!");
+    }
+
+    file << "frame,scope,gpu_ms";
+    if (statisticsEnabled)
+    {
+        file << ",input_primitives,vertex_invocations,clipping_primitives,fragment_invocations,compute_invocations";
+    }
+    file << "\n";
+
+    // Once the ring has wrapped, the oldest frame in it may be missing some scopes, so it is left out.
+    for (size_t i = 0; i < history.size(); i++)
+    {
+        const Sample& sample = history[(historyNext + i) % history.size()];
+        if (historyWrapped && sample.frame == overwrittenFrame)
+        {
+            continue;
+        }
+
+        file << sample.frame << "," << scopes[sample.scope].name << "," << sample.time;
+        if (statisticsEnabled)
+        {
+            const PipelineStatistics& s = sample.statistics;
+            file << "," << s.inputPrimitives << "," << s.vertexInvocations << "," << s.clippingPrimitives << ","
+                 << s.fragmentInvocations << "," << s.computeInvocations;
+        }
+        file << "\n";
+    }
+
+    if (!file)
+    {
+        throw std::runtime_error("failed to write GPU profile " + path + "!");
+    }
+}
+
+uint32_t GpuProfiler::scopeIndex(const std::string& name)
+{
+    auto found = std::find_if(scopes.begin(), scopes.end(), [&](const Scope& scope) { return scope.name == name; });
+    if (found != scopes.end())
+    {
+        return static_cast<uint32_t>(found - scopes.begin());
+    }
+
+    Scope scope;
+    scope.name        = name;
+    scope.timing.name = name;
+    scope.window.reserve(windowSize);
+    scopes.push_back(std::move(scope));
+    return static_cast<uint32_t>(scopes.size() - 1);
+}
+
+void GpuProfiler::addSample(uint64_t frame, uint32_t scope, double time, const PipelineStatistics& statistics)
+{
+    Scope& entry = scopes[scope];
+    if (entry.window.size() < windowSize)
+    {
+        entry.window.push_back(time);
+    }
+    else
+    {
+        entry.window[entry.next] = time;
+        entry.next               = (entry.next + 1) % windowSize;
+    }
+
+    entry.timing.lastTime       = time;
+    entry.timing.meanTime       = std::accumulate(entry.window.begin(), entry.window.end(), 0.0) / entry.window.size();
+    entry.timing.maxTime        = *std::max_element(entry.window.begin(), entry.window.end());
+    entry.timing.lastStatistics = statistics;
+
+    if (history.size() < historyCapacity)
+    {
+        history.push_back({frame, scope, time, statistics});
+        return;
+    }
+
+    // The frame's own sample comes last, so overwriting it drops the last of that frame.
+    Sample& oldest = history[historyNext];
+    if (oldest.scope == 0)
+    {
+        historyDroppedFrames++;
+    }
+    overwrittenFrame = oldest.frame;
+    oldest           = {frame, scope, time, statistics};
+    historyNext      = (historyNext + 1) % historyCapacity;
+    historyWrapped   = true;
+}
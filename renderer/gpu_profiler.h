@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Measures GPU time per named scope with timestamp queries and, when the device has the pipelineStatisticsQuery
+// feature, counts the primitives and shader invocations inside each scope.
+//
+// Every frame slot, i.e. every command buffer that is submitted again and again, owns its own query pools. A slot's
+// results are read when its previous submission's fence has signalled, a few frames after they were written, so
+// reading never stalls the CPU or the GPU. Scopes are flat: pipeline statistics queries cannot nest, and a scope's
+// time is the span between its begin and end timestamps, which overlaps neighbouring scopes when the GPU runs them
+// concurrently.
+class GpuProfiler {
+  public:
+    // Matches the order in which Vulkan returns the statistics selected in create().
+    struct PipelineStatistics
+    {
+        uint64_t inputPrimitives     = 0;
+        uint64_t vertexInvocations   = 0;
+        uint64_t clippingPrimitives  = 0;
+        uint64_t fragmentInvocations = 0;
+        uint64_t computeInvocations  = 0;
+    };
+
+    struct ScopeTiming
+    {
+        std::string        name;
+        double             lastTime = 0.0;
+        // Mean and maximum over the rolling window, in milliseconds.
+        double             meanTime = 0.0;
+        double             maxTime  = 0.0;
+        PipelineStatistics lastStatistics;
+    };
+
+    GpuProfiler() = default;
+
+    GpuProfiler(const GpuProfiler&)            = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    // timestampPeriod and timestampValidBits come from the device limits and the queue family the command buffers
+    // run on. The history keeps the last historyFrames frames, allocated up front so that collecting never touches
+    // the heap. Creating again after destroy(), e.g. with the swap chain, keeps the rolling times and the history.
+    void create(
+        VkDevice                     device,
+        uint32_t                     frameSlots,
+        uint32_t                     maxScopes,
+        float                        timestampPeriod,
+        uint32_t                     timestampValidBits,
+        bool                         pipelineStatistics,
+        uint32_t                     window,
+        uint32_t                     historyFrames,
+        const VkAllocationCallbacks* allocator = nullptr);
+    void destroy();
+
+    // Recording. beginFrame() resets the slot's queries and must come before any scope, outside a render pass.
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t slot);
+    void beginScope(VkCommandBuffer commandBuffer, uint32_t slot, const std::string& name);
+    void endScope(VkCommandBuffer commandBuffer, uint32_t slot);
+
+    // The slot's command buffer was submitted as frame number frame.
+    void submitted(uint32_t slot, uint64_t frame);
+    // Reads the slot's last submission once its fence has signalled. Returns false when nothing was pending or the
+    // results were not yet available, in which case that frame is skipped.
+    bool collect(uint32_t slot);
+
+    // One entry per scope in the order they were first seen. The first, "frame", spans all the others.
+    std::vector<ScopeTiming> timings() const;
+    bool                     pipelineStatisticsEnabled() const { return statisticsEnabled; }
+
+    // Every frame still in the history, oldest first, one row per scope: frame,scope,gpu_ms followed by the pipeline
+    // statistics when enabled.
+    void     writeCsv(const std::string& path) const;
+    // Collected frames the history had to overwrite to make room.
+    uint64_t droppedFrames() const { return historyDroppedFrames; }
+
+  private:
+    struct Slot
+    {
+        VkQueryPool           timestampPool  = VK_NULL_HANDLE;
+        VkQueryPool           statisticsPool = VK_NULL_HANDLE;
+        std::vector<uint32_t> scopes;
+        bool                  open    = false;
+        bool                  pending = false;
+        uint64_t              frame   = 0;
+    };
+
+    struct Scope
+    {
+        std::string         name;
+        std::vector<double> window;
+        size_t              next = 0;
+        ScopeTiming         timing;
+    };
+
+    struct Sample
+    {
+        uint64_t           frame;
+        uint32_t           scope;
+        double             time;
+        PipelineStatistics statistics;
+    };
+
+    uint32_t scopeIndex(const std::string& name);
+    // Fills timestampResults and statisticsResults with the slot's first queryCount scopes.
+    bool     readResults(const Slot& slot, uint32_t queryCount);
+    void     addSample(uint64_t frame, uint32_t scope, double time, const PipelineStatistics& statistics);
+
+    VkDevice                     device             = VK_NULL_HANDLE;
+    const VkAllocationCallbacks* allocator          = nullptr;
+    bool                         statisticsEnabled  = false;
+    std::vector<Slot>            slots;
+    uint32_t                     maxScopes          = 0;
+    double                       nanosecondsPerTick = 1.0;
+    uint64_t                     timestampMask      = UINT64_MAX;
+    uint32_t                     windowSize         = 1;
+
+    // Scope 0 is the whole frame.
+    std::vector<Scope> scopes;
+
+    // A ring once full: historyNext is the oldest sample, and overwrittenFrame the frame it last overwrote part of.
+    std::vector<Sample> history;
+    size_t              historyCapacity      = 0;
+    size_t              historyNext          = 0;
+    bool                historyWrapped       = false;
+    uint64_t            historyDroppedFrames = 0;
+    uint64_t            overwrittenFrame     = 0;
+
+    // Sized for maxScopes in create(), so collecting reads results without allocating.
+    std::vector<uint64_t>           timestampResults;
+    std::vector<PipelineStatistics> statisticsResults;
+};
@@ -0,0 +1,41 @@
+#include "heap_allocations.h"
+
+namespace {
+    // Plain integers, so they need no construction and can be touched from operator new at any point of a thread's
+    // life.
+    thread_local uint64_t allocations          = 0;
+    thread_local uint64_t uncountedAllocations = 0;
+    thread_local uint32_t uncountedDepth       = 0;
+} // namespace
+
+uint64_t threadHeapAllocations()
+{
+    return allocations;
+}
+
+uint64_t threadUncountedHeapAllocations()
+{
+    return uncountedAllocations;
+}
+
+void countHeapAllocation()
+{
+    if (uncountedDepth == 0)
+    {
+        allocations++;
+    }
+    else
+    {
+        uncountedAllocations++;
+    }
+}
+
+UncountedHeapAllocations::UncountedHeapAllocations()
+{
+    uncountedDepth++;
+}
+
+UncountedHeapAllocations::~UncountedHeapAllocations()
+{
+    uncountedDepth--;
+}
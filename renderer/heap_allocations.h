@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts the calling thread's calls to the global operator new, so that code which must not touch the heap, such as
+// the frame loop, can check that it does not. Only executables that link counting_operator_new.cpp in a build
+// without NDEBUG feed the count; everywhere else it stays 0.
+uint64_t threadHeapAllocations();
+// The calling thread's allocations made while an UncountedHeapAllocations was alive, kept apart from the count above.
+uint64_t threadUncountedHeapAllocations();
+
+// Called by the counting operator new for every allocation.
+void countHeapAllocation();
+
+// While one is alive, the calling thread's allocations go to threadUncountedHeapAllocations() instead. Meant for
+// allocations the caller does not control, e.g. inside driver calls, and for growth that is expected and bounded, e.g.
+// a pool that fills up once: they are reported apart rather than failing a check on the counted ones.
+class UncountedHeapAllocations {
+  public:
+    UncountedHeapAllocations();
+    ~UncountedHeapAllocations();
+
+    UncountedHeapAllocations(const UncountedHeapAllocations&)            = delete;
+    UncountedHeapAllocations& operator=(const UncountedHeapAllocations&) = delete;
+};
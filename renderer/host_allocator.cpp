@@ -0,0 +1,273 @@
+#include "host_allocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace {
+    // In front of every block. Its size keeps the payload behind it 16-byte aligned.
+    struct alignas(16) BlockHeader
+    {
+        size_t   size;
+        uint32_t offset; // from the start of the underlying allocation to the payload
+        uint8_t  scope;
+        uint8_t  sizeClass;
+    };
+
+    constexpr uint8_t heapBlock      = 0xFF;
+    constexpr size_t  headerSize     = sizeof(BlockHeader);
+    constexpr size_t  poolAlignment  = alignof(BlockHeader);
+    constexpr size_t  slabBlockCount = 64;
+
+    BlockHeader* headerOf(void* memory)
+    {
+        return reinterpret_cast<BlockHeader*>(memory) - 1;
+    }
+
+    void raiseTo(std::atomic<size_t>& peak, size_t value)
+    {
+        size_t current = peak.load(std::memory_order_relaxed);
+        while (current < value && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+        }
+    }
+} // namespace
+
+HostAllocator::HostAllocator()
+{
+    for (size_t i = 0; i < sizeClasses.size(); i++)
+    {
+        pools[i].blockSize = headerSize + sizeClasses[i];
+    }
+
+    allocationCallbacks.pUserData             = this;
+    allocationCallbacks.pfnAllocation         = allocation;
+    allocationCallbacks.pfnReallocation       = reallocation;
+    allocationCallbacks.pfnFree               = freeing;
+    allocationCallbacks.pfnInternalAllocation = internalAllocation;
+    allocationCallbacks.pfnInternalFree       = internalFree;
+}
+
+HostAllocator::~HostAllocator() = default;
+
+HostAllocator::Statistics HostAllocator::statistics() const
+{
+    Statistics stats;
+    for (uint32_t scope = 0; scope < scopeCount; scope++)
+    {
+        const Counters& counter = counters[scope];
+        stats[scope].allocations    = counter.allocations.load(std::memory_order_relaxed);
+        stats[scope].frees          = counter.frees.load(std::memory_order_relaxed);
+        stats[scope].pooled         = counter.pooled.load(std::memory_order_relaxed);
+        stats[scope].bytesAllocated = counter.bytesAllocated.load(std::memory_order_relaxed);
+        stats[scope].liveBytes      = counter.liveBytes.load(std::memory_order_relaxed);
+        stats[scope].peakBytes      = counter.peakBytes.load(std::memory_order_relaxed);
+        stats[scope].internalBytes  = counter.internalBytes.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+size_t HostAllocator::poolCapacity() const
+{
+    size_t capacity = 0;
+    for (const Pool& pool : pools)
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        capacity += pool.slabs.size() * slabBlockCount * pool.blockSize;
+    }
+    return capacity;
+}
+
+const char* HostAllocator::scopeName(uint32_t scope)
+{
+    const char* names[] = {"command", "object", "cache", "device", "instance"};
+    return scope < scopeCount ? names[scope] : "unknown";
+}
+
+void* HostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    if (size == 0 || scope >= scopeCount)
+    {
+        return nullptr;
+    }
+
+    // Command and object scope allocations come and go with command recording and object creation, so they are the
+    // ones worth keeping off the heap.
+    uint8_t sizeClass = heapBlock;
+    if ((scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND || scope == VK_SYSTEM_ALLOCATION_SCOPE_OBJECT) &&
+        alignment <= poolAlignment)
+    {
+        auto fit = std::lower_bound(sizeClasses.begin(), sizeClasses.end(), size);
+        if (fit != sizeClasses.end())
+        {
+            sizeClass = static_cast<uint8_t>(fit - sizeClasses.begin());
+        }
+    }
+
+    uint8_t* payload;
+    uint32_t offset;
+    if (sizeClass != heapBlock)
+    {
+        uint8_t* block = static_cast<uint8_t*>(takeBlock(pools[sizeClass]));
+        if (!block)
+        {
+            return nullptr;
+        }
+        payload = block + headerSize;
+        offset  = static_cast<uint32_t>(headerSize);
+    }
+    else
+    {
+        // malloc aligns to at least 16 bytes, so the payload lands at most alignment bytes past the header.
+        alignment      = std::max(alignment, poolAlignment);
+        uint8_t* block = static_cast<uint8_t*>(std::malloc(headerSize + alignment + size));
+        if (!block)
+        {
+            return nullptr;
+        }
+        uintptr_t first = reinterpret_cast<uintptr_t>(block + headerSize);
+        payload         = reinterpret_cast<uint8_t*>((first + alignment - 1) & ~uintptr_t(alignment - 1));
+        offset          = static_cast<uint32_t>(payload - block);
+    }
+
+    *headerOf(payload) = {size, offset, static_cast<uint8_t>(scope), sizeClass};
+
+    Counters& counter = counters[scope];
+    counter.allocations.fetch_add(1, std::memory_order_relaxed);
+    counter.bytesAllocated.fetch_add(size, std::memory_order_relaxed);
+    if (sizeClass != heapBlock)
+    {
+        counter.pooled.fetch_add(1, std::memory_order_relaxed);
+    }
+    raiseTo(counter.peakBytes, counter.liveBytes.fetch_add(size, std::memory_order_relaxed) + size);
+
+    return payload;
+}
+
+void* HostAllocator::reallocate(void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    if (!original)
+    {
+        return allocate(size, alignment, scope);
+    }
+    if (size == 0)
+    {
+        free(original);
+        return nullptr;
+    }
+
+    // On failure the original allocation must stay valid, so it is only freed once the copy exists.
+    void* moved = allocate(size, alignment, scope);
+    if (moved)
+    {
+        std::memcpy(moved, original, std::min(size, headerOf(original)->size));
+        free(original);
+    }
+    return moved;
+}
+
+void HostAllocator::free(void* memory)
+{
+    if (!memory)
+    {
+        return;
+    }
+
+    BlockHeader header = *headerOf(memory);
+
+    Counters& counter = counters[header.scope];
+    counter.frees.fetch_add(1, std::memory_order_relaxed);
+    counter.liveBytes.fetch_sub(header.size, std::memory_order_relaxed);
+
+    uint8_t* block = static_cast<uint8_t*>(memory) - header.offset;
+    if (header.sizeClass != heapBlock)
+    {
+        returnBlock(pools[header.sizeClass], block);
+    }
+    else
+    {
+        std::free(block);
+    }
+}
+
+void* HostAllocator::takeBlock(Pool& pool)
+{
+    std::lock_guard<std::mutex> lock(pool.mutex);
+
+    if (!pool.freeList)
+    {
+        auto slab = std::unique_ptr<uint8_t[]>(new (std::nothrow) uint8_t[slabBlockCount * pool.blockSize]);
+        if (!slab)
+        {
+            return nullptr;
+        }
+
+        // Free blocks store the next free block in their first bytes.
+        for (size_t i = slabBlockCount; i-- > 0;)
+        {
+            void* block                 = slab.get() + i * pool.blockSize;
+            *static_cast<void**>(block) = pool.freeList;
+            pool.freeList               = block;
+        }
+        pool.slabs.push_back(std::move(slab));
+    }
+
+    void* block   = pool.freeList;
+    pool.freeList = *static_cast<void**>(block);
+    return block;
+}
+
+void HostAllocator::returnBlock(Pool& pool, void* block)
+{
+    std::lock_guard<std::mutex> lock(pool.mutex);
+
+    *static_cast<void**>(block) = pool.freeList;
+    pool.freeList               = block;
+}
+
+VKAPI_ATTR void* VKAPI_CALL
+HostAllocator::allocation(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    return static_cast<HostAllocator*>(userData)->allocate(size, alignment, scope);
+}
+
+VKAPI_ATTR void* VKAPI_CALL HostAllocator::reallocation(
+    void*                   userData,
+    void*                   original,
+    size_t                  size,
+    size_t                  alignment,
+    VkSystemAllocationScope scope)
+{
+    return static_cast<HostAllocator*>(userData)->reallocate(original, size, alignment, scope);
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::freeing(void* userData, void* memory)
+{
+    static_cast<HostAllocator*>(userData)->free(memory);
+}
+
+// VK_INTERNAL_ALLOCATION_TYPE_EXECUTABLE is the only internal allocation type, so only the scope is recorded.
+VKAPI_ATTR void VKAPI_CALL HostAllocator::internalAllocation(
+    void*                    userData,
+    size_t                   size,
+    VkInternalAllocationType /*type*/,
+    VkSystemAllocationScope  scope)
+{
+    if (scope < scopeCount)
+    {
+        static_cast<HostAllocator*>(userData)->counters[scope].internalBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::internalFree(
+    void*                    userData,
+    size_t                   size,
+    VkInternalAllocationType /*type*/,
+    VkSystemAllocationScope  scope)
+{
+    if (scope < scopeCount)
+    {
+        static_cast<HostAllocator*>(userData)->counters[scope].internalBytes.fetch_sub(size, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// VkAllocationCallbacks that count the driver's host allocations per VkSystemAllocationScope and serve small
+// command- and object-scoped ones from size-class pools instead of the general-purpose heap.
+//
+// Every block starts with a header recording its size, scope and size class, so frees and reallocations need no
+// lookup. Pool blocks go back to their class's free list and only return to the heap when the allocator is
+// destroyed, which must come after every object created with its callbacks has been destroyed. Vulkan may call the
+// callbacks from any thread that calls it.
+class HostAllocator {
+  public:
+    static constexpr uint32_t scopeCount = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+    // Pooled payload sizes; anything larger, or aligned to more than 16 bytes, goes to the heap.
+    static constexpr std::array<size_t, 6> sizeClasses = {32, 64, 128, 256, 512, 1024};
+
+    struct ScopeStatistics
+    {
+        uint64_t allocations    = 0; // reallocations count as one allocation and one free
+        uint64_t frees          = 0;
+        uint64_t pooled         = 0; // allocations served from a size-class pool
+        uint64_t bytesAllocated = 0; // over the allocator's lifetime
+        size_t   liveBytes      = 0;
+        size_t   peakBytes      = 0;
+        size_t   internalBytes  = 0; // the driver's own allocations, as reported through the notifications
+    };
+
+    using Statistics = std::array<ScopeStatistics, scopeCount>;
+
+    HostAllocator();
+    ~HostAllocator();
+
+    HostAllocator(const HostAllocator&)            = delete;
+    HostAllocator& operator=(const HostAllocator&) = delete;
+
+    // Pass to every vkCreate*, vkAllocate*, vkDestroy* and vkFree* call of the objects this allocator tracks.
+    const VkAllocationCallbacks* callbacks() const { return &allocationCallbacks; }
+
+    Statistics statistics() const;
+    // Bytes the pools took from the heap, whether their blocks are in use or free.
+    size_t     poolCapacity() const;
+
+    static const char* scopeName(uint32_t scope);
+
+  private:
+    struct Counters
+    {
+        std::atomic<uint64_t> allocations{0};
+        std::atomic<uint64_t> frees{0};
+        std::atomic<uint64_t> pooled{0};
+        std::atomic<uint64_t> bytesAllocated{0};
+        std::atomic<size_t>   liveBytes{0};
+        std::atomic<size_t>   peakBytes{0};
+        std::atomic<size_t>   internalBytes{0};
+    };
+
+    // A free list of equally sized blocks carved out of slabs that are never given back before destruction.
+    struct Pool
+    {
+        mutable std::mutex                      mutex;
+        size_t                                  blockSize = 0;
+        void*                                   freeList  = nullptr;
+        std::vector<std::unique_ptr<uint8_t[]>> slabs;
+    };
+
+    void* allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+    void* reallocate(void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    void  free(void* memory);
+
+    void* takeBlock(Pool& pool);
+    void  returnBlock(Pool& pool, void* block);
+
+    static VKAPI_ATTR void* VKAPI_CALL
+    allocation(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    static VKAPI_ATTR void* VKAPI_CALL
+    reallocation(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    static VKAPI_ATTR void VKAPI_CALL freeing(void* userData, void* memory);
+    static VKAPI_ATTR void VKAPI_CALL internalAllocation(
+        void*                    userData,
+        size_t                   size,
+        VkInternalAllocationType type,
+        VkSystemAllocationScope  scope);
+    static VKAPI_ATTR void VKAPI_CALL
+    internalFree(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+    VkAllocationCallbacks                allocationCallbacks{};
+    std::array<Counters, scopeCount>     counters;
+    std::array<Pool, sizeClasses.size()> pools;
+};
@@ -0,0 +1,158 @@
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "image_sequence_writer.h"
+
+#include "cpu_profiler.h"
+#include "heap_allocations.h"
+
+#include <stb_image_write.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+ImageSequenceWriter::ImageSequenceWriter(std::string directory, uint32_t workerCount, size_t queueCapacity)
+    : directory(std::move(directory))
+    , queueCapacity(std::max<size_t>(1, queueCapacity))
+    , jobs(this->queueCapacity)
+{
+    std::filesystem::create_directories(this->directory);
+
+    workerCount = std::max(1u, workerCount);
+    spareBuffers.reserve(this->queueCapacity + workerCount + 1);
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        workers.emplace_back(&ImageSequenceWriter::work, this);
+    }
+}
+
+ImageSequenceWriter::~ImageSequenceWriter()
+{
+    finish();
+}
+
+void ImageSequenceWriter::submit(uint32_t frame, const void* pixels, uint32_t width, uint32_t height)
+{
+    // Copy outside the lock: the copy is what frees the caller's buffer, the lock only guards the queue.
+    Job job{frame, width, height, takeBuffer(size_t(width) * height * 4)};
+    std::memcpy(job.pixels.data(), pixels, job.pixels.size());
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (jobCount >= queueCapacity)
+    {
+        auto blockStart = std::chrono::steady_clock::now();
+        slotAvailable.wait(lock, [this] { return jobCount < queueCapacity; });
+        stats.blockedTime +=
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - blockStart).count();
+    }
+
+    jobs[(firstJob + jobCount) % queueCapacity] = std::move(job);
+    jobCount++;
+
+    queueDepthTotal += jobCount;
+    submissions++;
+    stats.maxQueueDepth  = std::max(stats.maxQueueDepth, jobCount);
+    stats.meanQueueDepth = static_cast<double>(queueDepthTotal) / submissions;
+
+    lock.unlock();
+    jobAvailable.notify_one();
+}
+
+void ImageSequenceWriter::finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobAvailable.notify_all();
+
+    for (auto& worker : workers)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+}
+
+// A buffer is in the queue, with a worker or being filled by submit(), so at most queueCapacity + workerCount() + 1
+// exist. New ones are only made while the pool fills up, or grown after the frame size changed, and that bounded
+// growth is counted apart from the heap allocation count.
+std::vector<uint8_t> ImageSequenceWriter::takeBuffer(size_t size)
+{
+    std::vector<uint8_t> buffer;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!spareBuffers.empty())
+        {
+            buffer = std::move(spareBuffers.back());
+            spareBuffers.pop_back();
+        }
+    }
+
+    UncountedHeapAllocations poolGrowth;
+    buffer.resize(size);
+    return buffer;
+}
+
+ImageSequenceWriter::Statistics ImageSequenceWriter::statistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void ImageSequenceWriter::work()
+{
+    CPU_THREAD_NAME("PNG encoder");
+
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobAvailable.wait(lock, [this] { return stopping || jobCount > 0; });
+            if (jobCount == 0)
+            {
+                return;
+            }
+
+            job      = std::move(jobs[firstJob]);
+            firstJob = (firstJob + 1) % queueCapacity;
+            jobCount--;
+        }
+        slotAvailable.notify_one();
+
+        CPU_ZONE("encode PNG");
+
+        // Swap chain formats are BGRA; PNG wants RGBA. Alpha is forced opaque since the scene never writes it.
+        for (size_t texel = 0; texel < job.pixels.size(); texel += 4)
+        {
+            std::swap(job.pixels[texel], job.pixels[texel + 2]);
+            job.pixels[texel + 3] = 255;
+        }
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%05u.png", job.frame);
+        std::string path = (std::filesystem::path(directory) / name).string();
+
+        int written = stbi_write_png(
+            path.c_str(),
+            static_cast<int>(job.width),
+            static_cast<int>(job.height),
+            4,
+            job.pixels.data(),
+            static_cast<int>(job.width * 4));
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (written)
+        {
+            stats.framesWritten++;
+        }
+        else
+        {
+            stats.failedFrames++;
+        }
+        spareBuffers.push_back(std::move(job.pixels));
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writes rendered frames to <directory>/frame_NNNNN.png on worker threads.
+//
+// submit() only copies the pixels out of the caller's buffer, so a readback buffer can be reused as soon as it
+// returns. Encoding is far slower than rendering a frame, so the queue is bounded: once queueCapacity frames are
+// waiting, submit() blocks until a worker takes one, and that time is reported as blockedTime. Pixel buffers go back
+// to a pool once encoded, so after the first few frames submitting does not allocate.
+class ImageSequenceWriter {
+  public:
+    struct Statistics
+    {
+        uint32_t framesWritten  = 0;
+        uint32_t failedFrames   = 0;
+        double   meanQueueDepth = 0.0;
+        size_t   maxQueueDepth  = 0;
+        double   blockedTime    = 0.0; // ms submit() spent waiting for room in the queue
+    };
+
+    ImageSequenceWriter(std::string directory, uint32_t workerCount, size_t queueCapacity);
+    ~ImageSequenceWriter();
+
+    ImageSequenceWriter(const ImageSequenceWriter&)            = delete;
+    ImageSequenceWriter& operator=(const ImageSequenceWriter&) = delete;
+
+    // pixels holds width * height BGRA texels, rows tightly packed, as copied from a B8G8R8A8 image.
+    void submit(uint32_t frame, const void* pixels, uint32_t width, uint32_t height);
+    // Waits for every queued frame to be written and stops the workers.
+    void finish();
+
+    uint32_t   workerCount() const { return static_cast<uint32_t>(workers.size()); }
+    Statistics statistics() const;
+
+  private:
+    struct Job
+    {
+        uint32_t             frame;
+        uint32_t             width;
+        uint32_t             height;
+        std::vector<uint8_t> pixels;
+    };
+
+    void                 work();
+    std::vector<uint8_t> takeBuffer(size_t size);
+
+    std::string              directory;
+    size_t                   queueCapacity;
+    std::vector<std::thread> workers;
+
+    // jobs is a ring of queueCapacity entries holding jobCount jobs from firstJob on.
+    mutable std::mutex                mutex;
+    std::condition_variable           jobAvailable;
+    std::condition_variable           slotAvailable;
+    std::vector<Job>                  jobs;
+    size_t                            firstJob = 0;
+    size_t                            jobCount = 0;
+    std::vector<std::vector<uint8_t>> spareBuffers;
+    bool                              stopping = false;
+
+    Statistics stats;
+    uint64_t   queueDepthTotal = 0;
+    uint32_t   submissions     = 0;
+};
@@ -0,0 +1,265 @@
+#include "light_clusters.h"
+
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // A sphere touches a box when the box's closest point to its center lies within the radius.
+    bool sphereTouchesBox(const glm::vec3& center, float radius, const glm::vec3& min, const glm::vec3& max)
+    {
+        glm::vec3 offset = glm::clamp(center, min, max) - center;
+        return glm::dot(offset, offset) <= radius * radius;
+    }
+} // namespace
+
+void LightClusters::setProjection(const glm::mat4& proj, float nearPlane, float farPlane)
+{
+    glm::vec2 scale(proj[0][0], proj[1][1]);
+    if (!clusterMin.empty() && scale == projectionScale && nearPlane == nearDepth && farPlane == farDepth)
+    {
+        return;
+    }
+
+    projectionScale = scale;
+    nearDepth       = nearPlane;
+    farDepth        = farPlane;
+
+    float logRange = std::log(farPlane / nearPlane);
+    depthScale     = depthSlices / logRange;
+    depthBias      = -(depthSlices * std::log(nearPlane)) / logRange;
+
+    clusterMin.resize(clusterCount);
+    clusterMax.resize(clusterCount);
+    for (uint32_t slice = 0; slice < depthSlices; slice++)
+    {
+        float sliceNear = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(slice) / depthSlices);
+        float sliceFar  = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(slice + 1) / depthSlices);
+
+        for (uint32_t tileY = 0; tileY < tilesY; tileY++)
+        {
+            for (uint32_t tileX = 0; tileX < tilesX; tileX++)
+            {
+                // A tile's side planes pass through the eye, so its cross-section is widest at the far depth; taking
+                // both depths keeps the box correct on either side of the view axis.
+                glm::vec2 ndcMin(2.0f * tileX / tilesX - 1.0f, 2.0f * tileY / tilesY - 1.0f);
+                glm::vec2 ndcMax(2.0f * (tileX + 1) / tilesX - 1.0f, 2.0f * (tileY + 1) / tilesY - 1.0f);
+                glm::vec2 a = ndcMin * sliceNear / scale;
+                glm::vec2 b = ndcMax * sliceNear / scale;
+                glm::vec2 c = ndcMin * sliceFar / scale;
+                glm::vec2 d = ndcMax * sliceFar / scale;
+
+                uint32_t cluster    = (slice * tilesY + tileY) * tilesX + tileX;
+                clusterMin[cluster] = glm::vec3(glm::min(glm::min(a, b), glm::min(c, d)), sliceNear);
+                clusterMax[cluster] = glm::vec3(glm::max(glm::max(a, b), glm::max(c, d)), sliceFar);
+            }
+        }
+    }
+}
+
+// The sphere's bounding box reaches its extreme screen positions at its corners, so its tile range comes from
+// dividing the box's sides by its nearest and farthest depth. Lights entirely in front of the near plane or beyond
+// the far plane end up with minDepth > maxDepth.
+void LightClusters::project(const BoundingSpheres& lights, const glm::mat4& toView)
+{
+    size_t count = lights.size();
+    for (std::vector<float>* values :
+         {&centerX, &centerY, &centerDepth, &minDepth, &maxDepth, &minTileX, &maxTileX, &minTileY, &maxTileY})
+    {
+        values->resize(count);
+    }
+
+    size_t i = 0;
+
+#if defined(RENDERER_SIMD)
+    // Rows of toView, the third negated so it yields view depth rather than view-space z.
+    Lanes::Float rows[3][4];
+    for (int row = 0; row < 3; row++)
+    {
+        float sign = row == 2 ? -1.0f : 1.0f;
+        for (int column = 0; column < 4; column++)
+        {
+            rows[row][column] = Lanes::broadcast(sign * toView[column][row]);
+        }
+    }
+
+    Lanes::Float nearPlane = Lanes::broadcast(nearDepth);
+    Lanes::Float farPlane  = Lanes::broadcast(farDepth);
+    Lanes::Float scaleX    = Lanes::broadcast(projectionScale.x * tilesX * 0.5f);
+    Lanes::Float scaleY    = Lanes::broadcast(projectionScale.y * tilesY * 0.5f);
+    Lanes::Float offsetX   = Lanes::broadcast(tilesX * 0.5f);
+    Lanes::Float offsetY   = Lanes::broadcast(tilesY * 0.5f);
+
+    auto transform = [](Lanes::Float x, Lanes::Float y, Lanes::Float z, const Lanes::Float* row)
+    {
+        return Lanes::add(
+            Lanes::add(Lanes::multiply(row[0], x), Lanes::multiply(row[1], y)),
+            Lanes::add(Lanes::multiply(row[2], z), row[3]));
+    };
+
+    // Tile coordinates of the extremes of center +- radius over the near and far depth, in either order since the
+    // projection may flip Y.
+    auto tileRange = [](Lanes::Float center,
+                        Lanes::Float radius,
+                        Lanes::Float nearest,
+                        Lanes::Float farthest,
+                        Lanes::Float scale,
+                        Lanes::Float offset,
+                        float*       minTile,
+                        float*       maxTile)
+    {
+        Lanes::Float low     = Lanes::subtract(center, radius);
+        Lanes::Float high    = Lanes::add(center, radius);
+        Lanes::Float lowest  = Lanes::min(Lanes::divide(low, nearest), Lanes::divide(low, farthest));
+        Lanes::Float highest = Lanes::max(Lanes::divide(high, nearest), Lanes::divide(high, farthest));
+        Lanes::Float first   = Lanes::add(Lanes::multiply(lowest, scale), offset);
+        Lanes::Float second  = Lanes::add(Lanes::multiply(highest, scale), offset);
+        Lanes::store(minTile, Lanes::min(first, second));
+        Lanes::store(maxTile, Lanes::max(first, second));
+    };
+
+    for (; i + Lanes::width <= count; i += Lanes::width)
+    {
+        Lanes::Float x      = Lanes::load(&lights.x[i]);
+        Lanes::Float y      = Lanes::load(&lights.y[i]);
+        Lanes::Float z      = Lanes::load(&lights.z[i]);
+        Lanes::Float radius = Lanes::load(&lights.radius[i]);
+
+        Lanes::Float viewX    = transform(x, y, z, rows[0]);
+        Lanes::Float viewY    = transform(x, y, z, rows[1]);
+        Lanes::Float depth    = transform(x, y, z, rows[2]);
+        Lanes::Float nearest  = Lanes::max(Lanes::subtract(depth, radius), nearPlane);
+        Lanes::Float farthest = Lanes::min(Lanes::add(depth, radius), farPlane);
+
+        Lanes::store(&centerX[i], viewX);
+        Lanes::store(&centerY[i], viewY);
+        Lanes::store(&centerDepth[i], depth);
+        Lanes::store(&minDepth[i], nearest);
+        Lanes::store(&maxDepth[i], farthest);
+        tileRange(viewX, radius, nearest, farthest, scaleX, offsetX, &minTileX[i], &maxTileX[i]);
+        tileRange(viewY, radius, nearest, farthest, scaleY, offsetY, &minTileY[i], &maxTileY[i]);
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        projectScalar(lights, toView, i);
+    }
+}
+
+void LightClusters::projectScalar(const BoundingSpheres& lights, const glm::mat4& toView, size_t light)
+{
+    glm::vec3 view     = glm::vec3(toView * glm::vec4(lights.x[light], lights.y[light], lights.z[light], 1.0f));
+    float     radius   = lights.radius[light];
+    float     depth    = -view.z;
+    float     nearest  = std::max(depth - radius, nearDepth);
+    float     farthest = std::min(depth + radius, farDepth);
+
+    auto tileRange = [&](float center, float scale, uint32_t tiles, float& minTile, float& maxTile)
+    {
+        float lowest  = std::min((center - radius) / nearest, (center - radius) / farthest);
+        float highest = std::max((center + radius) / nearest, (center + radius) / farthest);
+        float first   = lowest * scale * tiles * 0.5f + tiles * 0.5f;
+        float second  = highest * scale * tiles * 0.5f + tiles * 0.5f;
+        minTile       = std::min(first, second);
+        maxTile       = std::max(first, second);
+    };
+
+    centerX[light]     = view.x;
+    centerY[light]     = view.y;
+    centerDepth[light] = depth;
+    minDepth[light]    = nearest;
+    maxDepth[light]    = farthest;
+    tileRange(view.x, projectionScale.x, tilesX, minTileX[light], maxTileX[light]);
+    tileRange(view.y, projectionScale.y, tilesY, minTileY[light], maxTileY[light]);
+}
+
+size_t LightClusters::assign(
+    const BoundingSpheres&     lights,
+    const glm::mat4&           toView,
+    size_t                     indexCapacity,
+    std::pmr::memory_resource* scratch)
+{
+    project(lights, toView);
+
+    auto slice = [this](float depth)
+    {
+        float value = std::floor(std::log(depth) * depthScale + depthBias);
+        return static_cast<uint32_t>(std::clamp(value, 0.0f, depthSlices - 1.0f));
+    };
+    auto tile = [](float value, uint32_t tiles)
+    { return static_cast<uint32_t>(std::clamp(std::floor(value), 0.0f, tiles - 1.0f)); };
+
+    std::pmr::vector<Pair> pairs(scratch);
+    clusterCursors.assign(clusterCount, 0);
+    viewSpaceLights.resize(lights.size());
+
+    for (uint32_t light = 0; light < lights.size(); light++)
+    {
+        glm::vec3 center(centerX[light], centerY[light], centerDepth[light]);
+        float     radius       = lights.radius[light];
+        viewSpaceLights[light] = glm::vec4(center.x, center.y, -center.z, radius);
+
+        bool outsideDepth  = minDepth[light] > maxDepth[light];
+        bool outsideScreen = maxTileX[light] < 0.0f || minTileX[light] >= tilesX || maxTileY[light] < 0.0f ||
+                             minTileY[light] >= tilesY;
+        if (outsideDepth || outsideScreen)
+        {
+            continue;
+        }
+
+        uint32_t firstX     = tile(minTileX[light], tilesX);
+        uint32_t lastX      = tile(maxTileX[light], tilesX);
+        uint32_t firstY     = tile(minTileY[light], tilesY);
+        uint32_t lastY      = tile(maxTileY[light], tilesY);
+        uint32_t firstSlice = slice(minDepth[light]);
+        uint32_t lastSlice  = slice(maxDepth[light]);
+
+        for (uint32_t z = firstSlice; z <= lastSlice; z++)
+        {
+            for (uint32_t y = firstY; y <= lastY; y++)
+            {
+                for (uint32_t x = firstX; x <= lastX; x++)
+                {
+                    uint32_t cluster = (z * tilesY + y) * tilesX + x;
+                    if (sphereTouchesBox(center, radius, clusterMin[cluster], clusterMax[cluster]))
+                    {
+                        pairs.push_back({cluster, light});
+                        clusterCursors[cluster]++;
+                    }
+                }
+            }
+        }
+    }
+
+    // Counts become offsets, then each pair drops into its cluster's next slot.
+    clusterRanges.resize(clusterCount);
+    uint32_t offset = 0;
+    for (uint32_t cluster = 0; cluster < clusterCount; cluster++)
+    {
+        clusterRanges[cluster]  = {offset, clusterCursors[cluster]};
+        clusterCursors[cluster] = offset;
+        offset += clusterRanges[cluster].count;
+    }
+
+    size_t written = std::min(pairs.size(), indexCapacity);
+    lightIndices.resize(written);
+    for (const Pair& pair : pairs)
+    {
+        uint32_t slot = clusterCursors[pair.cluster]++;
+        if (slot < written)
+        {
+            lightIndices[slot] = pair.light;
+        }
+    }
+
+    for (Range& range : clusterRanges)
+    {
+        size_t room = written - std::min<size_t>(range.offset, written);
+        range.count = static_cast<uint32_t>(std::min<size_t>(range.count, room));
+    }
+
+    dropped = pairs.size() - written;
+    return written;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "frustum_culling.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// Assigns point lights to the clusters of a view-space froxel grid: the screen split into tiles and each tile's
+// frustum cut into depth slices that thicken exponentially with distance, so clusters keep a similar shape from near
+// to far. A fragment finds its cluster from its pixel and view depth and only shades the lights listed there.
+//
+// Assignment walks the lights rather than the clusters. Each light's sphere is projected to a range of tiles and
+// slices, several lights at a time with SIMD, and only the clusters in that range are tested against the sphere. The
+// resulting (cluster, light) pairs are grouped by cluster in one counting pass, so each cluster's lights are
+// contiguous in indices() and in ascending light order.
+class LightClusters {
+  public:
+    static constexpr uint32_t tilesX       = 16;
+    static constexpr uint32_t tilesY       = 9;
+    static constexpr uint32_t depthSlices  = 24;
+    static constexpr uint32_t clusterCount = tilesX * tilesY * depthSlices;
+
+    // The lights of a cluster are indices()[offset, offset + count). Laid out as the shader reads it.
+    struct Range
+    {
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    // proj is a symmetric perspective projection such as glm::perspective, with or without Vulkan's Y flip, and
+    // nearPlane and farPlane are the ones it was built with. The cluster bounds are only rebuilt when these change.
+    void setProjection(const glm::mat4& proj, float nearPlane, float farPlane);
+
+    // lights are spheres in the space toView maps from; toView must be rigid so radii carry over. At most
+    // indexCapacity indices are kept: clusters that land past the capacity lose their last lights. Returns the number
+    // of indices written. The (cluster, light) pairs are gathered in scratch, e.g. a frame's arena.
+    size_t assign(
+        const BoundingSpheres&     lights,
+        const glm::mat4&           toView,
+        size_t                     indexCapacity,
+        std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+    // Makes room for count indices up front, so assign() never reallocates as the lights move about.
+    void reserveIndices(size_t count) { lightIndices.reserve(count); }
+
+    // Cluster (slice * tilesY + tileY) * tilesX + tileX holds the view depth d when
+    // slice = floor(log(d) * sliceScale() + sliceBias()).
+    float sliceScale() const { return depthScale; }
+    float sliceBias() const { return depthBias; }
+
+    const std::vector<Range>&     ranges() const { return clusterRanges; }
+    const std::vector<uint32_t>&  indices() const { return lightIndices; }
+    // Each light's view-space center and radius, in input order.
+    const std::vector<glm::vec4>& viewLights() const { return viewSpaceLights; }
+    // Light indices the last assign() had no room for.
+    size_t droppedIndices() const { return dropped; }
+
+  private:
+    struct Pair
+    {
+        uint32_t cluster;
+        uint32_t light;
+    };
+
+    void project(const BoundingSpheres& lights, const glm::mat4& toView);
+    void projectScalar(const BoundingSpheres& lights, const glm::mat4& toView, size_t light);
+
+    glm::vec2 projectionScale = glm::vec2(0.0f);
+    float     nearDepth       = 0.0f;
+    float     farDepth        = 0.0f;
+    float     depthScale      = 0.0f;
+    float     depthBias       = 0.0f;
+    size_t    dropped         = 0;
+
+    // Cluster bounds in view space with depth growing away from the camera: (x, y, depth).
+    std::vector<glm::vec3> clusterMin;
+    std::vector<glm::vec3> clusterMax;
+
+    // Per light, written by project(): the view-space center, the depth range clipped to the near and far planes
+    // and the fractional tile range the sphere covers on screen.
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerDepth;
+    std::vector<float> minDepth;
+    std::vector<float> maxDepth;
+    std::vector<float> minTileX;
+    std::vector<float> maxTileX;
+    std::vector<float> minTileY;
+    std::vector<float> maxTileY;
+
+    std::vector<uint32_t>  clusterCursors;
+    std::vector<Range>     clusterRanges;
+    std::vector<uint32_t>  lightIndices;
+    std::vector<glm::vec4> viewSpaceLights;
+};
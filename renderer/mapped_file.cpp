@@ -0,0 +1,130 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path)
+{
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("failed to open " + path + "!");
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        CloseHandle(file);
+        throw std::runtime_error("failed to read the size of " + path + "!");
+    }
+    length = static_cast<size_t>(fileSize.QuadPart);
+
+    // An empty file cannot be mapped, and has nothing to map anyway.
+    if (length > 0)
+    {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping)
+        {
+            bytes = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            // The view keeps the mapping object alive.
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        throw std::runtime_error("failed to open " + path + "!");
+    }
+
+    struct stat status;
+    if (fstat(file, &status) != 0)
+    {
+        close(file);
+        throw std::runtime_error("failed to read the size of " + path + "!");
+    }
+    length = static_cast<size_t>(status.st_size);
+
+    if (length > 0)
+    {
+        void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapping != MAP_FAILED)
+        {
+            bytes = static_cast<const uint8_t*>(mapping);
+            // Loaders go through all of it right away, so start reading it in.
+            madvise(mapping, length, MADV_WILLNEED);
+        }
+    }
+    // The mapping keeps its own reference to the file.
+    close(file);
+#endif
+
+    if (length > 0 && !bytes)
+    {
+        throw std::runtime_error("failed to map " + path + "!");
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    release();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : bytes(std::exchange(other.bytes, nullptr))
+    , length(std::exchange(other.length, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        bytes  = std::exchange(other.bytes, nullptr);
+        length = std::exchange(other.length, 0);
+    }
+    return *this;
+}
+
+bool MappedFile::contains(const void* pointer, size_t size) const
+{
+    auto* begin = static_cast<const uint8_t*>(pointer);
+    return bytes && begin >= bytes && size <= length && static_cast<size_t>(begin - bytes) <= length - size;
+}
+
+void MappedFile::release()
+{
+    if (!bytes)
+    {
+        return;
+    }
+
+#if defined(_WIN32)
+    UnmapViewOfFile(bytes);
+#else
+    munmap(const_cast<uint8_t*>(bytes), length);
+#endif
+    bytes  = nullptr;
+    length = 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A whole file mapped read-only into memory. Pages are read in by the OS as they are first touched, so a loader can
+// hand out pointers into the file instead of reading it into buffers of its own. The mapping lives as long as the
+// object, and moves with it without changing address.
+class MappedFile {
+  public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return bytes; }
+    size_t         size() const { return length; }
+    // Whether [pointer, pointer + size) lies inside the mapping.
+    bool           contains(const void* pointer, size_t size) const;
+
+  private:
+    void release();
+
+    const uint8_t* bytes  = nullptr;
+    size_t         length = 0;
+};
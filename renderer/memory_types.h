@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+// The first memory type allowed by typeBits (a VkMemoryRequirements::memoryTypeBits mask) that has every flag in
+// properties, or -1 when there is none.
+inline int32_t findMemoryTypeIndex(
+    const VkPhysicalDeviceMemoryProperties& memoryProperties,
+    uint32_t                                typeBits,
+    VkMemoryPropertyFlags                   properties)
+{
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    {
+        if ((typeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return static_cast<int32_t>(i);
+        }
+    }
+    return -1;
+}
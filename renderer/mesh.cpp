@@ -0,0 +1,151 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "mesh.h"
+
+#include <glm/gtx/hash.hpp>
+#include <tiny_obj_loader.h>
+
+#include <algorithm>
+#include <istream>
+#include <stdexcept>
+#include <streambuf>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+    struct VertexHash
+    {
+        size_t operator()(const Vertex& vertex) const
+        {
+            return ((std::hash<glm::vec3>()(vertex.pos) ^ (std::hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
+                   (std::hash<glm::vec2>()(vertex.texCoord) << 1);
+        }
+    };
+
+    // Lets tinyobj read text already in memory without copying it into a string stream first.
+    class MemoryStreamBuffer : public std::streambuf {
+      public:
+        explicit MemoryStreamBuffer(std::string_view text)
+        {
+            char* begin = const_cast<char*>(text.data());
+            setg(begin, begin, begin + text.size());
+        }
+    };
+
+    Mesh meshFromShapes(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes)
+    {
+        std::vector<Vertex> corners;
+        for (const auto& shape : shapes)
+        {
+            for (const auto& index : shape.mesh.indices)
+            {
+                Vertex vertex{};
+
+                vertex.pos = {
+                    attrib.vertices[3 * index.vertex_index + 0],
+                    attrib.vertices[3 * index.vertex_index + 1],
+                    attrib.vertices[3 * index.vertex_index + 2]};
+
+                vertex.texCoord = {
+                    attrib.texcoords[2 * index.texcoord_index + 0],
+                    attrib.texcoords[2 * index.texcoord_index + 1]};
+
+                vertex.color = {1.0f, 1.0f, 1.0f};
+
+                corners.push_back(vertex);
+            }
+        }
+
+        return indexVertices(corners);
+    }
+} // namespace
+
+Mesh loadObjMesh(const std::string& path)
+{
+    tinyobj::attrib_t                attrib;
+    std::vector<tinyobj::shape_t>    shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string                      warn, err;
+
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str()))
+    {
+        throw std::runtime_error(warn + err);
+    }
+
+    return meshFromShapes(attrib, shapes);
+}
+
+Mesh parseObjMesh(std::string_view text)
+{
+    tinyobj::attrib_t                attrib;
+    std::vector<tinyobj::shape_t>    shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string                      warn, err;
+
+    MemoryStreamBuffer buffer(text);
+    std::istream       stream(&buffer);
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &stream))
+    {
+        throw std::runtime_error(warn + err);
+    }
+
+    return meshFromShapes(attrib, shapes);
+}
+
+Model modelFromMesh(Mesh mesh)
+{
+    Model model;
+    model.ownedVertices  = std::move(mesh.vertices);
+    model.ownedIndices   = std::move(mesh.indices);
+    model.vertices       = model.ownedVertices;
+    model.indices        = model.ownedIndices;
+    model.boundingSphere = mesh.boundingSphere;
+    return model;
+}
+
+Mesh indexVertices(const std::vector<Vertex>& corners)
+{
+    Mesh mesh;
+    mesh.indices.reserve(corners.size());
+
+    std::unordered_map<Vertex, uint32_t, VertexHash> uniqueVertices;
+    uniqueVertices.reserve(corners.size());
+
+    for (const Vertex& vertex : corners)
+    {
+        auto [entry, inserted] = uniqueVertices.try_emplace(vertex, static_cast<uint32_t>(mesh.vertices.size()));
+        if (inserted)
+        {
+            mesh.vertices.push_back(vertex);
+        }
+        mesh.indices.push_back(entry->second);
+    }
+
+    mesh.boundingSphere = computeBoundingSphere(mesh.vertices);
+    return mesh;
+}
+
+glm::vec4 computeBoundingSphere(std::span<const Vertex> vertices)
+{
+    if (vertices.empty())
+    {
+        return glm::vec4(0.0f);
+    }
+
+    glm::vec3 minBounds = vertices[0].pos;
+    glm::vec3 maxBounds = vertices[0].pos;
+    for (const auto& vertex : vertices)
+    {
+        minBounds = glm::min(minBounds, vertex.pos);
+        maxBounds = glm::max(maxBounds, vertex.pos);
+    }
+
+    glm::vec3 center = (minBounds + maxBounds) * 0.5f;
+    float     radius = 0.0f;
+    for (const auto& vertex : vertices)
+    {
+        radius = std::max(radius, glm::length(vertex.pos - center));
+    }
+
+    return glm::vec4(center, radius);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "texture.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct Vertex
+{
+    glm::vec3 pos;
+    glm::vec3 color;
+    glm::vec2 texCoord;
+
+    bool operator==(const Vertex& other) const
+    {
+        return pos == other.pos && color == other.color && texCoord == other.texCoord;
+    }
+};
+
+struct Mesh
+{
+    std::vector<Vertex>   vertices;
+    std::vector<uint32_t> indices;
+    // Center of the vertices' bounding box and the distance to the farthest vertex from it.
+    glm::vec4             boundingSphere = glm::vec4(0.0f);
+};
+
+// A model ready for upload: its geometry in the layout above and, when the file embeds one, its texture.
+//
+// vertices and indices point into file when the file already stores them that way, so they go from the file to the
+// GPU with a single copy, and into ownedVertices and ownedIndices otherwise. Moving a Model keeps both valid.
+struct Model
+{
+    std::span<const Vertex>    vertices;
+    std::span<const uint32_t>  indices;
+    glm::vec4                  boundingSphere = glm::vec4(0.0f);
+    std::optional<TextureData> texture;
+
+    MappedFile            file;
+    std::vector<Vertex>   ownedVertices;
+    std::vector<uint32_t> ownedIndices;
+
+    bool verticesMapped() const { return !vertices.empty() && file.contains(vertices.data(), vertices.size_bytes()); }
+    bool indicesMapped() const { return !indices.empty() && file.contains(indices.data(), indices.size_bytes()); }
+};
+
+// Loads every shape of a Wavefront OBJ file into one indexed mesh with constant white vertex colors.
+Mesh loadObjMesh(const std::string& path);
+// Likewise for OBJ text already in memory, e.g. read from an asset archive. Material libraries are not loaded.
+Mesh parseObjMesh(std::string_view text);
+
+// Takes over mesh's vertices and indices.
+Model modelFromMesh(Mesh mesh);
+
+// Turns a triangle list with one vertex per corner into an indexed mesh, keeping the first occurrence of each
+// distinct vertex so the vertices stay in the order they were first used.
+Mesh indexVertices(const std::vector<Vertex>& corners);
+
+glm::vec4 computeBoundingSphere(std::span<const Vertex> vertices);
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Render settings the controller trades against frame time. renderScale applies to both swap chain dimensions.
+struct QualityLevel
+{
+    float    renderScale;
+    uint32_t sampleCount;
+    bool     sampleShading;
+};
+
+// Builds levels from most to least expensive: sample shading goes first, then sample count and render scale are
+// lowered alternately so neither collapses to its minimum before the other has moved.
+inline std::vector<QualityLevel> buildQualityLadder(uint32_t maxSamples, uint32_t minSamples, float minScale)
+{
+    constexpr float scaleStep = 0.125f;
+
+    minSamples = std::min(minSamples, maxSamples);
+
+    std::vector<QualityLevel> levels;
+    QualityLevel              level{1.0f, maxSamples, true};
+    levels.push_back(level);
+
+    level.sampleShading = false;
+    levels.push_back(level);
+
+    bool reduceSamples = true;
+    while (level.sampleCount > minSamples || level.renderScale > minScale)
+    {
+        bool canReduceSamples = level.sampleCount > minSamples;
+        bool canReduceScale   = level.renderScale > minScale;
+
+        if ((reduceSamples && canReduceSamples) || !canReduceScale)
+        {
+            level.sampleCount /= 2;
+        }
+        else
+        {
+            level.renderScale = std::max(minScale, level.renderScale - scaleStep);
+        }
+
+        reduceSamples = !reduceSamples;
+        levels.push_back(level);
+    }
+
+    return levels;
+}
+
+// Walks a quality ladder to keep GPU frame time within a budget.
+//
+// Decisions are made on the mean of a full window of frames, and the window restarts after every change so frames
+// rendered at the previous level never count. Stepping down happens as soon as a window is over budget. Stepping
+// up needs a window comfortably under budget (upgradeHeadroom) and a longer quiet period; each time a step up has to
+// be undone, that period doubles so the controller settles instead of oscillating between two levels.
+class QualityController {
+    std::vector<QualityLevel> levels;
+    double                    budget;
+    uint32_t                  window;
+    uint32_t                  upgradeDelay;
+    std::vector<double>       samples;
+
+    size_t   level                = 0;
+    uint32_t framesSinceChange    = 0;
+    bool     lastChangeWasUpgrade = false;
+    uint32_t changes              = 0;
+    double   lastMean             = 0.0;
+
+  public:
+    static constexpr double upgradeHeadroom = 0.75;
+
+    QualityController(std::vector<QualityLevel> levels, double budget, uint32_t window)
+        : levels(std::move(levels))
+        , budget(budget)
+        , window(window)
+        , upgradeDelay(window * 4)
+    {
+        samples.reserve(window);
+    }
+
+    // Records one frame's GPU time in milliseconds. Returns true when the current level changed.
+    bool addFrameTime(double frameTime)
+    {
+        framesSinceChange++;
+        samples.push_back(frameTime);
+        if (samples.size() < window)
+        {
+            return false;
+        }
+
+        double total = 0.0;
+        for (double sample : samples)
+        {
+            total += sample;
+        }
+        lastMean = total / samples.size();
+        samples.clear();
+
+        if (lastMean > budget && level + 1 < levels.size())
+        {
+            // The level just stepped up to cannot hold the budget: wait longer before trying it again.
+            if (lastChangeWasUpgrade && framesSinceChange <= upgradeDelay)
+            {
+                upgradeDelay *= 2;
+            }
+
+            return changeLevel(level + 1, false);
+        }
+
+        if (lastMean < budget * upgradeHeadroom && level > 0 && framesSinceChange >= upgradeDelay)
+        {
+            return changeLevel(level - 1, true);
+        }
+
+        return false;
+    }
+
+    const QualityLevel& current() const { return levels[level]; }
+
+    size_t currentIndex() const { return level; }
+
+    size_t levelCount() const { return levels.size(); }
+
+    uint32_t changeCount() const { return changes; }
+
+    // Mean GPU frame time of the last complete window.
+    double lastWindowMean() const { return lastMean; }
+
+  private:
+    bool changeLevel(size_t newLevel, bool upgrade)
+    {
+        level                = newLevel;
+        lastChangeWasUpgrade = upgrade;
+        framesSinceChange    = 0;
+        changes++;
+
+        return true;
+    }
+};
@@ -0,0 +1,741 @@
+#include "render_graph.h"
+
+#include "deletion_queue.h"
+#include "memory_types.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    constexpr VkAccessFlags writeAccessMask =
+        VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT |
+        VK_ACCESS_MEMORY_WRITE_BIT;
+
+    // Images restricted to these usages never leave a render pass, so their memory may be allocated lazily.
+    constexpr VkImageUsageFlags attachmentOnlyUsage =
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+        VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+    // Where a resource stands between barriers: the last writes, the reads since then, and which stages and
+    // access types the last barrier already made those writes visible to.
+    struct ResourceState
+    {
+        VkImageLayout        layout        = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags writeStages   = 0;
+        VkAccessFlags        writeAccess   = 0;
+        VkPipelineStageFlags readStages    = 0;
+        VkPipelineStageFlags visibleStages = 0;
+        VkAccessFlags        visibleAccess = 0;
+    };
+
+    // Layout transitions of combined depth/stencil formats must name both aspects.
+    VkImageAspectFlags barrierAspect(VkFormat format, VkImageAspectFlags aspect)
+    {
+        bool hasStencil = format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT ||
+                          format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+
+        return (aspect & VK_IMAGE_ASPECT_DEPTH_BIT) && hasStencil ? aspect | VK_IMAGE_ASPECT_STENCIL_BIT : aspect;
+    }
+
+    ResourceState stateAfter(const ResourceAccess& access, VkImageLayout layout)
+    {
+        ResourceState state{};
+        state.layout      = layout;
+        state.writeAccess = access.access & writeAccessMask;
+        if (state.writeAccess != 0)
+        {
+            state.writeStages = access.stages;
+        }
+        else
+        {
+            state.readStages = access.stages;
+        }
+
+        return state;
+    }
+} // namespace
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::read(Resource resource, const ResourceAccess& access)
+{
+    graph.passes[pass].accesses.push_back({resource, access, false, false});
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::write(Resource resource, const ResourceAccess& access, bool discard)
+{
+    graph.passes[pass].accesses.push_back({resource, access, true, discard});
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::sideEffect()
+{
+    graph.passes[pass].sideEffect = true;
+    return *this;
+}
+
+RenderGraph::Resource RenderGraph::createImage(std::string name, const ImageDescription& description)
+{
+    ResourceEntry entry{};
+    entry.name        = std::move(name);
+    entry.isImage     = true;
+    entry.transient   = true;
+    entry.description = description;
+
+    resources.push_back(std::move(entry));
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::importImage(
+    std::string                   name,
+    std::vector<VkImage>          images,
+    VkImageAspectFlags            aspect,
+    const ResourceAccess&         initial,
+    std::optional<ResourceAccess> final)
+{
+    ResourceEntry entry{};
+    entry.name               = std::move(name);
+    entry.isImage            = true;
+    entry.transient          = false;
+    entry.description.aspect = aspect;
+    entry.images             = std::move(images);
+    entry.initial            = initial;
+    entry.final              = final;
+
+    resources.push_back(std::move(entry));
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::importBuffer(
+    std::string                   name,
+    std::vector<VkBuffer>         buffers,
+    std::optional<ResourceAccess> final)
+{
+    ResourceEntry entry{};
+    entry.name      = std::move(name);
+    entry.isImage   = false;
+    entry.transient = false;
+    entry.buffers   = std::move(buffers);
+    entry.final     = final;
+
+    resources.push_back(std::move(entry));
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+RenderGraph::PassBuilder RenderGraph::addPass(std::string name, RecordFunction record)
+{
+    Pass pass{};
+    pass.name   = std::move(name);
+    pass.record = std::move(record);
+
+    passes.push_back(std::move(pass));
+    return PassBuilder(*this, static_cast<uint32_t>(passes.size() - 1));
+}
+
+void RenderGraph::compile(VkDevice device, VkPhysicalDevice physicalDevice, const VkAllocationCallbacks* allocator)
+{
+    this->device    = device;
+    this->allocator = allocator;
+
+    // A pass may declare the same resource more than once (e.g. a depth test reads and writes); fold them.
+    for (auto& pass : passes)
+    {
+        std::vector<PassAccess> merged;
+        for (const auto& access : pass.accesses)
+        {
+            auto existing = std::find_if(
+                merged.begin(),
+                merged.end(),
+                [&access](const PassAccess& other) { return other.resource == access.resource; });
+
+            if (existing == merged.end())
+            {
+                merged.push_back(access);
+                continue;
+            }
+
+            if (resources[access.resource].isImage && existing->access.layout != access.access.layout)
+            {
+                throw std::runtime_error(
+                    "render graph pass " + pass.name + " uses " + resources[access.resource].name +
+                    " in two layouts!");
+            }
+
+            existing->access.stages |= access.access.stages;
+            existing->access.access |= access.access.access;
+            existing->discard = existing->discard && access.discard && access.write;
+            existing->write   = existing->write || access.write;
+        }
+        pass.accesses = std::move(merged);
+    }
+
+    cullPasses();
+
+    for (uint32_t passIndex : livePasses())
+    {
+        for (const auto& access : passes[passIndex].accesses)
+        {
+            ResourceEntry& entry = resources[access.resource];
+            entry.firstPass      = std::min(entry.firstPass, passIndex);
+            entry.lastPass       = std::max(entry.lastPass, passIndex);
+        }
+    }
+
+    allocateTransients(physicalDevice);
+    computeBarriers();
+
+    stats.passes       = static_cast<uint32_t>(livePasses().size());
+    stats.culledPasses = static_cast<uint32_t>(passes.size()) - stats.passes;
+
+    auto countBatch = [this](const BarrierBatch& batch)
+    {
+        if (batch.empty())
+        {
+            return;
+        }
+
+        stats.barrierBatches++;
+        for (const auto& barrier : batch.barriers)
+        {
+            if (resources[barrier.resource].isImage)
+            {
+                stats.imageBarriers++;
+            }
+            else
+            {
+                stats.bufferBarriers++;
+            }
+        }
+    };
+
+    for (uint32_t passIndex : livePasses())
+    {
+        countBatch(passBarriers[passIndex]);
+    }
+    countBatch(finalBarriers);
+}
+
+void RenderGraph::cullPasses()
+{
+    // Walking backwards, a pass survives if it has a side effect, writes an imported resource, or writes something a
+    // surviving pass reads. A discarding write ends the dependency chain for that resource.
+    std::vector<bool> needed(resources.size(), false);
+
+    for (size_t i = passes.size(); i-- > 0;)
+    {
+        Pass& pass = passes[i];
+
+        bool live = pass.sideEffect;
+        for (const auto& access : pass.accesses)
+        {
+            if (access.write && (needed[access.resource] || !resources[access.resource].transient))
+            {
+                live = true;
+            }
+        }
+
+        pass.culled = !live;
+        if (!live)
+        {
+            continue;
+        }
+
+        for (const auto& access : pass.accesses)
+        {
+            if (access.write && access.discard)
+            {
+                needed[access.resource] = false;
+            }
+        }
+        for (const auto& access : pass.accesses)
+        {
+            if (!access.write || !access.discard)
+            {
+                needed[access.resource] = true;
+            }
+        }
+    }
+}
+
+std::vector<uint32_t> RenderGraph::livePasses() const
+{
+    std::vector<uint32_t> live;
+    for (uint32_t i = 0; i < passes.size(); i++)
+    {
+        if (!passes[i].culled)
+        {
+            live.push_back(i);
+        }
+    }
+
+    return live;
+}
+
+void RenderGraph::allocateTransients(VkPhysicalDevice physicalDevice)
+{
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    auto findMemoryType = [&memoryProperties](uint32_t typeBits, VkMemoryPropertyFlags properties)
+    { return findMemoryTypeIndex(memoryProperties, typeBits, properties); };
+
+    std::vector<Resource> transients;
+    for (Resource resource = 0; resource < resources.size(); resource++)
+    {
+        ResourceEntry& entry = resources[resource];
+        if (!entry.transient)
+        {
+            continue;
+        }
+
+        // Images no live pass touches still get memory of their own so they never alias anything.
+        if (entry.firstPass == UINT32_MAX)
+        {
+            entry.firstPass = 0;
+            entry.lastPass  = static_cast<uint32_t>(passes.size());
+        }
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width  = entry.description.extent.width;
+        imageInfo.extent.height = entry.description.extent.height;
+        imageInfo.extent.depth  = 1;
+        imageInfo.mipLevels     = entry.description.mipLevels;
+        imageInfo.arrayLayers   = 1;
+        imageInfo.format        = entry.description.format;
+        imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage         = entry.description.usage;
+        imageInfo.samples       = entry.description.samples;
+        imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+
+        entry.images.resize(1);
+        if (vkCreateImage(device, &imageInfo, allocator, &entry.images[0]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create render graph image " + entry.name + "!");
+        }
+
+        vkGetImageMemoryRequirements(device, entry.images[0], &entry.requirements);
+        stats.transientBytesRequested += entry.requirements.size;
+        transients.push_back(resource);
+    }
+
+    // Largest first, each image goes into the first block of the same memory type whose occupants are all dead
+    // before it starts or born after it ends. Every occupant sits at offset 0, so alignment is always satisfied.
+    std::sort(
+        transients.begin(),
+        transients.end(),
+        [this](Resource a, Resource b) { return resources[a].requirements.size > resources[b].requirements.size; });
+
+    for (Resource resource : transients)
+    {
+        ResourceEntry& entry = resources[resource];
+
+        bool attachmentOnly = (entry.description.usage & ~attachmentOnlyUsage) == 0 &&
+                              (entry.description.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+
+        int32_t memoryType = -1;
+        if (attachmentOnly)
+        {
+            memoryType = findMemoryType(
+                entry.requirements.memoryTypeBits,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+        }
+        if (memoryType < 0)
+        {
+            memoryType = findMemoryType(entry.requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        }
+        if (memoryType < 0)
+        {
+            throw std::runtime_error("failed to find memory for render graph image " + entry.name + "!");
+        }
+
+        auto overlaps = [this, &entry](Resource other)
+        {
+            return resources[other].firstPass <= entry.lastPass && entry.firstPass <= resources[other].lastPass;
+        };
+
+        auto block = std::find_if(
+            memoryBlocks.begin(),
+            memoryBlocks.end(),
+            [&](const MemoryBlock& candidate)
+            {
+                return candidate.memoryType == static_cast<uint32_t>(memoryType) &&
+                       std::none_of(candidate.occupants.begin(), candidate.occupants.end(), overlaps);
+            });
+
+        if (block == memoryBlocks.end())
+        {
+            memoryBlocks.push_back({static_cast<uint32_t>(memoryType), 0, {}});
+            block = memoryBlocks.end() - 1;
+        }
+
+        block->size = std::max(block->size, entry.requirements.size);
+        block->occupants.push_back(resource);
+        entry.memoryBlock = static_cast<uint32_t>(block - memoryBlocks.begin());
+    }
+
+    for (auto& block : memoryBlocks)
+    {
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize  = block.size;
+        allocInfo.memoryTypeIndex = block.memoryType;
+
+        if (vkAllocateMemory(device, &allocInfo, allocator, &block.memory) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate render graph memory!");
+        }
+
+        stats.transientBytesAllocated += block.size;
+        if (memoryProperties.memoryTypes[block.memoryType].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+        {
+            stats.lazilyAllocatedBytes += block.size;
+        }
+
+        for (Resource resource : block.occupants)
+        {
+            ResourceEntry& entry = resources[resource];
+            vkBindImageMemory(device, entry.images[0], block.memory, 0);
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image                           = entry.images[0];
+            viewInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format                          = entry.description.format;
+            viewInfo.subresourceRange.aspectMask     = entry.description.aspect;
+            viewInfo.subresourceRange.baseMipLevel   = 0;
+            viewInfo.subresourceRange.levelCount     = entry.description.mipLevels;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount     = 1;
+
+            if (vkCreateImageView(device, &viewInfo, allocator, &entry.view) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create render graph image view " + entry.name + "!");
+            }
+        }
+    }
+}
+
+void RenderGraph::computeBarriers()
+{
+    auto lastAccess = [this](Resource resource)
+    {
+        const ResourceEntry& entry = resources[resource];
+        if (entry.lastPass < passes.size())
+        {
+            for (const auto& access : passes[entry.lastPass].accesses)
+            {
+                if (access.resource == resource)
+                {
+                    return access.access;
+                }
+            }
+        }
+
+        return ResourceAccess{VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0};
+    };
+
+    // Each frame starts where the previous one left off. For transients that is whatever last used their memory:
+    // the previous occupant of an aliased block or, for the first occupant, the last one of the previous frame.
+    std::vector<ResourceState> states(resources.size());
+    for (Resource resource = 0; resource < resources.size(); resource++)
+    {
+        const ResourceEntry& entry = resources[resource];
+
+        if (entry.transient)
+        {
+            std::optional<Resource> previous;
+            Resource                lastOccupant = resource;
+            for (Resource occupant : memoryBlocks[entry.memoryBlock].occupants)
+            {
+                uint32_t lastPass = resources[occupant].lastPass;
+                if (lastPass < entry.firstPass && (!previous || lastPass > resources[*previous].lastPass))
+                {
+                    previous = occupant;
+                }
+                if (lastPass > resources[lastOccupant].lastPass)
+                {
+                    lastOccupant = occupant;
+                }
+            }
+
+            states[resource] = stateAfter(lastAccess(previous.value_or(lastOccupant)), VK_IMAGE_LAYOUT_UNDEFINED);
+        }
+        else if (entry.initial)
+        {
+            states[resource] = stateAfter(*entry.initial, entry.initial->layout);
+        }
+        else if (entry.final)
+        {
+            states[resource] = stateAfter(*entry.final, entry.final->layout);
+        }
+        else if (entry.firstPass != UINT32_MAX)
+        {
+            states[resource] = stateAfter(lastAccess(resource), VK_IMAGE_LAYOUT_UNDEFINED);
+        }
+    }
+
+    auto applyAccess = [this, &states](BarrierBatch& batch, const PassAccess& access)
+    {
+        ResourceState&        state        = states[access.resource];
+        const ResourceAccess& requested    = access.access;
+        bool                  layoutChange = resources[access.resource].isImage && state.layout != requested.layout;
+
+        if (access.write)
+        {
+            if (layoutChange || state.writeStages != 0 || state.readStages != 0)
+            {
+                batch.srcStages |= state.writeStages | state.readStages;
+                batch.dstStages |= requested.stages;
+
+                // Write-after-read only needs the execution dependency carried by the stage masks.
+                if (layoutChange || state.writeAccess != 0)
+                {
+                    VkImageLayout oldLayout = access.discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+                    batch.barriers.push_back(
+                        {access.resource, oldLayout, requested.layout, state.writeAccess, requested.access});
+                }
+            }
+
+            // Nothing has seen these writes yet, not even later work in the same stages.
+            state             = stateAfter(requested, requested.layout);
+            state.writeStages = requested.stages;
+            return;
+        }
+
+        bool needsVisibility = state.writeStages != 0 && ((requested.stages & ~state.visibleStages) != 0 ||
+                                                          (requested.access & ~state.visibleAccess) != 0);
+        if (layoutChange || needsVisibility)
+        {
+            batch.srcStages |= state.writeStages | (layoutChange ? state.readStages : 0);
+            batch.dstStages |= requested.stages;
+            batch.barriers.push_back(
+                {access.resource, state.layout, requested.layout, state.writeAccess, requested.access});
+
+            if (layoutChange)
+            {
+                // The transition itself counts as a write that later readers in other stages must wait for.
+                state.layout        = requested.layout;
+                state.writeStages   = requested.stages;
+                state.writeAccess   = 0;
+                state.readStages    = 0;
+                state.visibleStages = requested.stages;
+                state.visibleAccess = requested.access;
+            }
+            else
+            {
+                state.visibleStages |= requested.stages;
+                state.visibleAccess |= requested.access;
+            }
+        }
+
+        state.readStages |= requested.stages;
+    };
+
+    passBarriers.assign(passes.size(), {});
+    for (uint32_t passIndex : livePasses())
+    {
+        for (const auto& access : passes[passIndex].accesses)
+        {
+            applyAccess(passBarriers[passIndex], access);
+        }
+    }
+
+    finalBarriers = {};
+    for (Resource resource = 0; resource < resources.size(); resource++)
+    {
+        if (resources[resource].final)
+        {
+            applyAccess(finalBarriers, {resource, *resources[resource].final, false, false});
+        }
+    }
+}
+
+void RenderGraph::recordBatch(VkCommandBuffer commandBuffer, uint32_t frame, const BarrierBatch& batch) const
+{
+    if (batch.empty())
+    {
+        return;
+    }
+
+    std::vector<VkImageMemoryBarrier>  imageBarriers;
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+
+    for (const auto& barrier : batch.barriers)
+    {
+        const ResourceEntry& entry = resources[barrier.resource];
+
+        if (entry.isImage)
+        {
+            VkImageAspectFlags aspect = barrierAspect(entry.description.format, entry.description.aspect);
+
+            VkImageMemoryBarrier imageBarrier{};
+            imageBarrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            imageBarrier.oldLayout                       = barrier.oldLayout;
+            imageBarrier.newLayout                       = barrier.newLayout;
+            imageBarrier.srcAccessMask                   = barrier.srcAccess;
+            imageBarrier.dstAccessMask                   = barrier.dstAccess;
+            imageBarrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.image                           = frameImage(entry, frame);
+            imageBarrier.subresourceRange.aspectMask     = aspect;
+            imageBarrier.subresourceRange.baseMipLevel   = 0;
+            imageBarrier.subresourceRange.levelCount     = VK_REMAINING_MIP_LEVELS;
+            imageBarrier.subresourceRange.baseArrayLayer = 0;
+            imageBarrier.subresourceRange.layerCount     = VK_REMAINING_ARRAY_LAYERS;
+            imageBarriers.push_back(imageBarrier);
+        }
+        else
+        {
+            VkBufferMemoryBarrier bufferBarrier{};
+            bufferBarrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            bufferBarrier.srcAccessMask       = barrier.srcAccess;
+            bufferBarrier.dstAccessMask       = barrier.dstAccess;
+            bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.buffer              = frameBuffer(entry, frame);
+            bufferBarrier.offset              = 0;
+            bufferBarrier.size                = VK_WHOLE_SIZE;
+            bufferBarriers.push_back(bufferBarrier);
+        }
+    }
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        batch.srcStages != 0 ? batch.srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        batch.dstStages != 0 ? batch.dstStages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0,
+        nullptr,
+        static_cast<uint32_t>(bufferBarriers.size()),
+        bufferBarriers.data(),
+        static_cast<uint32_t>(imageBarriers.size()),
+        imageBarriers.data());
+}
+
+void RenderGraph::execute(
+    VkCommandBuffer commandBuffer,
+    uint32_t        frame,
+    const PassHook& beforePass,
+    const PassHook& afterPass) const
+{
+    for (uint32_t passIndex : livePasses())
+    {
+        if (beforePass)
+        {
+            beforePass(commandBuffer, frame, passes[passIndex].name);
+        }
+        recordBatch(commandBuffer, frame, passBarriers[passIndex]);
+        passes[passIndex].record(commandBuffer, frame);
+        if (afterPass)
+        {
+            afterPass(commandBuffer, frame, passes[passIndex].name);
+        }
+    }
+
+    recordBatch(commandBuffer, frame, finalBarriers);
+}
+
+void RenderGraph::destroy(DeletionQueue* deletionQueue)
+{
+    for (auto& entry : resources)
+    {
+        if (!entry.transient)
+        {
+            continue;
+        }
+
+        if (deletionQueue)
+        {
+            deletionQueue->retire(entry.view);
+            for (VkImage image : entry.images)
+            {
+                deletionQueue->retire(image);
+            }
+            continue;
+        }
+
+        if (entry.view != VK_NULL_HANDLE)
+        {
+            vkDestroyImageView(device, entry.view, allocator);
+        }
+        for (VkImage image : entry.images)
+        {
+            vkDestroyImage(device, image, allocator);
+        }
+    }
+
+    for (auto& block : memoryBlocks)
+    {
+        if (deletionQueue)
+        {
+            deletionQueue->retire(block.memory);
+        }
+        else
+        {
+            vkFreeMemory(device, block.memory, allocator);
+        }
+    }
+
+    passes.clear();
+    resources.clear();
+    passBarriers.clear();
+    finalBarriers = {};
+    memoryBlocks.clear();
+    stats = {};
+}
+
+VkImage RenderGraph::image(Resource resource) const
+{
+    return resources[resource].images[0];
+}
+
+VkImageView RenderGraph::view(Resource resource) const
+{
+    return resources[resource].view;
+}
+
+VkImage RenderGraph::frameImage(const ResourceEntry& entry, uint32_t frame) const
+{
+    return entry.images.size() == 1 ? entry.images[0] : entry.images[frame];
+}
+
+VkBuffer RenderGraph::frameBuffer(const ResourceEntry& entry, uint32_t frame) const
+{
+    return entry.buffers.size() == 1 ? entry.buffers[0] : entry.buffers[frame];
+}
+
+std::vector<std::string> RenderGraph::describe() const
+{
+    auto describeBatch = [this](const std::string& name, const BarrierBatch& batch)
+    {
+        uint32_t imageBarriers = 0;
+        for (const auto& barrier : batch.barriers)
+        {
+            imageBarriers += resources[barrier.resource].isImage ? 1 : 0;
+        }
+
+        return name + ": " + (batch.empty() ? std::string("no barrier")
+                                            : std::to_string(imageBarriers) + " image / " +
+                                                  std::to_string(batch.barriers.size() - imageBarriers) +
+                                                  " buffer barriers");
+    };
+
+    std::vector<std::string> lines;
+    for (const auto& pass : passes)
+    {
+        if (pass.culled)
+        {
+            lines.push_back(pass.name + ": culled");
+        }
+        else
+        {
+            lines.push_back(describeBatch(pass.name, passBarriers[&pass - passes.data()]));
+        }
+    }
+    lines.push_back(describeBatch("end of frame", finalBarriers));
+
+    return lines;
+}
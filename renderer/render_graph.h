@@ -0,0 +1,196 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+class DeletionQueue;
+
+// How a pass touches a resource: the pipeline stages and access types involved and, for images, the layout the
+// pass expects. Buffers ignore the layout.
+struct ResourceAccess
+{
+    VkPipelineStageFlags stages;
+    VkAccessFlags        access;
+    VkImageLayout        layout = VK_IMAGE_LAYOUT_UNDEFINED;
+};
+
+// A frame described as passes that declare which resources they read and write.
+//
+// compile() drops passes whose results nobody consumes, works out the barriers each remaining pass needs (one
+// batched vkCmdPipelineBarrier per pass at most) and creates the transient images. Transient images whose lifetimes
+// do not overlap share memory, and attachments that are only ever used inside render passes are placed in lazily
+// allocated memory when the device has it.
+//
+// Imported resources may have one handle per frame (e.g. swap chain images); execute() picks the handle for the
+// frame being recorded. Transient images are shared by all frames: their contents never outlive a frame.
+class RenderGraph {
+  public:
+    using Resource       = uint32_t;
+    using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, uint32_t frame)>;
+    using PassHook       = std::function<void(VkCommandBuffer commandBuffer, uint32_t frame, const std::string& pass)>;
+
+    struct ImageDescription
+    {
+        VkFormat              format;
+        VkExtent2D            extent;
+        uint32_t              mipLevels = 1;
+        VkSampleCountFlagBits samples   = VK_SAMPLE_COUNT_1_BIT;
+        VkImageUsageFlags     usage;
+        VkImageAspectFlags    aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    };
+
+    // Per-frame figures, i.e. what one execute() records.
+    struct Statistics
+    {
+        uint32_t     passes                  = 0;
+        uint32_t     culledPasses            = 0;
+        uint32_t     barrierBatches          = 0;
+        uint32_t     imageBarriers           = 0;
+        uint32_t     bufferBarriers          = 0;
+        VkDeviceSize transientBytesRequested = 0;
+        VkDeviceSize transientBytesAllocated = 0;
+        VkDeviceSize lazilyAllocatedBytes    = 0;
+    };
+
+    class PassBuilder {
+        RenderGraph& graph;
+        uint32_t     pass;
+
+      public:
+        PassBuilder(RenderGraph& graph, uint32_t pass)
+            : graph(graph)
+            , pass(pass)
+        {
+        }
+
+        PassBuilder& read(Resource resource, const ResourceAccess& access);
+        // discard allows the previous contents to be thrown away, e.g. before a clear or a full overwrite.
+        PassBuilder& write(Resource resource, const ResourceAccess& access, bool discard = false);
+        // Keeps the pass even when none of its writes are read, e.g. readbacks and presentation.
+        PassBuilder& sideEffect();
+    };
+
+    RenderGraph() = default;
+
+    RenderGraph(const RenderGraph&)            = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    Resource createImage(std::string name, const ImageDescription& description);
+    // initial is the state each frame starts from; final, when set, is the state the frame must leave it in.
+    Resource importImage(
+        std::string                   name,
+        std::vector<VkImage>          images,
+        VkImageAspectFlags            aspect,
+        const ResourceAccess&         initial,
+        std::optional<ResourceAccess> final = std::nullopt);
+    Resource importBuffer(
+        std::string                   name,
+        std::vector<VkBuffer>         buffers,
+        std::optional<ResourceAccess> final = std::nullopt);
+
+    PassBuilder addPass(std::string name, RecordFunction record);
+
+    // allocator, when set, is used for every object and allocation the graph creates until destroy().
+    void compile(VkDevice device, VkPhysicalDevice physicalDevice, const VkAllocationCallbacks* allocator = nullptr);
+    // beforePass and afterPass, when set, bracket each executed pass together with the barriers in front of it, e.g.
+    // for profiling scopes. They are called outside render passes.
+    void execute(
+        VkCommandBuffer commandBuffer,
+        uint32_t        frame,
+        const PassHook& beforePass = {},
+        const PassHook& afterPass  = {}) const;
+    // deletionQueue, when set, receives the graph's images and memory instead of destroying them right away, so the
+    // graph can be rebuilt while frames that use it are still in flight.
+    void destroy(DeletionQueue* deletionQueue = nullptr);
+
+    VkImage     image(Resource resource) const;
+    VkImageView view(Resource resource) const;
+
+    const Statistics& statistics() const { return stats; }
+
+    // One line per executed pass with the barriers recorded in front of it.
+    std::vector<std::string> describe() const;
+
+  private:
+    struct PassAccess
+    {
+        Resource       resource;
+        ResourceAccess access;
+        bool           write;
+        bool           discard;
+    };
+
+    struct Pass
+    {
+        std::string             name;
+        RecordFunction          record;
+        std::vector<PassAccess> accesses;
+        bool                    sideEffect = false;
+        bool                    culled     = false;
+    };
+
+    struct ResourceEntry
+    {
+        std::string                   name;
+        bool                          isImage;
+        bool                          transient;
+        ImageDescription              description{};
+        std::vector<VkImage>          images;
+        std::vector<VkBuffer>         buffers;
+        std::optional<ResourceAccess> initial;
+        std::optional<ResourceAccess> final;
+        VkImageView                   view        = VK_NULL_HANDLE;
+        uint32_t                      firstPass   = UINT32_MAX;
+        uint32_t                      lastPass    = 0;
+        uint32_t                      memoryBlock = UINT32_MAX;
+        VkMemoryRequirements          requirements{};
+    };
+
+    struct Barrier
+    {
+        Resource      resource;
+        VkImageLayout oldLayout;
+        VkImageLayout newLayout;
+        VkAccessFlags srcAccess;
+        VkAccessFlags dstAccess;
+    };
+
+    struct BarrierBatch
+    {
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        std::vector<Barrier> barriers;
+
+        bool empty() const { return srcStages == 0 && barriers.empty(); }
+    };
+
+    struct MemoryBlock
+    {
+        uint32_t              memoryType;
+        VkDeviceSize          size;
+        std::vector<Resource> occupants;
+        VkDeviceMemory        memory = VK_NULL_HANDLE;
+    };
+
+    void                  cullPasses();
+    void                  computeBarriers();
+    void                  allocateTransients(VkPhysicalDevice physicalDevice);
+    void                  recordBatch(VkCommandBuffer commandBuffer, uint32_t frame, const BarrierBatch& batch) const;
+    VkImage               frameImage(const ResourceEntry& entry, uint32_t frame) const;
+    VkBuffer              frameBuffer(const ResourceEntry& entry, uint32_t frame) const;
+    std::vector<uint32_t> livePasses() const;
+
+    VkDevice                     device    = VK_NULL_HANDLE;
+    const VkAllocationCallbacks* allocator = nullptr;
+    std::vector<Pass>            passes;
+    std::vector<ResourceEntry>   resources;
+    std::vector<BarrierBatch>    passBarriers;
+    BarrierBatch                 finalBarriers;
+    std::vector<MemoryBlock>     memoryBlocks;
+    Statistics                   stats;
+};
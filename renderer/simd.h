@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#    define RENDERER_SIMD 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#    include <emmintrin.h>
+#    define RENDERER_SIMD 1
+#endif
+
+// The handful of operations the CPU kernels need, at the widest width the build targets: AVX2 when the compiler
+// targets it, SSE2 on any other x86-64 build. Elsewhere RENDERER_SIMD stays undefined and the kernels only run their
+// scalar loops.
+#if defined(__AVX2__)
+struct Lanes
+{
+    using Float = __m256;
+
+    static constexpr size_t      width = 8;
+    static constexpr const char* name  = "AVX2";
+
+    static Float    load(const float* values) { return _mm256_loadu_ps(values); }
+    static void     store(float* values, Float a) { _mm256_storeu_ps(values, a); }
+    static Float    broadcast(float value) { return _mm256_set1_ps(value); }
+    static Float    add(Float a, Float b) { return _mm256_add_ps(a, b); }
+    static Float    subtract(Float a, Float b) { return _mm256_sub_ps(a, b); }
+    static Float    multiply(Float a, Float b) { return _mm256_mul_ps(a, b); }
+    static Float    divide(Float a, Float b) { return _mm256_div_ps(a, b); }
+    static Float    min(Float a, Float b) { return _mm256_min_ps(a, b); }
+    static Float    max(Float a, Float b) { return _mm256_max_ps(a, b); }
+    static Float    greaterEqual(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static Float    both(Float a, Float b) { return _mm256_and_ps(a, b); }
+    static Float    allTrue() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+    static uint32_t bits(Float mask) { return static_cast<uint32_t>(_mm256_movemask_ps(mask)); }
+};
+#elif defined(RENDERER_SIMD)
+struct Lanes
+{
+    using Float = __m128;
+
+    static constexpr size_t      width = 4;
+    static constexpr const char* name  = "SSE2";
+
+    static Float    load(const float* values) { return _mm_loadu_ps(values); }
+    static void     store(float* values, Float a) { _mm_storeu_ps(values, a); }
+    static Float    broadcast(float value) { return _mm_set1_ps(value); }
+    static Float    add(Float a, Float b) { return _mm_add_ps(a, b); }
+    static Float    subtract(Float a, Float b) { return _mm_sub_ps(a, b); }
+    static Float    multiply(Float a, Float b) { return _mm_mul_ps(a, b); }
+    static Float    divide(Float a, Float b) { return _mm_div_ps(a, b); }
+    static Float    min(Float a, Float b) { return _mm_min_ps(a, b); }
+    static Float    max(Float a, Float b) { return _mm_max_ps(a, b); }
+    static Float    greaterEqual(Float a, Float b) { return _mm_cmpge_ps(a, b); }
+    static Float    both(Float a, Float b) { return _mm_and_ps(a, b); }
+    static Float    allTrue() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+    static uint32_t bits(Float mask) { return static_cast<uint32_t>(_mm_movemask_ps(mask)); }
+};
+#endif
+
+// "AVX2", "SSE2" or "scalar".
+inline const char* simdInstructionSet()
+{
+#if defined(RENDERER_SIMD)
+    return Lanes::name;
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,42 @@
+#include "startup_timer.h"
+
+#include <utility>
+
+void StartupTimer::beginPhase(std::string name)
+{
+    if (finished())
+    {
+        return;
+    }
+
+    double now = elapsed();
+    endPhase(now);
+    recorded.push_back({std::move(name), now, 0.0});
+    phaseOpen = true;
+}
+
+void StartupTimer::markFirstFrame()
+{
+    if (finished())
+    {
+        return;
+    }
+
+    double now = elapsed();
+    endPhase(now);
+    firstFrame = now;
+}
+
+double StartupTimer::elapsed() const
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - origin).count();
+}
+
+void StartupTimer::endPhase(double now)
+{
+    if (phaseOpen)
+    {
+        recorded.back().duration = now - recorded.back().start;
+        phaseOpen                = false;
+    }
+}
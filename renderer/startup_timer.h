@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Splits startup into consecutive named phases, each ending where the next begins, and records when the first frame
+// reached the screen. Times are milliseconds since the origin, normally taken as early in the process as possible.
+//
+// Once the first frame is marked the timer stops listening, so code that runs again later (e.g. when the swap chain
+// is recreated) can keep its phase marks without polluting the startup numbers.
+class StartupTimer {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Phase
+    {
+        std::string name;
+        double      start;
+        double      duration;
+    };
+
+    explicit StartupTimer(Clock::time_point origin)
+        : origin(origin)
+    {
+    }
+
+    // Ends the current phase, if any, and starts one called name.
+    void beginPhase(std::string name);
+    // Ends the current phase and the startup.
+    void markFirstFrame();
+
+    bool                      finished() const { return firstFrame.has_value(); }
+    const std::vector<Phase>& phases() const { return recorded; }
+    // Time from the origin to markFirstFrame().
+    std::optional<double>     timeToFirstFrame() const { return firstFrame; }
+
+  private:
+    double elapsed() const;
+    void   endPhase(double now);
+
+    Clock::time_point     origin;
+    std::vector<Phase>    recorded;
+    bool                  phaseOpen = false;
+    std::optional<double> firstFrame;
+};
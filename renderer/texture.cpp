@@ -0,0 +1,158 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include "texture.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    // 8-bit sRGB to linear, and linear back to 8-bit sRGB through a table fine enough that rounding, not the
+    // table, decides the result.
+    constexpr uint32_t linearSteps = 4096;
+
+    struct SrgbTables
+    {
+        std::array<float, 256>           toLinear;
+        std::array<uint8_t, linearSteps> fromLinear;
+
+        SrgbTables()
+        {
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                float value = i / 255.0f;
+                toLinear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+            }
+            for (uint32_t i = 0; i < linearSteps; i++)
+            {
+                float value   = (i + 0.5f) / linearSteps;
+                float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+                fromLinear[i] = static_cast<uint8_t>(std::clamp(encoded * 255.0f + 0.5f, 0.0f, 255.0f));
+            }
+        }
+    };
+
+    const SrgbTables& srgbTables()
+    {
+        static const SrgbTables tables;
+        return tables;
+    }
+
+    // Takes over pixels, which stbi_load* returned for an RGBA request.
+    TextureData fromDecodedPixels(stbi_uc* pixels, int width, int height)
+    {
+        if (!pixels)
+        {
+            throw std::runtime_error("failed to load texture image!");
+        }
+
+        TextureData texture;
+        texture.levels.push_back(
+            {static_cast<uint32_t>(width),
+             static_cast<uint32_t>(height),
+             std::vector<uint8_t>(pixels, pixels + size_t(width) * height * 4)});
+        stbi_image_free(pixels);
+
+        return texture;
+    }
+} // namespace
+
+size_t TextureData::byteSize() const
+{
+    size_t size = 0;
+    for (const Level& level : levels)
+    {
+        size += level.pixels.size();
+    }
+    return size;
+}
+
+uint32_t mipLevelCount(uint32_t width, uint32_t height)
+{
+    uint32_t levels = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+    {
+        levels++;
+    }
+    return levels;
+}
+
+TextureData loadTexture(const std::string& path)
+{
+    int      width, height, channels;
+    stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    return fromDecodedPixels(pixels, width, height);
+}
+
+TextureData decodeTexture(const uint8_t* data, size_t size)
+{
+    int      width, height, channels;
+    stbi_uc* pixels =
+        stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &channels, STBI_rgb_alpha);
+    return fromDecodedPixels(pixels, width, height);
+}
+
+TextureData::Level downsampleLevel(const TextureData::Level& source, uint32_t steps, bool srgb)
+{
+    TextureData::Level level;
+    level.width  = std::max(1u, source.width >> steps);
+    level.height = std::max(1u, source.height >> steps);
+    level.pixels.resize(size_t(level.width) * level.height * 4);
+
+    const SrgbTables& tables = srgbTables();
+    uint32_t          block  = 1u << steps;
+    float             scale  = 1.0f / (block * block);
+
+    auto sourceRow = [&source](uint32_t y)
+    { return source.pixels.data() + size_t(std::min(y, source.height - 1)) * source.width * 4; };
+
+    for (uint32_t y = 0; y < level.height; y++)
+    {
+        uint8_t* out = level.pixels.data() + size_t(y) * level.width * 4;
+
+        for (uint32_t x = 0; x < level.width; x++)
+        {
+            float    linear[3] = {};
+            uint32_t alpha     = 0;
+            for (uint32_t row = 0; row < block; row++)
+            {
+                const uint8_t* in = sourceRow(y * block + row);
+                for (uint32_t column = 0; column < block; column++)
+                {
+                    const uint8_t* texel = in + size_t(std::min(x * block + column, source.width - 1)) * 4;
+                    for (uint32_t channel = 0; channel < 3; channel++)
+                    {
+                        linear[channel] += srgb ? tables.toLinear[texel[channel]] : texel[channel];
+                    }
+                    alpha += texel[3];
+                }
+            }
+
+            for (uint32_t channel = 0; channel < 3; channel++)
+            {
+                float mean = linear[channel] * scale;
+                out[x * 4 + channel] =
+                    srgb ? tables.fromLinear[std::min(static_cast<uint32_t>(mean * linearSteps), linearSteps - 1)]
+                         : static_cast<uint8_t>(mean + 0.5f);
+            }
+            out[x * 4 + 3] = static_cast<uint8_t>((alpha + block * block / 2) >> (steps * 2));
+        }
+    }
+
+    return level;
+}
+
+void generateMipChain(TextureData& texture, bool srgb)
+{
+    texture.levels.resize(1);
+
+    uint32_t count = mipLevelCount(texture.width(), texture.height());
+    texture.levels.reserve(count);
+    for (uint32_t i = 1; i < count; i++)
+    {
+        texture.levels.push_back(downsampleLevel(texture.levels[i - 1], 1, srgb));
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// An 8-bit RGBA image with its mip levels, level 0 first, each tightly packed.
+struct TextureData
+{
+    struct Level
+    {
+        uint32_t             width;
+        uint32_t             height;
+        std::vector<uint8_t> pixels;
+    };
+
+    std::vector<Level> levels;
+
+    uint32_t width() const { return levels.empty() ? 0 : levels[0].width; }
+    uint32_t height() const { return levels.empty() ? 0 : levels[0].height; }
+    // All levels back to back, in the order a buffer-to-image copy of the whole chain reads them.
+    size_t   byteSize() const;
+};
+
+// The number of levels down to 1x1: floor(log2(max(width, height))) + 1.
+uint32_t mipLevelCount(uint32_t width, uint32_t height);
+
+// Decodes an image file to RGBA; the result has level 0 only.
+TextureData loadTexture(const std::string& path);
+// Likewise for an image file already in memory, e.g. one embedded in a model.
+TextureData decodeTexture(const uint8_t* data, size_t size);
+
+// The level steps levels below source in its mip chain, each texel the box filter of the 2^steps x 2^steps texels it
+// covers. Odd sizes repeat the last row or column. srgb filters in linear space; alpha is always linear. One step is a
+// 2x2 filter, and more reach a coarse level in a single pass over source.
+TextureData::Level downsampleLevel(const TextureData::Level& source, uint32_t steps, bool srgb);
+
+// Appends the levels below level 0, each a 2x2 box filter of the one above. Odd sizes repeat the last row or
+// column. srgb filters in linear space, as the GPU does when it blits sRGB images; alpha is always linear.
+void generateMipChain(TextureData& texture, bool srgb);
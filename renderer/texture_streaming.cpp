@@ -0,0 +1,134 @@
+#include "texture_streaming.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+float meshUvDensity(std::span<const Vertex> vertices, std::span<const uint32_t> indices)
+{
+    double surfaceArea = 0.0;
+    double uvArea      = 0.0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        const Vertex& a = vertices[indices[i]];
+        const Vertex& b = vertices[indices[i + 1]];
+        const Vertex& c = vertices[indices[i + 2]];
+
+        surfaceArea += 0.5 * glm::length(glm::cross(b.pos - a.pos, c.pos - a.pos));
+
+        glm::vec2 u = b.texCoord - a.texCoord;
+        glm::vec2 v = c.texCoord - a.texCoord;
+        uvArea += 0.5 * std::abs(u.x * v.y - u.y * v.x);
+    }
+
+    return surfaceArea > 0.0 ? static_cast<float>(std::sqrt(uvArea / surfaceArea)) : 0.0f;
+}
+
+uint32_t wantedMipLevel(uint32_t size, float uvDensity, float pixelsPerUnit, uint32_t levelCount)
+{
+    if (pixelsPerUnit <= 0.0f)
+    {
+        return levelCount - 1;
+    }
+
+    float texelsPerPixel = size * uvDensity / pixelsPerUnit;
+    if (texelsPerPixel <= 1.0f)
+    {
+        return 0;
+    }
+    return std::min(static_cast<uint32_t>(std::log2(texelsPerPixel)), levelCount - 1);
+}
+
+MipResidency::MipResidency(std::vector<size_t> levelBytes, uint32_t tailLevel, size_t budget, uint32_t evictionDelay)
+    : tailBytes(levelBytes.size() + 1, 0)
+    , tail(std::min(tailLevel, static_cast<uint32_t>(levelBytes.size()) - 1))
+    , evictionDelay(evictionDelay)
+{
+    for (size_t i = levelBytes.size(); i-- > 0;)
+    {
+        tailBytes[i] = tailBytes[i + 1] + levelBytes[i];
+    }
+
+    budgetFirst = tail;
+    while (budgetFirst > 0 && tailBytes[budgetFirst - 1] <= budget)
+    {
+        budgetFirst--;
+    }
+
+    first = tail;
+}
+
+uint32_t MipResidency::update(uint32_t wantedLevel)
+{
+    uint32_t target = std::min(std::max(wantedLevel, budgetFirst), tail);
+
+    if (target < first)
+    {
+        first          = target;
+        framesUnwanted = 0;
+    }
+    else if (target > first && ++framesUnwanted >= evictionDelay)
+    {
+        first          = target;
+        framesUnwanted = 0;
+        evicted++;
+    }
+    else if (target == first)
+    {
+        framesUnwanted = 0;
+    }
+
+    return first;
+}
+
+StreamedMipChain::StreamedMipChain(TextureData texture, uint32_t tailSize, bool srgb)
+    : chain(std::move(texture))
+{
+    uint32_t levelCount = mipLevelCount(chain.width(), chain.height());
+    chain.levels.resize(1);
+    for (uint32_t level = 1; level < levelCount; level++)
+    {
+        chain.levels.push_back({std::max(1u, chain.width() >> level), std::max(1u, chain.height() >> level), {}});
+    }
+
+    tail = 0;
+    while (tail + 1 < levelCount && std::max(chain.levels[tail].width, chain.levels[tail].height) > tailSize)
+    {
+        tail++;
+    }
+
+    if (tail > 0)
+    {
+        chain.levels[tail] = downsampleLevel(chain.levels[0], tail, srgb);
+    }
+    for (uint32_t level = tail + 1; level < levelCount; level++)
+    {
+        chain.levels[level] = downsampleLevel(chain.levels[level - 1], 1, srgb);
+    }
+
+    // Level 0 is the source itself, so it is ready once level 1 is.
+    ready.store(tail > 1 ? tail : 0, std::memory_order_release);
+    if (tail > 1)
+    {
+        worker = std::thread([this, srgb] { filterLevels(srgb); });
+    }
+}
+
+StreamedMipChain::~StreamedMipChain()
+{
+    stopping = true;
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+}
+
+void StreamedMipChain::filterLevels(bool srgb)
+{
+    for (uint32_t level = tail - 1; level > 0 && !stopping; level--)
+    {
+        // Only the pixels change: the sizes may be read for any level at any time.
+        chain.levels[level].pixels = downsampleLevel(chain.levels[0], level, srgb).pixels;
+        ready.store(level > 1 ? level : 0, std::memory_order_release);
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "mesh.h"
+#include "texture.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <thread>
+#include <vector>
+
+// Texture coordinates per unit of surface: the square root of a triangle list's total UV area over its total surface
+// area. A texture size texels wide puts size * meshUvDensity(...) texels across one unit of the surface.
+float meshUvDensity(std::span<const Vertex> vertices, std::span<const uint32_t> indices);
+
+// The finest mip level worth having for a texture size texels wide, mapped at uvDensity, on a surface where one unit
+// spans pixelsPerUnit pixels: each level halves the texel density, so this is the first level at which a texel
+// covers at least a pixel. pixelsPerUnit of 0, nothing visible, asks for the last level.
+uint32_t wantedMipLevel(uint32_t size, float uvDensity, float pixelsPerUnit, uint32_t levelCount);
+
+// Decides which mip levels of a streamed texture are resident. They are always a tail of the chain,
+// [firstLevel(), levelCount): the levels from tailLevel on never leave, and finer ones come and go with what frames
+// ask for.
+//
+// A level is made resident as soon as a frame wants it, unless the levels from it on would take more than the
+// budget. Levels no frame wants any more are evicted only once evictionDelay frames in a row went without them, so a
+// camera moving back and forth does not upload the same level again and again.
+class MipResidency {
+  public:
+    // levelBytes holds the size of every level, finest first.
+    MipResidency(std::vector<size_t> levelBytes, uint32_t tailLevel, size_t budget, uint32_t evictionDelay);
+
+    // Takes the finest level this frame wants and returns the first level to keep resident.
+    uint32_t update(uint32_t wantedLevel);
+
+    uint32_t firstLevel() const { return first; }
+    uint32_t levelCount() const { return static_cast<uint32_t>(tailBytes.size()) - 1; }
+    uint32_t tailLevel() const { return tail; }
+    // The finest level the budget allows, or tailLevel when even the tail is over budget.
+    uint32_t budgetLevel() const { return budgetFirst; }
+    // Bytes of levels [first, levelCount).
+    size_t   bytes(uint32_t first) const { return tailBytes[first]; }
+    uint32_t evictions() const { return evicted; }
+
+  private:
+    // tailBytes[i] is the size of levels [i, levelCount); the extra last entry is 0.
+    std::vector<size_t> tailBytes;
+    uint32_t            tail;
+    uint32_t            budgetFirst;
+    uint32_t            evictionDelay;
+    uint32_t            first;
+    uint32_t            framesUnwanted = 0;
+    uint32_t            evicted        = 0;
+};
+
+// The mip chain a streamed texture uploads from, built from level 0 without holding up the first frame. The
+// constructor filters only the tail, the levels no larger than tailSize, straight from level 0. A worker thread then
+// fills in the finer levels coarsest first, each also straight from level 0, so the first one a frame asks for is
+// ready after a single pass. Every level's size is known from the start.
+class StreamedMipChain {
+  public:
+    StreamedMipChain(TextureData texture, uint32_t tailSize, bool srgb);
+    // Waits for the level the worker is filtering, if any.
+    ~StreamedMipChain();
+
+    StreamedMipChain(const StreamedMipChain&)            = delete;
+    StreamedMipChain& operator=(const StreamedMipChain&) = delete;
+
+    // Pixels of levels before readyLevel() may still be empty or being written.
+    const TextureData& texture() const { return chain; }
+    uint32_t           tailLevel() const { return tail; }
+    // Levels [readyLevel(), levelCount) hold their pixels and no longer change.
+    uint32_t           readyLevel() const { return ready.load(std::memory_order_acquire); }
+
+  private:
+    void filterLevels(bool srgb);
+
+    TextureData           chain;
+    uint32_t              tail;
+    std::atomic<uint32_t> ready;
+    std::atomic<bool>     stopping = false;
+    std::thread           worker;
+};
@@ -0,0 +1,104 @@
+#include "thread_pool.h"
+
+#include "cpu_profiler.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t workerCount)
+{
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    loopAvailable.notify_all();
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, ChunkFunction function)
+{
+    grain             = std::max<size_t>(1, grain);
+    size_t chunkCount = (count + grain - 1) / grain;
+    if (chunkCount == 0)
+    {
+        return;
+    }
+
+    // A single chunk is not worth waking anyone for.
+    if (chunkCount == 1 || workers.empty())
+    {
+        for (size_t chunk = 0; chunk < chunkCount; chunk++)
+        {
+            function(chunk * grain, std::min(count, (chunk + 1) * grain), chunk);
+        }
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    this->function   = &function;
+    this->count      = count;
+    this->grain      = grain;
+    this->chunkCount = chunkCount;
+    nextChunk        = 0;
+    chunksDone       = 0;
+    generation++;
+    loopAvailable.notify_all();
+
+    runChunks(lock);
+    loopFinished.wait(lock, [this] { return chunksDone == this->chunkCount; });
+    this->function = nullptr;
+}
+
+void ThreadPool::work()
+{
+    CPU_THREAD_NAME("thread pool worker");
+
+    uint64_t seenGeneration = 0;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;)
+    {
+        loopAvailable.wait(lock, [&] { return stopping || generation != seenGeneration; });
+        if (stopping)
+        {
+            return;
+        }
+
+        seenGeneration = generation;
+        runChunks(lock);
+    }
+}
+
+void ThreadPool::runChunks(std::unique_lock<std::mutex>& lock)
+{
+    while (function && nextChunk < chunkCount)
+    {
+        size_t               chunk = nextChunk++;
+        size_t               begin = chunk * grain;
+        size_t               end   = std::min(count, begin + grain);
+        const ChunkFunction& run   = *function;
+
+        lock.unlock();
+        {
+            CPU_ZONE("parallelFor chunk");
+            run(begin, end, chunk);
+        }
+        lock.lock();
+
+        if (++chunksDone == chunkCount)
+        {
+            loopFinished.notify_one();
+        }
+    }
+}
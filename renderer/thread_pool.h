@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// A fixed set of worker threads for data-parallel loops.
+//
+// parallelFor() splits [0, count) into chunks of at most grain items which the workers and the calling thread take
+// in turn, and returns once every chunk has run. One loop runs at a time; it is meant to be driven from a single
+// thread, e.g. the render thread.
+class ThreadPool {
+  public:
+    // Refers to a callable taking a chunk [begin, end) and the index of the chunk, i.e. begin / grain. Unlike
+    // std::function it never copies the callable, so starting a loop does not allocate; the callable only has to live
+    // until parallelFor() returns.
+    class ChunkFunction {
+      public:
+        template <typename Function>
+            requires(!std::is_same_v<std::remove_cvref_t<Function>, ChunkFunction>)
+        ChunkFunction(const Function& function)
+            : callable(&function)
+            , invoke([](const void* callable, size_t begin, size_t end, size_t chunk)
+                     { (*static_cast<const Function*>(callable))(begin, end, chunk); })
+        {
+        }
+
+        void operator()(size_t begin, size_t end, size_t chunk) const { invoke(callable, begin, end, chunk); }
+
+      private:
+        const void* callable;
+        void (*invoke)(const void* callable, size_t begin, size_t end, size_t chunk);
+    };
+
+    // workerCount excludes the calling thread, so 0 runs every loop inline.
+    explicit ThreadPool(uint32_t workerCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void parallelFor(size_t count, size_t grain, ChunkFunction function);
+
+    // Threads that take part in a loop, the caller included.
+    uint32_t threadCount() const { return static_cast<uint32_t>(workers.size()) + 1; }
+
+  private:
+    void work();
+    // Runs chunks of the current loop until none are left. Called with the lock held; returns with it held.
+    void runChunks(std::unique_lock<std::mutex>& lock);
+
+    std::vector<std::thread> workers;
+
+    std::mutex              mutex;
+    std::condition_variable loopAvailable;
+    std::condition_variable loopFinished;
+    bool                    stopping   = false;
+    uint64_t                generation = 0;
+
+    const ChunkFunction* function   = nullptr;
+    size_t               count      = 0;
+    size_t               grain      = 1;
+    size_t               nextChunk  = 0;
+    size_t               chunkCount = 0;
+    size_t               chunksDone = 0;
+};
@@ -1,13 +1,128 @@
 #version 450
 
+// Specialization constants let one module serve every variant; the driver removes the disabled paths.
+layout(constant_id = 0) const bool USE_VERTEX_COLOR  = true;
+layout(constant_id = 1) const bool USE_TEXTURE       = true;
+layout(constant_id = 2) const bool USE_LIGHTING      = false;
+// Above 1 when every material's texture is bound at once, bindless.
+layout(constant_id = 3) const uint TEXTURE_COUNT     = 1;
+// Set for streamed textures, whose views also cover levels that are not uploaded yet.
+layout(constant_id = 4) const bool CLAMP_TEXTURE_LOD = false;
+
+const float AMBIENT = 0.1;
+
+layout(binding = 0) uniform UniformBufferObject
+{
+    mat4  model;
+    mat4  view;
+    mat4  proj;
+    vec4  frustumPlanes[6];
+    uint  objectCount;
+    // Tiles across, tiles down, depth slices and light count.
+    uvec4 clusterGrid;
+    // Tiles per pixel in x and y, then the slice of view depth d is floor(log(d) * z + w).
+    vec4  clusterScale;
+    // The finest level of the texture's views that may be sampled, with CLAMP_TEXTURE_LOD.
+    float textureMinLod;
+}
+ubo;
+
+// View-space center and radius, then color.
+struct PointLight
+{
+    vec4 positionRadius;
+    vec4 color;
+};
+
+layout(std430, binding = 3) readonly buffer LightBuffer
+{
+    PointLight lights[];
+};
+
+// Per cluster, the offset and count of its lights in lightIndices.
+layout(std430, binding = 4) readonly buffer ClusterBuffer
+{
+    uvec2 clusters[];
+};
+
+layout(std430, binding = 5) readonly buffer LightIndexBuffer
+{
+    uint lightIndices[];
+};
+
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) in vec3 fragViewPosition;
+layout(location = 3) flat in uint fragMaterial;
 
 layout(location = 0) out vec4 outColor;
 
-layout(binding = 1) uniform sampler2D texSampler;
+// Set 1 is the material: its texture, or with bindless textures an array of every material's, indexed by the
+// object's material. Every draw is a single instance, so the index is uniform across the draw and needs no
+// nonuniformEXT.
+layout(set = 1, binding = 0) uniform sampler2D textures[TEXTURE_COUNT];
+
+// Only the lights assigned to this fragment's cluster are visited. Vertices carry no normals, so the face normal comes
+// from the position's screen-space derivatives and is turned towards the camera.
+vec3 clusteredLighting()
+{
+    vec3 normal = normalize(cross(dFdx(fragViewPosition), dFdy(fragViewPosition)));
+    if (dot(normal, fragViewPosition) > 0.0)
+    {
+        normal = -normal;
+    }
+
+    float depth = -fragViewPosition.z;
+    uvec2 tile  = min(uvec2(gl_FragCoord.xy * ubo.clusterScale.xy), ubo.clusterGrid.xy - 1u);
+    float slice = floor(log(depth) * ubo.clusterScale.z + ubo.clusterScale.w);
+    uint  z     = uint(clamp(slice, 0.0, float(ubo.clusterGrid.z - 1u)));
+    uvec2 range = clusters[(z * ubo.clusterGrid.y + tile.y) * ubo.clusterGrid.x + tile.x];
+
+    vec3 lighting = vec3(AMBIENT);
+    for (uint i = 0u; i < range.y; i++)
+    {
+        PointLight light         = lights[lightIndices[range.x + i]];
+        vec3       toLight       = light.positionRadius.xyz - fragViewPosition;
+        float      lightDistance = length(toLight);
+        float      falloff       = clamp(1.0 - lightDistance / light.positionRadius.w, 0.0, 1.0);
+
+        lighting += light.color.rgb * max(dot(normal, toLight / lightDistance), 0.0) * falloff * falloff;
+    }
+    return lighting;
+}
+
+// Scaling both gradients raises the level of detail by the same amount for every filter, anisotropic included, so the
+// clamp keeps the sampler's filtering instead of forcing one level with textureLod.
+vec4 sampleTexture(sampler2D image, vec2 uv)
+{
+    if (!CLAMP_TEXTURE_LOD)
+    {
+        return texture(image, uv);
+    }
+
+    float lod   = textureQueryLod(image, uv).y;
+    float scale = exp2(max(ubo.textureMinLod - lod, 0.0));
+    return textureGrad(image, uv, dFdx(uv) * scale, dFdy(uv) * scale);
+}
 
 void main()
 {
-    outColor = vec4(fragColor * texture(texSampler, fragTexCoord).rgb, 1.0);
+    vec3 color = vec3(1.0);
+
+    if (USE_VERTEX_COLOR)
+    {
+        color *= fragColor;
+    }
+
+    if (USE_TEXTURE)
+    {
+        color *= sampleTexture(textures[TEXTURE_COUNT > 1 ? fragMaterial : 0], fragTexCoord).rgb;
+    }
+
+    if (USE_LIGHTING)
+    {
+        color *= clusteredLighting();
+    }
+
+    outColor = vec4(color, 1.0);
 }
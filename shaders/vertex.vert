@@ -8,16 +8,37 @@ layout(binding = 0) uniform UniformBufferObject
 }
 ubo;
 
+struct ObjectData
+{
+    mat4 model;
+    vec4 boundingSphere;
+    uint indexCount;
+    uint firstIndex;
+    int  vertexOffset;
+    uint material;
+};
+
+// Indexed by gl_InstanceIndex: every draw passes its object index as firstInstance.
+layout(std430, binding = 2) readonly buffer ObjectBuffer
+{
+    ObjectData objects[];
+};
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 fragViewPosition;
+layout(location = 3) flat out uint fragMaterial;
 
 void main()
 {
-    gl_Position  = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
-    fragColor    = inColor;
-    fragTexCoord = inTexCoord;
+    vec4 viewPosition = ubo.view * ubo.model * objects[gl_InstanceIndex].model * vec4(inPosition, 1.0);
+    gl_Position       = ubo.proj * viewPosition;
+    fragColor         = inColor;
+    fragTexCoord      = inTexCoord;
+    fragViewPosition  = viewPosition.xyz;
+    fragMaterial      = objects[gl_InstanceIndex].material;
 }
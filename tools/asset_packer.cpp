@@ -0,0 +1,64 @@
+// Packs files into an asset archive for the viewer's --archive option. Usage: AssetPacker [--store] <archive> <root>
+// <file>...; each file is a path relative to root and is stored under that name. --store skips LZ4 compression.
+#include "../renderer/asset_archive.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        bool                     compress = true;
+        std::vector<std::string> arguments;
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--store")
+            {
+                compress = false;
+            }
+            else
+            {
+                arguments.push_back(arg);
+            }
+        }
+
+        if (arguments.size() < 3)
+        {
+            throw std::invalid_argument("usage: AssetPacker [--store] <archive> <root> <file>...");
+        }
+
+        std::string               root = arguments[1].ends_with('/') ? arguments[1] : arguments[1] + "/";
+        std::vector<ArchiveInput> files;
+        for (size_t i = 2; i < arguments.size(); i++)
+        {
+            files.push_back({arguments[i], root + arguments[i]});
+        }
+
+        uint64_t size       = 0;
+        uint64_t storedSize = 0;
+        for (const ArchiveEntry& entry : writeAssetArchive(arguments[0], files, compress))
+        {
+            std::cout << "[ARCHIVE] \t" << entry.name << ": " << entry.size / 1024 << " KiB"
+                      << (entry.compression == ArchiveCompression::Lz4
+                              ? ", " + std::to_string(entry.storedSize / 1024) + " KiB as LZ4"
+                              : std::string())
+                      << std::endl;
+            size += entry.size;
+            storedSize += entry.storedSize;
+        }
+
+        std::cout << "[ARCHIVE] \t" << files.size() << " files, " << size / 1024 << " KiB stored in "
+                  << storedSize / 1024 << " KiB" << std::endl;
+        return EXIT_SUCCESS;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}